@@ -52,6 +52,7 @@ AssignmentClient::AssignmentClient(int &argc, char **argv) :
     const QString ASSIGNMENT_POOL_OPTION = "pool";
     const QString ASSIGNMENT_WALLET_DESTINATION_ID_OPTION = "wallet";
     const QString CUSTOM_ASSIGNMENT_SERVER_HOSTNAME_OPTION = "a";
+    const QString DATAGRAM_CAPTURE_OPTION = "captureDatagrams";
 
     Assignment::Type requestAssignmentType = Assignment::AllTypes;
 
@@ -78,6 +79,11 @@ AssignmentClient::AssignmentClient(int &argc, char **argv) :
         _requestAssignment.setWalletUUID(walletUUID);
     }
 
+    // check for a file to capture the datagrams of our assignments to, for the datagram-replay tool
+    if (argumentVariantMap.contains(DATAGRAM_CAPTURE_OPTION)) {
+        _datagramCaptureFilename = argumentVariantMap.value(DATAGRAM_CAPTURE_OPTION).toString();
+    }
+
     // create a NodeList as an unassigned client
     NodeList* nodeList = NodeList::createInstance(NodeType::Unassigned);
 
@@ -140,6 +146,11 @@ void AssignmentClient::readPendingDatagrams() {
 
                     qDebug() << "Destination IP for assignment is" << nodeList->getDomainHandler().getIP().toString();
 
+                    if (!_datagramCaptureFilename.isEmpty()) {
+                        nodeList->startDatagramCapture(_datagramCaptureFilename,
+                                                       Assignment::nodeTypeForType(_currentAssignment->getType()));
+                    }
+
                     // start the deployed assignment
                     AssignmentThread* workerThread = new AssignmentThread(_currentAssignment, this);
 
@@ -204,6 +215,9 @@ void AssignmentClient::assignmentCompleted() {
 
     NodeList* nodeList = NodeList::getInstance();
 
+    // a capture covers one assignment, the next one starts the file over
+    nodeList->stopDatagramCapture();
+
     // have us handle incoming NodeList datagrams again
     disconnect(&nodeList->getNodeSocket(), 0, _currentAssignment.data(), 0);
     connect(&nodeList->getNodeSocket(), &QUdpSocket::readyRead, this, &AssignmentClient::readPendingDatagrams);
@@ -216,4 +230,8 @@ void AssignmentClient::assignmentCompleted() {
     nodeList->setOwnerType(NodeType::Unassigned);
     nodeList->reset();
     nodeList->resetNodeInterestSet();
+
+    // an assignment that read the socket on its own thread may have left datagrams behind it, and the socket only
+    // signals readyRead again once it has been read
+    readPendingDatagrams();
 }
@@ -31,6 +31,7 @@ private:
     Assignment _requestAssignment;
     static SharedAssignmentPointer _currentAssignment;
     QString _assignmentServerHostname;
+    QString _datagramCaptureFilename;
 };
 
 #endif // hifi_AssignmentClient_h
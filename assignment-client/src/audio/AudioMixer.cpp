@@ -9,7 +9,6 @@
 //  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
 //
 
-#include <mmintrin.h>
 #include <errno.h>
 #include <fcntl.h>
 #include <fstream>
@@ -45,13 +44,16 @@
 #include <NetworkAccessManager.h>
 #include <NodeList.h>
 #include <Node.h>
+#include <PacketBuffer.h>
 #include <PacketHeaders.h>
 #include <SharedUtil.h>
 #include <StdDev.h>
 #include <UUID.h>
 
+#include "AudioMixKernels.h"
 #include "AudioRingBuffer.h"
 #include "AudioMixerClientData.h"
+#include "AudioMixerWorker.h"
 #include "AvatarAudioStream.h"
 #include "InjectedAudioStream.h"
 
@@ -79,14 +81,26 @@ AudioMixer::AudioMixer(const QByteArray& packet) :
     _numStatFrames(0),
     _sumListeners(0),
     _sumMixes(0),
+    _sumCandidateStreams(0),
+    _sumSourceStreams(0),
     _sourceUnattenuatedZone(NULL),
     _listenerUnattenuatedZone(NULL),
-    _lastSendAudioStreamStatsTime(usecTimestampNow())
+    _lastSendAudioStreamStatsTime(usecTimestampNow()),
+    _frameSourceNodes(),
+    _frameListeningNodes(),
+    _sourceGrid(),
+    _mixWorkers(),
+    _mixThreadPool(),
+    _mixFrameDoneSemaphore(0),
+    _audioPackets()
 {
     
 }
 
 AudioMixer::~AudioMixer() {
+    _mixThreadPool.waitForDone();
+    qDeleteAll(_mixWorkers);
+
     delete _sourceUnattenuatedZone;
     delete _listenerUnattenuatedZone;
 }
@@ -95,8 +109,9 @@ const float ATTENUATION_BEGINS_AT_DISTANCE = 1.0f;
 const float ATTENUATION_AMOUNT_PER_DOUBLING_IN_DISTANCE = 0.18f;
 const float ATTENUATION_EPSILON_DISTANCE = 0.1f;
 
-void AudioMixer::addStreamToMixForListeningNodeWithStream(PositionalAudioStream* streamToAdd,
-                                                          AvatarAudioStream* listeningNodeStream) {
+bool AudioMixer::addStreamToMixForListeningNodeWithStream(PositionalAudioStream* streamToAdd,
+                                                          AvatarAudioStream* listeningNodeStream,
+                                                          float* mixSamples, int16_t* streamSamples) const {
     float bearingRelativeAngleToSource = 0.0f;
     float attenuationCoefficient = 1.0f;
     int numSamplesDelay = 0;
@@ -118,11 +133,9 @@ void AudioMixer::addStreamToMixForListeningNodeWithStream(PositionalAudioStream*
         if (streamToAdd->getLastPopOutputTrailingLoudness() / distanceBetween <= _minAudibilityThreshold) {
             // according to mixer performance we have decided this does not get to be mixed in
             // bail out
-            return;
+            return false;
         }
         
-        ++_sumMixes;
-        
         if (streamToAdd->getListenerUnattenuatedZone()) {
             shouldAttenuate = !streamToAdd->getListenerUnattenuatedZone()->contains(listeningNodeStream->getPosition());
         }
@@ -209,89 +222,109 @@ void AudioMixer::addStreamToMixForListeningNodeWithStream(PositionalAudioStream*
     
     if (!streamToAdd->isStereo() && shouldAttenuate) {
         // this is a mono stream, which means it gets full attenuation and spatialization
+
+        // copy the popped output into a contiguous buffer, preceded by the samples prior to the popped output
+        // that the delayed channel needs at its beginning
+        // TODO: those earlier samples may be inside the last frame written if the ringbuffer is completely full
+        // maybe make AudioRingBuffer have 1 extra frame in its buffer
+        AudioRingBuffer::ConstIterator delayStreamPopOutput = streamPopOutput - numSamplesDelay;
+        delayStreamPopOutput.readSamples(streamSamples, NETWORK_BUFFER_LENGTH_SAMPLES_PER_CHANNEL + numSamplesDelay);
+
+        const int16_t* goodChannelSamples = streamSamples + numSamplesDelay;
+        const int16_t* delayedChannelSamples = streamSamples;
+        float delayedChannelCoefficient = attenuationCoefficient * weakChannelAmplitudeRatio;
         
         // if the bearing relative angle to source is > 0 then the delayed channel is the right one
-        int delayedChannelOffset = (bearingRelativeAngleToSource > 0.0f) ? 1 : 0;
-        int goodChannelOffset = delayedChannelOffset == 0 ? 1 : 0;
-        
-        int16_t correctStreamSample[2], delayStreamSample[2];
-        int delayedChannelIndex = 0;
-        
-        const int SINGLE_STEREO_OFFSET = 2;
-        
-        for (int s = 0; s < NETWORK_BUFFER_LENGTH_SAMPLES_STEREO; s += 4) {
-            
-            // setup the int16_t variables for the two sample sets
-            correctStreamSample[0] = streamPopOutput[s / 2] * attenuationCoefficient;
-            correctStreamSample[1] = streamPopOutput[(s / 2) + 1] * attenuationCoefficient;
-            
-            delayedChannelIndex = s + (numSamplesDelay * 2) + delayedChannelOffset;
-            
-            delayStreamSample[0] = correctStreamSample[0] * weakChannelAmplitudeRatio;
-            delayStreamSample[1] = correctStreamSample[1] * weakChannelAmplitudeRatio;
-            
-            _clientSamples[s + goodChannelOffset] += correctStreamSample[0];
-            _clientSamples[s + goodChannelOffset + SINGLE_STEREO_OFFSET] += correctStreamSample[1];
-            _clientSamples[delayedChannelIndex] += delayStreamSample[0];
-            _clientSamples[delayedChannelIndex + SINGLE_STEREO_OFFSET] += delayStreamSample[1];
-        }
-        
-        if (numSamplesDelay > 0) {
-            // if there was a sample delay for this stream, we need to pull samples prior to the popped output
-            // to stick at the beginning
-            float attenuationAndWeakChannelRatio = attenuationCoefficient * weakChannelAmplitudeRatio;
-            AudioRingBuffer::ConstIterator delayStreamPopOutput = streamPopOutput - numSamplesDelay;
-
-            // TODO: delayStreamPopOutput may be inside the last frame written if the ringbuffer is completely full
-            // maybe make AudioRingBuffer have 1 extra frame in its buffer
-            
-            for (int i = 0; i < numSamplesDelay; i++) {
-                int parentIndex = i * 2;
-                _clientSamples[parentIndex + delayedChannelOffset] += *delayStreamPopOutput * attenuationAndWeakChannelRatio;
-                ++delayStreamPopOutput;
-            }
+        if (bearingRelativeAngleToSource > 0.0f) {
+            AudioMixKernels::mixMonoToStereo(mixSamples, goodChannelSamples, attenuationCoefficient,
+                                             delayedChannelSamples, delayedChannelCoefficient,
+                                             NETWORK_BUFFER_LENGTH_SAMPLES_PER_CHANNEL);
+        } else {
+            AudioMixKernels::mixMonoToStereo(mixSamples, delayedChannelSamples, delayedChannelCoefficient,
+                                             goodChannelSamples, attenuationCoefficient,
+                                             NETWORK_BUFFER_LENGTH_SAMPLES_PER_CHANNEL);
         }
     } else {
-        int stereoDivider = streamToAdd->isStereo() ? 1 : 2;
-
         if (!shouldAttenuate) {
             attenuationCoefficient = 1.0f;
         }
 
-        for (int s = 0; s < NETWORK_BUFFER_LENGTH_SAMPLES_STEREO; s++) {
-            _clientSamples[s] = glm::clamp(_clientSamples[s] + (int)(streamPopOutput[s / stereoDivider] * attenuationCoefficient),
-                                            MIN_SAMPLE_VALUE, MAX_SAMPLE_VALUE);
+        if (streamToAdd->isStereo()) {
+            streamPopOutput.readSamples(streamSamples, NETWORK_BUFFER_LENGTH_SAMPLES_STEREO);
+            AudioMixKernels::mixWithGain(mixSamples, streamSamples, attenuationCoefficient,
+                                         NETWORK_BUFFER_LENGTH_SAMPLES_STEREO);
+        } else {
+            // an unattenuated mono stream goes into both channels as is
+            streamPopOutput.readSamples(streamSamples, NETWORK_BUFFER_LENGTH_SAMPLES_PER_CHANNEL);
+            AudioMixKernels::mixMonoToStereo(mixSamples, streamSamples, attenuationCoefficient,
+                                             streamSamples, attenuationCoefficient,
+                                             NETWORK_BUFFER_LENGTH_SAMPLES_PER_CHANNEL);
         }
     }
+
+    return true;
 }
 
-void AudioMixer::prepareMixForListeningNode(Node* node) {
+int AudioMixer::prepareMixForListeningNode(Node* node, float* mixSamples, int16_t* streamSamples,
+                                           QVector<AudioSourceGrid::Source>& candidateSources) const {
     AvatarAudioStream* nodeAudioStream = ((AudioMixerClientData*) node->getLinkedData())->getAvatarAudioStream();
+    int numMixes = 0;
 
     // zero out the client mix for this node
-    memset(_clientSamples, 0, NETWORK_BUFFER_LENGTH_BYTES_STEREO);
+    memset(mixSamples, 0, NETWORK_BUFFER_LENGTH_SAMPLES_STEREO * sizeof(float));
 
-    // loop through all other nodes that have sufficient audio to mix
-    foreach (const SharedNodePointer& otherNode, NodeList::getInstance()->getNodeHash()) {
-        if (otherNode->getLinkedData()) {
+    // grab the streams from every cell of the source grid that is close enough for something in it to be audible
+    candidateSources.resize(0);
+    _sourceGrid.findCandidateSources(nodeAudioStream->getPosition(), _minAudibilityThreshold, candidateSources);
 
-            AudioMixerClientData* otherNodeClientData = (AudioMixerClientData*) otherNode->getLinkedData();
+    foreach (const AudioSourceGrid::Source& candidateSource, candidateSources) {
+        PositionalAudioStream* otherNodeStream = candidateSource.stream;
 
-            // enumerate the ARBs attached to the otherNode and add all that should be added to mix
+        if (*candidateSource.node != *node || otherNodeStream->shouldLoopbackForNode()) {
+            if (addStreamToMixForListeningNodeWithStream(otherNodeStream, nodeAudioStream, mixSamples, streamSamples)) {
+                ++numMixes;
+            }
+        }
+    }
 
-            const QHash<QUuid, PositionalAudioStream*>& otherNodeAudioStreams = otherNodeClientData->getAudioStreams();
-            QHash<QUuid, PositionalAudioStream*>::ConstIterator i;
-            for (i = otherNodeAudioStreams.begin(); i != otherNodeAudioStreams.constEnd(); i++) {
-                PositionalAudioStream* otherNodeStream = i.value();
+    return numMixes;
+}
 
-                if ((*otherNode != *node || otherNodeStream->shouldLoopbackForNode())
-                    && otherNodeStream->lastPopSucceeded()
-                    && otherNodeStream->getLastPopOutputTrailingLoudness() > 0.0f) {
+void AudioMixer::setupMixWorkers(int numMixThreads) {
+    _mixThreadPool.waitForDone();
+    qDeleteAll(_mixWorkers);
+    _mixWorkers.clear();
 
-                    addStreamToMixForListeningNodeWithStream(otherNodeStream, nodeAudioStream);
-                }
-            }
+    numMixThreads = glm::clamp(numMixThreads, 1, MAX_NUM_MIX_THREADS);
+
+    // with a single mix thread the worker runs directly on the assignment thread and never touches the pool
+    QSemaphore* frameDoneSemaphore = (numMixThreads > 1) ? &_mixFrameDoneSemaphore : NULL;
+
+    for (int i = 0; i < numMixThreads; i++) {
+        _mixWorkers.append(new AudioMixerWorker(this, i, numMixThreads, frameDoneSemaphore));
+    }
+
+    _mixThreadPool.setMaxThreadCount(numMixThreads);
+
+    // keep the mix threads around between frames instead of letting the pool expire them
+    _mixThreadPool.setExpiryTimeout(-1);
+}
+
+void AudioMixer::mixFrame() {
+    if (_mixWorkers.size() == 1) {
+        _mixWorkers[0]->run();
+    } else {
+        foreach (AudioMixerWorker* worker, _mixWorkers) {
+            _mixThreadPool.start(worker);
         }
+
+        // block until every worker has finished its slice of the listeners
+        _mixFrameDoneSemaphore.acquire(_mixWorkers.size());
+    }
+
+    foreach (AudioMixerWorker* worker, _mixWorkers) {
+        _sumMixes += worker->takeNumMixes();
+        _sumCandidateStreams += worker->takeNumCandidateStreams();
     }
 }
 
@@ -300,41 +333,49 @@ void AudioMixer::readPendingDatagrams() {
     HifiSockAddr senderSockAddr;
     NodeList* nodeList = NodeList::getInstance();
     
-    while (readAvailableDatagram(receivedPacket, senderSockAddr)) {
-        if (nodeList->packetVersionAndHashMatch(receivedPacket)) {
-            // pull any new audio data from nodes off of the network stack
-            PacketType mixerPacketType = packetTypeForPacket(receivedPacket);
-            if (mixerPacketType == PacketTypeMicrophoneAudioNoEcho
-                || mixerPacketType == PacketTypeMicrophoneAudioWithEcho
-                || mixerPacketType == PacketTypeInjectAudio
-                || mixerPacketType == PacketTypeSilentAudioFrame
-                || mixerPacketType == PacketTypeAudioStreamStats) {
-                
-                nodeList->findNodeAndUpdateWithDataFromPacket(receivedPacket);
-            } else if (mixerPacketType == PacketTypeMuteEnvironment) {
-                QByteArray packet = receivedPacket;
-                populatePacketHeader(packet, PacketTypeMuteEnvironment);
-                
-                foreach (const SharedNodePointer& node, nodeList->getNodeHash()) {
-                    if (node->getType() == NodeType::Agent && node->getActiveSocket() && node->getLinkedData() && node != nodeList->sendingNodeForPacket(receivedPacket)) {
-                        nodeList->writeDatagram(packet, packet.size(), node);
-                    }
+    while (readVerifiedDatagram(receivedPacket, senderSockAddr)) {
+        // pull any new audio data from nodes off of the network stack
+        // (with the socket read on its own thread these are queued for the frame instead, and never get here)
+        PacketType mixerPacketType = packetTypeForPacket(receivedPacket);
+        if (mixerPacketType == PacketTypeMicrophoneAudioNoEcho
+            || mixerPacketType == PacketTypeMicrophoneAudioWithEcho
+            || mixerPacketType == PacketTypeInjectAudio
+            || mixerPacketType == PacketTypeSilentAudioFrame
+            || mixerPacketType == PacketTypeAudioStreamStats) {
+            
+            nodeList->findNodeAndUpdateWithDataFromPacket(receivedPacket);
+        } else if (mixerPacketType == PacketTypeMuteEnvironment) {
+            QByteArray packet = receivedPacket;
+            populatePacketHeader(packet, PacketTypeMuteEnvironment);
+            
+            foreach (const SharedNodePointer& node, nodeList->getNodeHash()) {
+                if (node->getType() == NodeType::Agent && node->getActiveSocket() && node->getLinkedData() && node != nodeList->sendingNodeForPacket(receivedPacket)) {
+                    nodeList->writeDatagram(packet, packet.size(), node);
                 }
-
-            } else {
-                // let processNodeData handle it.
-                nodeList->processNodeData(senderSockAddr, receivedPacket);
             }
+
+        } else {
+            // let processNodeData handle it.
+            nodeList->processNodeData(senderSockAddr, receivedPacket);
         }
     }
 }
 
+void AudioMixer::parseQueuedAudioPackets() {
+    NodeList* nodeList = NodeList::getInstance();
+    ReceivedPacket receivedPacket;
+    while (_audioPackets.pop(receivedPacket)) {
+        nodeList->findNodeAndUpdateWithDataFromPacket(receivedPacket.packet, receivedPacket.receivedUsecs);
+    }
+}
+
 void AudioMixer::sendStatsPacket() {
     static QJsonObject statsObject;
     
     statsObject["useDynamicJitterBuffers"] = _useDynamicJitterBuffers;
     statsObject["trailing_sleep_percentage"] = _trailingSleepRatio * 100.0f;
     statsObject["performance_throttling_ratio"] = _performanceThrottlingRatio;
+    statsObject["audio_packets_dropped"] = (double) _audioPackets.getDroppedCount();
 
     statsObject["average_listeners_per_frame"] = (float) _sumListeners / (float) _numStatFrames;
     
@@ -344,9 +385,25 @@ void AudioMixer::sendStatsPacket() {
         statsObject["average_mixes_per_listener"] = 0.0;
     }
 
+    if (_numStatFrames > 0) {
+        statsObject["average_source_streams_per_frame"] = (float) _sumSourceStreams / (float) _numStatFrames;
+        statsObject["average_candidate_streams_per_frame"] = (float) _sumCandidateStreams / (float) _numStatFrames;
+        statsObject["average_mixed_streams_per_frame"] = (float) _sumMixes / (float) _numStatFrames;
+    }
+
+    statsObject["mix_threads"] = _mixWorkers.size();
+    foreach (AudioMixerWorker* worker, _mixWorkers) {
+        QString threadPrefix = QString("mix_thread_%1_").arg(worker->getWorkerIndex());
+        statsObject[threadPrefix + "average_usecs_per_frame"] = worker->getAverageMixUsecsPerFrame();
+        statsObject[threadPrefix + "max_usecs_per_frame"] = (double) worker->getMaxMixUsecs();
+        worker->resetMixTimeStats();
+    }
+
     ThreadedAssignment::addPacketStatsAndSendStatsPacket(statsObject);
     _sumListeners = 0;
     _sumMixes = 0;
+    _sumCandidateStreams = 0;
+    _sumSourceStreams = 0;
     _numStatFrames = 0;
 
 
@@ -388,6 +445,16 @@ void AudioMixer::sendStatsPacket() {
 void AudioMixer::run() {
 
     ThreadedAssignment::commonInit(AUDIO_MIXER_LOGGING_TARGET_NAME, NodeType::AudioMixer);
+    enableBatchedDatagramReads();
+
+    PacketReceiver* packetReceiver = createPacketReceiver();
+    if (packetReceiver) {
+        // the audio waits in its queue for the next frame, everything else comes through readPendingDatagrams
+        packetReceiver->routeToQueue(QSet<PacketType>() << PacketTypeMicrophoneAudioNoEcho
+                                     << PacketTypeMicrophoneAudioWithEcho << PacketTypeInjectAudio
+                                     << PacketTypeSilentAudioFrame << PacketTypeAudioStreamStats, &_audioPackets);
+        startPacketReceiver();
+    }
 
     NodeList* nodeList = NodeList::getInstance();
 
@@ -417,6 +484,8 @@ void AudioMixer::run() {
     
     // check the settings object to see if we have anything we can parse out
     const QString AUDIO_GROUP_KEY = "audio";
+
+    int numMixThreads = DEFAULT_NUM_MIX_THREADS;
     
     if (settingsObject.contains(AUDIO_GROUP_KEY)) {
         QJsonObject audioGroupObject = settingsObject[AUDIO_GROUP_KEY].toObject();
@@ -473,15 +542,22 @@ void AudioMixer::run() {
             qDebug() << "Buffers inside this zone will not be attenuated inside a box with center at"
                 << QString("%1, %2, %3").arg(destinationCenter.x).arg(destinationCenter.y).arg(destinationCenter.z);
         }
+
+        const QString MIX_THREADS_JSON_KEY = "E-mix-threads";
+        numMixThreads = audioGroupObject[MIX_THREADS_JSON_KEY].toString().toInt(&ok);
+        if (!ok || numMixThreads < 1) {
+            numMixThreads = DEFAULT_NUM_MIX_THREADS;
+        }
     }
+
+    setupMixWorkers(numMixThreads);
+    qDebug() << "Mixing listeners on" << _mixWorkers.size() << "thread(s) with"
+        << AudioMixKernels::getInstructionSetName() << "mix kernels.";
     
     int nextFrame = 0;
     QElapsedTimer timer;
     timer.start();
     
-    char* clientMixBuffer = new char[NETWORK_BUFFER_LENGTH_BYTES_STEREO + sizeof(quint16)
-                                     + numBytesForPacketHeaderGivenPacketType(PacketTypeMixedAudio)];
-    
     int usecToSleep = BUFFER_SEND_INTERVAL_USECS;
     
     const int TRAILING_AVERAGE_FRAMES = 100;
@@ -547,7 +623,17 @@ void AudioMixer::run() {
             sendAudioStreamStats = true;
         }
 
-        foreach (const SharedNodePointer& node, nodeList->getNodeHash()) {
+        // the streams get everything that arrived up to now before they are popped
+        parseQueuedAudioPackets();
+
+        _frameSourceNodes.clear();
+        _frameListeningNodes.clear();
+        _sourceGrid.clear();
+
+        SharedNodeSnapshot nodeSnapshot = nodeList->getNodeSnapshot();
+        const QVector<SharedNodePointer>& nodes = nodeSnapshot->getNodes();
+        for (int n = 0; n < nodes.size(); n++) {
+            const SharedNodePointer& node = nodes[n];
             if (node->getLinkedData()) {
                 AudioMixerClientData* nodeData = (AudioMixerClientData*)node->getLinkedData();
 
@@ -555,38 +641,71 @@ void AudioMixer::run() {
                 // a pointer to the popped data is stored as a member in InboundAudioStream.
                 // That's how the popped audio data will be read for mixing (but only if the pop was successful)
                 nodeData->checkBuffersBeforeFrameSend(_sourceUnattenuatedZone, _listenerUnattenuatedZone);
-            
+
+                // hold on to the node for the frame, the source grid only keeps raw pointers to it and its streams
+                _frameSourceNodes.append(node);
+
+                const QHash<QUuid, PositionalAudioStream*>& nodeAudioStreams = nodeData->getAudioStreams();
+                QHash<QUuid, PositionalAudioStream*>::ConstIterator i;
+                for (i = nodeAudioStreams.constBegin(); i != nodeAudioStreams.constEnd(); i++) {
+                    PositionalAudioStream* nodeStream = i.value();
+                    if (nodeStream->lastPopSucceeded() && nodeStream->getLastPopOutputTrailingLoudness() > 0.0f) {
+                        _sourceGrid.addSource(nodeStream, node.data());
+                    }
+                }
+
                 if (node->getType() == NodeType::Agent && node->getActiveSocket()
                     && nodeData->getAvatarAudioStream()) {
+                    _frameListeningNodes.append(node);
+                }
+            }
+        }
 
-                    prepareMixForListeningNode(node.data());
+        _sumSourceStreams += _sourceGrid.getNumSources();
 
-                    // pack header
-                    int numBytesPacketHeader = populatePacketHeader(clientMixBuffer, PacketTypeMixedAudio);
-                    char* dataAt = clientMixBuffer + numBytesPacketHeader;
+        // every stream has been popped for this frame, now the listener mixes can be prepared in parallel
+        mixFrame();
 
-                    // pack sequence number
-                    quint16 sequence = nodeData->getOutgoingSequenceNumber();
-                    memcpy(dataAt, &sequence, sizeof(quint16));
-                    dataAt += sizeof(quint16);
+        // the mixes for every listener go out together once they are all packed
+        nodeList->beginDatagramBatch();
 
-                    // pack mixed audio samples
-                    memcpy(dataAt, _clientSamples, NETWORK_BUFFER_LENGTH_BYTES_STEREO);
-                    dataAt += NETWORK_BUFFER_LENGTH_BYTES_STEREO;
+        for (int i = 0; i < _frameListeningNodes.size(); i++) {
+            const SharedNodePointer& node = _frameListeningNodes[i];
+            AudioMixerClientData* nodeData = (AudioMixerClientData*)node->getLinkedData();
 
-                    // send mixed audio packet
-                    nodeList->writeDatagram(clientMixBuffer, dataAt - clientMixBuffer, node);
-                    nodeData->incrementOutgoingMixedAudioSequenceNumber();
+            // listener i was mixed by worker (i % numWorkers) into slot (i / numWorkers) of its output
+            AudioMixerWorker* mixWorker = _mixWorkers[i % _mixWorkers.size()];
 
-                    // send an audio stream stats packet if it's time
-                    if (sendAudioStreamStats) {
-                        nodeData->sendAudioStreamStatsPackets(node);
-                    }
+            // pack header, the buffer goes back to the pool once the datagram is sent
+            SharedPacketBuffer mixPacket = PacketBuffer::create(PacketTypeMixedAudio);
+            char* dataAt = mixPacket->getPayload();
 
-                    ++_sumListeners;
-                }
+            // pack sequence number
+            quint16 sequence = nodeData->getOutgoingSequenceNumber();
+            memcpy(dataAt, &sequence, sizeof(quint16));
+            dataAt += sizeof(quint16);
+
+            // pack mixed audio samples
+            memcpy(dataAt, mixWorker->getMixedSamplesForSlot(i / _mixWorkers.size()), NETWORK_BUFFER_LENGTH_BYTES_STEREO);
+            dataAt += NETWORK_BUFFER_LENGTH_BYTES_STEREO;
+
+            // send mixed audio packet, which is hashed in place
+            mixPacket->setPayloadBytes(dataAt - mixPacket->getPayload());
+            nodeList->writeDatagram(mixPacket, node);
+            nodeData->incrementOutgoingMixedAudioSequenceNumber();
+
+            // send an audio stream stats packet if it's time
+            if (sendAudioStreamStats) {
+                nodeData->sendAudioStreamStatsPackets(node);
             }
+
+            ++_sumListeners;
         }
+
+        nodeList->flushDatagramBatch();
+        
+        // the frame's work runs from popping the streams through sending the mixes
+        frameCompleted(usecTimestampNow() - now);
         
         ++_numStatFrames;
         
@@ -602,6 +721,4 @@ void AudioMixer::run() {
             usleep(usecToSleep);
         }
     }
-    
-    delete[] clientMixBuffer;
 }
@@ -12,17 +12,28 @@
 #ifndef hifi_AudioMixer_h
 #define hifi_AudioMixer_h
 
+#include <QtCore/QSemaphore>
+#include <QtCore/QThreadPool>
+#include <QtCore/QVector>
+
 #include <AABox.h>
 #include <AudioRingBuffer.h>
+#include <PacketReceiver.h>
 #include <ThreadedAssignment.h>
 
+#include "AudioSourceGrid.h"
+
 class PositionalAudioStream;
 class AvatarAudioStream;
+class AudioMixerWorker;
 
 const int SAMPLE_PHASE_DELAY_AT_90 = 20;
 
 const quint64 TOO_LONG_SINCE_LAST_SEND_AUDIO_STREAM_STATS = 1 * USECS_PER_SECOND;
 
+const int DEFAULT_NUM_MIX_THREADS = 1;
+const int MAX_NUM_MIX_THREADS = 16;
+
 /// Handles assignments of type AudioMixer - mixing streams of audio and re-distributing to various clients.
 class AudioMixer : public ThreadedAssignment {
     Q_OBJECT
@@ -42,16 +53,38 @@ public slots:
     static int getMaxFramesOverDesired() { return _maxFramesOverDesired; }
 
 private:
-    /// adds one stream to the mix for a listening node
-    void addStreamToMixForListeningNodeWithStream(PositionalAudioStream* streamToAdd,
-                                                  AvatarAudioStream* listeningNodeStream);
+    friend class AudioMixerWorker;
+
+    /// adds one stream to the mix for a listening node, returns true if the stream was audible enough to be mixed
+    /// streamSamples is scratch space for a contiguous copy of the stream's popped output
+    bool addStreamToMixForListeningNodeWithStream(PositionalAudioStream* streamToAdd,
+                                                  AvatarAudioStream* listeningNodeStream,
+                                                  float* mixSamples, int16_t* streamSamples) const;
     
-    /// prepares and sends a mix to one Node
-    void prepareMixForListeningNode(Node* node);
+    /// prepares the unsaturated mix for one Node in mixSamples, returns the number of streams mixed
+    /// streamSamples and candidateSources are scratch space owned by the caller
+    int prepareMixForListeningNode(Node* node, float* mixSamples, int16_t* streamSamples,
+                                   QVector<AudioSourceGrid::Source>& candidateSources) const;
+
+    /// sets up the workers that the listener mixes are spread across
+    void setupMixWorkers(int numMixThreads);
+
+    /// prepares the mixes for every listener of this frame, on the mix threads if there are more than one
+    void mixFrame();
+
+    /// hands the audio packets the receive thread queued since the last frame to their nodes
+    void parseQueuedAudioPackets();
     
-    // client samples capacity is larger than what will be sent to optimize mixing
-    // we are MMX adding 4 samples at a time so we need client samples to have an extra 4
-    int16_t _clientSamples[NETWORK_BUFFER_LENGTH_SAMPLES_STEREO + (SAMPLE_PHASE_DELAY_AT_90 * 2)];
+    // the nodes with linked data and the listening agents for the frame currently being mixed
+    QVector<SharedNodePointer> _frameSourceNodes;
+    QVector<SharedNodePointer> _frameListeningNodes;
+
+    // the streams popped this frame, indexed by position so listeners only visit the ones they could hear
+    AudioSourceGrid _sourceGrid;
+
+    QVector<AudioMixerWorker*> _mixWorkers;
+    QThreadPool _mixThreadPool;
+    QSemaphore _mixFrameDoneSemaphore;
     
     float _trailingSleepRatio;
     float _minAudibilityThreshold;
@@ -59,6 +92,8 @@ private:
     int _numStatFrames;
     int _sumListeners;
     int _sumMixes;
+    int _sumCandidateStreams;
+    int _sumSourceStreams;
     AABox* _sourceUnattenuatedZone;
     AABox* _listenerUnattenuatedZone;
 
@@ -67,6 +102,9 @@ private:
     static int _maxFramesOverDesired;
 
     quint64 _lastSendAudioStreamStatsTime;
+
+    // the audio and stream stats packets, taken at the start of each frame when the socket is read on its own thread
+    ReceivedPacketRing _audioPackets;
 };
 
 #endif // hifi_AudioMixer_h
@@ -95,6 +95,8 @@ int AudioMixerClientData::parseData(const QByteArray& packet) {
             }
         }
 
+        // the stream's jitter stats go by when the packet came off the socket
+        matchingStream->setPacketReceivedUsecs(getPacketReceivedUsecs());
         return matchingStream->parseData(packet);
     }
     return 0;
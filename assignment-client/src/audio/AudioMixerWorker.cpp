@@ -0,0 +1,91 @@
+//
+//  AudioMixerWorker.cpp
+//  assignment-client/src/audio
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#include <QtCore/QElapsedTimer>
+
+#include <AudioMixKernels.h>
+
+#include "AudioMixerWorker.h"
+
+AudioMixerWorker::AudioMixerWorker(AudioMixer* mixer, int workerIndex, int numWorkers, QSemaphore* frameDoneSemaphore) :
+    _mixer(mixer),
+    _workerIndex(workerIndex),
+    _numWorkers(numWorkers),
+    _frameDoneSemaphore(frameDoneSemaphore),
+    _mixedSamples(),
+    _candidateSources(),
+    _numMixes(0),
+    _numCandidateStreams(0),
+    _numMixFrames(0),
+    _sumMixUsecs(0),
+    _maxMixUsecs(0)
+{
+    // the mixer keeps its workers around for the life of the assignment, the thread pool must not delete them
+    setAutoDelete(false);
+}
+
+void AudioMixerWorker::run() {
+    QElapsedTimer mixTimer;
+    mixTimer.start();
+
+    const QVector<SharedNodePointer>& listeningNodes = _mixer->_frameListeningNodes;
+
+    int numSlots = 0;
+    if (listeningNodes.size() > _workerIndex) {
+        numSlots = ((listeningNodes.size() - _workerIndex - 1) / _numWorkers) + 1;
+    }
+
+    // resize keeps the capacity around, so after the first few frames this does not allocate
+    _mixedSamples.resize(numSlots * NETWORK_BUFFER_LENGTH_SAMPLES_STEREO);
+
+    int slot = 0;
+    for (int i = _workerIndex; i < listeningNodes.size(); i += _numWorkers) {
+        _numMixes += _mixer->prepareMixForListeningNode(listeningNodes[i].data(), _mixSamples, _streamSamples,
+                                                        _candidateSources);
+        _numCandidateStreams += _candidateSources.size();
+
+        AudioMixKernels::saturateMix(_mixedSamples.data() + (slot * NETWORK_BUFFER_LENGTH_SAMPLES_STEREO),
+                                     _mixSamples, NETWORK_BUFFER_LENGTH_SAMPLES_STEREO);
+        ++slot;
+    }
+
+    quint64 mixUsecs = mixTimer.nsecsElapsed() / 1000;
+    _sumMixUsecs += mixUsecs;
+    if (mixUsecs > _maxMixUsecs) {
+        _maxMixUsecs = mixUsecs;
+    }
+    ++_numMixFrames;
+
+    if (_frameDoneSemaphore) {
+        _frameDoneSemaphore->release();
+    }
+}
+
+int AudioMixerWorker::takeNumMixes() {
+    int numMixes = _numMixes;
+    _numMixes = 0;
+    return numMixes;
+}
+
+int AudioMixerWorker::takeNumCandidateStreams() {
+    int numCandidateStreams = _numCandidateStreams;
+    _numCandidateStreams = 0;
+    return numCandidateStreams;
+}
+
+float AudioMixerWorker::getAverageMixUsecsPerFrame() const {
+    return (_numMixFrames > 0) ? (float) _sumMixUsecs / (float) _numMixFrames : 0.0f;
+}
+
+void AudioMixerWorker::resetMixTimeStats() {
+    _numMixFrames = 0;
+    _sumMixUsecs = 0;
+    _maxMixUsecs = 0;
+}
@@ -0,0 +1,68 @@
+//
+//  AudioMixerWorker.h
+//  assignment-client/src/audio
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#ifndef hifi_AudioMixerWorker_h
+#define hifi_AudioMixerWorker_h
+
+#include <QtCore/QRunnable>
+#include <QtCore/QSemaphore>
+#include <QtCore/QVector>
+
+#include <AudioRingBuffer.h>
+
+#include "AudioMixer.h"
+
+/// Prepares the mixes for one slice of the listening nodes in a frame. The AudioMixer owns one worker per mix thread,
+/// worker N handles every listener whose index in the frame's listener list is N modulo the number of workers.
+class AudioMixerWorker : public QRunnable {
+public:
+    AudioMixerWorker(AudioMixer* mixer, int workerIndex, int numWorkers, QSemaphore* frameDoneSemaphore);
+
+    /// mixes every listener in this worker's slice of the current frame
+    void run();
+
+    /// returns the mixed stereo samples for the listener at the given position in this worker's slice
+    const int16_t* getMixedSamplesForSlot(int slot) const { return _mixedSamples.constData() + (slot * NETWORK_BUFFER_LENGTH_SAMPLES_STEREO); }
+
+    int getWorkerIndex() const { return _workerIndex; }
+
+    /// returns the number of streams mixed since the last call, and resets the count
+    int takeNumMixes();
+
+    /// returns the number of streams that survived source grid culling since the last call, and resets the count
+    int takeNumCandidateStreams();
+
+    float getAverageMixUsecsPerFrame() const;
+    quint64 getMaxMixUsecs() const { return _maxMixUsecs; }
+    void resetMixTimeStats();
+
+private:
+    AudioMixer* _mixer;
+    int _workerIndex;
+    int _numWorkers;
+    QSemaphore* _frameDoneSemaphore;
+
+    // streams are accumulated at full precision and saturated to int16 once the whole mix is done
+    float _mixSamples[NETWORK_BUFFER_LENGTH_SAMPLES_STEREO];
+
+    // a contiguous copy of the stream being mixed, with room for the samples before it that a delayed channel needs
+    int16_t _streamSamples[NETWORK_BUFFER_LENGTH_SAMPLES_STEREO + SAMPLE_PHASE_DELAY_AT_90];
+
+    QVector<int16_t> _mixedSamples;
+    QVector<AudioSourceGrid::Source> _candidateSources;
+
+    int _numMixes;
+    int _numCandidateStreams;
+    int _numMixFrames;
+    quint64 _sumMixUsecs;
+    quint64 _maxMixUsecs;
+};
+
+#endif // hifi_AudioMixerWorker_h
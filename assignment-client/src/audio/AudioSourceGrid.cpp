@@ -0,0 +1,126 @@
+//
+//  AudioSourceGrid.cpp
+//  assignment-client/src/audio
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#include <algorithm>
+
+#include <GeometryUtil.h>
+#include <SharedUtil.h>
+
+#include "PositionalAudioStream.h"
+
+#include "AudioSourceGrid.h"
+
+AudioSourceGrid::AudioSourceGrid(float cellSize) :
+    _cellSize(cellSize),
+    _maxLoudness(0.0f),
+    _numSources(0),
+    _numOccupiedCells(0),
+    _cells(),
+    _cellIndices()
+{
+
+}
+
+void AudioSourceGrid::clear() {
+    for (int i = 0; i < _numOccupiedCells; i++) {
+        _cells[i].sources.resize(0);
+    }
+    _cellIndices.clear();
+
+    _maxLoudness = 0.0f;
+    _numSources = 0;
+    _numOccupiedCells = 0;
+}
+
+void AudioSourceGrid::addSource(PositionalAudioStream* stream, Node* node) {
+    glm::ivec3 coordinates = gridCellForPosition(stream->getPosition(), _cellSize);
+    quint64 key = gridCellKey(coordinates);
+
+    int cellIndex = _cellIndices.value(key, -1);
+    if (cellIndex == -1) {
+        cellIndex = _numOccupiedCells++;
+        if (cellIndex == _cells.size()) {
+            _cells.append(Cell());
+        }
+
+        Cell& newCell = _cells[cellIndex];
+        newCell.coordinates = coordinates;
+        newCell.maxLoudness = 0.0f;
+
+        _cellIndices.insert(key, cellIndex);
+    }
+
+    Cell& cell = _cells[cellIndex];
+
+    Source source = { stream, node };
+    cell.sources.append(source);
+
+    float loudness = stream->getLastPopOutputTrailingLoudness();
+    cell.maxLoudness = std::max(cell.maxLoudness, loudness);
+    _maxLoudness = std::max(_maxLoudness, loudness);
+
+    ++_numSources;
+}
+
+bool AudioSourceGrid::cellCouldBeAudible(const Cell& cell, const glm::vec3& listenerPosition,
+                                         float minAudibilityThreshold) const {
+    // the AudioMixer drops a stream when loudness / distance <= threshold, so nothing in this cell can be heard if
+    // the closest point of the cell is at least as far away as its loudest stream reaches
+    glm::vec3 cellMinimum = glm::vec3(cell.coordinates) * _cellSize;
+    glm::vec3 cellMaximum = cellMinimum + glm::vec3(_cellSize);
+    glm::vec3 closestPoint = glm::clamp(listenerPosition, cellMinimum, cellMaximum);
+
+    float audibleDistance = cell.maxLoudness / minAudibilityThreshold;
+    glm::vec3 toClosestPoint = closestPoint - listenerPosition;
+
+    return glm::dot(toClosestPoint, toClosestPoint) < audibleDistance * audibleDistance;
+}
+
+void AudioSourceGrid::appendCellSources(const Cell& cell, QVector<Source>& candidates) const {
+    foreach (const Source& source, cell.sources) {
+        candidates.append(source);
+    }
+}
+
+void AudioSourceGrid::findCandidateSources(const glm::vec3& listenerPosition, float minAudibilityThreshold,
+                                           QVector<Source>& candidates) const {
+    if (_numSources == 0) {
+        return;
+    }
+
+    // nothing can be heard beyond the distance that the loudest stream in the frame reaches
+    float maxAudibleDistance = _maxLoudness / minAudibilityThreshold;
+    float cellsPerAxis = (2.0f * maxAudibleDistance / _cellSize) + 2.0f;
+
+    if (cellsPerAxis * cellsPerAxis * cellsPerAxis < _numOccupiedCells) {
+        // the audible box around the listener covers fewer cells than are occupied, so look them up directly
+        glm::ivec3 minimumCell = gridCellForPosition(listenerPosition - glm::vec3(maxAudibleDistance), _cellSize);
+        glm::ivec3 maximumCell = gridCellForPosition(listenerPosition + glm::vec3(maxAudibleDistance), _cellSize);
+
+        glm::ivec3 coordinates;
+        for (coordinates.x = minimumCell.x; coordinates.x <= maximumCell.x; coordinates.x++) {
+            for (coordinates.y = minimumCell.y; coordinates.y <= maximumCell.y; coordinates.y++) {
+                for (coordinates.z = minimumCell.z; coordinates.z <= maximumCell.z; coordinates.z++) {
+                    int cellIndex = _cellIndices.value(gridCellKey(coordinates), -1);
+                    if (cellIndex != -1 && cellCouldBeAudible(_cells[cellIndex], listenerPosition, minAudibilityThreshold)) {
+                        appendCellSources(_cells[cellIndex], candidates);
+                    }
+                }
+            }
+        }
+    } else {
+        // the sources are spread over fewer cells than the audible box would cover, just check every occupied cell
+        for (int i = 0; i < _numOccupiedCells; i++) {
+            if (cellCouldBeAudible(_cells[i], listenerPosition, minAudibilityThreshold)) {
+                appendCellSources(_cells[i], candidates);
+            }
+        }
+    }
+}
@@ -0,0 +1,69 @@
+//
+//  AudioSourceGrid.h
+//  assignment-client/src/audio
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#ifndef hifi_AudioSourceGrid_h
+#define hifi_AudioSourceGrid_h
+
+#include <glm/glm.hpp>
+
+#include <QtCore/QHash>
+#include <QtCore/QVector>
+
+class Node;
+class PositionalAudioStream;
+
+const float DEFAULT_AUDIO_SOURCE_GRID_CELL_SIZE = 16.0f; // meters
+
+/// A uniform grid over the positions of the audio streams popped in one mixer frame. Each cell remembers the loudest
+/// stream inside of it so that a listener can skip every cell that is too far away for any of its streams to pass the
+/// mixer's loudness / distance audibility test.
+class AudioSourceGrid {
+public:
+    struct Source {
+        PositionalAudioStream* stream;
+        Node* node;
+    };
+
+    AudioSourceGrid(float cellSize = DEFAULT_AUDIO_SOURCE_GRID_CELL_SIZE);
+
+    /// empties the grid, keeping the cells allocated so the next frame can re-use them
+    void clear();
+
+    /// adds a stream that was successfully popped this frame and belongs to the given node
+    void addSource(PositionalAudioStream* stream, Node* node);
+
+    /// appends to candidates every source that could be audible at the listener position with the given threshold
+    void findCandidateSources(const glm::vec3& listenerPosition, float minAudibilityThreshold,
+                              QVector<Source>& candidates) const;
+
+    int getNumSources() const { return _numSources; }
+    int getNumOccupiedCells() const { return _numOccupiedCells; }
+
+private:
+    struct Cell {
+        glm::ivec3 coordinates;
+        float maxLoudness;
+        QVector<Source> sources;
+    };
+
+    bool cellCouldBeAudible(const Cell& cell, const glm::vec3& listenerPosition, float minAudibilityThreshold) const;
+    void appendCellSources(const Cell& cell, QVector<Source>& candidates) const;
+
+    float _cellSize;
+    float _maxLoudness;
+    int _numSources;
+    int _numOccupiedCells;
+
+    // cells are never freed between frames, only the first _numOccupiedCells are in use
+    QVector<Cell> _cells;
+    QHash<quint64, int> _cellIndices;
+};
+
+#endif // hifi_AudioSourceGrid_h
@@ -0,0 +1,91 @@
+//
+//  AvatarInterestGrid.cpp
+//  assignment-client/src/avatars
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#include <GeometryUtil.h>
+
+#include "AvatarInterestGrid.h"
+
+AvatarInterestGrid::AvatarInterestGrid(float cellSize) :
+    _cellSize(cellSize),
+    _numOccupiedCells(0),
+    _cells(),
+    _cellIndices()
+{
+
+}
+
+void AvatarInterestGrid::clear() {
+    for (int i = 0; i < _numOccupiedCells; i++) {
+        _cells[i].nodes.resize(0);
+    }
+    _cellIndices.clear();
+    _numOccupiedCells = 0;
+}
+
+void AvatarInterestGrid::addAvatar(Node* node, const glm::vec3& position) {
+    glm::ivec3 coordinates = gridCellForPosition(position, _cellSize);
+    quint64 key = gridCellKey(coordinates);
+
+    int cellIndex = _cellIndices.value(key, -1);
+    if (cellIndex == -1) {
+        cellIndex = _numOccupiedCells++;
+        if (cellIndex == _cells.size()) {
+            _cells.append(Cell());
+        }
+        _cells[cellIndex].coordinates = coordinates;
+        _cellIndices.insert(key, cellIndex);
+    }
+
+    _cells[cellIndex].nodes.append(node);
+}
+
+void AvatarInterestGrid::findCellsInRange(const glm::vec3& position, float distance, QVector<int>& cellIndices) const {
+    glm::ivec3 minimumCell = gridCellForPosition(position - glm::vec3(distance), _cellSize);
+    glm::ivec3 maximumCell = gridCellForPosition(position + glm::vec3(distance), _cellSize);
+    glm::ivec3 cellsPerAxis = maximumCell - minimumCell + glm::ivec3(1);
+
+    if ((qint64) cellsPerAxis.x * cellsPerAxis.y * cellsPerAxis.z < _numOccupiedCells) {
+        // the box around the position covers fewer cells than are occupied, so look them up directly
+        glm::ivec3 coordinates;
+        for (coordinates.x = minimumCell.x; coordinates.x <= maximumCell.x; coordinates.x++) {
+            for (coordinates.y = minimumCell.y; coordinates.y <= maximumCell.y; coordinates.y++) {
+                for (coordinates.z = minimumCell.z; coordinates.z <= maximumCell.z; coordinates.z++) {
+                    int cellIndex = _cellIndices.value(gridCellKey(coordinates), -1);
+                    if (cellIndex != -1) {
+                        cellIndices.append(cellIndex);
+                    }
+                }
+            }
+        }
+    } else {
+        // the avatars are spread over fewer cells than the box would cover, just check every occupied cell
+        for (int i = 0; i < _numOccupiedCells; i++) {
+            if (glm::all(glm::greaterThanEqual(_cells[i].coordinates, minimumCell))
+                && glm::all(glm::lessThanEqual(_cells[i].coordinates, maximumCell))) {
+                cellIndices.append(i);
+            }
+        }
+    }
+}
+
+void AvatarInterestGrid::getDistanceRange(const Cell& cell, const glm::vec3& position,
+                                          float& closest, float& farthest) const {
+    glm::vec3 cellMinimum = glm::vec3(cell.coordinates) * _cellSize;
+    glm::vec3 cellMaximum = cellMinimum + glm::vec3(_cellSize);
+
+    closest = glm::length(glm::clamp(position, cellMinimum, cellMaximum) - position);
+
+    // the farthest corner is on the opposite side of the cell's center on every axis
+    glm::vec3 cellCenter = cellMinimum + glm::vec3(_cellSize * 0.5f);
+    glm::vec3 farthestCorner(position.x < cellCenter.x ? cellMaximum.x : cellMinimum.x,
+                             position.y < cellCenter.y ? cellMaximum.y : cellMinimum.y,
+                             position.z < cellCenter.z ? cellMaximum.z : cellMinimum.z);
+    farthest = glm::length(farthestCorner - position);
+}
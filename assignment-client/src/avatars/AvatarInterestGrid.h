@@ -0,0 +1,57 @@
+//
+//  AvatarInterestGrid.h
+//  assignment-client/src/avatars
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#ifndef hifi_AvatarInterestGrid_h
+#define hifi_AvatarInterestGrid_h
+
+#include <glm/glm.hpp>
+
+#include <QtCore/QHash>
+#include <QtCore/QVector>
+
+class Node;
+
+const float DEFAULT_AVATAR_INTEREST_GRID_CELL_SIZE = 8.0f; // meters
+
+/// A uniform grid over the avatars encoded in one broadcast frame. Lets the AvatarMixer work out the update rate tier
+/// for a whole cell of avatars at once when the cell sits entirely inside one of the tier's distance bands.
+class AvatarInterestGrid {
+public:
+    struct Cell {
+        glm::ivec3 coordinates;
+        QVector<Node*> nodes;
+    };
+
+    AvatarInterestGrid(float cellSize = DEFAULT_AVATAR_INTEREST_GRID_CELL_SIZE);
+
+    /// empties the grid, keeping the cells allocated so the next frame can re-use them
+    void clear();
+
+    void addAvatar(Node* node, const glm::vec3& position);
+
+    /// appends to cellIndices the index of every occupied cell that has a point within distance of the position
+    void findCellsInRange(const glm::vec3& position, float distance, QVector<int>& cellIndices) const;
+
+    int getNumOccupiedCells() const { return _numOccupiedCells; }
+    const Cell& getCell(int index) const { return _cells[index]; }
+
+    /// the distances from the given position to the closest and farthest points of the cell
+    void getDistanceRange(const Cell& cell, const glm::vec3& position, float& closest, float& farthest) const;
+
+private:
+    float _cellSize;
+    int _numOccupiedCells;
+
+    // cells are never freed between frames, only the first _numOccupiedCells are in use
+    QVector<Cell> _cells;
+    QHash<quint64, int> _cellIndices;
+};
+
+#endif // hifi_AvatarInterestGrid_h
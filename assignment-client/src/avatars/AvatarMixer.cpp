@@ -9,8 +9,12 @@
 //  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
 //
 
+#include <algorithm>
+
 #include <QtCore/QCoreApplication>
 #include <QtCore/QDateTime>
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QEventLoop>
 #include <QtCore/QJsonObject>
 #include <QtCore/QTimer>
 #include <QtCore/QThread>
@@ -38,7 +42,20 @@ AvatarMixer::AvatarMixer(const QByteArray& packet) :
     _sumListeners(0),
     _numStatFrames(0),
     _sumBillboardPackets(0),
-    _sumIdentityPackets(0)
+    _sumIdentityPackets(0),
+    _sumEncodeUsecs(0),
+    _sumBytesEncoded(0),
+    _sumBytesSent(0),
+    _sumAvatarsSent(0),
+    _sumAvatarsDeferred(0),
+    _sumKeyframesSent(0),
+    _broadcastFrame(0),
+    _listenerBytesPerSecond(DEFAULT_LISTENER_KILOBYTES_PER_SECOND * BYTES_PER_KILOBYTE),
+    _interestGrid(),
+    _listenerCells(),
+    _sendCandidates(),
+    _avatarRecord(),
+    _avatarDataPackets()
 {
     // make sure we hear about node kills so we can tell the other nodes
     connect(NodeList::getInstance(), &NodeList::nodeKilled, this, &AvatarMixer::nodeKilled);
@@ -57,10 +74,48 @@ void attachAvatarDataToNode(Node* newNode) {
 
 const float BILLBOARD_AND_IDENTITY_SEND_PROBABILITY = 1.0f / 300.0f;
 
+const int AVATAR_BROADCAST_FRAMES_PER_SECOND = 1000 / AVATAR_DATA_SEND_INTERVAL_MSECS;
+
+// avatars closer than this are sent every frame, the interval then doubles each time the distance doubles
+const float FULL_RATE_DISTANCE = 4.0f;
+
+// unused budget is kept around for this many frames, to absorb the odd burst of identity and billboard packets
+const int MAX_BANDWIDTH_BUDGET_CARRY_OVER_FRAMES = 4;
+
+const int STALE_SOURCE_CHECK_INTERVAL_FRAMES = 5 * AVATAR_BROADCAST_FRAMES_PER_SECOND;
+
+// every listener gets a fresh keyframe of each avatar at least this often, which bounds how long a lost keyframe
+// leaves the deltas that follow it unusable
+const int AVATAR_KEYFRAME_INTERVAL_FRAMES = 2 * AVATAR_BROADCAST_FRAMES_PER_SECOND;
+
+int AvatarMixer::updateIntervalForDistance(float distance) {
+    int updateInterval = 1;
+    float tierDistance = FULL_RATE_DISTANCE;
+    
+    while (distance > tierDistance && updateInterval < MAX_AVATAR_UPDATE_INTERVAL) {
+        updateInterval *= 2;
+        tierDistance *= 2.0f;
+    }
+    
+    return updateInterval;
+}
+
+bool AvatarMixer::isMoreOverdue(const AvatarSendCandidate& first, const AvatarSendCandidate& second) {
+    return first.overdueRatio > second.overdueRatio;
+}
+
+// Each listener gets every other avatar at a rate picked by distance: every frame nearby, then every 2nd, 4th and
+// 8th frame further out. The avatars that are due are sent most overdue first until the listener's bandwidth budget
+// for the frame runs out, the rest stay due and move up for the next frame. Each avatar goes out as a delta against
+// the last keyframe the listener was sent of it, so an idle avatar costs little more than its UUID.
 // NOTE: some additional optimizations to consider.
 //    1) use the view frustum to cull those avatars that are out of view. Since avatar data doesn't need to be present
 //       if the avatar is not in view or in the keyhole.
 void AvatarMixer::broadcastAvatarData() {
+    quint64 frameStart = usecTimestampNow();
+    
+    // every avatar is sent as it was at the start of the frame
+    parseQueuedAvatarData();
     
     int idleTime = QDateTime::currentMSecsSinceEpoch() - _lastFrameTimestamp;
     
@@ -118,99 +173,187 @@ void AvatarMixer::broadcastAvatarData() {
     int numPacketHeaderBytes = populatePacketHeader(mixedAvatarByteArray, PacketTypeBulkAvatarData);
     
     NodeList* nodeList = NodeList::getInstance();
+    SharedNodeSnapshot nodeSnapshot = nodeList->getNodeSnapshot();
+    const QVector<SharedNodePointer>& nodes = nodeSnapshot->getNodes();
     
     AvatarMixerClientData* nodeData = NULL;
     AvatarMixerClientData* otherNodeData = NULL;
     
-    foreach (const SharedNodePointer& node, nodeList->getNodeHash()) {
+    // encode every avatar once for this frame, the listener loop below only copies the encoded data into packets
+    QElapsedTimer encodeTimer;
+    encodeTimer.start();
+    
+    for (int n = 0; n < nodes.size(); n++) {
+        const SharedNodePointer& node = nodes[n];
+        if ((nodeData = reinterpret_cast<AvatarMixerClientData*>(node->getLinkedData()))) {
+            if (nodeData->getMutex().tryLock()) {
+                _sumBytesEncoded += nodeData->encodeForBroadcast(node->getUUID());
+                nodeData->getMutex().unlock();
+            } else {
+                // the avatar is being updated right now, it will be sent out again next frame
+                nodeData->clearEncodedAvatar();
+            }
+        }
+    }
+    
+    _sumEncodeUsecs += encodeTimer.nsecsElapsed() / 1000;
+    
+    // bucket the encoded avatars by position, so the update tier of a whole cell can often be decided at once
+    _interestGrid.clear();
+    for (int n = 0; n < nodes.size(); n++) {
+        const SharedNodePointer& node = nodes[n];
+        if ((nodeData = reinterpret_cast<AvatarMixerClientData*>(node->getLinkedData())) && nodeData->hasEncodedAvatar()) {
+            _interestGrid.addAvatar(node.data(), nodeData->getEncodedPosition());
+        }
+    }
+    
+    ++_broadcastFrame;
+    
+    // when we're struggling the tier distances shrink, which moves avatars into the slower tiers
+    const float MIN_TIER_DISTANCE_SCALE = 1.0f / MAX_AVATAR_UPDATE_INTERVAL;
+    float tierDistanceScale = std::max(1.0f - _performanceThrottlingRatio, MIN_TIER_DISTANCE_SCALE);
+    float slowestTierDistance = FULL_RATE_DISTANCE * (MAX_AVATAR_UPDATE_INTERVAL / 2) * tierDistanceScale;
+    
+    int frameBudgetBytes = _listenerBytesPerSecond / AVATAR_BROADCAST_FRAMES_PER_SECOND;
+    int maxBudgetBytes = frameBudgetBytes * MAX_BANDWIDTH_BUDGET_CARRY_OVER_FRAMES;
+    
+    bool shouldRemoveStaleSources = (_broadcastFrame % STALE_SOURCE_CHECK_INTERVAL_FRAMES) == 0;
+    
+    nodeList->beginDatagramBatch();
+    
+    for (int n = 0; n < nodes.size(); n++) {
+        const SharedNodePointer& node = nodes[n];
         if (node->getLinkedData() && node->getType() == NodeType::Agent && node->getActiveSocket()
-            && (nodeData = reinterpret_cast<AvatarMixerClientData*>(node->getLinkedData()))->getMutex().tryLock()) {
+            && (nodeData = reinterpret_cast<AvatarMixerClientData*>(node->getLinkedData()))->hasEncodedAvatar()) {
             ++_sumListeners;
             
             // reset packet pointers for this node
             mixedAvatarByteArray.resize(numPacketHeaderBytes);
             
-            AvatarData& avatar = nodeData->getAvatar();
-            glm::vec3 myPosition = avatar.getPosition();
+            glm::vec3 myPosition = nodeData->getEncodedPosition();
             
-            // this is an AGENT we have received head data from
-            // send back a packet with other active node data to this node
-            foreach (const SharedNodePointer& otherNode, nodeList->getNodeHash()) {
-                if (otherNode->getLinkedData() && otherNode->getUUID() != node->getUUID()
-                    && (otherNodeData = reinterpret_cast<AvatarMixerClientData*>(otherNode->getLinkedData()))->getMutex().tryLock()) {
-                    
-                    AvatarMixerClientData* otherNodeData = reinterpret_cast<AvatarMixerClientData*>(otherNode->getLinkedData());
-                    AvatarData& otherAvatar = otherNodeData->getAvatar();
-                    glm::vec3 otherPosition = otherAvatar.getPosition();
+            // if the receiving avatar has just connected make sure we send out the mesh and billboard
+            // for the avatars it hears about this frame (assuming they exist)
+            bool forceSend = !nodeData->checkAndSetHasReceivedFirstPackets();
             
-                    float distanceToAvatar = glm::length(myPosition - otherPosition);
-                    //  The full rate distance is the distance at which EVERY update will be sent for this avatar
-                    //  at a distance of twice the full rate distance, there will be a 50% chance of sending this avatar's update
-                    const float FULL_RATE_DISTANCE = 2.f;
+            nodeData->addToBandwidthBudget(frameBudgetBytes, maxBudgetBytes);
+            
+            // every avatar beyond the last tier distance is in the slowest tier, so the cells past the listener's
+            // neighborhood only need to be looked at once per slowest tier interval, on a frame spread by listener
+            _listenerCells.resize(0);
+            if ((_broadcastFrame + qHash(node->getUUID())) % MAX_AVATAR_UPDATE_INTERVAL == 0) {
+                for (int c = 0; c < _interestGrid.getNumOccupiedCells(); c++) {
+                    _listenerCells.append(c);
+                }
+            } else {
+                _interestGrid.findCellsInRange(myPosition, slowestTierDistance, _listenerCells);
+            }
+            
+            // gather every avatar whose tier says it is due to be sent to this listener
+            _sendCandidates.resize(0);
+            
+            foreach (int c, _listenerCells) {
+                const AvatarInterestGrid::Cell& cell = _interestGrid.getCell(c);
+                
+                float closestDistance, farthestDistance;
+                _interestGrid.getDistanceRange(cell, myPosition, closestDistance, farthestDistance);
+                
+                int cellUpdateInterval = updateIntervalForDistance(closestDistance / tierDistanceScale);
+                bool isCellInOneTier = cellUpdateInterval == updateIntervalForDistance(farthestDistance / tierDistanceScale);
+                
+                foreach (Node* otherNode, cell.nodes) {
+                    if (otherNode == node.data()) {
+                        continue;
+                    }
                     
-                    //  Decide whether to send this avatar's data based on it's distance from us
-                    if ((_performanceThrottlingRatio == 0 || randFloat() < (1.0f - _performanceThrottlingRatio))
-                        && (distanceToAvatar == 0.f || randFloat() < FULL_RATE_DISTANCE / distanceToAvatar)) {
-                        QByteArray avatarByteArray;
-                        avatarByteArray.append(otherNode->getUUID().toRfc4122());
-                        avatarByteArray.append(otherAvatar.toByteArray());
-                        
-                        if (avatarByteArray.size() + mixedAvatarByteArray.size() > MAX_PACKET_SIZE) {
-                            nodeList->writeDatagram(mixedAvatarByteArray, node);
-                            
-                            // reset the packet
-                            mixedAvatarByteArray.resize(numPacketHeaderBytes);
-                        }
-                        
-                        // copy the avatar into the mixedAvatarByteArray packet
-                        mixedAvatarByteArray.append(avatarByteArray);
-                        
-                        // if the receiving avatar has just connected make sure we send out the mesh and billboard
-                        // for this avatar (assuming they exist)
-                        bool forceSend = !nodeData->checkAndSetHasReceivedFirstPackets();
-                        
-                        // we will also force a send of billboard or identity packet
-                        // if either has changed in the last frame
-                        
-                        if (otherNodeData->getBillboardChangeTimestamp() > 0
-                            && (forceSend
-                                || otherNodeData->getBillboardChangeTimestamp() > _lastFrameTimestamp
-                                || randFloat() < BILLBOARD_AND_IDENTITY_SEND_PROBABILITY)) {
-                            QByteArray billboardPacket = byteArrayWithPopulatedHeader(PacketTypeAvatarBillboard);
-                            billboardPacket.append(otherNode->getUUID().toRfc4122());
-                            billboardPacket.append(otherNodeData->getAvatar().getBillboard());
-                            nodeList->writeDatagram(billboardPacket, node);
-                            
-                            ++_sumBillboardPackets;
-                        }
-                        
-                        if (otherNodeData->getIdentityChangeTimestamp() > 0
-                            && (forceSend
-                                || otherNodeData->getIdentityChangeTimestamp() > _lastFrameTimestamp
-                                || randFloat() < BILLBOARD_AND_IDENTITY_SEND_PROBABILITY)) {
-                                
-                            QByteArray identityPacket = byteArrayWithPopulatedHeader(PacketTypeAvatarIdentity);
-                            
-                            QByteArray individualData = otherNodeData->getAvatar().identityByteArray();
-                            individualData.replace(0, NUM_BYTES_RFC4122_UUID, otherNode->getUUID().toRfc4122());
-                            identityPacket.append(individualData);
-                            
-                            nodeList->writeDatagram(identityPacket, node);
-                                
-                            ++_sumIdentityPackets;
-                        }
+                    otherNodeData = reinterpret_cast<AvatarMixerClientData*>(otherNode->getLinkedData());
+                    
+                    int updateInterval = cellUpdateInterval;
+                    if (!isCellInOneTier) {
+                        float distanceToAvatar = glm::length(myPosition - otherNodeData->getEncodedPosition());
+                        updateInterval = updateIntervalForDistance(distanceToAvatar / tierDistanceScale);
+                    }
+                    
+                    quint64 framesSinceSent = _broadcastFrame - nodeData->getLastSentFrame(otherNode->getUUID());
+                    if (framesSinceSent >= (quint64) updateInterval) {
+                        AvatarSendCandidate candidate = { otherNode, otherNodeData, (float) framesSinceSent / updateInterval };
+                        _sendCandidates.append(candidate);
                     }
+                }
+            }
+            
+            // the most overdue avatars go first, so whatever the budget can't fit this frame moves up for the next one
+            std::sort(_sendCandidates.begin(), _sendCandidates.end(), isMoreOverdue);
+            
+            int numCandidatesSent = 0;
+            foreach (const AvatarSendCandidate& candidate, _sendCandidates) {
+                if (nodeData->getBandwidthBudget() <= 0) {
+                    break;
+                }
                 
-                    otherNodeData->getMutex().unlock();
+                otherNodeData = candidate.nodeData;
+                
+                if (nodeData->encodeAvatarRecord(_avatarRecord, candidate.node->getUUID(), *otherNodeData,
+                                                 _broadcastFrame, AVATAR_KEYFRAME_INTERVAL_FRAMES)) {
+                    ++_sumKeyframesSent;
+                }
+                
+                if (_avatarRecord.size() + mixedAvatarByteArray.size() > MAX_PACKET_SIZE) {
+                    nodeList->writeDatagram(mixedAvatarByteArray, node);
+                    
+                    // reset the packet
+                    mixedAvatarByteArray.resize(numPacketHeaderBytes);
+                }
+                
+                // copy the avatar into the mixedAvatarByteArray packet
+                mixedAvatarByteArray.append(_avatarRecord);
+                nodeData->spendBandwidthBudget(_avatarRecord.size());
+                _sumBytesSent += _avatarRecord.size();
+                ++numCandidatesSent;
+                
+                // we will also force a send of billboard or identity packet
+                // if either has changed in the last frame
+                
+                if (otherNodeData->getBillboardChangeTimestamp() > 0
+                    && (forceSend
+                        || otherNodeData->getBillboardChangeTimestamp() > _lastFrameTimestamp
+                        || randFloat() < BILLBOARD_AND_IDENTITY_SEND_PROBABILITY)) {
+                    const QByteArray& billboardPacket = otherNodeData->getEncodedBillboardPacket();
+                    nodeList->writeDatagram(billboardPacket, node);
+                    nodeData->spendBandwidthBudget(billboardPacket.size());
+                    _sumBytesSent += billboardPacket.size();
+                    
+                    ++_sumBillboardPackets;
+                }
+                
+                if (otherNodeData->getIdentityChangeTimestamp() > 0
+                    && (forceSend
+                        || otherNodeData->getIdentityChangeTimestamp() > _lastFrameTimestamp
+                        || randFloat() < BILLBOARD_AND_IDENTITY_SEND_PROBABILITY)) {
+                    const QByteArray& identityPacket = otherNodeData->getEncodedIdentityPacket();
+                    nodeList->writeDatagram(identityPacket, node);
+                    nodeData->spendBandwidthBudget(identityPacket.size());
+                    _sumBytesSent += identityPacket.size();
+                    
+                    ++_sumIdentityPackets;
                 }
             }
             
+            _sumAvatarsSent += numCandidatesSent;
+            _sumAvatarsDeferred += _sendCandidates.size() - numCandidatesSent;
+            
             nodeList->writeDatagram(mixedAvatarByteArray, node);
             
-            nodeData->getMutex().unlock();
+            if (shouldRemoveStaleSources) {
+                nodeData->removeSourcesNotSentSince(_broadcastFrame - STALE_SOURCE_CHECK_INTERVAL_FRAMES);
+            }
         }
     }
     
+    nodeList->flushDatagramBatch();
+    
+    frameCompleted(usecTimestampNow() - frameStart);
+    
     _lastFrameTimestamp = QDateTime::currentMSecsSinceEpoch();
 }
 
@@ -233,61 +376,68 @@ void AvatarMixer::readPendingDatagrams() {
     
     NodeList* nodeList = NodeList::getInstance();
     
-    while (readAvailableDatagram(receivedPacket, senderSockAddr)) {
-        if (nodeList->packetVersionAndHashMatch(receivedPacket)) {
-            switch (packetTypeForPacket(receivedPacket)) {
-                case PacketTypeAvatarData: {
-                    nodeList->findNodeAndUpdateWithDataFromPacket(receivedPacket);
-                    break;
-                }
-                case PacketTypeAvatarIdentity: {
-                    
-                    // check if we have a matching node in our list
-                    SharedNodePointer avatarNode = nodeList->sendingNodeForPacket(receivedPacket);
+    while (readVerifiedDatagram(receivedPacket, senderSockAddr)) {
+        switch (packetTypeForPacket(receivedPacket)) {
+            case PacketTypeAvatarData: {
+                // only here when the socket isn't read on its own thread
+                nodeList->findNodeAndUpdateWithDataFromPacket(receivedPacket);
+                break;
+            }
+            case PacketTypeAvatarIdentity: {
+                
+                // check if we have a matching node in our list
+                SharedNodePointer avatarNode = nodeList->sendingNodeForPacket(receivedPacket);
+                
+                if (avatarNode && avatarNode->getLinkedData()) {
+                    AvatarMixerClientData* nodeData = reinterpret_cast<AvatarMixerClientData*>(avatarNode->getLinkedData());
+                    AvatarData& avatar = nodeData->getAvatar();
                     
-                    if (avatarNode && avatarNode->getLinkedData()) {
-                        AvatarMixerClientData* nodeData = reinterpret_cast<AvatarMixerClientData*>(avatarNode->getLinkedData());
-                        AvatarData& avatar = nodeData->getAvatar();
-                        
-                        // parse the identity packet and update the change timestamp if appropriate
-                        if (avatar.hasIdentityChangedAfterParsing(receivedPacket)) {
-                            QMutexLocker nodeDataLocker(&nodeData->getMutex());
-                            nodeData->setIdentityChangeTimestamp(QDateTime::currentMSecsSinceEpoch());
-                        }
+                    // parse the identity packet and update the change timestamp if appropriate
+                    if (avatar.hasIdentityChangedAfterParsing(receivedPacket)) {
+                        QMutexLocker nodeDataLocker(&nodeData->getMutex());
+                        nodeData->setIdentityChangeTimestamp(QDateTime::currentMSecsSinceEpoch());
                     }
-                    break;
                 }
-                case PacketTypeAvatarBillboard: {
-                    
-                    // check if we have a matching node in our list
-                    SharedNodePointer avatarNode = nodeList->sendingNodeForPacket(receivedPacket);
+                break;
+            }
+            case PacketTypeAvatarBillboard: {
+                
+                // check if we have a matching node in our list
+                SharedNodePointer avatarNode = nodeList->sendingNodeForPacket(receivedPacket);
+                
+                if (avatarNode && avatarNode->getLinkedData()) {
+                    AvatarMixerClientData* nodeData = static_cast<AvatarMixerClientData*>(avatarNode->getLinkedData());
+                    AvatarData& avatar = nodeData->getAvatar();
                     
-                    if (avatarNode && avatarNode->getLinkedData()) {
-                        AvatarMixerClientData* nodeData = static_cast<AvatarMixerClientData*>(avatarNode->getLinkedData());
-                        AvatarData& avatar = nodeData->getAvatar();
-                        
-                        // parse the billboard packet and update the change timestamp if appropriate
-                        if (avatar.hasBillboardChangedAfterParsing(receivedPacket)) {
-                            QMutexLocker nodeDataLocker(&nodeData->getMutex());
-                            nodeData->setBillboardChangeTimestamp(QDateTime::currentMSecsSinceEpoch());
-                        }
-                        
+                    // parse the billboard packet and update the change timestamp if appropriate
+                    if (avatar.hasBillboardChangedAfterParsing(receivedPacket)) {
+                        QMutexLocker nodeDataLocker(&nodeData->getMutex());
+                        nodeData->setBillboardChangeTimestamp(QDateTime::currentMSecsSinceEpoch());
                     }
-                    break;
-                }
-                case PacketTypeKillAvatar: {
-                    nodeList->processKillNode(receivedPacket);
-                    break;
+                    
                 }
-                default:
-                    // hand this off to the NodeList
-                    nodeList->processNodeData(senderSockAddr, receivedPacket);
-                    break;
+                break;
+            }
+            case PacketTypeKillAvatar: {
+                nodeList->processKillNode(receivedPacket);
+                break;
             }
+            default:
+                // hand this off to the NodeList
+                nodeList->processNodeData(senderSockAddr, receivedPacket);
+                break;
         }
     }
 }
 
+void AvatarMixer::parseQueuedAvatarData() {
+    NodeList* nodeList = NodeList::getInstance();
+    ReceivedPacket receivedPacket;
+    while (_avatarDataPackets.pop(receivedPacket)) {
+        nodeList->findNodeAndUpdateWithDataFromPacket(receivedPacket.packet, receivedPacket.receivedUsecs);
+    }
+}
+
 void AvatarMixer::sendStatsPacket() {
     QJsonObject statsObject;
     statsObject["average_listeners_last_second"] = (float) _sumListeners / (float) _numStatFrames;
@@ -295,25 +445,83 @@ void AvatarMixer::sendStatsPacket() {
     statsObject["average_billboard_packets_per_frame"] = (float) _sumBillboardPackets / (float) _numStatFrames;
     statsObject["average_identity_packets_per_frame"] = (float) _sumIdentityPackets / (float) _numStatFrames;
     
+    statsObject["average_encode_usecs_per_frame"] = (float) _sumEncodeUsecs / (float) _numStatFrames;
+    statsObject["average_bytes_encoded_per_frame"] = (float) _sumBytesEncoded / (float) _numStatFrames;
+    statsObject["average_bytes_sent_per_frame"] = (float) _sumBytesSent / (float) _numStatFrames;
+    
+    if (_sumListeners > 0) {
+        statsObject["average_avatars_sent_per_listener"] = (float) _sumAvatarsSent / (float) _sumListeners;
+        statsObject["average_avatars_deferred_per_listener"] = (float) _sumAvatarsDeferred / (float) _sumListeners;
+        statsObject["average_keyframes_sent_per_listener"] = (float) _sumKeyframesSent / (float) _sumListeners;
+    } else {
+        statsObject["average_avatars_sent_per_listener"] = 0.0;
+        statsObject["average_avatars_deferred_per_listener"] = 0.0;
+        statsObject["average_keyframes_sent_per_listener"] = 0.0;
+    }
+    
     statsObject["trailing_sleep_percentage"] = _trailingSleepRatio * 100;
     statsObject["performance_throttling_ratio"] = _performanceThrottlingRatio;
+    statsObject["avatar_data_packets_dropped"] = (double) _avatarDataPackets.getDroppedCount();
     
     ThreadedAssignment::addPacketStatsAndSendStatsPacket(statsObject);
     
     _sumListeners = 0;
     _sumBillboardPackets = 0;
     _sumIdentityPackets = 0;
+    _sumEncodeUsecs = 0;
+    _sumBytesEncoded = 0;
+    _sumBytesSent = 0;
+    _sumAvatarsSent = 0;
+    _sumAvatarsDeferred = 0;
+    _sumKeyframesSent = 0;
     _numStatFrames = 0;
 }
 
 void AvatarMixer::run() {
     ThreadedAssignment::commonInit(AVATAR_MIXER_LOGGING_NAME, NodeType::AvatarMixer);
+    enableBatchedDatagramReads();
+    
+    PacketReceiver* packetReceiver = createPacketReceiver();
+    if (packetReceiver) {
+        // avatar data waits for the broadcast thread, everything else comes through readPendingDatagrams
+        packetReceiver->routeToQueue(QSet<PacketType>() << PacketTypeAvatarData, &_avatarDataPackets);
+        startPacketReceiver();
+    }
     
     NodeList* nodeList = NodeList::getInstance();
     nodeList->addNodeTypeToInterestSet(NodeType::Agent);
     
     nodeList->linkedDataCreateCallback = attachAvatarDataToNode;
     
+    // wait until we have the domain-server settings, if there are none we go with the defaults
+    DomainHandler& domainHandler = nodeList->getDomainHandler();
+    
+    qDebug() << "Waiting for domain settings from domain-server.";
+    
+    // block until we get the settingsRequestComplete signal
+    QEventLoop loop;
+    connect(&domainHandler, &DomainHandler::settingsReceived, &loop, &QEventLoop::quit);
+    connect(&domainHandler, &DomainHandler::settingsReceiveFail, &loop, &QEventLoop::quit);
+    domainHandler.requestDomainSettings();
+    loop.exec();
+    
+    const QJsonObject& settingsObject = domainHandler.getSettingsObject();
+    
+    const QString AVATARS_GROUP_KEY = "avatars";
+    
+    if (settingsObject.contains(AVATARS_GROUP_KEY)) {
+        QJsonObject avatarsGroupObject = settingsObject[AVATARS_GROUP_KEY].toObject();
+        
+        const QString LISTENER_BANDWIDTH_JSON_KEY = "A-listener-bandwidth";
+        bool ok;
+        int listenerKilobytesPerSecond = avatarsGroupObject[LISTENER_BANDWIDTH_JSON_KEY].toString().toInt(&ok);
+        if (ok && listenerKilobytesPerSecond > 0) {
+            _listenerBytesPerSecond = listenerKilobytesPerSecond * BYTES_PER_KILOBYTE;
+        }
+    }
+    
+    qDebug() << "Avatar data budget per listener is" << _listenerBytesPerSecond / BYTES_PER_KILOBYTE << "KB/s.";
+    
     // setup the timer that will be fired on the broadcast thread
     QTimer* broadcastTimer = new QTimer();
     broadcastTimer->setInterval(AVATAR_DATA_SEND_INTERVAL_MSECS);
@@ -15,8 +15,21 @@
 #ifndef hifi_AvatarMixer_h
 #define hifi_AvatarMixer_h
 
+#include <QtCore/QVector>
+
+#include <PacketReceiver.h>
 #include <ThreadedAssignment.h>
 
+#include "AvatarInterestGrid.h"
+
+class AvatarMixerClientData;
+
+const int BYTES_PER_KILOBYTE = 1024;
+const int DEFAULT_LISTENER_KILOBYTES_PER_SECOND = 500;
+
+// the slowest tier sends an avatar every 8th broadcast frame
+const int MAX_AVATAR_UPDATE_INTERVAL = 8;
+
 /// Handles assignments of type AvatarMixer - distribution of avatar data to various clients
 class AvatarMixer : public ThreadedAssignment {
 public:
@@ -34,8 +47,21 @@ public slots:
     void sendStatsPacket();
     
 private:
+    struct AvatarSendCandidate {
+        Node* node;
+        AvatarMixerClientData* nodeData;
+        float overdueRatio; // frames since last sent over the update interval of the avatar's tier
+    };
+    
     void broadcastAvatarData();
     
+    /// hands the avatar data the receive thread queued since the last broadcast to the nodes
+    void parseQueuedAvatarData();
+    
+    /// the number of broadcast frames between updates for an avatar at the given distance from the listener
+    static int updateIntervalForDistance(float distance);
+    static bool isMoreOverdue(const AvatarSendCandidate& first, const AvatarSendCandidate& second);
+    
     QThread _broadcastThread;
     
     quint64 _lastFrameTimestamp;
@@ -47,6 +73,25 @@ private:
     int _numStatFrames;
     int _sumBillboardPackets;
     int _sumIdentityPackets;
+    
+    quint64 _sumEncodeUsecs;
+    quint64 _sumBytesEncoded;
+    quint64 _sumBytesSent;
+    int _sumAvatarsSent;
+    int _sumAvatarsDeferred;
+    int _sumKeyframesSent;
+    
+    quint64 _broadcastFrame;
+    int _listenerBytesPerSecond;
+    
+    AvatarInterestGrid _interestGrid;
+    QVector<int> _listenerCells;
+    QVector<AvatarSendCandidate> _sendCandidates;
+    QByteArray _avatarRecord;
+    
+    // the avatar data packets, taken on the broadcast thread at the start of each frame when the socket is read on
+    // its own thread
+    ReceivedPacketRing _avatarDataPackets;
 };
 
 #endif // hifi_AvatarMixer_h
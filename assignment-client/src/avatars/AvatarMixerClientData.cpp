@@ -9,7 +9,11 @@
 //  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
 //
 
+#include <algorithm>
+
+#include <NodeList.h>
 #include <PacketHeaders.h>
+#include <UUID.h>
 
 #include "AvatarMixerClientData.h"
 
@@ -17,7 +21,17 @@ AvatarMixerClientData::AvatarMixerClientData() :
     NodeData(),
     _hasReceivedFirstPackets(false),
     _billboardChangeTimestamp(0),
-    _identityChangeTimestamp(0)
+    _identityChangeTimestamp(0),
+    _hasEncodedAvatar(false),
+    _encodedPosition(),
+    _broadcastState(),
+    _encodedKeyframe(),
+    _encodedBillboardPacket(),
+    _encodedBillboardTimestamp(0),
+    _encodedIdentityPacket(),
+    _encodedIdentityTimestamp(0),
+    _sentAvatars(),
+    _bandwidthBudgetBytes(0)
 {
     
 }
@@ -33,3 +47,88 @@ bool AvatarMixerClientData::checkAndSetHasReceivedFirstPackets() {
     _hasReceivedFirstPackets = true;
     return oldValue;
 }
+
+int AvatarMixerClientData::encodeForBroadcast(const QUuid& nodeUUID) {
+    _encodedPosition = _avatar.getPosition();
+    
+    _avatar.toBroadcastState(_broadcastState);
+    
+    // the keyframe is the same for every listener but for its sequence number, which is patched in as it is sent
+    _encodedKeyframe = nodeUUID.toRfc4122();
+    _broadcastState.appendKeyframe(_encodedKeyframe, 0);
+    _hasEncodedAvatar = true;
+    
+    int numBytesEncoded = _encodedKeyframe.size();
+    
+    // the billboard and identity only change on occasion, so only re-encode them when they have
+    if (_billboardChangeTimestamp > _encodedBillboardTimestamp) {
+        _encodedBillboardPacket = byteArrayWithPopulatedHeader(PacketTypeAvatarBillboard);
+        _encodedBillboardPacket.append(nodeUUID.toRfc4122());
+        _encodedBillboardPacket.append(_avatar.getBillboard());
+        _encodedBillboardTimestamp = _billboardChangeTimestamp;
+        
+        numBytesEncoded += _encodedBillboardPacket.size();
+    }
+    
+    if (_identityChangeTimestamp > _encodedIdentityTimestamp) {
+        _encodedIdentityPacket = byteArrayWithPopulatedHeader(PacketTypeAvatarIdentity);
+        
+        QByteArray individualData = _avatar.identityByteArray();
+        individualData.replace(0, NUM_BYTES_RFC4122_UUID, nodeUUID.toRfc4122());
+        _encodedIdentityPacket.append(individualData);
+        _encodedIdentityTimestamp = _identityChangeTimestamp;
+        
+        numBytesEncoded += _encodedIdentityPacket.size();
+    }
+    
+    return numBytesEncoded;
+}
+
+bool AvatarMixerClientData::encodeAvatarRecord(QByteArray& record, const QUuid& sourceUUID,
+                                               const AvatarMixerClientData& sourceData, quint64 frame,
+                                               int keyframeIntervalFrames) {
+    SentAvatar& sentAvatar = _sentAvatars[sourceUUID];
+    sentAvatar.lastSentFrame = frame;
+    
+    const QByteArray& encodedKeyframe = sourceData.getEncodedKeyframe();
+    
+    if (sentAvatar.keyframeFrame > 0 && frame - sentAvatar.keyframeFrame < (quint64) keyframeIntervalFrames) {
+        record = encodedKeyframe.left(NUM_BYTES_RFC4122_UUID);
+        
+        // a delta that carries most of the avatar anyway is better spent on a keyframe, which resets the baseline
+        if (sourceData.getBroadcastState().appendDelta(record, sentAvatar.keyframe, sentAvatar.keyframeSequence)
+            && record.size() < encodedKeyframe.size() / 2) {
+            return false;
+        }
+    }
+    
+    record = encodedKeyframe;
+    record[NUM_BYTES_RFC4122_UUID + 1] = (char) ++sentAvatar.keyframeSequence;
+    
+    sentAvatar.keyframeFrame = frame;
+    sentAvatar.keyframe = sourceData.getBroadcastState();
+    
+    return true;
+}
+
+void AvatarMixerClientData::removeSourcesNotSentSince(quint64 frame) {
+    QHash<QUuid, SentAvatar>::iterator it = _sentAvatars.begin();
+    while (it != _sentAvatars.end()) {
+        if (it.value().lastSentFrame >= frame) {
+            ++it;
+        } else if (!NodeList::getInstance()->nodeWithUUID(it.key())) {
+            // the listener was told to kill this avatar, so its keyframe sequence can start over
+            it = _sentAvatars.erase(it);
+        } else {
+            // the listener may still hold a keyframe of this avatar, so keep counting its keyframe sequence from where
+            // it was - starting over could line a new delta up with that old keyframe - and only drop the baseline
+            it.value().keyframeFrame = 0;
+            it.value().keyframe = AvatarBroadcastState();
+            ++it;
+        }
+    }
+}
+
+void AvatarMixerClientData::addToBandwidthBudget(int frameBudgetBytes, int maxBudgetBytes) {
+    _bandwidthBudgetBytes = std::min(_bandwidthBudgetBytes + frameBudgetBytes, maxBudgetBytes);
+}
@@ -12,6 +12,7 @@
 #ifndef hifi_AvatarMixerClientData_h
 #define hifi_AvatarMixerClientData_h
 
+#include <QtCore/QHash>
 #include <QtCore/QUrl>
 
 #include <AvatarData.h>
@@ -33,11 +34,70 @@ public:
     quint64 getIdentityChangeTimestamp() const { return _identityChangeTimestamp; }
     void setIdentityChangeTimestamp(quint64 identityChangeTimestamp) { _identityChangeTimestamp = identityChangeTimestamp; }
     
+    /// encodes the avatar once for every listener in this broadcast frame, along with the identity and billboard
+    /// packets if they have changed since they were last encoded - the node's mutex must be held by the caller
+    /// \return the number of bytes that had to be encoded
+    int encodeForBroadcast(const QUuid& nodeUUID);
+    
+    /// writes the record of the source's avatar for this listener - a delta against the last keyframe this listener was
+    /// sent of it, or a new keyframe if the last one is too old, too far off, or the delta wouldn't save much over one
+    /// \return true if the record is a keyframe
+    bool encodeAvatarRecord(QByteArray& record, const QUuid& sourceUUID, const AvatarMixerClientData& sourceData,
+                            quint64 frame, int keyframeIntervalFrames);
+    
+    /// drops the encoding from the last frame, for when this avatar could not be encoded in the current one
+    void clearEncodedAvatar() { _hasEncodedAvatar = false; }
+    
+    bool hasEncodedAvatar() const { return _hasEncodedAvatar; }
+    const glm::vec3& getEncodedPosition() const { return _encodedPosition; }
+    
+    /// the node's UUID followed by a keyframe record of the avatar, with a keyframe sequence number of zero
+    const QByteArray& getEncodedKeyframe() const { return _encodedKeyframe; }
+    const AvatarBroadcastState& getBroadcastState() const { return _broadcastState; }
+    
+    const QByteArray& getEncodedBillboardPacket() const { return _encodedBillboardPacket; }
+    const QByteArray& getEncodedIdentityPacket() const { return _encodedIdentityPacket; }
+    
+    /// the broadcast frame in which the avatar of the given source node was last sent to this listener, 0 if never
+    quint64 getLastSentFrame(const QUuid& sourceUUID) const { return _sentAvatars.value(sourceUUID).lastSentFrame; }
+    
+    /// forgets sources that have not been sent since before the given frame, so killed avatars don't pile up - sources
+    /// that are still connected only drop their keyframe and keep their keyframe sequence
+    void removeSourcesNotSentSince(quint64 frame);
+    
+    /// refills the listener's send budget for one frame, unused bytes carry over up to maxBudgetBytes
+    void addToBandwidthBudget(int frameBudgetBytes, int maxBudgetBytes);
+    int getBandwidthBudget() const { return _bandwidthBudgetBytes; }
+    void spendBandwidthBudget(int numBytes) { _bandwidthBudgetBytes -= numBytes; }
+    
 private:
+    /// what this listener was last sent of another avatar
+    class SentAvatar {
+    public:
+        SentAvatar() : lastSentFrame(0), keyframeFrame(0), keyframeSequence(0), keyframe() {}
+        
+        quint64 lastSentFrame;
+        quint64 keyframeFrame;
+        quint8 keyframeSequence;
+        AvatarBroadcastState keyframe;
+    };
+    
     AvatarData _avatar;
     bool _hasReceivedFirstPackets;
     quint64 _billboardChangeTimestamp;
     quint64 _identityChangeTimestamp;
+    
+    bool _hasEncodedAvatar;
+    glm::vec3 _encodedPosition;
+    AvatarBroadcastState _broadcastState;
+    QByteArray _encodedKeyframe;
+    QByteArray _encodedBillboardPacket;
+    quint64 _encodedBillboardTimestamp;
+    QByteArray _encodedIdentityPacket;
+    quint64 _encodedIdentityTimestamp;
+    
+    QHash<QUuid, SentAvatar> _sentAvatars;
+    int _bandwidthBudgetBytes;
 };
 
 #endif // hifi_AvatarMixerClientData_h
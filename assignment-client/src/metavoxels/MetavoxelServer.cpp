@@ -43,6 +43,11 @@ const QString METAVOXEL_SERVER_LOGGING_NAME = "metavoxel-server";
 void MetavoxelServer::run() {
     commonInit(METAVOXEL_SERVER_LOGGING_NAME, NodeType::MetavoxelServer);
     
+    // nothing is routed, the receive thread just keeps the socket drained and checks the packets for us
+    if (createPacketReceiver()) {
+        startPacketReceiver();
+    }
+    
     NodeList* nodeList = NodeList::getInstance();
     nodeList->addNodeTypeToInterestSet(NodeType::Agent);
     
@@ -86,17 +91,15 @@ void MetavoxelServer::readPendingDatagrams() {
     
     NodeList* nodeList = NodeList::getInstance();
     
-    while (readAvailableDatagram(receivedPacket, senderSockAddr)) {
-        if (nodeList->packetVersionAndHashMatch(receivedPacket)) {
-            switch (packetTypeForPacket(receivedPacket)) {
-                case PacketTypeMetavoxelData:
-                    nodeList->findNodeAndUpdateWithDataFromPacket(receivedPacket);
-                    break;
-                
-                default:
-                    nodeList->processNodeData(senderSockAddr, receivedPacket);
-                    break;
-            }
+    while (readVerifiedDatagram(receivedPacket, senderSockAddr)) {
+        switch (packetTypeForPacket(receivedPacket)) {
+            case PacketTypeMetavoxelData:
+                nodeList->findNodeAndUpdateWithDataFromPacket(receivedPacket);
+                break;
+            
+            default:
+                nodeList->processNodeData(senderSockAddr, receivedPacket);
+                break;
         }
     }
 }
@@ -42,7 +42,9 @@ OctreeQueryNode::OctreeQueryNode() :
     _lastRootTimestamp(0),
     _myPacketType(PacketTypeUnknown),
     _isShuttingDown(false),
-    _sentPacketHistory()
+    _sentPacketHistory(),
+    _nackedSequenceNumbers(),
+    _sendRateController()
 {
 }
 
@@ -70,8 +72,8 @@ void OctreeQueryNode::forceNodeShutdown() {
     _isShuttingDown = true;
     nodeBag.unhookNotifications(); // if our node is shutting down, then we no longer need octree element notifications
     if (_octreeSendThread) {
-        // we really need to force our thread to shutdown, this is synchronous, we will block while the thread actually 
-        // shuts down because we really need it to shutdown, and it's ok if we wait for it to complete
+        // we really need to force our sender to shutdown, this is synchronous, we will block while a send worker
+        // finishes with it because we really need it to shutdown, and it's ok if we wait for it to complete
         OctreeSendThread* sendThread = _octreeSendThread;
         _octreeSendThread = NULL;
         sendThread->setIsShuttingDown();
@@ -95,8 +97,8 @@ void OctreeQueryNode::initializeOctreeSendThread(const SharedAssignmentPointer&
     _octreeSendThread = new OctreeSendThread(myAssignment, node);
     
     // we want to be notified when the thread finishes
-    connect(_octreeSendThread, &GenericThread::finished, this, &OctreeQueryNode::sendThreadFinished);
-    _octreeSendThread->initialize(true);
+    connect(_octreeSendThread, &OctreeSendThread::finished, this, &OctreeQueryNode::sendThreadFinished);
+    _octreeSendThread->initialize();
 }
 
 bool OctreeQueryNode::packetIsDuplicate() const {
@@ -404,4 +406,14 @@ void OctreeQueryNode::parseNackPacket(QByteArray& packet) {
         _nackedSequenceNumbers.enqueue(sequenceNumber);
         dataAt += sizeof(OCTREE_PACKET_SEQUENCE);
     }
+
+    // the first of the client's NACK packets is followed by its receive feedback
+    const unsigned char* endOfPacket = reinterpret_cast<const unsigned char*>(packet.data()) + packet.size();
+    if (endOfPacket - dataAt >= (int)OCTREE_NACK_FEEDBACK_SIZE) {
+        OCTREE_NACK_FEEDBACK_COUNT feedbackCounts[2];
+        memcpy(feedbackCounts, dataAt, sizeof(feedbackCounts));
+        OCTREE_NACK_FEEDBACK_FLIGHT_TIME feedbackFlightTime;
+        memcpy(&feedbackFlightTime, dataAt + sizeof(feedbackCounts), sizeof(feedbackFlightTime));
+        _sendRateController.feedbackReceived(feedbackCounts[0], feedbackCounts[1], (float)feedbackFlightTime);
+    }
 }
@@ -22,6 +22,7 @@
 #include <OctreePacketData.h>
 #include <OctreeQuery.h>
 #include <OctreeSceneStats.h>
+#include <SendRateController.h>
 #include <ThreadedAssignment.h> // for SharedAssignmentPointer
 #include "SentPacketHistory.h"
 #include <qqueue.h>
@@ -112,6 +113,8 @@ public:
     bool hasNextNackedPacket() const;
     const QByteArray* getNextNackedPacket();
 
+    SendRateController& getSendRateController() { return _sendRateController; }
+
 private slots:
     void sendThreadFinished();
     
@@ -157,6 +160,8 @@ private:
 
     SentPacketHistory _sentPacketHistory;
     QQueue<OCTREE_PACKET_SEQUENCE> _nackedSequenceNumbers;
+
+    SendRateController _sendRateController; // how fast this client's link lets us send to it
 };
 
 #endif // hifi_OctreeQueryNode_h
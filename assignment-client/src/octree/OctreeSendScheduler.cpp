@@ -0,0 +1,186 @@
+//
+//  OctreeSendScheduler.cpp
+//  assignment-client/src/octree
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#include <QtCore/QMutexLocker>
+
+#include <algorithm>
+
+#include <SharedUtil.h>
+
+#include "OctreeSendScheduler.h"
+#include "OctreeSendThread.h"
+#include "OctreeServerConsts.h"
+
+// how long an idle worker waits before checking whether the scheduler is stopping
+const unsigned long IDLE_WORKER_WAIT_MSECS = 100;
+
+// a client that is a whole interval or more behind on its packets is due this much earlier
+const quint64 MAX_CATCH_UP_USECS = OCTREE_SEND_INTERVAL_USECS / 2;
+
+OctreeSendWorker::OctreeSendWorker(OctreeSendScheduler* scheduler) :
+    _scheduler(scheduler)
+{
+}
+
+bool OctreeSendWorker::process() {
+    return isStillRunning() && _scheduler->processNextSender();
+}
+
+void OctreeSendWorker::terminating() {
+    _scheduler->wakeWorkers();
+}
+
+OctreeSendScheduler::OctreeSendScheduler() :
+    _mutex(),
+    _senderDue(),
+    _senderProcessed(),
+    _queue(),
+    _workers(),
+    _isStopping(false),
+    _schedulingLatency(),
+    _maxSchedulingLatency(0)
+{
+}
+
+OctreeSendScheduler::~OctreeSendScheduler() {
+    stop();
+}
+
+void OctreeSendScheduler::start(int numWorkers) {
+    _isStopping = false;
+    for (int i = 0; i < numWorkers; i++) {
+        OctreeSendWorker* worker = new OctreeSendWorker(this);
+        worker->initialize(true);
+        _workers.append(worker);
+    }
+}
+
+void OctreeSendScheduler::stop() {
+    {
+        QMutexLocker locker(&_mutex);
+        _isStopping = true;
+        _senderDue.wakeAll();
+    }
+
+    foreach (OctreeSendWorker* worker, _workers) {
+        worker->terminate();
+        delete worker;
+    }
+    _workers.clear();
+}
+
+void OctreeSendScheduler::schedule(OctreeSendThread* sender) {
+    QMutexLocker locker(&_mutex);
+    sender->_isUnscheduled = false;
+    if (!sender->_isQueued && !sender->_isProcessing) {
+        enqueue(sender, usecTimestampNow());
+    }
+}
+
+void OctreeSendScheduler::unschedule(OctreeSendThread* sender) {
+    QMutexLocker locker(&_mutex);
+    sender->_isUnscheduled = true;
+    if (sender->_isQueued) {
+        _queue.remove(sender->_dueTime, sender);
+        sender->_isQueued = false;
+    }
+    while (sender->_isProcessing) {
+        _senderProcessed.wait(&_mutex);
+    }
+}
+
+void OctreeSendScheduler::enqueue(OctreeSendThread* sender, quint64 dueTime) {
+    sender->_dueTime = dueTime;
+    sender->_isQueued = true;
+    _queue.insert(dueTime, sender);
+    _senderDue.wakeOne();
+}
+
+bool OctreeSendScheduler::processNextSender() {
+    QMutexLocker locker(&_mutex);
+    if (_isStopping) {
+        return false;
+    }
+
+    if (_queue.isEmpty()) {
+        _senderDue.wait(&_mutex, IDLE_WORKER_WAIT_MSECS);
+        return !_isStopping;
+    }
+
+    // sleep until the first client is due, or until another one is queued ahead of it
+    quint64 now = usecTimestampNow();
+    QMultiMap<quint64, OctreeSendThread*>::iterator next = _queue.begin();
+    if (next.key() > now) {
+        unsigned long msecsUntilDue = (next.key() - now + USECS_PER_MSEC - 1) / USECS_PER_MSEC;
+        _senderDue.wait(&_mutex, std::min(msecsUntilDue, IDLE_WORKER_WAIT_MSECS));
+        return !_isStopping;
+    }
+
+    OctreeSendThread* sender = next.value();
+    _queue.erase(next);
+    sender->_isQueued = false;
+    sender->_isProcessing = true;
+
+    quint64 latency = now - sender->_dueTime;
+    _schedulingLatency.updateAverage((float)latency);
+    _maxSchedulingLatency = std::max(latency, _maxSchedulingLatency);
+
+    locker.unlock();
+
+    quint64 processStart = usecTimestampNow();
+    bool keepSending = sender->process();
+
+    locker.relock();
+
+    if (keepSending && !sender->_isUnscheduled && !_isStopping) {
+        float catchUpIntervals = std::min(sender->getIntervalsBehind(), 1.0f);
+        enqueue(sender, processStart + OCTREE_SEND_INTERVAL_USECS - (quint64)(catchUpIntervals * MAX_CATCH_UP_USECS));
+    } else if (!keepSending && !sender->_isUnscheduled) {
+        // the client is gone, let its node data know while the sender is still marked as processing, so that the
+        // node data can't delete it until we're done with it
+        sender->_isUnscheduled = true;
+        locker.unlock();
+        emit sender->finished();
+        locker.relock();
+    }
+
+    sender->_isProcessing = false;
+    _senderProcessed.wakeAll();
+
+    return !_isStopping;
+}
+
+void OctreeSendScheduler::wakeWorkers() {
+    QMutexLocker locker(&_mutex);
+    _senderDue.wakeAll();
+}
+
+void OctreeSendScheduler::getQueueDepth(int& numDue, int& numWaiting) const {
+    QMutexLocker locker(&_mutex);
+    quint64 now = usecTimestampNow();
+    numDue = 0;
+    QMultiMap<quint64, OctreeSendThread*>::const_iterator i = _queue.constBegin();
+    while (i != _queue.constEnd() && i.key() <= now) {
+        numDue++;
+        ++i;
+    }
+    numWaiting = _queue.size() - numDue;
+}
+
+float OctreeSendScheduler::getAverageSchedulingLatency() const {
+    QMutexLocker locker(&_mutex);
+    return _schedulingLatency.getAverage();
+}
+
+void OctreeSendScheduler::resetStats() {
+    QMutexLocker locker(&_mutex);
+    _schedulingLatency.reset();
+    _maxSchedulingLatency = 0;
+}
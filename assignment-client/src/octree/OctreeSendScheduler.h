@@ -0,0 +1,96 @@
+//
+//  OctreeSendScheduler.h
+//  assignment-client/src/octree
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#ifndef hifi_OctreeSendScheduler_h
+#define hifi_OctreeSendScheduler_h
+
+#include <QtCore/QMultiMap>
+#include <QtCore/QMutex>
+#include <QtCore/QVector>
+#include <QtCore/QWaitCondition>
+
+#include <GenericThread.h>
+#include <SimpleMovingAverage.h>
+
+class OctreeSendScheduler;
+class OctreeSendThread;
+
+const int DEFAULT_NUM_SEND_THREADS = 4;
+const int MAX_NUM_SEND_THREADS = 64;
+
+/// One of the threads of an OctreeSendScheduler, processes whichever client is due next
+class OctreeSendWorker : public GenericThread {
+    Q_OBJECT
+public:
+    OctreeSendWorker(OctreeSendScheduler* scheduler);
+
+protected:
+    virtual bool process();
+    virtual void terminating();
+
+private:
+    OctreeSendScheduler* _scheduler;
+};
+
+/// Runs the OctreeSendThread of every connected client on a fixed pool of worker threads. Each client is due again one
+/// send interval after its last run started, and workers take the client that has been due the longest. A client that
+/// still has something to send but fell behind on its packets per interval is due up to half an interval early, so it
+/// can catch up on the packets it was owed.
+class OctreeSendScheduler {
+public:
+    OctreeSendScheduler();
+    ~OctreeSendScheduler();
+
+    /// starts the worker threads
+    void start(int numWorkers);
+
+    /// stops the worker threads, waiting for the clients they are processing
+    void stop();
+
+    /// queues a client to be processed as soon as a worker is free
+    void schedule(OctreeSendThread* sender);
+
+    /// removes a client from the queue, waiting for a worker to finish processing it if one is, after this returns
+    /// the scheduler will not touch the sender again
+    void unschedule(OctreeSendThread* sender);
+
+    /// takes the next due client, if there is one, and processes it
+    /// \return false once the scheduler is stopping
+    bool processNextSender();
+
+    void wakeWorkers();
+
+    int getNumWorkers() const { return _workers.size(); }
+
+    /// the number of clients waiting for a worker, and the number of clients waiting for their next interval
+    void getQueueDepth(int& numDue, int& numWaiting) const;
+
+    /// usecs between a client becoming due and a worker starting to process it
+    float getAverageSchedulingLatency() const;
+    quint64 getMaxSchedulingLatency() const { return _maxSchedulingLatency; }
+
+    void resetStats();
+
+private:
+    void enqueue(OctreeSendThread* sender, quint64 dueTime);
+
+    mutable QMutex _mutex;
+    QWaitCondition _senderDue;
+    QWaitCondition _senderProcessed;
+
+    QMultiMap<quint64, OctreeSendThread*> _queue; // keyed by the time the client is due
+    QVector<OctreeSendWorker*> _workers;
+    bool _isStopping;
+
+    SimpleMovingAverage _schedulingLatency;
+    quint64 _maxSchedulingLatency;
+};
+
+#endif // hifi_OctreeSendScheduler_h
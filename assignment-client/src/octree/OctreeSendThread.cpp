@@ -28,26 +28,37 @@ OctreeSendThread::OctreeSendThread(const SharedAssignmentPointer& myAssignment,
     _nodeUUID(node->getUUID()),
     _packetData(),
     _nodeMissingCount(0),
-    _isShuttingDown(false)
+    _isShuttingDown(false),
+    _maxPacketsPerInterval(0),
+    _packetsBehind(0.0f),
+    _lastProcessStart(0),
+    _packetsPerIntervalRemainder(0.0f),
+    _dueTime(0),
+    _isQueued(false),
+    _isProcessing(false),
+    _isUnscheduled(false)
 {
     QString safeServerName("Octree");
     if (_myServer) {
         safeServerName = _myServer->getMyServerName();
     }
     qDebug() << qPrintable(safeServerName)  << "server [" << _myServer << "]: client connected "
-                                            "- starting sending thread [" << this << "]";
+                                            "- starting sender [" << this << "]";
 
     OctreeServer::clientConnected();
 }
 
 OctreeSendThread::~OctreeSendThread() {
+    // make sure no send worker is still holding on to us
+    terminate();
+
     QString safeServerName("Octree");
     if (_myServer) {
         safeServerName = _myServer->getMyServerName();
     }
     
     qDebug() << qPrintable(safeServerName)  << "server [" << _myServer << "]: client disconnected "
-                                            "- ending sending thread [" << this << "]";
+                                            "- ending sender [" << this << "]";
 
     OctreeServer::clientDisconnected();
     OctreeServer::stopTrackingThread(this);
@@ -56,11 +67,22 @@ OctreeSendThread::~OctreeSendThread() {
     _myAssignment.clear();
 }
 
+void OctreeSendThread::initialize() {
+    if (_myServer) {
+        _myServer->getSendScheduler()->schedule(this);
+    }
+}
+
+void OctreeSendThread::terminate() {
+    if (_myServer) {
+        _myServer->getSendScheduler()->unschedule(this);
+    }
+}
+
 void OctreeSendThread::setIsShuttingDown() {
     _isShuttingDown = true;
 }
 
-
 bool OctreeSendThread::process() {
     if (_isShuttingDown) {
         return false; // exit early if we're shutting down
@@ -73,7 +95,7 @@ bool OctreeSendThread::process() {
 
     OctreeServer::didProcess(this);
 
-    quint64  start = usecTimestampNow();
+    quint64 start = usecTimestampNow();
 
     // don't do any send processing until the initial load of the octree is complete...
     if (_myServer->isInitialLoadComplete()) {
@@ -84,35 +106,34 @@ bool OctreeSendThread::process() {
             // Sometimes the node data has not yet been linked, in which case we can't really do anything
             if (nodeData && !nodeData->isShuttingDown()) {
                 bool viewFrustumChanged = nodeData->updateCurrentViewFrustum();
-                packetDistributor(nodeData, viewFrustumChanged);
-            }
-        }
-    }
 
-    if (_isShuttingDown) {
-        return false; // exit early if we're shutting down
-    }
-
-    // Only sleep if we're still running and we got the lock last time we tried, otherwise try to get the lock asap
-    if (isStillRunning()) {
-        // dynamically sleep until we need to fire off the next set of octree elements
-        int elapsed = (usecTimestampNow() - start);
-        int usecToSleep =  OCTREE_SEND_INTERVAL_USECS - elapsed;
-
-        if (usecToSleep > 0) {
-            PerformanceWarning warn(false,"OctreeSendThread... usleep()",false,&_usleepTime,&_usleepCalls);
-            usleep(usecToSleep);
-        } else {
-            const int MIN_USEC_TO_SLEEP = 1;
-            usleep(MIN_USEC_TO_SLEEP);
+                // this client's packets for the interval go out together once they are all encoded
+                NodeList::getInstance()->beginDatagramBatch();
+                int packetsSent = packetDistributor(nodeData, viewFrustumChanged);
+                NodeList::getInstance()->flushDatagramBatch();
+                nodeData->getSendRateController().packetsSent(packetsSent);
+
+                // if we were processed late and there's still more to send, then the client is owed the packets it
+                // could have been sent in the meantime
+                if (_lastProcessStart > 0 && !nodeData->nodeBag.isEmpty()) {
+                    const float MAX_INTERVALS_BEHIND = 2.0f;
+                    float intervalsElapsed = (float)(start - _lastProcessStart) / (float)OCTREE_SEND_INTERVAL_USECS;
+                    _packetsBehind = glm::clamp(_packetsBehind + (_maxPacketsPerInterval * intervalsElapsed) - packetsSent,
+                                                0.0f, _maxPacketsPerInterval * MAX_INTERVALS_BEHIND);
+                } else {
+                    _packetsBehind = 0.0f;
+                }
+                _lastProcessStart = start;
+            }
         }
     }
 
-    return isStillRunning();  // keep running till they terminate us
+    return !_isShuttingDown;
 }
 
-quint64 OctreeSendThread::_usleepTime = 0;
-quint64 OctreeSendThread::_usleepCalls = 0;
+float OctreeSendThread::getIntervalsBehind() const {
+    return (_maxPacketsPerInterval > 0) ? (_packetsBehind / (float)_maxPacketsPerInterval) : 0.0f;
+}
 
 quint64 OctreeSendThread::_totalBytes = 0;
 quint64 OctreeSendThread::_totalWastedBytes = 0;
@@ -290,10 +311,23 @@ int OctreeSendThread::packetDistributor(OctreeQueryNode* nodeData, bool viewFrus
         return 0;
     }
     
-    // calculate max number of packets that can be sent during this interval
+    // calculate max number of packets that can be sent during this interval. Until the client reports how its receiving
+    // is going we send at the rate it asked for, after that the rate follows what its link takes
     int clientMaxPacketsPerInterval = std::max(1, (nodeData->getMaxOctreePacketsPerSecond() / INTERVALS_PER_SECOND));
     int maxPacketsPerInterval = std::min(clientMaxPacketsPerInterval, _myServer->getPacketsPerClientPerInterval());
 
+    SendRateController& sendRateController = nodeData->getSendRateController();
+    sendRateController.setMaxPacketsPerSecond(_myServer->getAdaptivePacketsPerClientPerSecond());
+    sendRateController.setInitialPacketsPerSecond(maxPacketsPerInterval * INTERVALS_PER_SECOND);
+    if (sendRateController.hasFeedback()) {
+        // slow links may get less than a packet per interval, so the part of a packet left over carries on to the next
+        float packetsThisInterval = sendRateController.getPacketsPerSecond() / INTERVALS_PER_SECOND
+            + _packetsPerIntervalRemainder;
+        maxPacketsPerInterval = (int)packetsThisInterval;
+        _packetsPerIntervalRemainder = packetsThisInterval - maxPacketsPerInterval;
+    }
+    _maxPacketsPerInterval = maxPacketsPerInterval;
+
     int truePacketsSent = 0;
     int trueBytesSent = 0;
     int packetsSentThisInterval = 0;
@@ -371,6 +405,9 @@ int OctreeSendThread::packetDistributor(OctreeQueryNode* nodeData, bool viewFrus
         // start tracking our stats
         nodeData->stats.sceneStarted(isFullScene, viewFrustumChanged, _myServer->getOctree()->getRoot(), _myServer->getJurisdiction());
 
+        // send what looks biggest from where the client is first, the elements still in the bag included
+        nodeData->nodeBag.setView(nodeData->getCurrentViewFrustum(), !_myServer->wantsUnorderedSceneBag());
+
         // This is the start of "resending" the scene.
         bool dontRestartSceneOnMove = false; // this is experimental
         if (dontRestartSceneOnMove) {
@@ -402,8 +439,14 @@ int OctreeSendThread::packetDistributor(OctreeQueryNode* nodeData, bool viewFrus
             quint64 startInside = usecTimestampNow();            
 
             bool lastNodeDidntFit = false; // assume each node fits
-            if (!nodeData->nodeBag.isEmpty()) {
-                OctreeElement* subTree = nodeData->nodeBag.extract();
+
+            // take the element out of the bag only once we're reading, so that a writer can't delete it in between
+            quint64 lockWaitStart = usecTimestampNow();
+            quint64 readEpoch = _myServer->getOctree()->beginRead();
+            quint64 lockWaitEnd = usecTimestampNow();
+
+            OctreeElement* subTree = nodeData->nodeBag.extract();
+            if (subTree) {
                 
                 /* TODO: Looking for a way to prevent locking and encoding a tree that is not
                 // going to result in any packets being sent...
@@ -439,16 +482,14 @@ int OctreeSendThread::packetDistributor(OctreeQueryNode* nodeData, bool viewFrus
                                              WANT_EXISTS_BITS, DONT_CHOP, wantDelta, lastViewFrustum,
                                              wantOcclusionCulling, coverageMap, boundaryLevelAdjust, voxelSizeScale,
                                              nodeData->getLastTimeBagEmpty(),
-                                             isFullScene, &nodeData->stats, _myServer->getJurisdiction());
+                                             isFullScene, &nodeData->stats, _myServer->getJurisdiction(),
+                                             _myServer->getSubtreeCache());
 
                 // TODO: should this include the lock time or not? This stat is sent down to the client,
                 // it seems like it may be a good idea to include the lock time as part of the encode time
                 // are reported to client. Since you can encode without the lock
                 nodeData->stats.encodeStarted();
                 
-                quint64 lockWaitStart = usecTimestampNow();
-                _myServer->getOctree()->lockForRead();
-                quint64 lockWaitEnd = usecTimestampNow();
                 lockWaitElapsedUsec = (float)(lockWaitEnd - lockWaitStart);
 
                 quint64 encodeStart = usecTimestampNow();
@@ -460,6 +501,9 @@ int OctreeSendThread::packetDistributor(OctreeQueryNode* nodeData, bool viewFrus
                 // sent the entire scene. We want to know this below so we'll actually write this content into
                 // the packet and send it
                 completedScene = nodeData->nodeBag.isEmpty();
+                if (nodeData->nodeBag.getUsefulCount() == 0) {
+                    nodeData->stats.sceneUseful();
+                }
 
                 // if we're trying to fill a full size packet, then we use this logic to determine if we have a DIDNT_FIT case.
                 if (_packetData.getTargetSize() == MAX_OCTREE_PACKET_DATA_SIZE) {
@@ -478,12 +522,12 @@ int OctreeSendThread::packetDistributor(OctreeQueryNode* nodeData, bool viewFrus
                 }
 
                 nodeData->stats.encodeStopped();
-                _myServer->getOctree()->unlock();
             } else {
                 // If the bag was empty then we didn't even attempt to encode, and so we know the bytesWritten were 0
                 bytesWritten = 0;
                 somethingToSend = false; // this will cause us to drop out of the loop...
             }
+            _myServer->getOctree()->endRead(readEpoch);
 
             // If the last node didn't fit, but we're in compressed mode, then we actually want to see if we can fit a
             // little bit more in this packet. To do this we write into the packet, but don't send it yet, we'll
@@ -5,7 +5,7 @@
 //  Created by Brad Hefta-Gaub on 8/21/13.
 //  Copyright 2013 High Fidelity, Inc.
 //
-//  Threaded or non-threaded object for sending voxels to a client
+//  Sends octree packets to a single client
 //
 //  Distributed under the Apache License, Version 2.0.
 //  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
@@ -14,7 +14,8 @@
 #ifndef hifi_OctreeSendThread_h
 #define hifi_OctreeSendThread_h
 
-#include <GenericThread.h>
+#include <QtCore/QObject>
+
 #include <NetworkPacket.h>
 #include <OctreeElementBag.h>
 
@@ -22,27 +23,39 @@
 
 class OctreeServer;
 
-/// Threaded processor for sending voxel packets to a single client
-class OctreeSendThread : public GenericThread {
+/// Sends voxel packets to a single client. The sender doesn't own a thread, once initialized it is processed once per
+/// send interval by one of the workers of its server's OctreeSendScheduler.
+class OctreeSendThread : public QObject {
     Q_OBJECT
 public:
     OctreeSendThread(const SharedAssignmentPointer& myAssignment, const SharedNodePointer& node);
     virtual ~OctreeSendThread();
-    
+
+    /// Call to start sending, hands the sender to the server's send scheduler.
+    void initialize();
+
+    /// Call to stop sending, waits for a send worker to finish with this sender if one is processing it.
+    void terminate();
+
     void setIsShuttingDown();
 
+    /// Sends this interval's packets to the client, returns false once the client is gone.
+    bool process();
+
+    /// How many intervals worth of packets the client is owed, because it was processed late while it still had
+    /// something to send.
+    float getIntervalsBehind() const;
+
     static quint64 _totalBytes;
     static quint64 _totalWastedBytes;
     static quint64 _totalPackets;
 
-    static quint64 _usleepTime;
-    static quint64 _usleepCalls;
-
-protected:
-    /// Implements generic processing behavior for this thread.
-    virtual bool process();
+signals:
+    void finished();
 
 private:
+    friend class OctreeSendScheduler;
+
     SharedAssignmentPointer _myAssignment;
     OctreeServer* _myServer;
     SharedNodePointer _node;
@@ -55,6 +68,19 @@ private:
     
     int _nodeMissingCount;
     bool _isShuttingDown;
+
+    // how far behind the client is on the packets it was allowed to be sent
+    int _maxPacketsPerInterval;
+    float _packetsBehind;
+    quint64 _lastProcessStart;
+
+    float _packetsPerIntervalRemainder; // the part of a packet the adaptive send rate allows that carries to the next interval
+
+    // owned by the OctreeSendScheduler, and only touched while holding its lock
+    quint64 _dueTime;
+    bool _isQueued;
+    bool _isProcessing;
+    bool _isUnscheduled;
 };
 
 #endif // hifi_OctreeSendThread_h
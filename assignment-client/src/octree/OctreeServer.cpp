@@ -19,6 +19,10 @@
 #include <AccountManager.h>
 #include <HTTPConnection.h>
 #include <Logging.h>
+#include <OctreeElementIndex.h>
+#include <OctreeElementReclaimer.h>
+#include <OctreeElementSlab.h>
+#include <PacketReceiver.h>
 #include <UUID.h>
 
 #include "../AssignmentClient.h"
@@ -79,6 +83,8 @@ int OctreeServer::_noProcessWait = 0;
 
 void OctreeServer::resetSendingStats() {
     _averageLoopTime.reset();
+    _sendScheduler.resetStats();
+    _subtreeCache.resetStats();
 
     _averageEncodeTime.reset();
     _averageShortEncodeTime.reset();
@@ -225,16 +231,20 @@ OctreeServer::OctreeServer(const QByteArray& packet) :
     _httpManager(NULL),
     _statusPort(0),
     _packetsPerClientPerInterval(10),
+    _adaptivePacketsPerClientPerInterval(DEFAULT_ADAPTIVE_PACKETS_PER_CLIENT_PER_INTERVAL),
     _packetsTotalPerInterval(DEFAULT_PACKETS_PER_INTERVAL),
     _tree(NULL),
     _wantPersist(true),
     _debugSending(false),
     _debugReceiving(false),
     _verboseDebug(false),
+    _unorderedSceneBag(false),
     _jurisdiction(NULL),
     _jurisdictionSender(NULL),
     _octreeInboundPacketProcessor(NULL),
     _persistThread(NULL),
+    _sendScheduler(),
+    _subtreeCache(),
     _started(time(0)),
     _startedUSecs(usecTimestampNow())
 {
@@ -277,6 +287,9 @@ OctreeServer::~OctreeServer() {
         _persistThread->deleteLater();
     }
 
+    // every client's sender holds on to this assignment, so by now there is nothing left for the workers to process
+    _sendScheduler.stop();
+
     delete _jurisdiction;
     _jurisdiction = NULL;
     
@@ -328,6 +341,7 @@ bool OctreeServer::handleHTTPRequest(HTTPConnection* connection, const QUrl& url
             showStats = true;
         } else if (url.path() == "/resetStats") {
             _octreeInboundPacketProcessor->resetStats();
+            _octreeInboundPacketProcessor->getPacketQueue().resetStats();
             resetSendingStats();
             showStats = true;
         }
@@ -371,6 +385,17 @@ bool OctreeServer::handleHTTPRequest(HTTPConnection* connection, const QUrl& url
             statsString += getFileLoadTime();
             statsString += "\r\n";
 
+            if (isPersistEnabled()) {
+                statsString += QString("%1 File Saves: %2 (%3 failed)\r\n").arg(getMyServerName())
+                    .arg(_persistThread->getSaveCount()).arg(_persistThread->getFailedSaveCount());
+                if (_persistThread->getSaveCount() > 0) {
+                    statsString += QString().sprintf("Last Save: %lld bytes in %.3f seconds, tree locked for %.3f seconds\r\n",
+                        _persistThread->getLastSaveBytes(),
+                        (float)_persistThread->getLastSaveElapsedTime() / (float)USECS_PER_SECOND,
+                        (float)_persistThread->getLastSaveLockTime() / (float)USECS_PER_SECOND);
+                }
+            }
+
         } else {
             statsString += "Voxels not yet loaded...\r\n";
         }
@@ -386,6 +411,8 @@ bool OctreeServer::handleHTTPRequest(HTTPConnection* connection, const QUrl& url
 
         statsString += QString("        Configured Max PPS/Client: %1 pps/client\r\n")
             .arg(locale.toString((uint)getPacketsPerClientPerSecond()).rightJustified(COLUMN_WIDTH, ' '));
+        statsString += QString("          Adaptive Max PPS/Client: %1 pps/client\r\n")
+            .arg(locale.toString((uint)getAdaptivePacketsPerClientPerSecond()).rightJustified(COLUMN_WIDTH, ' '));
         statsString += QString("        Configured Max PPS/Server: %1 pps/server\r\n\r\n")
             .arg(locale.toString((uint)getPacketsTotalPerSecond()).rightJustified(COLUMN_WIDTH, ' '));
 
@@ -422,8 +449,53 @@ bool OctreeServer::handleHTTPRequest(HTTPConnection* connection, const QUrl& url
         statsString += QString("          Total Clients Connected: %1 clients\r\n")
             .arg(locale.toString((uint)getCurrentClientCount()).rightJustified(COLUMN_WIDTH, ' '));
 
+        // how the send rates of the clients reporting feedback have adapted to their links
+        int numAdaptiveClients = 0;
+        int numSlowStartClients = 0;
+        float totalAdaptiveRate = 0.0f;
+        float minAdaptiveRate = 0.0f;
+        float maxAdaptiveRate = 0.0f;
+        quint32 totalBackoffs = 0;
+        SharedNodeSnapshot nodeSnapshot = NodeList::getInstance()->getNodeSnapshot();
+        foreach (const SharedNodePointer& node, nodeSnapshot->getNodes()) {
+            OctreeQueryNode* nodeData = static_cast<OctreeQueryNode*>(node->getLinkedData());
+            if (nodeData && nodeData->getSendRateController().hasFeedback()) {
+                const SendRateController& sendRateController = nodeData->getSendRateController();
+                float rate = sendRateController.getPacketsPerSecond();
+                minAdaptiveRate = (numAdaptiveClients == 0) ? rate : std::min(minAdaptiveRate, rate);
+                maxAdaptiveRate = std::max(maxAdaptiveRate, rate);
+                totalAdaptiveRate += rate;
+                totalBackoffs += sendRateController.getBackoffCount();
+                if (sendRateController.isInSlowStart()) {
+                    numSlowStartClients++;
+                }
+                numAdaptiveClients++;
+            }
+        }
+        statsString += QString("     Clients reporting feedback: %1 clients (%2 in slow start)\r\n")
+            .arg(locale.toString(numAdaptiveClients).rightJustified(COLUMN_WIDTH, ' '))
+            .arg(numSlowStartClients);
+        if (numAdaptiveClients > 0) {
+            statsString += QString().sprintf("    Adaptive send rate per client:  %9.1f pps (min %.1f, max %.1f)\r\n",
+                totalAdaptiveRate / numAdaptiveClients, minAdaptiveRate, maxAdaptiveRate);
+            statsString += QString("            Send rate backoffs: %1 backoffs\r\n")
+                .arg(locale.toString((uint)totalBackoffs).rightJustified(COLUMN_WIDTH, ' '));
+        }
+
         quint64 oneSecondAgo = usecTimestampNow() - USECS_PER_SECOND;
         
+        int numClientsDue;
+        int numClientsWaiting;
+        _sendScheduler.getQueueDepth(numClientsDue, numClientsWaiting);
+        statsString += QString("                     Send threads: %1 threads\r\n")
+            .arg(locale.toString(_sendScheduler.getNumWorkers()).rightJustified(COLUMN_WIDTH, ' '));
+        statsString += QString("    Clients due, waiting for send: %1 clients\r\n")
+            .arg(locale.toString(numClientsDue).rightJustified(COLUMN_WIDTH, ' '));
+        statsString += QString("   Clients waiting for next frame: %1 clients\r\n")
+            .arg(locale.toString(numClientsWaiting).rightJustified(COLUMN_WIDTH, ' '));
+        statsString += QString().sprintf("       Average scheduling latency:      %9.2f usecs (max %llu usecs)\r\n\r\n",
+            _sendScheduler.getAverageSchedulingLatency(), _sendScheduler.getMaxSchedulingLatency());
+
         statsString += QString("            process() last second: %1 clients\r\n")
             .arg(locale.toString((uint)howManyThreadsDidProcess(oneSecondAgo)).rightJustified(COLUMN_WIDTH, ' '));
         statsString += QString("  packetDistributor() last second: %1 clients\r\n")
@@ -567,6 +639,26 @@ bool OctreeServer::handleHTTPRequest(HTTPConnection* connection, const QUrl& url
                                          _averageExtraLongCompressTime.getAverage(), 
                                          extraLongVsTotalCompress * AS_PERCENT, _extraLongCompress);
 
+        if (_tree && _tree->canCacheEncodedSubtrees()) {
+            statsString += QString().sprintf("           Subtree cache hit ratio:      %6.2f%% (%s hits, %s misses)\r\n",
+                _subtreeCache.getHitRatio() * AS_PERCENT,
+                locale.toString((uint)_subtreeCache.getHits()).toLocal8Bit().constData(),
+                locale.toString((uint)_subtreeCache.getMisses()).toLocal8Bit().constData());
+            statsString += QString("     Bytes served from subtree cache: %1 bytes\r\n")
+                .arg(locale.toString((qulonglong)_subtreeCache.getBytesServed()).rightJustified(COLUMN_WIDTH, ' '));
+            statsString += QString("                Subtree cache size: %1 bytes in %2 subtrees (max %3 bytes)\r\n\r\n")
+                .arg(locale.toString(_subtreeCache.getSizeBytes()).rightJustified(COLUMN_WIDTH, ' '))
+                .arg(locale.toString(_subtreeCache.getSliceCount()))
+                .arg(locale.toString(_subtreeCache.getMaxSizeBytes()));
+        }
+
+        if (_tree && _tree->supportsSnapshotReads()) {
+            statsString += QString("               Snapshot tree readers: %1\r\n")
+                .arg(locale.toString(OctreeElementReclaimer::getActiveReaderCount()).rightJustified(COLUMN_WIDTH, ' '));
+            statsString += QString("    Retired elements waiting on reads: %1\r\n\r\n")
+                .arg(locale.toString(OctreeElementReclaimer::getRetiredCount()).rightJustified(COLUMN_WIDTH, ' '));
+        }
+
         float averagePacketSendingTime = getAveragePacketSendingTime();
         statsString += QString().sprintf("         Average packet sending time:    %9.2f usecs (includes node lock)\r\n", 
                                         averagePacketSendingTime);
@@ -651,6 +743,26 @@ bool OctreeServer::handleHTTPRequest(HTTPConnection* connection, const QUrl& url
         statsString += QString("  Average Wait Lock Time/Element: %1 usecs\r\n")
             .arg(locale.toString((uint)averageLockWaitTimePerElement).rightJustified(COLUMN_WIDTH, ' '));
 
+        // the queue edits wait in before they are processed, one sender at a time
+        PacketQueue& inboundQueue = _octreeInboundPacketProcessor->getPacketQueue();
+        QVector<quint64> queueWaitHistogram = inboundQueue.getWaitUsecsHistogram();
+        statsString += QString("            Inbound Queue Depth: %1 packets\r\n")
+            .arg(locale.toString((uint)inboundQueue.size()).rightJustified(COLUMN_WIDTH, ' '));
+        statsString += QString("        Max Inbound Queue Depth: %1 packets\r\n")
+            .arg(locale.toString((uint)inboundQueue.getMaxDepth()).rightJustified(COLUMN_WIDTH, ' '));
+        statsString += QString("        Dropped Inbound Packets: %1 packets\r\n")
+            .arg(locale.toString((uint)inboundQueue.getDroppedCount()).rightJustified(COLUMN_WIDTH, ' '));
+        statsString += QString("     Inbound Queue Wait, median: %1 usecs or less\r\n")
+            .arg(locale.toString((uint)PacketQueue::histogramPercentile(queueWaitHistogram, 0.5f))
+                 .rightJustified(COLUMN_WIDTH, ' '));
+        statsString += QString("       Inbound Queue Wait, 99th: %1 usecs or less\r\n")
+            .arg(locale.toString((uint)PacketQueue::histogramPercentile(queueWaitHistogram, 0.99f))
+                 .rightJustified(COLUMN_WIDTH, ' '));
+        statsString += QString("  Inbound Queue Depth Histogram: %1\r\n")
+            .arg(PacketQueue::histogramToString(inboundQueue.getDepthHistogram()));
+        statsString += QString("   Inbound Queue Wait Histogram: %1 (usecs)\r\n")
+            .arg(PacketQueue::histogramToString(queueWaitHistogram));
+
 
         int senderNumber = 0;
         NodeToSenderStatsMap& allSenderStats = _octreeInboundPacketProcessor->getSingleSenderStats();
@@ -733,46 +845,19 @@ bool OctreeServer::handleHTTPRequest(HTTPConnection* connection, const QUrl& url
         statsString += QString("                    Total:      %1 nodes\r\n")
             .arg(locale.toString((uint)checkSum).rightJustified(16, ' '));
 
-#ifdef BLENDED_UNION_CHILDREN
         statsString += "\r\n";
         statsString += "OctreeElement Children Encoding Statistics...\r\n";
-
-        statsString += QString().sprintf("    Single or No Children:      %10.llu nodes (%5.2f%%)\r\n",
-             OctreeElement::getSingleChildrenCount(),
-             ((float)OctreeElement::getSingleChildrenCount() / (float)nodeCount) * AS_PERCENT));
-        statsString += QString().sprintf("    Two Children as Offset:     %10.llu nodes (%5.2f%%)\r\n",
-             OctreeElement::getTwoChildrenOffsetCount(),
-             ((float)OctreeElement::getTwoChildrenOffsetCount() / (float)nodeCount) * AS_PERCENT));
-        statsString += QString().sprintf("    Two Children as External:   %10.llu nodes (%5.2f%%)\r\n",
-             OctreeElement::getTwoChildrenExternalCount(),
-             ((float)OctreeElement::getTwoChildrenExternalCount() / (float)nodeCount) * AS_PERCENT);
-        statsString += QString().sprintf("    Three Children as Offset:   %10.llu nodes (%5.2f%%)\r\n",
-             OctreeElement::getThreeChildrenOffsetCount(),
-             ((float)OctreeElement::getThreeChildrenOffsetCount() / (float)nodeCount) * AS_PERCENT);
-        statsString += QString().sprintf("    Three Children as External: %10.llu nodes (%5.2f%%)\r\n",
-             OctreeElement::getThreeChildrenExternalCount(),
-             ((float)OctreeElement::getThreeChildrenExternalCount() / (float)nodeCount) * AS_PERCENT);
-        statsString += QString().sprintf("    Children as External Array: %10.llu nodes (%5.2f%%)\r\n",
-             OctreeElement::getExternalChildrenCount(),
-             ((float)OctreeElement::getExternalChildrenCount() / (float)nodeCount) * AS_PERCENT);
-
-        checkSum = OctreeElement::getSingleChildrenCount() +
-        OctreeElement::getTwoChildrenOffsetCount() + OctreeElement::getTwoChildrenExternalCount() +
-        OctreeElement::getThreeChildrenOffsetCount() + OctreeElement::getThreeChildrenExternalCount() +
-        OctreeElement::getExternalChildrenCount();
-
-        statsString += "                                ----------------\r\n";
-        statsString += QString().sprintf("                         Total: %10.llu nodes\r\n", checkSum);
-        statsString += QString().sprintf("                      Expected: %10.lu nodes\r\n", nodeCount);
-
-        statsString += "\r\n";
-        statsString += "In other news....\r\n";
-
-        statsString += QString().sprintf("could store 4 children internally:     %10.llu nodes\r\n",
-                                         OctreeElement::getCouldStoreFourChildrenInternally());
-        statsString += QString().sprintf("could NOT store 4 children internally: %10.llu nodes\r\n",
-                                         OctreeElement::getCouldNotStoreFourChildrenInternally());
-#endif
+        statsString += QString().sprintf("    Children as Index Block:    %s nodes (%5.2f%%)\r\n",
+            locale.toString((uint)OctreeElement::getExternalChildrenCount()).rightJustified(16, ' ').toLocal8Bit().constData(),
+            ((float)OctreeElement::getExternalChildrenCount() / (float)nodeCount) * AS_PERCENT);
+        statsString += QString().sprintf("    Slab Reserved Memory:       %8.2f %s\r\n",
+                                         OctreeElementSlab::getTotalReservedBytes() / memoryScale, memoryScaleLabel);
+        OctreeElementIndex* elementIndex = _tree->getElementIndex();
+        if (elementIndex) {
+            statsString += QString().sprintf("    Indexed Elements:           %s nodes in %s slots\r\n",
+                locale.toString(elementIndex->size()).rightJustified(16, ' ').toLocal8Bit().constData(),
+                locale.toString(elementIndex->getCapacity()).toLocal8Bit().constData());
+        }
 
         statsString += "\r\n\r\n";
         statsString += "</pre>\r\n";
@@ -833,45 +918,44 @@ void OctreeServer::readPendingDatagrams() {
     
     NodeList* nodeList = NodeList::getInstance();
     
-    while (readAvailableDatagram(receivedPacket, senderSockAddr)) {
-        if (nodeList->packetVersionAndHashMatch(receivedPacket)) {
-            PacketType packetType = packetTypeForPacket(receivedPacket);
-            SharedNodePointer matchingNode = nodeList->sendingNodeForPacket(receivedPacket);
-            if (packetType == getMyQueryMessageType()) {
-                // If we got a query packet, then we're talking to an agent, and we
-                // need to make sure we have it in our nodeList.
-                if (matchingNode) {
-                    nodeList->updateNodeWithDataFromPacket(matchingNode, receivedPacket);
-                    OctreeQueryNode* nodeData = (OctreeQueryNode*)matchingNode->getLinkedData();
-                    if (nodeData && !nodeData->isOctreeSendThreadInitalized()) {
-                        
-                        // NOTE: this is an important aspect of the proper ref counting. The send threads/node data need to 
-                        // know that the OctreeServer/Assignment will not get deleted on it while it's still active. The 
-                        // solution is to get the shared pointer for the current assignment. We need to make sure this is the 
-                        // same SharedAssignmentPointer that was ref counted by the assignment client.                    
-                        SharedAssignmentPointer sharedAssignment = AssignmentClient::getCurrentAssignment();
-                        nodeData->initializeOctreeSendThread(sharedAssignment, matchingNode);
-                    }
+    while (readVerifiedDatagram(receivedPacket, senderSockAddr)) {
+        PacketType packetType = packetTypeForPacket(receivedPacket);
+        SharedNodePointer matchingNode = nodeList->sendingNodeForPacket(receivedPacket);
+        if (packetType == getMyQueryMessageType()) {
+            // If we got a query packet, then we're talking to an agent, and we
+            // need to make sure we have it in our nodeList.
+            if (matchingNode) {
+                nodeList->updateNodeWithDataFromPacket(matchingNode, receivedPacket);
+                OctreeQueryNode* nodeData = (OctreeQueryNode*)matchingNode->getLinkedData();
+                if (nodeData && !nodeData->isOctreeSendThreadInitalized()) {
+                    
+                    // NOTE: this is an important aspect of the proper ref counting. The send threads/node data need to 
+                    // know that the OctreeServer/Assignment will not get deleted on it while it's still active. The 
+                    // solution is to get the shared pointer for the current assignment. We need to make sure this is the 
+                    // same SharedAssignmentPointer that was ref counted by the assignment client.                    
+                    SharedAssignmentPointer sharedAssignment = AssignmentClient::getCurrentAssignment();
+                    nodeData->initializeOctreeSendThread(sharedAssignment, matchingNode);
                 }
-            } else if (packetType == PacketTypeOctreeDataNack) {
-                // If we got a nack packet, then we're talking to an agent, and we
-                // need to make sure we have it in our nodeList.
-                if (matchingNode) {
-                    OctreeQueryNode* nodeData = (OctreeQueryNode*)matchingNode->getLinkedData();
-                    if (nodeData) {
-                        nodeData->parseNackPacket(receivedPacket);
-                    }
+            }
+        } else if (packetType == PacketTypeOctreeDataNack) {
+            // If we got a nack packet, then we're talking to an agent, and we
+            // need to make sure we have it in our nodeList.
+            if (matchingNode) {
+                OctreeQueryNode* nodeData = (OctreeQueryNode*)matchingNode->getLinkedData();
+                if (nodeData) {
+                    nodeData->parseNackPacket(receivedPacket);
                 }
-            } else if (packetType == PacketTypeJurisdictionRequest) {
-                _jurisdictionSender->queueReceivedPacket(matchingNode, receivedPacket);
-            } else if (packetType == PacketTypeSignedTransactionPayment) {
-                handleSignedTransactionPayment(packetType, receivedPacket);
-            } else if (_octreeInboundPacketProcessor && getOctree()->handlesEditPacketType(packetType)) {
-                _octreeInboundPacketProcessor->queueReceivedPacket(matchingNode, receivedPacket);
-            } else {
-                // let processNodeData handle it.
-                NodeList::getInstance()->processNodeData(senderSockAddr, receivedPacket);
             }
+        } else if (packetType == PacketTypeJurisdictionRequest) {
+            // this and the edits only come through here when the socket isn't read on its own thread
+            _jurisdictionSender->queueReceivedPacket(matchingNode, receivedPacket);
+        } else if (packetType == PacketTypeSignedTransactionPayment) {
+            handleSignedTransactionPayment(packetType, receivedPacket);
+        } else if (_octreeInboundPacketProcessor && getOctree()->handlesEditPacketType(packetType)) {
+            _octreeInboundPacketProcessor->queueReceivedPacket(matchingNode, receivedPacket);
+        } else {
+            // let processNodeData handle it.
+            NodeList::getInstance()->processNodeData(senderSockAddr, receivedPacket);
         }
     }
 }
@@ -885,6 +969,7 @@ void OctreeServer::run() {
     
     // use common init to setup common timers and logging
     commonInit(getMyLoggingServerTargetName(), getMyNodeType());
+    enableBatchedDatagramReads();
 
     // Now would be a good time to parse our arguments, if we got them as assignment
     if (getPayload().size() > 0) {
@@ -969,6 +1054,23 @@ void OctreeServer::run() {
     _debugReceiving =  cmdOptionExists(_argc, _argv, DEBUG_RECEIVING);
     qDebug("debugReceiving=%s", debug::valueOf(_debugReceiving));
 
+    // scenes are sent in whatever order the elements come out of the bag rather than nearest and coarsest first,
+    // compare the time to a useful scene the clients get in their stats with and without it
+    const char* UNORDERED_SCENE_BAG = "--unorderedSceneBag";
+    _unorderedSceneBag = cmdOptionExists(_argc, _argv, UNORDERED_SCENE_BAG);
+    qDebug("unorderedSceneBag=%s", debug::valueOf(_unorderedSceneBag));
+
+    // edits find the elements they change from an index rather than by descending the tree, compare the process
+    // time per element on the stats page with and without it
+    const char* ELEMENT_INDEX = "--elementIndex";
+    bool wantElementIndex = cmdOptionExists(_argc, _argv, ELEMENT_INDEX);
+    qDebug("elementIndex=%s", debug::valueOf(wantElementIndex));
+    if (wantElementIndex) {
+        _tree->lockForWrite();
+        _tree->setUseElementIndex(true);
+        _tree->unlock();
+    }
+
     // By default we will persist, if you want to disable this, then pass in this parameter
     const char* NO_PERSIST = "--NoPersist";
     if (cmdOptionExists(_argc, _argv, NO_PERSIST)) {
@@ -990,8 +1092,17 @@ void OctreeServer::run() {
 
         qDebug("persistFilename=%s", _persistFilename);
 
+        const char* PERSIST_BACKUPS = "--persistBackups";
+        const char* persistBackupsParameter = getCmdOption(_argc, _argv, PERSIST_BACKUPS);
+        int persistBackups = OctreePersistThread::DEFAULT_PERSIST_BACKUPS;
+        if (persistBackupsParameter) {
+            persistBackups = std::max(0, atoi(persistBackupsParameter));
+        }
+        qDebug("persistBackups=%d", persistBackups);
+
         // now set up PersistThread
-        _persistThread = new OctreePersistThread(_tree, _persistFilename);
+        _persistThread = new OctreePersistThread(_tree, _persistFilename, OctreePersistThread::DEFAULT_PERSIST_INTERVAL,
+                                                 persistBackups);
         if (_persistThread) {
             _persistThread->initialize(true);
         }
@@ -1020,6 +1131,21 @@ void OctreeServer::run() {
     qDebug("packetsPerSecondPerClientMax=%s _packetsPerClientPerInterval=%d", 
                     packetsPerSecondPerClientMax, _packetsPerClientPerInterval);
 
+    // Check to see if the user passed in a command line option for the most we send to a client that reports feedback,
+    // an explicit per client max holds for those clients too
+    const char* ADAPTIVE_PACKETS_PER_SECOND_PER_CLIENT_MAX = "--adaptivePacketsPerSecondPerClientMax";
+    const char* adaptivePacketsPerSecondPerClientMax = getCmdOption(_argc, _argv, ADAPTIVE_PACKETS_PER_SECOND_PER_CLIENT_MAX);
+    if (adaptivePacketsPerSecondPerClientMax) {
+        _adaptivePacketsPerClientPerInterval = atoi(adaptivePacketsPerSecondPerClientMax) / INTERVALS_PER_SECOND;
+        if (_adaptivePacketsPerClientPerInterval < 1) {
+            _adaptivePacketsPerClientPerInterval = 1;
+        }
+    } else if (packetsPerSecondPerClientMax) {
+        _adaptivePacketsPerClientPerInterval = _packetsPerClientPerInterval;
+    }
+    qDebug("adaptivePacketsPerSecondPerClientMax=%s _adaptivePacketsPerClientPerInterval=%d",
+                    adaptivePacketsPerSecondPerClientMax, _adaptivePacketsPerClientPerInterval);
+
     // Check to see if the user passed in a command line option for setting packet send rate
     const char* PACKETS_PER_SECOND_TOTAL_MAX = "--packetsPerSecondTotalMax";
     const char* packetsPerSecondTotalMax = getCmdOption(_argc, _argv, PACKETS_PER_SECOND_TOTAL_MAX);
@@ -1032,6 +1158,16 @@ void OctreeServer::run() {
     qDebug("packetsPerSecondTotalMax=%s _packetsTotalPerInterval=%d", 
                     packetsPerSecondTotalMax, _packetsTotalPerInterval);
 
+    // Check to see if the user passed in a command line option for the number of threads sending to clients
+    const char* SEND_THREADS = "--sendThreads";
+    const char* sendThreads = getCmdOption(_argc, _argv, SEND_THREADS);
+    int numSendThreads = DEFAULT_NUM_SEND_THREADS;
+    if (sendThreads) {
+        numSendThreads = std::max(1, std::min(atoi(sendThreads), MAX_NUM_SEND_THREADS));
+    }
+    qDebug("sendThreads=%s numSendThreads=%d", sendThreads, numSendThreads);
+    _sendScheduler.start(numSendThreads);
+
     HifiSockAddr senderSockAddr;
 
     // set up our jurisdiction broadcaster...
@@ -1045,6 +1181,21 @@ void OctreeServer::run() {
     _octreeInboundPacketProcessor = new OctreeInboundPacketProcessor(this);
     _octreeInboundPacketProcessor->initialize(true);
 
+    PacketReceiver* packetReceiver = createPacketReceiver();
+    if (packetReceiver) {
+        // edits and jurisdiction requests go straight from the receive thread to the threads that handle them,
+        // queries and nacks still come through readPendingDatagrams
+        QSet<PacketType> editPacketTypes;
+        for (int packetType = PacketTypeUnknown; packetType <= PacketTypeSignedTransactionPayment; packetType++) {
+            if (getOctree()->handlesEditPacketType((PacketType) packetType)) {
+                editPacketTypes << (PacketType) packetType;
+            }
+        }
+        packetReceiver->routeToProcessor(editPacketTypes, _octreeInboundPacketProcessor);
+        packetReceiver->routeToProcessor(QSet<PacketType>() << PacketTypeJurisdictionRequest, _jurisdictionSender);
+        startPacketReceiver();
+    }
+
     // Convert now to tm struct for local timezone
     tm* localtm = localtime(&_started);
     const int MAX_TIME_LENGTH = 128;
@@ -1275,6 +1426,11 @@ void OctreeServer::sendStatsPacket() {
         
     statsObject1[baseName + QString(".0.3.uptime")] = getUptime();
     statsObject1[baseName + QString(".0.4.persistFileLoadTime")] = getFileLoadTime();
+    if (_persistThread) {
+        statsObject1[baseName + QString(".0.4.persistLastSaveTime")] = (double)_persistThread->getLastSaveElapsedTime();
+        statsObject1[baseName + QString(".0.4.persistLastSaveBytes")] = (double)_persistThread->getLastSaveBytes();
+        statsObject1[baseName + QString(".0.4.persistLastSaveLockTime")] = (double)_persistThread->getLastSaveLockTime();
+    }
     statsObject1[baseName + QString(".0.5.clients")] = getCurrentClientCount();
     
     quint64 oneSecondAgo = usecTimestampNow() - USECS_PER_SECOND;
@@ -1331,6 +1487,16 @@ void OctreeServer::sendStatsPacket() {
     statsObject3[baseName + QString(".3.inbound.timing.5.avgLockWaitTimePerElement")] = 
         (double)_octreeInboundPacketProcessor->getAverageLockWaitTimePerElement();
 
+    PacketQueue& inboundQueue = _octreeInboundPacketProcessor->getPacketQueue();
+    QVector<quint64> queueWaitHistogram = inboundQueue.getWaitUsecsHistogram();
+    statsObject3[baseName + QString(".3.inbound.queue.1.depth")] = (double)inboundQueue.size();
+    statsObject3[baseName + QString(".3.inbound.queue.2.maxDepth")] = (double)inboundQueue.getMaxDepth();
+    statsObject3[baseName + QString(".3.inbound.queue.3.dropped")] = (double)inboundQueue.getDroppedCount();
+    statsObject3[baseName + QString(".3.inbound.queue.4.medianWaitTime")] =
+        (double)PacketQueue::histogramPercentile(queueWaitHistogram, 0.5f);
+    statsObject3[baseName + QString(".3.inbound.queue.5.99thPercentileWaitTime")] =
+        (double)PacketQueue::histogramPercentile(queueWaitHistogram, 0.99f);
+
     NodeList::getInstance()->sendStatsToDomainServer(statsObject3);
 }
 
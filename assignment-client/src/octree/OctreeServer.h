@@ -20,13 +20,16 @@
 
 #include <ThreadedAssignment.h>
 #include <EnvironmentData.h>
+#include <OctreeSubtreeCache.h>
 
 #include "OctreePersistThread.h"
+#include "OctreeSendScheduler.h"
 #include "OctreeSendThread.h"
 #include "OctreeServerConsts.h"
 #include "OctreeInboundPacketProcessor.h"
 
 const int DEFAULT_PACKETS_PER_INTERVAL = 2000; // some 120,000 packets per second total
+const int DEFAULT_ADAPTIVE_PACKETS_PER_CLIENT_PER_INTERVAL = 100; // some 6,000 packets per second to a fast client
 
 /// Handles assignments of type OctreeServer - sending octrees to various clients.
 class OctreeServer : public ThreadedAssignment, public HTTPRequestHandler {
@@ -41,14 +44,22 @@ public:
     bool wantsDebugSending() const { return _debugSending; }
     bool wantsDebugReceiving() const { return _debugReceiving; }
     bool wantsVerboseDebug() const { return _verboseDebug; }
+    bool wantsUnorderedSceneBag() const { return _unorderedSceneBag; }
 
     Octree* getOctree() { return _tree; }
     JurisdictionMap* getJurisdiction() { return _jurisdiction; }
+    OctreeSendScheduler* getSendScheduler() { return &_sendScheduler; }
+    OctreeSubtreeCache* getSubtreeCache() { return _tree->canCacheEncodedSubtrees() ? &_subtreeCache : NULL; }
 
     int getPacketsPerClientPerInterval() const { return std::min(_packetsPerClientPerInterval, 
                                 std::max(1, getPacketsTotalPerInterval() / std::max(1, getCurrentClientCount()))); }
 
     int getPacketsPerClientPerSecond() const { return getPacketsPerClientPerInterval() * INTERVALS_PER_SECOND; }
+
+    /// the most we send to a client that reports how its receiving is going, whose rate then follows its link
+    int getAdaptivePacketsPerClientPerInterval() const { return std::min(_adaptivePacketsPerClientPerInterval,
+                                std::max(1, getPacketsTotalPerInterval() / std::max(1, getCurrentClientCount()))); }
+    int getAdaptivePacketsPerClientPerSecond() const { return getAdaptivePacketsPerClientPerInterval() * INTERVALS_PER_SECOND; }
     int getPacketsTotalPerInterval() const { return _packetsTotalPerInterval; }
     int getPacketsTotalPerSecond() const { return getPacketsTotalPerInterval() * INTERVALS_PER_SECOND; }
     
@@ -151,16 +162,20 @@ protected:
 
     char _persistFilename[MAX_FILENAME_LENGTH];
     int _packetsPerClientPerInterval;
+    int _adaptivePacketsPerClientPerInterval;
     int _packetsTotalPerInterval;
     Octree* _tree; // this IS a reaveraging tree
     bool _wantPersist;
     bool _debugSending;
     bool _debugReceiving;
     bool _verboseDebug;
+    bool _unorderedSceneBag;
     JurisdictionMap* _jurisdiction;
     JurisdictionSender* _jurisdictionSender;
     OctreeInboundPacketProcessor* _octreeInboundPacketProcessor;
     OctreePersistThread* _persistThread;
+    OctreeSendScheduler _sendScheduler; // runs the senders of all the clients on a fixed pool of threads
+    OctreeSubtreeCache _subtreeCache; // encoded subtrees shared by all the send threads
 
     static OctreeServer* _instance;
 
@@ -44,8 +44,17 @@ DomainServer::DomainServer(int argc, char* argv[]) :
     _sessionAuthenticationHash(),
     _webAuthenticationStateSet(),
     _cookieSessionHash(),
-    _settingsManager()
+    _settingsManager(),
+    _domainListStatsTimer(),
+    _domainListBytesSent(0),
+    _numFullDomainListsSent(0),
+    _numDeltaDomainListsSent(0),
+    _domainListBytesPerSecond(0.0f),
+    _fullDomainListsPerSecond(0.0f),
+    _deltaDomainListsPerSecond(0.0f)
 {
+    _domainListStatsTimer.start();
+
     setOrganizationName("High Fidelity");
     setOrganizationDomain("highfidelity.io");
     setApplicationName("domain-server");
@@ -571,75 +580,153 @@ NodeSet DomainServer::nodeInterestListFromPacket(const QByteArray& packet, int n
     return nodeInterestSet;
 }
 
-void DomainServer::sendDomainListToNode(const SharedNodePointer& node, const HifiSockAddr &senderSockAddr,
-                                        const NodeSet& nodeInterestList) {
+quint32 DomainServer::domainListVersionFromPacket(const QByteArray& packet, int numPreceedingBytes) {
+    QDataStream packetStream(packet);
+    packetStream.skipRawData(numPreceedingBytes);
 
-    QByteArray broadcastPacket = byteArrayWithPopulatedHeader(PacketTypeDomainList);
+    // the acked version follows the node interest list
+    quint8 numInterestTypes = 0;
+    packetStream >> numInterestTypes;
+    packetStream.skipRawData(numInterestTypes * sizeof(NodeType_t));
 
-    // always send the node their own UUID back
-    QDataStream broadcastDataStream(&broadcastPacket, QIODevice::Append);
-    broadcastDataStream << node->getUUID();
+    quint32 ackedListVersion = 0;
+    if (!packetStream.atEnd()) {
+        packetStream >> ackedListVersion;
+    }
 
-    int numBroadcastPacketLeadBytes = broadcastDataStream.device()->pos();
+    return ackedListVersion;
+}
+
+void DomainServer::sendDomainListToNode(const SharedNodePointer& node, const HifiSockAddr &senderSockAddr,
+                                        const NodeSet& nodeInterestList, quint32 ackedListVersion) {
+
+    if (nodeInterestList.size() == 0) {
+        return;
+    }
 
     DomainServerNodeData* nodeData = reinterpret_cast<DomainServerNodeData*>(node->getLinkedData());
 
     LimitedNodeList* nodeList = LimitedNodeList::getInstance();
 
-    if (nodeInterestList.size() > 0) {
-
-//        DTLSServerSession* dtlsSession = _isUsingDTLS ? _dtlsSessions[senderSockAddr] : NULL;
-        int dataMTU = MAX_PACKET_SIZE;
+    // pack the entry for every node this node is interested in, the same way whether or not it has changed
+    QHash<QUuid, QByteArray> listEntries;
 
-        if (nodeData->isAuthenticated()) {
-            // if this authenticated node has any interest types, send back those nodes as well
-            foreach (const SharedNodePointer& otherNode, nodeList->getNodeHash()) {
+    if (nodeData->isAuthenticated()) {
+        // if this authenticated node has any interest types, send back those nodes as well
+        SharedNodeSnapshot nodeSnapshot = nodeList->getNodeSnapshot();
+        const QVector<SharedNodePointer>& otherNodes = nodeSnapshot->getNodes();
+        for (int i = 0; i < otherNodes.size(); i++) {
+            const SharedNodePointer& otherNode = otherNodes[i];
 
-                // reset our nodeByteArray and nodeDataStream
+            if (otherNode->getUUID() != node->getUUID() && nodeInterestList.contains(otherNode->getType())) {
                 QByteArray nodeByteArray;
                 QDataStream nodeDataStream(&nodeByteArray, QIODevice::Append);
 
-                if (otherNode->getUUID() != node->getUUID() && nodeInterestList.contains(otherNode->getType())) {
-
-                    // don't send avatar nodes to other avatars, that will come from avatar mixer
-                    nodeDataStream << *otherNode.data();
+                // don't send avatar nodes to other avatars, that will come from avatar mixer
+                nodeDataStream << *otherNode.data();
 
-                    // pack the secret that these two nodes will use to communicate with each other
-                    QUuid secretUUID = nodeData->getSessionSecretHash().value(otherNode->getUUID());
-                    if (secretUUID.isNull()) {
-                        // generate a new secret UUID these two nodes can use
-                        secretUUID = QUuid::createUuid();
+                // pack the secret that these two nodes will use to communicate with each other
+                QUuid secretUUID = nodeData->getSessionSecretHash().value(otherNode->getUUID());
+                if (secretUUID.isNull()) {
+                    // generate a new secret UUID these two nodes can use
+                    secretUUID = QUuid::createUuid();
 
-                        // set that on the current Node's sessionSecretHash
-                        nodeData->getSessionSecretHash().insert(otherNode->getUUID(), secretUUID);
+                    // set that on the current Node's sessionSecretHash
+                    nodeData->getSessionSecretHash().insert(otherNode->getUUID(), secretUUID);
 
-                        // set it on the other Node's sessionSecretHash
-                        reinterpret_cast<DomainServerNodeData*>(otherNode->getLinkedData())
-                        ->getSessionSecretHash().insert(node->getUUID(), secretUUID);
-
-                    }
+                    // set it on the other Node's sessionSecretHash
+                    reinterpret_cast<DomainServerNodeData*>(otherNode->getLinkedData())
+                    ->getSessionSecretHash().insert(node->getUUID(), secretUUID);
 
-                    nodeDataStream << secretUUID;
+                }
 
-                    if (broadcastPacket.size() +  nodeByteArray.size() > dataMTU) {
-                        // we need to break here and start a new packet
-                        // so send the current one
+                nodeDataStream << secretUUID;
 
-                        nodeList->writeDatagram(broadcastPacket, node, senderSockAddr);
+                listEntries.insert(otherNode->getUUID(), nodeByteArray);
+            }
+        }
+    }
 
-                        // reset the broadcastPacket structure
-                        broadcastPacket.resize(numBroadcastPacketLeadBytes);
-                        broadcastDataStream.device()->seek(numBroadcastPacketLeadBytes);
-                    }
+    // if the node has everything we last sent it, it only needs what changed since, otherwise it gets the whole list
+    QHash<QUuid, QByteArray>& sentEntries = nodeData->getSentDomainListEntries();
+    bool isFullList = ackedListVersion == 0 || ackedListVersion != nodeData->getSentDomainListVersion();
 
-                    // append the nodeByteArray to the current state of broadcastDataStream
-                    broadcastPacket.append(nodeByteArray);
-                }
+    QList<QByteArray> changedEntries;
+    for (QHash<QUuid, QByteArray>::const_iterator entry = listEntries.constBegin(); entry != listEntries.constEnd(); entry++) {
+        if (isFullList || sentEntries.value(entry.key()) != entry.value()) {
+            changedEntries.append(QByteArray(1, DOMAIN_LIST_NODE_ENTRY) + entry.value());
+        }
+    }
+    if (!isFullList) {
+        for (QHash<QUuid, QByteArray>::const_iterator entry = sentEntries.constBegin(); entry != sentEntries.constEnd();
+             entry++) {
+            if (!listEntries.contains(entry.key())) {
+                changedEntries.append(QByteArray(1, DOMAIN_LIST_REMOVED_NODE_ENTRY) + entry.key().toRfc4122());
             }
         }
+    }
 
-        // always write the last broadcastPacket
-        nodeList->writeDatagram(broadcastPacket, node, senderSockAddr);
+    // an unchanged list keeps its version, and the node gets an empty list as the reply to its check in
+    quint32 listVersion = nodeData->getSentDomainListVersion();
+    if (isFullList || !changedEntries.isEmpty()) {
+        // 0 means nothing was sent yet, so the version skips it if it ever wraps
+        if (++listVersion == 0) {
+            listVersion = 1;
+        }
+    }
+    nodeData->setSentDomainListVersion(listVersion);
+    sentEntries = listEntries;
+
+    // always send the node their own UUID back, along with the list version and which part of the list this is
+    QByteArray listPacketHeader = byteArrayWithPopulatedHeader(PacketTypeDomainList);
+    QDataStream listPacketHeaderStream(&listPacketHeader, QIODevice::Append);
+    listPacketHeaderStream << node->getUUID() << listVersion << (quint8) isFullList;
+    int numListPacketLeadBytes = listPacketHeader.size() + 2 * sizeof(quint16);
+
+    // split the entries into as many packets as it takes, every part says how many there are so the node can tell
+    // when it has the whole list
+    QList<QByteArray> listParts;
+    QByteArray listPart;
+    foreach (const QByteArray& changedEntry, changedEntries) {
+        if (numListPacketLeadBytes + listPart.size() + changedEntry.size() > MAX_PACKET_SIZE && !listPart.isEmpty()) {
+            listParts.append(listPart);
+            listPart.clear();
+        }
+        listPart.append(changedEntry);
+    }
+    listParts.append(listPart);
+
+    for (int i = 0; i < listParts.size(); i++) {
+        QByteArray listPacket = listPacketHeader;
+        QDataStream listPacketStream(&listPacket, QIODevice::Append);
+        listPacketStream << (quint16) i << (quint16) listParts.size();
+        listPacket.append(listParts[i]);
+
+        nodeList->writeDatagram(listPacket, node, senderSockAddr);
+        _domainListBytesSent += listPacket.size();
+    }
+
+    if (isFullList) {
+        _numFullDomainListsSent++;
+    } else {
+        _numDeltaDomainListsSent++;
+    }
+    updateDomainListStats();
+}
+
+void DomainServer::updateDomainListStats() {
+    // the rates are over the last interval of at least a second
+    qint64 elapsedMsecs = _domainListStatsTimer.elapsed();
+    if (elapsedMsecs >= (qint64)MSECS_PER_SECOND) {
+        float elapsedSeconds = elapsedMsecs / (float)MSECS_PER_SECOND;
+        _domainListBytesPerSecond = _domainListBytesSent / elapsedSeconds;
+        _fullDomainListsPerSecond = _numFullDomainListsSent / elapsedSeconds;
+        _deltaDomainListsPerSecond = _numDeltaDomainListsSent / elapsedSeconds;
+
+        _domainListBytesSent = 0;
+        _numFullDomainListsSent = 0;
+        _numDeltaDomainListsSent = 0;
+        _domainListStatsTimer.restart();
     }
 }
 
@@ -846,7 +933,8 @@ void DomainServer::processDatagram(const QByteArray& receivedPacket, const HifiS
                 quint64 timeNow = usecTimestampNow();
                 checkInNode->setLastHeardMicrostamp(timeNow);
 
-                sendDomainListToNode(checkInNode, senderSockAddr, nodeInterestListFromPacket(receivedPacket, numNodeInfoBytes));
+                sendDomainListToNode(checkInNode, senderSockAddr, nodeInterestListFromPacket(receivedPacket, numNodeInfoBytes),
+                                     domainListVersionFromPacket(receivedPacket, numNodeInfoBytes));
             }
         } else if (requestType == PacketTypeNodeJsonStats) {
             SharedNodePointer matchingNode = nodeList->sendingNodeForPacket(receivedPacket);
@@ -1049,6 +1137,19 @@ bool DomainServer::handleHTTPRequest(HTTPConnection* connection, const QUrl& url
             QJsonDocument transactionsDocument(rootObject);
             connection->respond(HTTPConnection::StatusCode200, transactionsDocument.toJson(), qPrintable(JSON_MIME_TYPE));
 
+            return true;
+        } else if (url.path() == "/stats.json") {
+            // the cost of keeping every node's list of the other nodes up to date
+            updateDomainListStats();
+
+            QJsonObject rootJSON;
+            rootJSON["domain_list_bytes_per_second"] = _domainListBytesPerSecond;
+            rootJSON["full_domain_lists_per_second"] = _fullDomainListsPerSecond;
+            rootJSON["delta_domain_lists_per_second"] = _deltaDomainListsPerSecond;
+
+            QJsonDocument statsDocument(rootJSON);
+            connection->respond(HTTPConnection::StatusCode200, statsDocument.toJson(), qPrintable(JSON_MIME_TYPE));
+
             return true;
         } else if (url.path() == QString("%1.json").arg(URI_NODES)) {
             // setup the JSON
@@ -13,6 +13,7 @@
 #define hifi_DomainServer_h
 
 #include <QtCore/QCoreApplication>
+#include <QtCore/QElapsedTimer>
 #include <QtCore/QHash>
 #include <QtCore/QJsonObject>
 #include <QtCore/QQueue>
@@ -68,8 +69,10 @@ private:
     int parseNodeDataFromByteArray(NodeType_t& nodeType, HifiSockAddr& publicSockAddr,
                                     HifiSockAddr& localSockAddr, const QByteArray& packet, const HifiSockAddr& senderSockAddr);
     NodeSet nodeInterestListFromPacket(const QByteArray& packet, int numPreceedingBytes);
+    quint32 domainListVersionFromPacket(const QByteArray& packet, int numPreceedingBytes);
     void sendDomainListToNode(const SharedNodePointer& node, const HifiSockAddr& senderSockAddr,
-                              const NodeSet& nodeInterestList);
+                              const NodeSet& nodeInterestList, quint32 ackedListVersion = 0);
+    void updateDomainListStats();
     
     void parseAssignmentConfigs(QSet<Assignment::Type>& excludedTypes);
     void addStaticAssignmentToAssignmentHash(Assignment* newAssignment);
@@ -121,6 +124,14 @@ private:
     QHash<QUuid, DomainServerWebSessionData> _cookieSessionHash;
     
     DomainServerSettingsManager _settingsManager;
+    
+    QElapsedTimer _domainListStatsTimer;
+    quint64 _domainListBytesSent;
+    int _numFullDomainListsSent;
+    int _numDeltaDomainListsSent;
+    float _domainListBytesPerSecond;
+    float _fullDomainListsPerSecond;
+    float _deltaDomainListsPerSecond;
 };
 
 #endif // hifi_DomainServer_h
@@ -19,6 +19,8 @@
 
 DomainServerNodeData::DomainServerNodeData() :
     _sessionSecretHash(),
+    _sentDomainListVersion(0),
+    _sentDomainListEntries(),
     _assignmentUUID(),
     _walletUUID(),
     _username(),
@@ -47,10 +47,19 @@ public:
     bool isAuthenticated() const { return _isAuthenticated; }
     
     QHash<QUuid, QUuid>& getSessionSecretHash() { return _sessionSecretHash; }
+    
+    /// the version of the last domain list sent to this node, 0 before the first
+    quint32 getSentDomainListVersion() const { return _sentDomainListVersion; }
+    void setSentDomainListVersion(quint32 sentDomainListVersion) { _sentDomainListVersion = sentDomainListVersion; }
+    
+    /// the packed entry of every node in the last domain list sent to this node, by node UUID
+    QHash<QUuid, QByteArray>& getSentDomainListEntries() { return _sentDomainListEntries; }
 private:
     QJsonObject mergeJSONStatsFromNewObject(const QJsonObject& newObject, QJsonObject destinationObject);
     
     QHash<QUuid, QUuid> _sessionSecretHash;
+    quint32 _sentDomainListVersion;
+    QHash<QUuid, QByteArray> _sentDomainListEntries;
     QUuid _assignmentUUID;
     QUuid _walletUUID;
     QString _username;
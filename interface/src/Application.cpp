@@ -2284,16 +2284,26 @@ int Application::sendNackPackets() {
             }
 
             // get sequence number stats of node, prune its missing set, and make a copy of the missing set
-            SequenceNumberStats& sequenceNumberStats = _octreeServerSceneStats[nodeUUID].getIncomingOctreeSequenceNumberStats();
+            OctreeSceneStats& sceneStats = _octreeServerSceneStats[nodeUUID];
+            SequenceNumberStats& sequenceNumberStats = sceneStats.getIncomingOctreeSequenceNumberStats();
             sequenceNumberStats.pruneMissingSet();
             const QSet<OCTREE_PACKET_SEQUENCE> missingSequenceNumbers = sequenceNumberStats.getMissingSet();
 
+            // the server sets how fast it sends to us by these - the flight time includes the clock skew between us and
+            // the server, so it is often negative
+            OCTREE_NACK_FEEDBACK_COUNT feedbackCounts[] = { sequenceNumberStats.getReceived(),
+                sequenceNumberStats.getLost() };
+            OCTREE_NACK_FEEDBACK_FLIGHT_TIME feedbackFlightTime = (OCTREE_NACK_FEEDBACK_FLIGHT_TIME)
+                glm::clamp(sceneStats.getIncomingFlightTimeAverage(), -MAX_OCTREE_NACK_FEEDBACK_FLIGHT_TIME_USECS,
+                           MAX_OCTREE_NACK_FEEDBACK_FLIGHT_TIME_USECS);
+
             _octreeSceneStatsLock.unlock();
 
-            // construct nack packet(s) for this node
+            // construct nack packet(s) for this node, there is always at least one so that the feedback goes out
             int numSequenceNumbersAvailable = missingSequenceNumbers.size();
             QSet<OCTREE_PACKET_SEQUENCE>::const_iterator missingSequenceNumbersIterator = missingSequenceNumbers.constBegin();
-            while (numSequenceNumbersAvailable > 0) {
+            bool isFirstPacket = true;
+            while (isFirstPacket || numSequenceNumbersAvailable > 0) {
 
                 char* dataAt = packet;
                 int bytesRemaining = MAX_PACKET_SIZE;
@@ -2303,6 +2313,10 @@ int Application::sendNackPackets() {
                 dataAt += numBytesPacketHeader;
                 bytesRemaining -= numBytesPacketHeader;
 
+                if (isFirstPacket) {
+                    bytesRemaining -= OCTREE_NACK_FEEDBACK_SIZE;
+                }
+
                 // calculate and pack the number of sequence numbers
                 int numSequenceNumbersRoomFor = (bytesRemaining - sizeof(uint16_t)) / sizeof(OCTREE_PACKET_SEQUENCE);
                 uint16_t numSequenceNumbers = min(numSequenceNumbersAvailable, numSequenceNumbersRoomFor);
@@ -2320,6 +2334,14 @@ int Application::sendNackPackets() {
                 }
                 numSequenceNumbersAvailable -= numSequenceNumbers;
 
+                if (isFirstPacket) {
+                    memcpy(dataAt, feedbackCounts, sizeof(feedbackCounts));
+                    dataAt += sizeof(feedbackCounts);
+                    memcpy(dataAt, &feedbackFlightTime, sizeof(feedbackFlightTime));
+                    dataAt += sizeof(feedbackFlightTime);
+                    isFirstPacket = false;
+                }
+
                 // send it
                 NodeList::getInstance()->writeUnverifiedDatagram(packet, dataAt - packet, node);
                 packetsSent++;
@@ -61,7 +61,7 @@ void OctreePacketProcessor::processPacket(const SharedNodePointer& sendingNode,
     } // fall through to piggyback message
     
     voxelPacketType = packetTypeForPacket(mutablePacket);
-    PacketVersion packetVersion = mutablePacket[1];
+    PacketVersion packetVersion = versionFromPacketHeader(mutablePacket.constData());
     PacketVersion expectedVersion = versionForPacketType(voxelPacketType);
     
     // check version of piggyback packet against expected version
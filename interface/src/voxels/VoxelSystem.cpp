@@ -1910,9 +1910,9 @@ void VoxelSystem::hideOutOfView(bool forceFullFrustum) {
 
     {
         PerformanceWarning warn(Menu::getInstance()->isOptionChecked(MenuOption::PipelineWarnings), 
-                            "VoxelSystem::... recurseTreeWithOperation(hideOutOfViewOperation)");
+                            "VoxelSystem::... recurseTreeInViewWithOperation(hideOutOfViewOperation)");
         _tree->lockForRead();
-        _tree->recurseTreeWithOperation(hideOutOfViewOperation,(void*)&args);
+        _tree->recurseTreeInViewWithOperation(args.thisViewFrustum, hideOutOfViewOperation, (void*)&args);
         _tree->unlock();
     }
     _lastCulledViewFrustum = args.thisViewFrustum; // save last stable
@@ -2006,13 +2006,13 @@ bool VoxelSystem::showAllSubTreeOperation(OctreeElement* element, void* extraDat
 // "hide" voxels in the VBOs that are still in the tree that but not in view.
 // We don't remove them from the tree, we don't delete them, we do remove them
 // from the VBOs and mark them as such in the tree.
-bool VoxelSystem::hideOutOfViewOperation(OctreeElement* element, void* extraData) {
+bool VoxelSystem::hideOutOfViewOperation(OctreeElement* element, ViewFrustum::location inFrustum, float furthestDistance,
+                                         void* extraData) {
     VoxelTreeElement* voxel = (VoxelTreeElement*)element;
     hideOutOfViewArgs* args = (hideOutOfViewArgs*)extraData;
     
     // If we're still recursing the tree using this operator, then we don't know if we're inside or outside...
-    // so before we move forward we need to determine our frustum location
-    ViewFrustum::location inFrustum = voxel->inFrustum(args->thisViewFrustum);
+    // the recursion determined our frustum location along with our siblings' before we got here
 
     // If we've culled at least once, then we will use the status of this voxel in the last culled frustum to determine
     // how to proceed. If we've never culled, then we just consider all these voxels to be UNKNOWN so that we will not
@@ -2076,7 +2076,7 @@ bool VoxelSystem::hideOutOfViewOperation(OctreeElement* element, void* extraData
             
             float voxelSizeScale = Menu::getInstance()->getVoxelSizeScale();
             int boundaryLevelAdjust = Menu::getInstance()->getBoundaryLevelAdjust();
-            bool shouldRender = voxel->calculateShouldRender(&args->thisViewFrustum, voxelSizeScale, boundaryLevelAdjust);
+            bool shouldRender = voxel->calculateShouldRenderAtDistance(furthestDistance, voxelSizeScale, boundaryLevelAdjust);
             voxel->setShouldRender(shouldRender);
             
             if (voxel->getShouldRender() && !voxel->isKnownBufferIndex()) {
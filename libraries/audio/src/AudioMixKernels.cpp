@@ -0,0 +1,220 @@
+//
+//  AudioMixKernels.cpp
+//  libraries/audio/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#include <math.h>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define AUDIO_MIX_KERNELS_SSE2
+#include <emmintrin.h>
+#endif
+
+#include "AudioMixKernels.h"
+
+static const float MIN_MIX_VALUE = -32768.0f;
+static const float MAX_MIX_VALUE = 32767.0f;
+
+const char* AudioMixKernels::getInstructionSetName() {
+#if defined(__AVX2__)
+    return "avx2";
+#elif defined(AUDIO_MIX_KERNELS_SSE2)
+    return "sse2";
+#else
+    return "scalar";
+#endif
+}
+
+void AudioMixKernels::mixMonoToStereoScalar(float* mixSamples, const int16_t* leftSource, float leftGain,
+                                            const int16_t* rightSource, float rightGain, int numFrames) {
+    for (int i = 0; i < numFrames; i++) {
+        mixSamples[2 * i] += leftSource[i] * leftGain;
+        mixSamples[(2 * i) + 1] += rightSource[i] * rightGain;
+    }
+}
+
+void AudioMixKernels::mixWithGainScalar(float* mixSamples, const int16_t* source, float gain, int numSamples) {
+    for (int i = 0; i < numSamples; i++) {
+        mixSamples[i] += source[i] * gain;
+    }
+}
+
+void AudioMixKernels::saturateMixScalar(int16_t* destination, const float* mixSamples, int numSamples) {
+    for (int i = 0; i < numSamples; i++) {
+        float sample = mixSamples[i];
+        if (sample < MIN_MIX_VALUE) {
+            sample = MIN_MIX_VALUE;
+        } else if (sample > MAX_MIX_VALUE) {
+            sample = MAX_MIX_VALUE;
+        }
+        // round half to even, the same as the default rounding mode of the vector conversions
+        destination[i] = (int16_t) lrintf(sample);
+    }
+}
+
+#if defined(__AVX2__)
+
+// sign extends 8 int16 samples to floats
+static inline __m256 loadSamples(const int16_t* source) {
+    __m128i samples = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source));
+    return _mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(samples));
+}
+
+void AudioMixKernels::mixMonoToStereo(float* mixSamples, const int16_t* leftSource, float leftGain,
+                                      const int16_t* rightSource, float rightGain, int numFrames) {
+    const int FRAMES_PER_STEP = 8;
+    __m256 leftGains = _mm256_set1_ps(leftGain);
+    __m256 rightGains = _mm256_set1_ps(rightGain);
+
+    int i = 0;
+    for (; i + FRAMES_PER_STEP <= numFrames; i += FRAMES_PER_STEP) {
+        __m256 left = _mm256_mul_ps(loadSamples(leftSource + i), leftGains);
+        __m256 right = _mm256_mul_ps(loadSamples(rightSource + i), rightGains);
+
+        // unpack interleaves inside each 128 bit lane, the permutes put the frames back in order
+        __m256 lowPairs = _mm256_unpacklo_ps(left, right);
+        __m256 highPairs = _mm256_unpackhi_ps(left, right);
+        __m256 firstFrames = _mm256_permute2f128_ps(lowPairs, highPairs, 0x20);
+        __m256 lastFrames = _mm256_permute2f128_ps(lowPairs, highPairs, 0x31);
+
+        float* mixAt = mixSamples + (2 * i);
+        _mm256_storeu_ps(mixAt, _mm256_add_ps(_mm256_loadu_ps(mixAt), firstFrames));
+        _mm256_storeu_ps(mixAt + 8, _mm256_add_ps(_mm256_loadu_ps(mixAt + 8), lastFrames));
+    }
+
+    mixMonoToStereoScalar(mixSamples + (2 * i), leftSource + i, leftGain, rightSource + i, rightGain, numFrames - i);
+}
+
+void AudioMixKernels::mixWithGain(float* mixSamples, const int16_t* source, float gain, int numSamples) {
+    const int SAMPLES_PER_STEP = 8;
+    __m256 gains = _mm256_set1_ps(gain);
+
+    int i = 0;
+    for (; i + SAMPLES_PER_STEP <= numSamples; i += SAMPLES_PER_STEP) {
+        __m256 mix = _mm256_add_ps(_mm256_loadu_ps(mixSamples + i), _mm256_mul_ps(loadSamples(source + i), gains));
+        _mm256_storeu_ps(mixSamples + i, mix);
+    }
+
+    mixWithGainScalar(mixSamples + i, source + i, gain, numSamples - i);
+}
+
+void AudioMixKernels::saturateMix(int16_t* destination, const float* mixSamples, int numSamples) {
+    const int SAMPLES_PER_STEP = 16;
+    __m256 minimum = _mm256_set1_ps(MIN_MIX_VALUE);
+    __m256 maximum = _mm256_set1_ps(MAX_MIX_VALUE);
+
+    int i = 0;
+    for (; i + SAMPLES_PER_STEP <= numSamples; i += SAMPLES_PER_STEP) {
+        // clamp before converting so that huge mixes can't wrap around in the int32 conversion
+        __m256 first = _mm256_min_ps(_mm256_max_ps(_mm256_loadu_ps(mixSamples + i), minimum), maximum);
+        __m256 second = _mm256_min_ps(_mm256_max_ps(_mm256_loadu_ps(mixSamples + i + 8), minimum), maximum);
+
+        // the pack works per 128 bit lane, so the 64 bit blocks come out as 0 2 1 3 and need to be reordered
+        __m256i packed = _mm256_packs_epi32(_mm256_cvtps_epi32(first), _mm256_cvtps_epi32(second));
+        packed = _mm256_permute4x64_epi64(packed, 0xD8);
+
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(destination + i), packed);
+    }
+
+    saturateMixScalar(destination + i, mixSamples + i, numSamples - i);
+}
+
+#elif defined(AUDIO_MIX_KERNELS_SSE2)
+
+// sign extends 8 int16 samples to two sets of 4 floats
+static inline void loadSamples(const int16_t* source, __m128& low, __m128& high) {
+    __m128i samples = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source));
+
+    // put each sample in the top half of a 32 bit lane, then shift it down to sign extend
+    low = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(samples, samples), 16));
+    high = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(samples, samples), 16));
+}
+
+static inline void addToMix(float* mixAt, __m128 samples) {
+    _mm_storeu_ps(mixAt, _mm_add_ps(_mm_loadu_ps(mixAt), samples));
+}
+
+void AudioMixKernels::mixMonoToStereo(float* mixSamples, const int16_t* leftSource, float leftGain,
+                                      const int16_t* rightSource, float rightGain, int numFrames) {
+    const int FRAMES_PER_STEP = 8;
+    __m128 leftGains = _mm_set1_ps(leftGain);
+    __m128 rightGains = _mm_set1_ps(rightGain);
+
+    int i = 0;
+    for (; i + FRAMES_PER_STEP <= numFrames; i += FRAMES_PER_STEP) {
+        __m128 leftLow, leftHigh, rightLow, rightHigh;
+        loadSamples(leftSource + i, leftLow, leftHigh);
+        loadSamples(rightSource + i, rightLow, rightHigh);
+
+        leftLow = _mm_mul_ps(leftLow, leftGains);
+        leftHigh = _mm_mul_ps(leftHigh, leftGains);
+        rightLow = _mm_mul_ps(rightLow, rightGains);
+        rightHigh = _mm_mul_ps(rightHigh, rightGains);
+
+        float* mixAt = mixSamples + (2 * i);
+        addToMix(mixAt, _mm_unpacklo_ps(leftLow, rightLow));
+        addToMix(mixAt + 4, _mm_unpackhi_ps(leftLow, rightLow));
+        addToMix(mixAt + 8, _mm_unpacklo_ps(leftHigh, rightHigh));
+        addToMix(mixAt + 12, _mm_unpackhi_ps(leftHigh, rightHigh));
+    }
+
+    mixMonoToStereoScalar(mixSamples + (2 * i), leftSource + i, leftGain, rightSource + i, rightGain, numFrames - i);
+}
+
+void AudioMixKernels::mixWithGain(float* mixSamples, const int16_t* source, float gain, int numSamples) {
+    const int SAMPLES_PER_STEP = 8;
+    __m128 gains = _mm_set1_ps(gain);
+
+    int i = 0;
+    for (; i + SAMPLES_PER_STEP <= numSamples; i += SAMPLES_PER_STEP) {
+        __m128 low, high;
+        loadSamples(source + i, low, high);
+
+        addToMix(mixSamples + i, _mm_mul_ps(low, gains));
+        addToMix(mixSamples + i + 4, _mm_mul_ps(high, gains));
+    }
+
+    mixWithGainScalar(mixSamples + i, source + i, gain, numSamples - i);
+}
+
+void AudioMixKernels::saturateMix(int16_t* destination, const float* mixSamples, int numSamples) {
+    const int SAMPLES_PER_STEP = 8;
+    __m128 minimum = _mm_set1_ps(MIN_MIX_VALUE);
+    __m128 maximum = _mm_set1_ps(MAX_MIX_VALUE);
+
+    int i = 0;
+    for (; i + SAMPLES_PER_STEP <= numSamples; i += SAMPLES_PER_STEP) {
+        // clamp before converting so that huge mixes can't wrap around in the int32 conversion
+        __m128 low = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(mixSamples + i), minimum), maximum);
+        __m128 high = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(mixSamples + i + 4), minimum), maximum);
+
+        __m128i packed = _mm_packs_epi32(_mm_cvtps_epi32(low), _mm_cvtps_epi32(high));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(destination + i), packed);
+    }
+
+    saturateMixScalar(destination + i, mixSamples + i, numSamples - i);
+}
+
+#else
+
+void AudioMixKernels::mixMonoToStereo(float* mixSamples, const int16_t* leftSource, float leftGain,
+                                      const int16_t* rightSource, float rightGain, int numFrames) {
+    mixMonoToStereoScalar(mixSamples, leftSource, leftGain, rightSource, rightGain, numFrames);
+}
+
+void AudioMixKernels::mixWithGain(float* mixSamples, const int16_t* source, float gain, int numSamples) {
+    mixWithGainScalar(mixSamples, source, gain, numSamples);
+}
+
+void AudioMixKernels::saturateMix(int16_t* destination, const float* mixSamples, int numSamples) {
+    saturateMixScalar(destination, mixSamples, numSamples);
+}
+
+#endif
@@ -0,0 +1,42 @@
+//
+//  AudioMixKernels.h
+//  libraries/audio/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#ifndef hifi_AudioMixKernels_h
+#define hifi_AudioMixKernels_h
+
+#include <stdint.h>
+
+/// Inner loops for mixing int16 streams into a float accumulator. Mixes are summed at full precision and only
+/// saturated back to int16 once every stream has been added, so the result does not depend on the order of the streams.
+/// Uses AVX2 or SSE2 when the library is compiled with them enabled and falls back to plain loops otherwise.
+class AudioMixKernels {
+public:
+    /// the instruction set the kernels were compiled for: "avx2", "sse2" or "scalar"
+    static const char* getInstructionSetName();
+
+    /// adds two mono sources to an interleaved stereo mix: mix[2i] += left[i] * leftGain, mix[2i + 1] += right[i] * rightGain
+    /// spatialized streams pass the same stream for both channels, with the delayed channel's source offset back in time
+    static void mixMonoToStereo(float* mixSamples, const int16_t* leftSource, float leftGain,
+                                const int16_t* rightSource, float rightGain, int numFrames);
+
+    /// adds a source to the mix sample for sample, used for stereo streams
+    static void mixWithGain(float* mixSamples, const int16_t* source, float gain, int numSamples);
+
+    /// rounds the accumulated mix to int16, saturating anything outside of the sample range
+    static void saturateMix(int16_t* destination, const float* mixSamples, int numSamples);
+
+    // plain implementations, used for the tail of each kernel and as a reference for the vectorized versions
+    static void mixMonoToStereoScalar(float* mixSamples, const int16_t* leftSource, float leftGain,
+                                      const int16_t* rightSource, float rightGain, int numFrames);
+    static void mixWithGainScalar(float* mixSamples, const int16_t* source, float gain, int numSamples);
+    static void saturateMixScalar(int16_t* destination, const float* mixSamples, int numSamples);
+};
+
+#endif // hifi_AudioMixKernels_h
@@ -89,7 +89,10 @@ int InboundAudioStream::parseData(const QByteArray& packet) {
     readBytes += sizeof(quint16);
     SequenceNumberStats::ArrivalInfo arrivalInfo = _incomingSequenceNumberStats.sequenceNumberReceived(sequence, senderUUID);
 
-    frameReceivedUpdateTimingStats();
+    // the gaps are measured between the times the frames came off the socket where that was recorded
+    quint64 receivedUsecs = getPacketReceivedUsecs();
+    setPacketReceivedUsecs(0);
+    frameReceivedUpdateTimingStats(receivedUsecs ? receivedUsecs : usecTimestampNow());
 
     // TODO: handle generalized silent packet here?????
 
@@ -246,12 +249,12 @@ int InboundAudioStream::clampDesiredJitterBufferFramesValue(int desired) const {
     return glm::clamp(desired, MIN_FRAMES_DESIRED, MAX_FRAMES_DESIRED);
 }
 
-void InboundAudioStream::frameReceivedUpdateTimingStats() {
+void InboundAudioStream::frameReceivedUpdateTimingStats(quint64 receivedUsecs) {
 
     // update our timegap stats and desired jitter buffer frames if necessary
     // discard the first few packets we receive since they usually have gaps that aren't represensative of normal jitter
     const int NUM_INITIAL_PACKETS_DISCARD = 3;
-    quint64 now = usecTimestampNow();
+    quint64 now = receivedUsecs;
     if (_incomingSequenceNumberStats.getReceived() > NUM_INITIAL_PACKETS_DISCARD) {
         quint64 gap = now - _lastFrameReceivedTime;
         _interframeTimeGapStatsForStatsPacket.update(gap);
@@ -111,7 +111,7 @@ public:
     int getPacketsReceived() const { return _incomingSequenceNumberStats.getReceived(); }
 
 private:
-    void frameReceivedUpdateTimingStats();
+    void frameReceivedUpdateTimingStats(quint64 receivedUsecs);
     int clampDesiredJitterBufferFramesValue(int desired) const;
 
     int writeSamplesForDroppedPackets(int numSamples);
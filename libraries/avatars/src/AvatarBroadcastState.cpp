@@ -0,0 +1,294 @@
+//
+//  AvatarBroadcastState.cpp
+//  libraries/avatars/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#include <cstring>
+#include <limits>
+
+#include <SharedUtil.h>
+
+#include "AvatarBroadcastState.h"
+
+const int BODY_DATA_OFFSET = sizeof(glm::vec3);
+const int HEAD_DATA_OFFSET = BODY_DATA_OFFSET + NUM_BYTES_AVATAR_BODY_DATA;
+const int AUDIO_DATA_OFFSET = HEAD_DATA_OFFSET + NUM_BYTES_AVATAR_HEAD_DATA;
+const int EXTRA_DATA_OFFSET = AUDIO_DATA_OFFSET + NUM_BYTES_AVATAR_AUDIO_DATA;
+
+const int NUM_BYTES_PACKED_JOINT_ROTATION = sizeof(quint32);
+
+static int numBytesForJointBits(int numJoints) {
+    return (numJoints + BITS_IN_BYTE - 1) / BITS_IN_BYTE;
+}
+
+static bool isJointBitSet(const QByteArray& jointBits, int index) {
+    return (jointBits.at(index / BITS_IN_BYTE) & (1 << (index % BITS_IN_BYTE))) != 0;
+}
+
+AvatarBroadcastState::AvatarBroadcastState() :
+    position(0.0f),
+    bodyData(NUM_BYTES_AVATAR_BODY_DATA, 0),
+    headData(NUM_BYTES_AVATAR_HEAD_DATA, 0),
+    audioData(NUM_BYTES_AVATAR_AUDIO_DATA, 0),
+    extraData(),
+    numJoints(0),
+    jointValidity(),
+    jointRotations()
+{
+
+}
+
+void AvatarBroadcastState::setFieldData(const unsigned char* fieldData, int numBytes) {
+    memcpy(&position, fieldData, sizeof(position));
+    bodyData = QByteArray(reinterpret_cast<const char*>(fieldData) + BODY_DATA_OFFSET, NUM_BYTES_AVATAR_BODY_DATA);
+    headData = QByteArray(reinterpret_cast<const char*>(fieldData) + HEAD_DATA_OFFSET, NUM_BYTES_AVATAR_HEAD_DATA);
+    audioData = QByteArray(reinterpret_cast<const char*>(fieldData) + AUDIO_DATA_OFFSET, NUM_BYTES_AVATAR_AUDIO_DATA);
+    extraData = QByteArray(reinterpret_cast<const char*>(fieldData) + EXTRA_DATA_OFFSET, numBytes - EXTRA_DATA_OFFSET);
+}
+
+void AvatarBroadcastState::appendKeyframe(QByteArray& record, quint8 sequence) const {
+    record.append((char) (AVATAR_RECORD_IS_KEYFRAME | AVATAR_RECORD_ALL_FIELDS));
+    record.append((char) sequence);
+
+    record.append(reinterpret_cast<const char*>(&position), sizeof(position));
+    record.append(bodyData);
+    record.append(headData);
+    record.append(audioData);
+
+    quint16 extraDataSize = extraData.size();
+    record.append(reinterpret_cast<const char*>(&extraDataSize), sizeof(extraDataSize));
+    record.append(extraData);
+
+    record.append((char) numJoints);
+    record.append(jointValidity);
+    for (int i = 0; i < numJoints; i++) {
+        if (isJointBitSet(jointValidity, i)) {
+            record.append(reinterpret_cast<const char*>(&jointRotations[i]), NUM_BYTES_PACKED_JOINT_ROTATION);
+        }
+    }
+}
+
+bool AvatarBroadcastState::appendDelta(QByteArray& record, const AvatarBroadcastState& keyframe,
+                                       quint8 keyframeSequence) const {
+    glm::vec3 offset = glm::floor((position - keyframe.position) / AVATAR_DELTA_POSITION_QUANTUM + 0.5f);
+    const float MAX_POSITION_OFFSET = std::numeric_limits<int16_t>::max();
+    if (glm::abs(offset.x) > MAX_POSITION_OFFSET || glm::abs(offset.y) > MAX_POSITION_OFFSET
+        || glm::abs(offset.z) > MAX_POSITION_OFFSET) {
+        return false;
+    }
+
+    // mark the joints that are valid now and weren't, or whose rotation differs from the keyframe
+    QByteArray changedJoints(numBytesForJointBits(numJoints), 0);
+    int numChangedJoints = 0;
+    for (int i = 0; i < numJoints; i++) {
+        if (isJointBitSet(jointValidity, i)
+            && (i >= keyframe.numJoints || !isJointBitSet(keyframe.jointValidity, i)
+                || jointRotations.at(i) != keyframe.jointRotations.at(i))) {
+            changedJoints[i / BITS_IN_BYTE] = (char) (changedJoints.at(i / BITS_IN_BYTE) | (1 << (i % BITS_IN_BYTE)));
+            ++numChangedJoints;
+        }
+    }
+
+    quint8 fieldMask = 0;
+    if (offset != glm::vec3(0.0f)) {
+        fieldMask |= AVATAR_RECORD_HAS_POSITION;
+    }
+    if (bodyData != keyframe.bodyData) {
+        fieldMask |= AVATAR_RECORD_HAS_BODY;
+    }
+    if (headData != keyframe.headData) {
+        fieldMask |= AVATAR_RECORD_HAS_HEAD;
+    }
+    if (audioData != keyframe.audioData) {
+        fieldMask |= AVATAR_RECORD_HAS_AUDIO;
+    }
+    if (extraData != keyframe.extraData) {
+        fieldMask |= AVATAR_RECORD_HAS_EXTRAS;
+    }
+    if (numChangedJoints > 0 || numJoints != keyframe.numJoints || jointValidity != keyframe.jointValidity) {
+        fieldMask |= AVATAR_RECORD_HAS_JOINTS;
+    }
+
+    record.append((char) fieldMask);
+    record.append((char) keyframeSequence);
+
+    if (fieldMask & AVATAR_RECORD_HAS_POSITION) {
+        int16_t packedOffset[3] = { (int16_t) offset.x, (int16_t) offset.y, (int16_t) offset.z };
+        record.append(reinterpret_cast<const char*>(packedOffset), sizeof(packedOffset));
+    }
+    if (fieldMask & AVATAR_RECORD_HAS_BODY) {
+        record.append(bodyData);
+    }
+    if (fieldMask & AVATAR_RECORD_HAS_HEAD) {
+        record.append(headData);
+    }
+    if (fieldMask & AVATAR_RECORD_HAS_AUDIO) {
+        record.append(audioData);
+    }
+    if (fieldMask & AVATAR_RECORD_HAS_EXTRAS) {
+        quint16 extraDataSize = extraData.size();
+        record.append(reinterpret_cast<const char*>(&extraDataSize), sizeof(extraDataSize));
+        record.append(extraData);
+    }
+    if (fieldMask & AVATAR_RECORD_HAS_JOINTS) {
+        record.append((char) numJoints);
+        record.append(jointValidity);
+        record.append(changedJoints);
+        for (int i = 0; i < numJoints; i++) {
+            if (isJointBitSet(changedJoints, i)) {
+                record.append(reinterpret_cast<const char*>(&jointRotations[i]), NUM_BYTES_PACKED_JOINT_ROTATION);
+            }
+        }
+    }
+
+    return true;
+}
+
+int AvatarBroadcastState::parseRecord(const unsigned char* sourceBuffer, int maxAvailableSize,
+                                      const AvatarBroadcastState& keyframe, bool& isKeyframe, quint8& sequence) {
+    const unsigned char* startPosition = sourceBuffer;
+    const unsigned char* endPosition = sourceBuffer + maxAvailableSize;
+
+    if (maxAvailableSize < NUM_BYTES_AVATAR_RECORD_HEADER) {
+        return -1;
+    }
+
+    quint8 fieldMask = *sourceBuffer++;
+    sequence = *sourceBuffer++;
+    isKeyframe = (fieldMask & AVATAR_RECORD_IS_KEYFRAME) != 0;
+
+    if (isKeyframe && (fieldMask & AVATAR_RECORD_ALL_FIELDS) != AVATAR_RECORD_ALL_FIELDS) {
+        return -1;
+    }
+
+    // a delta starts out as the keyframe, then has the fields that changed written over it
+    if (!isKeyframe) {
+        *this = keyframe;
+    }
+
+    if (fieldMask & AVATAR_RECORD_HAS_POSITION) {
+        if (isKeyframe) {
+            if (endPosition - sourceBuffer < (int) sizeof(position)) {
+                return -1;
+            }
+            memcpy(&position, sourceBuffer, sizeof(position));
+            sourceBuffer += sizeof(position);
+        } else {
+            int16_t packedOffset[3];
+            if (endPosition - sourceBuffer < (int) sizeof(packedOffset)) {
+                return -1;
+            }
+            memcpy(packedOffset, sourceBuffer, sizeof(packedOffset));
+            sourceBuffer += sizeof(packedOffset);
+            position = keyframe.position
+                + glm::vec3(packedOffset[0], packedOffset[1], packedOffset[2]) * AVATAR_DELTA_POSITION_QUANTUM;
+        }
+    }
+
+    if (fieldMask & AVATAR_RECORD_HAS_BODY) {
+        if (endPosition - sourceBuffer < NUM_BYTES_AVATAR_BODY_DATA) {
+            return -1;
+        }
+        bodyData = QByteArray(reinterpret_cast<const char*>(sourceBuffer), NUM_BYTES_AVATAR_BODY_DATA);
+        sourceBuffer += NUM_BYTES_AVATAR_BODY_DATA;
+    }
+
+    if (fieldMask & AVATAR_RECORD_HAS_HEAD) {
+        if (endPosition - sourceBuffer < NUM_BYTES_AVATAR_HEAD_DATA) {
+            return -1;
+        }
+        headData = QByteArray(reinterpret_cast<const char*>(sourceBuffer), NUM_BYTES_AVATAR_HEAD_DATA);
+        sourceBuffer += NUM_BYTES_AVATAR_HEAD_DATA;
+    }
+
+    if (fieldMask & AVATAR_RECORD_HAS_AUDIO) {
+        if (endPosition - sourceBuffer < NUM_BYTES_AVATAR_AUDIO_DATA) {
+            return -1;
+        }
+        audioData = QByteArray(reinterpret_cast<const char*>(sourceBuffer), NUM_BYTES_AVATAR_AUDIO_DATA);
+        sourceBuffer += NUM_BYTES_AVATAR_AUDIO_DATA;
+    }
+
+    if (fieldMask & AVATAR_RECORD_HAS_EXTRAS) {
+        quint16 extraDataSize;
+        if (endPosition - sourceBuffer < (int) sizeof(extraDataSize)) {
+            return -1;
+        }
+        memcpy(&extraDataSize, sourceBuffer, sizeof(extraDataSize));
+        sourceBuffer += sizeof(extraDataSize);
+
+        if (endPosition - sourceBuffer < extraDataSize) {
+            return -1;
+        }
+        extraData = QByteArray(reinterpret_cast<const char*>(sourceBuffer), extraDataSize);
+        sourceBuffer += extraDataSize;
+    }
+
+    if (fieldMask & AVATAR_RECORD_HAS_JOINTS) {
+        if (endPosition - sourceBuffer < 1) {
+            return -1;
+        }
+        numJoints = *sourceBuffer++;
+
+        int numJointBitBytes = numBytesForJointBits(numJoints);
+        int numMaskBytes = isKeyframe ? numJointBitBytes : 2 * numJointBitBytes;
+        if (endPosition - sourceBuffer < numMaskBytes) {
+            return -1;
+        }
+        jointValidity = QByteArray(reinterpret_cast<const char*>(sourceBuffer), numJointBitBytes);
+        sourceBuffer += numJointBitBytes;
+
+        // keyframes carry every valid joint, deltas only the ones marked as changed
+        QByteArray sentJoints = jointValidity;
+        if (!isKeyframe) {
+            sentJoints = QByteArray(reinterpret_cast<const char*>(sourceBuffer), numJointBitBytes);
+            sourceBuffer += numJointBitBytes;
+        }
+
+        jointRotations.resize(numJoints);
+        for (int i = 0; i < numJoints; i++) {
+            if (!isJointBitSet(jointValidity, i)) {
+                jointRotations[i] = 0;
+            } else if (isJointBitSet(sentJoints, i)) {
+                if (endPosition - sourceBuffer < NUM_BYTES_PACKED_JOINT_ROTATION) {
+                    return -1;
+                }
+                memcpy(&jointRotations[i], sourceBuffer, NUM_BYTES_PACKED_JOINT_ROTATION);
+                sourceBuffer += NUM_BYTES_PACKED_JOINT_ROTATION;
+            } else {
+                jointRotations[i] = (i < keyframe.jointRotations.size()) ? keyframe.jointRotations.at(i) : 0;
+            }
+        }
+    }
+
+    return sourceBuffer - startPosition;
+}
+
+QByteArray AvatarBroadcastState::toAvatarDataByteArray() const {
+    QByteArray avatarDataByteArray;
+    avatarDataByteArray.append(reinterpret_cast<const char*>(&position), sizeof(position));
+    avatarDataByteArray.append(bodyData);
+    avatarDataByteArray.append(headData);
+    avatarDataByteArray.append(audioData);
+    avatarDataByteArray.append(extraData);
+
+    avatarDataByteArray.append((char) numJoints);
+    avatarDataByteArray.append(jointValidity);
+
+    unsigned char packedRotation[2 * NUM_BYTES_PACKED_JOINT_ROTATION];
+    for (int i = 0; i < numJoints; i++) {
+        if (isJointBitSet(jointValidity, i)) {
+            glm::quat rotation;
+            unpackOrientationQuatFromSmallestThree(reinterpret_cast<const unsigned char*>(&jointRotations[i]), rotation);
+            avatarDataByteArray.append(reinterpret_cast<const char*>(packedRotation),
+                                       packOrientationQuatToBytes(packedRotation, rotation));
+        }
+    }
+
+    return avatarDataByteArray;
+}
@@ -0,0 +1,80 @@
+//
+//  AvatarBroadcastState.h
+//  libraries/avatars/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#ifndef hifi_AvatarBroadcastState_h
+#define hifi_AvatarBroadcastState_h
+
+#include <glm/glm.hpp>
+
+#include <QtCore/QByteArray>
+#include <QtCore/QVector>
+
+// the field groups of a bulk avatar data record, a group is only present if its bit is set in the record's field mask
+const quint8 AVATAR_RECORD_HAS_POSITION = 1 << 0;
+const quint8 AVATAR_RECORD_HAS_BODY = 1 << 1;
+const quint8 AVATAR_RECORD_HAS_HEAD = 1 << 2;
+const quint8 AVATAR_RECORD_HAS_AUDIO = 1 << 3;
+const quint8 AVATAR_RECORD_HAS_EXTRAS = 1 << 4;
+const quint8 AVATAR_RECORD_HAS_JOINTS = 1 << 5;
+const quint8 AVATAR_RECORD_ALL_FIELDS = (1 << 6) - 1;
+
+// keyframe records carry every field and reset the baseline that following delta records are applied to
+const quint8 AVATAR_RECORD_IS_KEYFRAME = 1 << 7;
+
+// field mask + keyframe sequence number
+const int NUM_BYTES_AVATAR_RECORD_HEADER = 2;
+
+// the fixed size fields, as they are packed by AvatarData::toByteArray
+const int NUM_BYTES_AVATAR_BODY_DATA = 8;
+const int NUM_BYTES_AVATAR_HEAD_DATA = 26;
+const int NUM_BYTES_AVATAR_AUDIO_DATA = 4;
+
+// delta records carry the position as a millimeter offset from the keyframe position, in signed two bytes per axis
+const float AVATAR_DELTA_POSITION_QUANTUM = 0.001f;
+
+/// The state of an avatar as it is broadcast by the avatar mixer, quantized the way it goes on the wire so that two
+/// states can be compared for the fields that changed between them. Each record in a bulk avatar data packet is either
+/// a keyframe, carrying the whole state, or a delta carrying only the fields and joints that differ from the last
+/// keyframe sent to the receiver. Deltas are always taken against a keyframe rather than the previous delta, so a lost
+/// delta costs nothing and a lost keyframe only stalls that avatar until the next one arrives.
+class AvatarBroadcastState {
+public:
+    AvatarBroadcastState();
+
+    /// splits the fields packed by AvatarData, from position through pupil dilation, into their groups
+    void setFieldData(const unsigned char* fieldData, int numBytes);
+
+    /// appends a keyframe record, tagged with the given keyframe sequence number
+    void appendKeyframe(QByteArray& record, quint8 sequence) const;
+
+    /// appends a delta record holding only the fields and joints that differ from the given keyframe
+    /// \return false, appending nothing, if the position is too far from the keyframe to be sent as an offset
+    bool appendDelta(QByteArray& record, const AvatarBroadcastState& keyframe, quint8 keyframeSequence) const;
+
+    /// parses a keyframe or delta record into this state, the fields a delta doesn't carry are taken from the keyframe
+    /// \return number of bytes parsed, or -1 if the record is malformed
+    int parseRecord(const unsigned char* sourceBuffer, int maxAvailableSize, const AvatarBroadcastState& keyframe,
+                    bool& isKeyframe, quint8& sequence);
+
+    /// the state in the format of AvatarData::toByteArray, which AvatarData then parses as if it came from the client
+    QByteArray toAvatarDataByteArray() const;
+
+    glm::vec3 position;
+    QByteArray bodyData; ///< body rotation and scale
+    QByteArray headData; ///< head rotation, lean and look at position
+    QByteArray audioData; ///< instantaneous audio loudness
+    QByteArray extraData; ///< chat message, bit items, referential, face data and pupil dilation
+
+    int numJoints;
+    QByteArray jointValidity; ///< one bit per joint, packed as in AvatarData::toByteArray
+    QVector<quint32> jointRotations; ///< smallest-three packed, zero for invalid joints
+};
+
+#endif // hifi_AvatarBroadcastState_h
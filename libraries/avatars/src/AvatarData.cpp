@@ -55,7 +55,10 @@ AvatarData::AvatarData() :
     _billboard(),
     _errorLogExpiry(0),
     _owningAvatarMixer(),
-    _lastUpdateTimer()
+    _lastUpdateTimer(),
+    _broadcastKeyframe(),
+    _broadcastKeyframeSequence(0),
+    _hasBroadcastKeyframe(false)
 {
     
 }
@@ -128,6 +131,62 @@ void AvatarData::setHandPosition(const glm::vec3& handPosition) {
 }
 
 QByteArray AvatarData::toByteArray() {
+    QByteArray avatarDataByteArray;
+    avatarDataByteArray.resize(MAX_PACKET_SIZE);
+    
+    unsigned char* destinationBuffer = reinterpret_cast<unsigned char*>(avatarDataByteArray.data());
+    unsigned char* startPosition = destinationBuffer;
+    
+    destinationBuffer += packFieldData(destinationBuffer);
+
+    // joint data
+    *destinationBuffer++ = _jointData.size();
+    unsigned char validity = 0;
+    int validityBit = 0;
+    foreach (const JointData& data, _jointData) {
+        if (data.valid) {
+            validity |= (1 << validityBit);
+        }
+        if (++validityBit == BITS_IN_BYTE) {
+            *destinationBuffer++ = validity;
+            validityBit = validity = 0;
+        }
+    }
+    if (validityBit != 0) {
+        *destinationBuffer++ = validity;
+    }
+    foreach (const JointData& data, _jointData) {
+        if (data.valid) {
+            destinationBuffer += packOrientationQuatToBytes(destinationBuffer, data.rotation);
+        }
+    }
+        
+    return avatarDataByteArray.left(destinationBuffer - startPosition);
+}
+
+void AvatarData::toBroadcastState(AvatarBroadcastState& state) {
+    QByteArray fieldData;
+    fieldData.resize(MAX_PACKET_SIZE);
+    
+    unsigned char* fieldBuffer = reinterpret_cast<unsigned char*>(fieldData.data());
+    state.setFieldData(fieldBuffer, packFieldData(fieldBuffer));
+    
+    state.numJoints = _jointData.size();
+    state.jointValidity.fill(0, (state.numJoints + BITS_IN_BYTE - 1) / BITS_IN_BYTE);
+    state.jointRotations.resize(state.numJoints);
+    
+    for (int i = 0; i < state.numJoints; i++) {
+        const JointData& data = _jointData.at(i);
+        if (data.valid) {
+            state.jointValidity[i / BITS_IN_BYTE] = (char) (state.jointValidity.at(i / BITS_IN_BYTE) | (1 << (i % BITS_IN_BYTE)));
+            packOrientationQuatToSmallestThree(reinterpret_cast<unsigned char*>(&state.jointRotations[i]), data.rotation);
+        } else {
+            state.jointRotations[i] = 0;
+        }
+    }
+}
+
+int AvatarData::packFieldData(unsigned char* destinationBuffer) {
     // TODO: DRY this up to a shared method
     // that can pack any type given the number of bytes
     // and return the number of bytes to push the pointer
@@ -140,10 +199,6 @@ QByteArray AvatarData::toByteArray() {
         }
     }
     
-    QByteArray avatarDataByteArray;
-    avatarDataByteArray.resize(MAX_PACKET_SIZE);
-    
-    unsigned char* destinationBuffer = reinterpret_cast<unsigned char*>(avatarDataByteArray.data());
     unsigned char* startPosition = destinationBuffer;
     
     memcpy(destinationBuffer, &_position, sizeof(_position));
@@ -227,30 +282,8 @@ QByteArray AvatarData::toByteArray() {
     
     // pupil dilation
     destinationBuffer += packFloatToByte(destinationBuffer, _headData->_pupilDilation, 1.0f);
-
-    // joint data
-    *destinationBuffer++ = _jointData.size();
-    unsigned char validity = 0;
-    int validityBit = 0;
-    foreach (const JointData& data, _jointData) {
-        if (data.valid) {
-            validity |= (1 << validityBit);
-        }
-        if (++validityBit == BITS_IN_BYTE) {
-            *destinationBuffer++ = validity;
-            validityBit = validity = 0;
-        }
-    }
-    if (validityBit != 0) {
-        *destinationBuffer++ = validity;
-    }
-    foreach (const JointData& data, _jointData) {
-        if (data.valid) {
-            destinationBuffer += packOrientationQuatToBytes(destinationBuffer, data.rotation);
-        }
-    }
-        
-    return avatarDataByteArray.left(destinationBuffer - startPosition);
+    
+    return destinationBuffer - startPosition;
 }
 
 bool AvatarData::shouldLogError(const quint64& now) {
@@ -277,6 +310,48 @@ int AvatarData::parseDataAtOffset(const QByteArray& packet, int offset) {
         _handData = new HandData(this);
     }
     
+    // the avatar mixer sends keyframe and delta records, avatars send their full data to the mixer
+    if (packetTypeForPacket(packet) == PacketTypeBulkAvatarData) {
+        return parseBroadcastRecordAtOffset(packet, offset);
+    } else {
+        return parseFullDataAtOffset(packet, offset);
+    }
+}
+
+int AvatarData::parseBroadcastRecordAtOffset(const QByteArray& packet, int offset) {
+    const unsigned char* sourceBuffer = reinterpret_cast<const unsigned char*>(packet.data()) + offset;
+    int maxAvailableSize = packet.size() - offset;
+    
+    AvatarBroadcastState state;
+    bool isKeyframe;
+    quint8 sequence;
+    int bytesRead = state.parseRecord(sourceBuffer, maxAvailableSize, _broadcastKeyframe, isKeyframe, sequence);
+    
+    if (bytesRead < 0) {
+        quint64 now = usecTimestampNow();
+        if (shouldLogError(now)) {
+            qDebug() << "Malformed AvatarData broadcast record;"
+                << " displayName = '" << _displayName << "'"
+                << " maxAvailableSize = " << maxAvailableSize;
+        }
+        // this packet is malformed so we report all bytes as consumed
+        return maxAvailableSize;
+    }
+    
+    if (isKeyframe) {
+        _broadcastKeyframe = state;
+        _broadcastKeyframeSequence = sequence;
+        _hasBroadcastKeyframe = true;
+    } else if (!_hasBroadcastKeyframe || sequence != _broadcastKeyframeSequence) {
+        // this delta is against a keyframe we never got, hold the current state until the next keyframe comes in
+        return bytesRead;
+    }
+    
+    parseFullDataAtOffset(state.toAvatarDataByteArray(), 0);
+    return bytesRead;
+}
+
+int AvatarData::parseFullDataAtOffset(const QByteArray& packet, int offset) {
     const unsigned char* startPosition = reinterpret_cast<const unsigned char*>(packet.data()) + offset;
     const unsigned char* sourceBuffer = startPosition;
     quint64 now = usecTimestampNow();
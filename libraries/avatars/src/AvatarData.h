@@ -49,6 +49,7 @@ typedef unsigned long long quint64;
 
 #include <Node.h>
 
+#include "AvatarBroadcastState.h"
 #include "Referential.h"
 #include "HeadData.h"
 #include "HandData.h"
@@ -150,6 +151,9 @@ public:
     void setHandPosition(const glm::vec3& handPosition);
 
     QByteArray toByteArray();
+    
+    /// quantizes the avatar the way the avatar mixer broadcasts it, see AvatarBroadcastState
+    void toBroadcastState(AvatarBroadcastState& state);
 
     /// \return true if an error should be logged
     bool shouldLogError(const quint64& now);
@@ -349,6 +353,19 @@ protected:
     /// Loads the joint indices, names from the FST file (if any)
     virtual void updateJointMappings();
     void changeReferential(Referential* ref);
+    
+    /// packs the fields from position through pupil dilation, which is everything but the joint data
+    int packFieldData(unsigned char* destinationBuffer);
+    
+    /// parses a keyframe or delta record from a bulk avatar data packet
+    int parseBroadcastRecordAtOffset(const QByteArray& packet, int offset);
+    
+    /// parses the avatar data in the format of toByteArray
+    int parseFullDataAtOffset(const QByteArray& packet, int offset);
+    
+    AvatarBroadcastState _broadcastKeyframe; ///< the last keyframe from the avatar mixer, that deltas are applied to
+    quint8 _broadcastKeyframeSequence;
+    bool _hasBroadcastKeyframe;
 
 private:
     // privatize the copy constructor and assignment operator so they cannot be called
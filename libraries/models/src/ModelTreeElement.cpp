@@ -22,7 +22,7 @@ ModelTreeElement::ModelTreeElement(unsigned char* octalCode) : OctreeElement(),
 };
 
 ModelTreeElement::~ModelTreeElement() {
-    _voxelMemoryUsage -= sizeof(ModelTreeElement);
+    statistics().voxelMemoryUsage -= sizeof(ModelTreeElement);
     delete _modelItems;
     _modelItems = NULL;
 }
@@ -40,7 +40,7 @@ OctreeElement* ModelTreeElement::createNewElement(unsigned char* octalCode) {
 void ModelTreeElement::init(unsigned char* octalCode) {
     OctreeElement::init(octalCode);
     _modelItems = new QList<ModelItem>;
-    _voxelMemoryUsage += sizeof(ModelTreeElement);
+    statistics().voxelMemoryUsage += sizeof(ModelTreeElement);
 }
 
 ModelTreeElement* ModelTreeElement::addChildAtIndex(int index) {
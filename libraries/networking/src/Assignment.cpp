@@ -38,6 +38,27 @@ Assignment::Type Assignment::typeForNodeType(NodeType_t nodeType) {
     }
 }
 
+NodeType_t Assignment::nodeTypeForType(Assignment::Type type) {
+    switch (type) {
+        case Assignment::AudioMixerType:
+            return NodeType::AudioMixer;
+        case Assignment::AvatarMixerType:
+            return NodeType::AvatarMixer;
+        case Assignment::AgentType:
+            return NodeType::Agent;
+        case Assignment::VoxelServerType:
+            return NodeType::VoxelServer;
+        case Assignment::ParticleServerType:
+            return NodeType::ParticleServer;
+        case Assignment::ModelServerType:
+            return NodeType::ModelServer;
+        case Assignment::MetavoxelServerType:
+            return NodeType::MetavoxelServer;
+        default:
+            return NodeType::Unassigned;
+    }
+}
+
 #ifdef WIN32
 //warning C4351: new behavior: elements of array 'Assignment::_payload' will be default initialized 
 // We're disabling this warning because the new behavior which is to initialize the array with 0 is acceptable to us.
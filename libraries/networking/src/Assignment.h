@@ -48,6 +48,7 @@ public:
     };
 
     static Assignment::Type typeForNodeType(NodeType_t nodeType);
+    static NodeType_t nodeTypeForType(Assignment::Type type);
 
     Assignment();
     Assignment(Assignment::Command command,
@@ -0,0 +1,222 @@
+//
+//  DatagramBatch.cpp
+//  libraries/networking/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#include <cstring>
+
+#include <QtCore/QDebug>
+
+#ifdef Q_OS_LINUX
+#include <errno.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#endif
+
+#include "LimitedNodeList.h"
+#include "DatagramBatch.h"
+
+DatagramReceiveBatch::DatagramReceiveBatch(int capacity) :
+    _capacity(capacity),
+    _buffer(NULL),
+    _slots(),
+    _sizes(),
+    _senders(),
+    _next(0),
+    _messages(NULL),
+    _iovecs(NULL),
+    _addresses(NULL)
+{
+#ifdef Q_OS_LINUX
+    _buffer = new char[_capacity * MAX_PACKET_SIZE];
+    _messages = new mmsghdr[_capacity];
+    _iovecs = new iovec[_capacity];
+    _addresses = new sockaddr_in[_capacity];
+    _slots.reserve(_capacity);
+    _sizes.reserve(_capacity);
+    _senders.reserve(_capacity);
+
+    memset(_messages, 0, sizeof(mmsghdr) * _capacity);
+    for (int i = 0; i < _capacity; i++) {
+        _iovecs[i].iov_base = _buffer + i * MAX_PACKET_SIZE;
+        _iovecs[i].iov_len = MAX_PACKET_SIZE;
+        _messages[i].msg_hdr.msg_iov = &_iovecs[i];
+        _messages[i].msg_hdr.msg_iovlen = 1;
+        _messages[i].msg_hdr.msg_name = &_addresses[i];
+    }
+#endif
+}
+
+DatagramReceiveBatch::~DatagramReceiveBatch() {
+    delete[] _buffer;
+    delete[] _messages;
+    delete[] _iovecs;
+    delete[] _addresses;
+}
+
+bool DatagramReceiveBatch::readNext(QUdpSocket& socket, QByteArray& datagram, HifiSockAddr& senderSockAddr) {
+    if (takeNext(datagram, senderSockAddr)) {
+        return true;
+    }
+
+    // the first datagram is read through the socket itself, which keeps its read notifications going, and then we
+    // take whatever else is already waiting in one batch
+    if (!socket.hasPendingDatagrams()) {
+        return false;
+    }
+    datagram.resize(socket.pendingDatagramSize());
+    socket.readDatagram(datagram.data(), datagram.size(),
+                        senderSockAddr.getAddressPointer(), senderSockAddr.getPortPointer());
+
+    receive(socket.socketDescriptor());
+    return true;
+}
+
+bool DatagramReceiveBatch::readNextFromDescriptor(qintptr socketDescriptor, QByteArray& datagram,
+                                                  HifiSockAddr& senderSockAddr) {
+    if (_next >= _slots.size()) {
+        receive(socketDescriptor);
+    }
+    return takeNext(datagram, senderSockAddr);
+}
+
+bool DatagramReceiveBatch::takeNext(QByteArray& datagram, HifiSockAddr& senderSockAddr) {
+    if (_next >= _slots.size()) {
+        return false;
+    }
+    datagram.resize(_sizes[_next]);
+    memcpy(datagram.data(), _buffer + _slots[_next] * MAX_PACKET_SIZE, _sizes[_next]);
+    senderSockAddr = _senders[_next];
+    _next++;
+    return true;
+}
+
+void DatagramReceiveBatch::receive(qintptr socketDescriptor) {
+    _slots.clear();
+    _sizes.clear();
+    _senders.clear();
+    _next = 0;
+
+#ifdef Q_OS_LINUX
+    for (int i = 0; i < _capacity; i++) {
+        _messages[i].msg_hdr.msg_namelen = sizeof(sockaddr_in);
+        _messages[i].msg_hdr.msg_flags = 0;
+    }
+
+    int numReceived = recvmmsg(socketDescriptor, _messages, _capacity, MSG_DONTWAIT, NULL);
+    if (numReceived < 0) {
+        if (errno != EAGAIN && errno != EWOULDBLOCK) {
+            qDebug() << "ERROR in recvmmsg:" << strerror(errno);
+        }
+        return;
+    }
+
+    for (int i = 0; i < numReceived; i++) {
+        if (_messages[i].msg_hdr.msg_flags & MSG_TRUNC) {
+            qDebug() << "Dropping datagram larger than" << MAX_PACKET_SIZE << "bytes";
+            continue;
+        }
+        _slots.append(i);
+        _sizes.append(_messages[i].msg_len);
+        _senders.append(HifiSockAddr(reinterpret_cast<const sockaddr*>(&_addresses[i])));
+    }
+#else
+    Q_UNUSED(socketDescriptor);
+#endif
+}
+
+DatagramSendBatch::DatagramSendBatch(int capacity) :
+    _capacity(capacity),
+    _isActive(false),
+    _buffer(NULL),
+    _sizes(),
+    _destinations(),
+    _messages(NULL),
+    _iovecs(NULL),
+    _addresses(NULL)
+{
+#ifdef Q_OS_LINUX
+    _buffer = new char[_capacity * MAX_PACKET_SIZE];
+    _messages = new mmsghdr[_capacity];
+    _iovecs = new iovec[_capacity];
+    _addresses = new sockaddr_in[_capacity];
+    _sizes.reserve(_capacity);
+    _destinations.reserve(_capacity);
+
+    memset(_messages, 0, sizeof(mmsghdr) * _capacity);
+    memset(_addresses, 0, sizeof(sockaddr_in) * _capacity);
+    for (int i = 0; i < _capacity; i++) {
+        _iovecs[i].iov_base = _buffer + i * MAX_PACKET_SIZE;
+        _messages[i].msg_hdr.msg_iov = &_iovecs[i];
+        _messages[i].msg_hdr.msg_iovlen = 1;
+        _messages[i].msg_hdr.msg_name = &_addresses[i];
+        _messages[i].msg_hdr.msg_namelen = sizeof(sockaddr_in);
+    }
+#endif
+}
+
+DatagramSendBatch::~DatagramSendBatch() {
+    delete[] _buffer;
+    delete[] _messages;
+    delete[] _iovecs;
+    delete[] _addresses;
+}
+
+qint64 DatagramSendBatch::queue(QUdpSocket& socket, const char* data, qint64 size,
+                                const HifiSockAddr& destinationSockAddr) {
+#ifdef Q_OS_LINUX
+    // anything we can't put in a slot goes out on its own
+    if (size <= MAX_PACKET_SIZE
+            && destinationSockAddr.getAddress().protocol() == QAbstractSocket::IPv4Protocol) {
+        if (_sizes.size() == _capacity) {
+            flush(socket);
+        }
+
+        int slot = _sizes.size();
+        memcpy(_buffer + slot * MAX_PACKET_SIZE, data, size);
+        _iovecs[slot].iov_len = size;
+        _addresses[slot].sin_family = AF_INET;
+        _addresses[slot].sin_addr.s_addr = htonl(destinationSockAddr.getAddress().toIPv4Address());
+        _addresses[slot].sin_port = htons(destinationSockAddr.getPort());
+
+        _sizes.append(size);
+        _destinations.append(destinationSockAddr);
+        return size;
+    }
+#endif
+    return socket.writeDatagram(data, size, destinationSockAddr.getAddress(), destinationSockAddr.getPort());
+}
+
+int DatagramSendBatch::flush(QUdpSocket& socket) {
+    int numQueued = _sizes.size();
+    int numSent = 0;
+
+#ifdef Q_OS_LINUX
+    while (numSent < numQueued) {
+        int numSentThisCall = sendmmsg(socket.socketDescriptor(), _messages + numSent, numQueued - numSent, 0);
+        if (numSentThisCall <= 0) {
+            qDebug() << "ERROR in sendmmsg:" << strerror(errno) << "- sending the rest of the batch one at a time";
+            break;
+        }
+        numSent += numSentThisCall;
+    }
+
+    for (int i = numSent; i < numQueued; i++) {
+        if (socket.writeDatagram(_buffer + i * MAX_PACKET_SIZE, _sizes[i],
+                                 _destinations[i].getAddress(), _destinations[i].getPort()) >= 0) {
+            numSent++;
+        }
+    }
+#else
+    Q_UNUSED(socket);
+#endif
+
+    _sizes.clear();
+    _destinations.clear();
+    return numSent;
+}
@@ -0,0 +1,94 @@
+//
+//  DatagramBatch.h
+//  libraries/networking/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#ifndef hifi_DatagramBatch_h
+#define hifi_DatagramBatch_h
+
+#include <QtCore/QByteArray>
+#include <QtCore/QVector>
+#include <QtNetwork/QUdpSocket>
+
+#include "HifiSockAddr.h"
+
+struct iovec;
+struct mmsghdr;
+struct sockaddr_in;
+
+const int DATAGRAM_BATCH_SIZE = 32;
+
+/// Reads the datagrams waiting on a socket in batches, into buffers allocated once. On Linux each batch is one recvmmsg()
+/// call, elsewhere datagrams are read one at a time through the socket.
+class DatagramReceiveBatch {
+public:
+    DatagramReceiveBatch(int capacity = DATAGRAM_BATCH_SIZE);
+    ~DatagramReceiveBatch();
+
+    /// Takes the next datagram, reading another batch from the socket once this one is used up
+    /// \return false if there was nothing left to read
+    bool readNext(QUdpSocket& socket, QByteArray& datagram, HifiSockAddr& senderSockAddr);
+
+    /// Takes the next datagram like readNext(), but only ever reads the socket descriptor itself, never through a
+    /// QUdpSocket, so it can be called from a thread other than the socket's. Only Linux reads anything this way.
+    bool readNextFromDescriptor(qintptr socketDescriptor, QByteArray& datagram, HifiSockAddr& senderSockAddr);
+
+private:
+    // not copyable, it owns the buffers the system calls point into
+    DatagramReceiveBatch(const DatagramReceiveBatch&);
+    DatagramReceiveBatch& operator=(const DatagramReceiveBatch&);
+
+    bool takeNext(QByteArray& datagram, HifiSockAddr& senderSockAddr);
+    void receive(qintptr socketDescriptor);
+
+    int _capacity;
+    char* _buffer; // _capacity slots of MAX_PACKET_SIZE bytes
+    QVector<int> _slots; // the slots holding the datagrams of this batch, in the order they were received
+    QVector<int> _sizes;
+    QVector<HifiSockAddr> _senders;
+    int _next;
+
+    mmsghdr* _messages;
+    iovec* _iovecs;
+    sockaddr_in* _addresses;
+};
+
+/// Queues the datagrams for a socket until flush(), and then sends them together. On Linux each batch is one sendmmsg()
+/// call, elsewhere datagrams are sent through the socket as soon as they are queued.
+class DatagramSendBatch {
+public:
+    DatagramSendBatch(int capacity = DATAGRAM_BATCH_SIZE);
+    ~DatagramSendBatch();
+
+    bool isActive() const { return _isActive; }
+    void setActive(bool isActive) { _isActive = isActive; }
+
+    /// Queues a copy of the datagram, sending the batch first if it is full
+    /// \return the number of bytes queued or sent, or -1 if sending failed
+    qint64 queue(QUdpSocket& socket, const char* data, qint64 size, const HifiSockAddr& destinationSockAddr);
+
+    /// Sends everything queued
+    /// \return the number of datagrams sent
+    int flush(QUdpSocket& socket);
+
+private:
+    DatagramSendBatch(const DatagramSendBatch&);
+    DatagramSendBatch& operator=(const DatagramSendBatch&);
+
+    int _capacity;
+    bool _isActive;
+    char* _buffer; // _capacity slots of MAX_PACKET_SIZE bytes
+    QVector<int> _sizes;
+    QVector<HifiSockAddr> _destinations;
+
+    mmsghdr* _messages;
+    iovec* _iovecs;
+    sockaddr_in* _addresses;
+};
+
+#endif // hifi_DatagramBatch_h
@@ -0,0 +1,194 @@
+//
+//  DatagramLog.cpp
+//  libraries/networking/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#include <cstring>
+#include <limits>
+
+#include <QtCore/QDebug>
+#include <QtCore/QMutexLocker>
+#include <QtCore/QtEndian>
+
+#include "DatagramLog.h"
+
+// records are gathered up to about this many bytes, or for this long, before they go to the file - a capture is usually
+// ended by killing the process, which loses only what is still buffered
+const int DATAGRAM_LOG_BUFFER_BYTES = 256 * 1024;
+const quint64 DATAGRAM_LOG_FLUSH_INTERVAL_USECS = USECS_PER_SECOND;
+
+DatagramLogWriter::DatagramLogWriter() :
+    _mutex(),
+    _isOpen(0),
+    _file(),
+    _buffer(),
+    _lastFlushAt(0),
+    _numRecords(0)
+{
+}
+
+DatagramLogWriter::~DatagramLogWriter() {
+    close();
+}
+
+bool DatagramLogWriter::open(const QString& filename, NodeType_t ownerType) {
+    QMutexLocker locker(&_mutex);
+    if (_isOpen.load()) {
+        _isOpen.store(0);
+        flushBuffer();
+        _file.close();
+    }
+
+    _file.setFileName(filename);
+    if (!_file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        qDebug() << "Failed to open datagram log" << filename << "-" << _file.errorString();
+        return false;
+    }
+
+    char header[DATAGRAM_LOG_HEADER_BYTES];
+    char* headerAt = header;
+    memcpy(headerAt, DATAGRAM_LOG_MAGIC, sizeof(DATAGRAM_LOG_MAGIC));
+    headerAt += sizeof(DATAGRAM_LOG_MAGIC);
+    *headerAt++ = DATAGRAM_LOG_VERSION;
+    *headerAt++ = ownerType;
+    qToLittleEndian<quint64>(usecTimestampNow(), reinterpret_cast<uchar*>(headerAt));
+
+    // room for the largest record on top of a full buffer, so appending never reallocates
+    _buffer.reserve(DATAGRAM_LOG_BUFFER_BYTES + DATAGRAM_LOG_RECORD_HEADER_BYTES + std::numeric_limits<quint16>::max());
+    _buffer.append(header, DATAGRAM_LOG_HEADER_BYTES);
+    _lastFlushAt = usecTimestampNow();
+    _numRecords = 0;
+    _isOpen.store(1);
+
+    qDebug() << "Capturing datagrams to" << filename;
+    return true;
+}
+
+void DatagramLogWriter::close() {
+    QMutexLocker locker(&_mutex);
+    if (!_isOpen.load()) {
+        return;
+    }
+    _isOpen.store(0);
+    flushBuffer();
+    _file.close();
+
+    qDebug() << "Captured" << _numRecords << "datagrams to" << _file.fileName();
+}
+
+void DatagramLogWriter::write(quint8 direction, NodeType_t nodeType, const QUuid& senderUUID,
+                              const char* data, qint64 size, quint64 timestamp) {
+    if (!_isOpen.load() || size > std::numeric_limits<quint16>::max()) {
+        return;
+    }
+
+    QMutexLocker locker(&_mutex);
+    if (!_isOpen.load()) {
+        // closed while we were waiting for the lock
+        return;
+    }
+
+    char recordHeader[DATAGRAM_LOG_RECORD_HEADER_BYTES];
+    char* headerAt = recordHeader;
+    qToLittleEndian<quint64>(timestamp, reinterpret_cast<uchar*>(headerAt));
+    headerAt += sizeof(quint64);
+    *headerAt++ = direction;
+    *headerAt++ = nodeType;
+    memcpy(headerAt, senderUUID.toRfc4122().constData(), NUM_BYTES_RFC4122_UUID);
+    headerAt += NUM_BYTES_RFC4122_UUID;
+    qToLittleEndian<quint16>((quint16)size, reinterpret_cast<uchar*>(headerAt));
+
+    _buffer.append(recordHeader, DATAGRAM_LOG_RECORD_HEADER_BYTES);
+    _buffer.append(data, size);
+    _numRecords++;
+
+    if (_buffer.size() >= DATAGRAM_LOG_BUFFER_BYTES || timestamp > _lastFlushAt + DATAGRAM_LOG_FLUSH_INTERVAL_USECS) {
+        flushBuffer();
+        _lastFlushAt = timestamp;
+    }
+}
+
+void DatagramLogWriter::flushBuffer() {
+    if (!_buffer.isEmpty() && _file.write(_buffer) != _buffer.size()) {
+        qDebug() << "Failed to write datagram log" << _file.fileName() << "-" << _file.errorString();
+    }
+    _file.flush();
+    _buffer.resize(0);
+}
+
+DatagramLogReader::DatagramLogReader() :
+    _file(),
+    _ownerType(NodeType::Unassigned),
+    _startTimestamp(0),
+    _errorString()
+{
+}
+
+bool DatagramLogReader::open(const QString& filename) {
+    close();
+
+    _file.setFileName(filename);
+    if (!_file.open(QIODevice::ReadOnly)) {
+        _errorString = _file.errorString();
+        return false;
+    }
+
+    char header[DATAGRAM_LOG_HEADER_BYTES];
+    if (_file.read(header, DATAGRAM_LOG_HEADER_BYTES) != DATAGRAM_LOG_HEADER_BYTES
+            || memcmp(header, DATAGRAM_LOG_MAGIC, sizeof(DATAGRAM_LOG_MAGIC)) != 0) {
+        _errorString = "not a datagram log";
+        _file.close();
+        return false;
+    }
+
+    const char* headerAt = header + sizeof(DATAGRAM_LOG_MAGIC);
+    quint8 version = *headerAt++;
+    if (version != DATAGRAM_LOG_VERSION) {
+        _errorString = QString("datagram log version %1, expected %2").arg(version).arg(DATAGRAM_LOG_VERSION);
+        _file.close();
+        return false;
+    }
+    _ownerType = *headerAt++;
+    _startTimestamp = qFromLittleEndian<quint64>(reinterpret_cast<const uchar*>(headerAt));
+
+    _errorString.clear();
+    return true;
+}
+
+void DatagramLogReader::close() {
+    if (_file.isOpen()) {
+        _file.close();
+    }
+}
+
+bool DatagramLogReader::readNext(DatagramLogRecord& record) {
+    char recordHeader[DATAGRAM_LOG_RECORD_HEADER_BYTES];
+    if (_file.read(recordHeader, DATAGRAM_LOG_RECORD_HEADER_BYTES) != DATAGRAM_LOG_RECORD_HEADER_BYTES) {
+        return false;
+    }
+
+    const char* headerAt = recordHeader;
+    record.timestamp = qFromLittleEndian<quint64>(reinterpret_cast<const uchar*>(headerAt));
+    headerAt += sizeof(quint64);
+    record.direction = *headerAt++;
+    record.nodeType = *headerAt++;
+    record.senderUUID = QUuid::fromRfc4122(QByteArray::fromRawData(headerAt, NUM_BYTES_RFC4122_UUID));
+    headerAt += NUM_BYTES_RFC4122_UUID;
+    quint16 size = qFromLittleEndian<quint16>(reinterpret_cast<const uchar*>(headerAt));
+
+    record.datagram.resize(size);
+    if (_file.read(record.datagram.data(), size) != size) {
+        _errorString = "datagram log ends in the middle of a record";
+        return false;
+    }
+    return true;
+}
+
+bool DatagramLogReader::rewind() {
+    return _file.seek(DATAGRAM_LOG_HEADER_BYTES);
+}
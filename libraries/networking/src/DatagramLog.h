@@ -0,0 +1,102 @@
+//
+//  DatagramLog.h
+//  libraries/networking/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#ifndef hifi_DatagramLog_h
+#define hifi_DatagramLog_h
+
+#include <QtCore/QAtomicInt>
+#include <QtCore/QByteArray>
+#include <QtCore/QFile>
+#include <QtCore/QMutex>
+#include <QtCore/QUuid>
+
+#include "Node.h"
+#include "SharedUtil.h"
+#include "UUID.h"
+
+// A datagram log starts with the magic, the version, the type of the node that captured it and the time the capture
+// started. Then every datagram is a record of its timestamp, direction, the type and UUID of the node that sent it,
+// its size and its bytes, all little endian.
+const char DATAGRAM_LOG_MAGIC[] = { 'H', 'F', 'D', 'L' };
+const quint8 DATAGRAM_LOG_VERSION = 1;
+
+const int DATAGRAM_LOG_HEADER_BYTES = sizeof(DATAGRAM_LOG_MAGIC) + sizeof(quint8) + sizeof(quint8) + sizeof(quint64);
+const int DATAGRAM_LOG_RECORD_HEADER_BYTES = sizeof(quint64) + sizeof(quint8) + sizeof(quint8)
+    + NUM_BYTES_RFC4122_UUID + sizeof(quint16);
+
+namespace DatagramDirection {
+    const quint8 Inbound = 0;
+    const quint8 Outbound = 1;
+}
+
+class DatagramLogRecord {
+public:
+    quint64 timestamp;
+    quint8 direction;
+    NodeType_t nodeType; // NodeType::Unassigned when the sender isn't a node we know
+    QUuid senderUUID;
+    QByteArray datagram;
+};
+
+/// Appends datagrams to a log file. Records are buffered and written out in large blocks, and any thread can write.
+class DatagramLogWriter {
+public:
+    DatagramLogWriter();
+    ~DatagramLogWriter();
+
+    bool open(const QString& filename, NodeType_t ownerType);
+    void close();
+
+    /// cheap enough to check for every datagram, the writer only locks once it is open
+    bool isOpen() const { return _isOpen.load() != 0; }
+
+    void write(quint8 direction, NodeType_t nodeType, const QUuid& senderUUID, const char* data, qint64 size,
+               quint64 timestamp = usecTimestampNow());
+
+    quint64 getNumRecords() const { return _numRecords; }
+
+private:
+    // must be called with the mutex held
+    void flushBuffer();
+
+    QMutex _mutex;
+    QAtomicInt _isOpen;
+    QFile _file;
+    QByteArray _buffer;
+    quint64 _lastFlushAt;
+    quint64 _numRecords;
+};
+
+/// Reads back a log written by DatagramLogWriter, one record at a time
+class DatagramLogReader {
+public:
+    DatagramLogReader();
+
+    bool open(const QString& filename);
+    void close();
+
+    NodeType_t getOwnerType() const { return _ownerType; }
+    quint64 getStartTimestamp() const { return _startTimestamp; }
+    const QString& getErrorString() const { return _errorString; }
+
+    /// \return false at the end of the log, or at a record that was cut off
+    bool readNext(DatagramLogRecord& record);
+
+    /// starts reading from the first record again
+    bool rewind();
+
+private:
+    QFile _file;
+    NodeType_t _ownerType;
+    quint64 _startTimestamp;
+    QString _errorString;
+};
+
+#endif // hifi_DatagramLog_h
@@ -21,9 +21,11 @@
 
 #include "AccountManager.h"
 #include "Assignment.h"
+#include "DatagramBatch.h"
 #include "HifiSockAddr.h"
 #include "Logging.h"
 #include "LimitedNodeList.h"
+#include "PacketBuffer.h"
 #include "PacketHeaders.h"
 #include "SharedUtil.h"
 #include "UUID.h"
@@ -65,8 +67,15 @@ LimitedNodeList::LimitedNodeList(unsigned short socketListenPort, unsigned short
     _sessionUUID(),
     _nodeHash(),
     _nodeHashMutex(QMutex::Recursive),
+    _nodeSnapshot(new NodeSnapshot()),
+    _nodeSnapshotVersion(0),
+    _nodeSnapshotMutex(),
+    _nodeSnapshotCaches(),
     _nodeSocket(this),
     _dtlsSocket(NULL),
+    _datagramSendBatches(),
+    _datagramCapture(),
+    _datagramCaptureOwnerType(NodeType::Unassigned),
     _numCollectedPackets(0),
     _numCollectedBytes(0),
     _packetStatTimer()
@@ -151,10 +160,15 @@ void LimitedNodeList::changeSendSocketBufferSize(int numSendBytes) {
 }
 
 bool LimitedNodeList::packetVersionAndHashMatch(const QByteArray& packet) {
+    // every datagram read comes through here, so this is where the inbound ones are captured
+    if (_datagramCapture.isOpen()) {
+        captureInboundDatagram(packet);
+    }
+    
     PacketType checkType = packetTypeForPacket(packet);
-    int numPacketTypeBytes = numBytesArithmeticCodingFromBuffer(packet.data());
+    PacketVersion packetVersion = versionFromPacketHeader(packet.constData());
     
-    if (packet[numPacketTypeBytes] != versionForPacketType(checkType)
+    if (packetVersion != versionForPacketType(checkType)
         && checkType != PacketTypeStunResponse) {
         PacketType mismatchType = packetTypeForPacket(packet);
         
@@ -163,7 +177,7 @@ bool LimitedNodeList::packetVersionAndHashMatch(const QByteArray& packet) {
         QUuid senderUUID = uuidFromPacketHeader(packet);
         if (!versionDebugSuppressMap.contains(senderUUID, checkType)) {
             qDebug() << "Packet version mismatch on" << packetTypeForPacket(packet) << "- Sender"
-            << uuidFromPacketHeader(packet) << "sent" << qPrintable(QString::number(packet[numPacketTypeBytes])) << "but"
+            << uuidFromPacketHeader(packet) << "sent" << qPrintable(QString::number(packetVersion)) << "but"
             << qPrintable(QString::number(versionForPacketType(mismatchType))) << "expected.";
             
             versionDebugSuppressMap.insert(senderUUID, checkType);
@@ -176,8 +190,10 @@ bool LimitedNodeList::packetVersionAndHashMatch(const QByteArray& packet) {
         // figure out which node this is from
         SharedNodePointer sendingNode = sendingNodeForPacket(packet);
         if (sendingNode) {
-            // check if the md5 hash in the header matches the hash we would expect
-            if (hashFromPacketHeader(packet) == hashForPacketAndConnectionUUID(packet, sendingNode->getConnectionSecret())) {
+            // check if the hash in the header matches the hash we would expect
+            if (packetHashMatchesConnectionUUID(packet.constData(), packet.size(), sendingNode->getConnectionSecret())) {
+                // answer with the kind of hash the node sends us, so that nodes that only know MD5 can still verify ours
+                sendingNode->updatePacketHashFromVerifiedPacket(packet.constData());
                 return true;
             } else {
                 qDebug() << "Packet hash mismatch on" << checkType << "- Sender"
@@ -194,86 +210,173 @@ bool LimitedNodeList::packetVersionAndHashMatch(const QByteArray& packet) {
     return false;
 }
 
+void LimitedNodeList::captureInboundDatagram(const QByteArray& packet) {
+    QUuid senderUUID;
+    NodeType_t senderType = NodeType::Unassigned;
+    
+    // STUN responses are the only datagrams we take that don't have our header
+    if (packetTypeForPacket(packet) != PacketTypeStunResponse && packet.size() >= numBytesForPacketHeader(packet)) {
+        senderUUID = uuidFromPacketHeader(packet);
+        SharedNodePointer sendingNode = nodeWithUUID(senderUUID);
+        if (sendingNode) {
+            senderType = sendingNode->getType();
+        }
+    }
+    
+    _datagramCapture.write(DatagramDirection::Inbound, senderType, senderUUID, packet.constData(), packet.size());
+}
+
+bool LimitedNodeList::startDatagramCapture(const QString& filename, NodeType_t ownerType) {
+    _datagramCaptureOwnerType = ownerType;
+    return _datagramCapture.open(filename, ownerType);
+}
+
+void LimitedNodeList::stopDatagramCapture() {
+    _datagramCapture.close();
+}
+
 qint64 LimitedNodeList::writeDatagram(const QByteArray& datagram, const HifiSockAddr& destinationSockAddr,
                                       const QUuid& connectionSecret) {
-    QByteArray datagramCopy = datagram;
+    return writeDatagram(datagram.constData(), datagram.size(), destinationSockAddr, connectionSecret);
+}
+
+qint64 LimitedNodeList::writeDatagram(const char* data, qint64 size, const HifiSockAddr& destinationSockAddr,
+                                      const QUuid& connectionSecret, bool wantsLegacyHash) {
+    if (connectionSecret.isNull()) {
+        return sendDatagram(data, size, destinationSockAddr);
+    }
     
-    if (!connectionSecret.isNull()) {
-        // setup the MD5 hash for source verification in the header
-        replaceHashInPacketGivenConnectionUUID(datagramCopy, connectionSecret);
+    // the caller's packet is left alone, so the hash goes into a copy - on the stack for anything that fits in a packet
+    char stackCopy[MAX_PACKET_SIZE];
+    QByteArray heapCopy;
+    char* datagramCopy = stackCopy;
+    if (size > MAX_PACKET_SIZE) {
+        heapCopy.resize(size);
+        datagramCopy = heapCopy.data();
     }
+    memcpy(datagramCopy, data, size);
+    
+    // setup the hash for source verification in the header
+    setPacketHasKeyedHash(datagramCopy, !wantsLegacyHash);
+    replaceHashInPacketGivenConnectionUUID(datagramCopy, size, connectionSecret);
     
+    return sendDatagram(datagramCopy, size, destinationSockAddr);
+}
+
+qint64 LimitedNodeList::sendDatagram(const char* data, qint64 size, const HifiSockAddr& destinationSockAddr) {
     // stat collection for packets
     ++_numCollectedPackets;
-    _numCollectedBytes += datagram.size();
+    _numCollectedBytes += size;
     
-    qint64 bytesWritten = _nodeSocket.writeDatagram(datagramCopy,
-                                                    destinationSockAddr.getAddress(), destinationSockAddr.getPort());
+    qint64 bytesWritten;
+    if (_datagramSendBatches.hasLocalData() && _datagramSendBatches.localData()->isActive()) {
+        bytesWritten = _datagramSendBatches.localData()->queue(_nodeSocket, data, size, destinationSockAddr);
+    } else {
+        bytesWritten = _nodeSocket.writeDatagram(data, size, destinationSockAddr.getAddress(), destinationSockAddr.getPort());
+    }
     
     if (bytesWritten < 0) {
         qDebug() << "ERROR in writeDatagram:" << _nodeSocket.error() << "-" << _nodeSocket.errorString();
+    } else if (_datagramCapture.isOpen()) {
+        _datagramCapture.write(DatagramDirection::Outbound, _datagramCaptureOwnerType, _sessionUUID, data, size);
     }
     
     return bytesWritten;
 }
 
+const HifiSockAddr* LimitedNodeList::destinationSockAddrForNode(const SharedNodePointer& destinationNode,
+                                                                const HifiSockAddr& overridenSockAddr) {
+    // if we don't have an ovveriden address, assume they want to send to the node's active socket
+    if (overridenSockAddr.isNull()) {
+        // this is NULL if we don't have a socket to send to
+        return destinationNode->getActiveSocket();
+    }
+    return &overridenSockAddr;
+}
+
 qint64 LimitedNodeList::writeDatagram(const QByteArray& datagram, const SharedNodePointer& destinationNode,
                                const HifiSockAddr& overridenSockAddr) {
+    return writeDatagram(datagram.constData(), datagram.size(), destinationNode, overridenSockAddr);
+}
+
+qint64 LimitedNodeList::writeUnverifiedDatagram(const QByteArray& datagram, const SharedNodePointer& destinationNode,
+                               const HifiSockAddr& overridenSockAddr) {
+    return writeUnverifiedDatagram(datagram.constData(), datagram.size(), destinationNode, overridenSockAddr);
+}
+
+qint64 LimitedNodeList::writeUnverifiedDatagram(const QByteArray& datagram, const HifiSockAddr& destinationSockAddr) {
+    return sendDatagram(datagram.constData(), datagram.size(), destinationSockAddr);
+}
+
+qint64 LimitedNodeList::writeDatagram(const char* data, qint64 size, const SharedNodePointer& destinationNode,
+                               const HifiSockAddr& overridenSockAddr) {
     if (destinationNode) {
-        // if we don't have an ovveriden address, assume they want to send to the node's active socket
-        const HifiSockAddr* destinationSockAddr = &overridenSockAddr;
-        if (overridenSockAddr.isNull()) {
-            if (destinationNode->getActiveSocket()) {
-                // use the node's active socket as the destination socket
-                destinationSockAddr = destinationNode->getActiveSocket();
-            } else {
-                // we don't have a socket to send to, return 0
-                return 0;
-            }
+        const HifiSockAddr* destinationSockAddr = destinationSockAddrForNode(destinationNode, overridenSockAddr);
+        if (!destinationSockAddr) {
+            // we don't have a socket to send to, return 0
+            return 0;
         }
         
-        return writeDatagram(datagram, *destinationSockAddr, destinationNode->getConnectionSecret());
+        return writeDatagram(data, size, *destinationSockAddr, destinationNode->getConnectionSecret(),
+                             destinationNode->wantsLegacyPacketHash());
     }
     
     // didn't have a destinationNode to send to, return 0
     return 0;
 }
 
-qint64 LimitedNodeList::writeUnverifiedDatagram(const QByteArray& datagram, const SharedNodePointer& destinationNode,
+qint64 LimitedNodeList::writeUnverifiedDatagram(const char* data, qint64 size, const SharedNodePointer& destinationNode,
                                const HifiSockAddr& overridenSockAddr) {
     if (destinationNode) {
-        // if we don't have an ovveriden address, assume they want to send to the node's active socket
-        const HifiSockAddr* destinationSockAddr = &overridenSockAddr;
-        if (overridenSockAddr.isNull()) {
-            if (destinationNode->getActiveSocket()) {
-                // use the node's active socket as the destination socket
-                destinationSockAddr = destinationNode->getActiveSocket();
-            } else {
-                // we don't have a socket to send to, return 0
-                return 0;
-            }
+        const HifiSockAddr* destinationSockAddr = destinationSockAddrForNode(destinationNode, overridenSockAddr);
+        if (!destinationSockAddr) {
+            // we don't have a socket to send to, return 0
+            return 0;
         }
         
         // don't use the node secret!
-        return writeDatagram(datagram, *destinationSockAddr, QUuid());
+        return sendDatagram(data, size, *destinationSockAddr);
     }
     
     // didn't have a destinationNode to send to, return 0
     return 0;
 }
 
-qint64 LimitedNodeList::writeUnverifiedDatagram(const QByteArray& datagram, const HifiSockAddr& destinationSockAddr) {
-    return writeDatagram(datagram, destinationSockAddr, QUuid());
+qint64 LimitedNodeList::writeDatagram(const SharedPacketBuffer& packet, const SharedNodePointer& destinationNode,
+                                      const HifiSockAddr& overridenSockAddr) {
+    if (packet && destinationNode) {
+        const HifiSockAddr* destinationSockAddr = destinationSockAddrForNode(destinationNode, overridenSockAddr);
+        if (!destinationSockAddr) {
+            // we don't have a socket to send to, return 0
+            return 0;
+        }
+        
+        if (!NON_VERIFIED_PACKETS.contains(packet->getType()) && !destinationNode->getConnectionSecret().isNull()) {
+            // setup the hash for source verification in the header, right where it is
+            destinationNode->replaceHashInPacket(packet->getData(), packet->getSize());
+        }
+        
+        return sendDatagram(packet->getData(), packet->getSize(), *destinationSockAddr);
+    }
+    
+    // didn't have a destinationNode to send to, return 0
+    return 0;
 }
 
-qint64 LimitedNodeList::writeDatagram(const char* data, qint64 size, const SharedNodePointer& destinationNode,
-                               const HifiSockAddr& overridenSockAddr) {
-    return writeDatagram(QByteArray(data, size), destinationNode, overridenSockAddr);
+void LimitedNodeList::beginDatagramBatch() {
+    if (!_datagramSendBatches.hasLocalData()) {
+        _datagramSendBatches.setLocalData(new DatagramSendBatch());
+    }
+    _datagramSendBatches.localData()->setActive(true);
 }
 
-qint64 LimitedNodeList::writeUnverifiedDatagram(const char* data, qint64 size, const SharedNodePointer& destinationNode,
-                               const HifiSockAddr& overridenSockAddr) {
-    return writeUnverifiedDatagram(QByteArray(data, size), destinationNode, overridenSockAddr);
+int LimitedNodeList::flushDatagramBatch() {
+    if (!_datagramSendBatches.hasLocalData()) {
+        return 0;
+    }
+    DatagramSendBatch* batch = _datagramSendBatches.localData();
+    batch->setActive(false);
+    return batch->flush(_nodeSocket);
 }
 
 void LimitedNodeList::processNodeData(const HifiSockAddr& senderSockAddr, const QByteArray& packet) {
@@ -285,10 +388,11 @@ void LimitedNodeList::processNodeData(const HifiSockAddr& senderSockAddr, const
     }
 }
 
-int LimitedNodeList::updateNodeWithDataFromPacket(const SharedNodePointer& matchingNode, const QByteArray &packet) {
+int LimitedNodeList::updateNodeWithDataFromPacket(const SharedNodePointer& matchingNode, const QByteArray &packet,
+                                                  quint64 receivedUsecs) {
     QMutexLocker locker(&matchingNode->getMutex());
     
-    matchingNode->setLastHeardMicrostamp(usecTimestampNow());
+    matchingNode->setLastHeardMicrostamp(receivedUsecs ? receivedUsecs : usecTimestampNow());
     matchingNode->recordBytesReceived(packet.size());
     
     if (!matchingNode->getLinkedData() && linkedDataCreateCallback) {
@@ -297,14 +401,15 @@ int LimitedNodeList::updateNodeWithDataFromPacket(const SharedNodePointer& match
     
     QMutexLocker linkedDataLocker(&matchingNode->getLinkedData()->getMutex());
     
+    matchingNode->getLinkedData()->setPacketReceivedUsecs(receivedUsecs);
     return matchingNode->getLinkedData()->parseData(packet);
 }
 
-int LimitedNodeList::findNodeAndUpdateWithDataFromPacket(const QByteArray& packet) {
+int LimitedNodeList::findNodeAndUpdateWithDataFromPacket(const QByteArray& packet, quint64 receivedUsecs) {
     SharedNodePointer matchingNode = sendingNodeForPacket(packet);
     
     if (matchingNode) {
-        updateNodeWithDataFromPacket(matchingNode, packet);
+        updateNodeWithDataFromPacket(matchingNode, packet, receivedUsecs);
     }
     
     // we weren't able to match the sender address to the address we have for this node, unlock and don't parse
@@ -312,19 +417,9 @@ int LimitedNodeList::findNodeAndUpdateWithDataFromPacket(const QByteArray& packe
 }
 
 SharedNodePointer LimitedNodeList::nodeWithUUID(const QUuid& nodeUUID, bool blockingLock) {
-    const int WAIT_TIME = 10; // wait up to 10ms in the try lock case
-    SharedNodePointer node;
-    // if caller wants us to block and guarantee the correct answer, then honor that request
-    if (blockingLock) {
-        // this will block till we can get access
-        QMutexLocker locker(&_nodeHashMutex);
-        node = _nodeHash.value(nodeUUID);
-    } else if (_nodeHashMutex.tryLock(WAIT_TIME)) { // some callers are willing to get wrong answers but not block
-        node = _nodeHash.value(nodeUUID);
-        _nodeHashMutex.unlock();
-    }
-    return node;
- }
+    Q_UNUSED(blockingLock);
+    return getNodeSnapshot()->nodeWithUUID(nodeUUID);
+}
 
 SharedNodePointer LimitedNodeList::sendingNodeForPacket(const QByteArray& packet) {
     QUuid nodeUUID = uuidFromPacketHeader(packet);
@@ -333,9 +428,24 @@ SharedNodePointer LimitedNodeList::sendingNodeForPacket(const QByteArray& packet
     return nodeWithUUID(nodeUUID);
 }
 
-NodeHash LimitedNodeList::getNodeHash() {
-    QMutexLocker locker(&_nodeHashMutex);
-    return NodeHash(_nodeHash);
+SharedNodeSnapshot LimitedNodeList::getNodeSnapshot() {
+    NodeSnapshotCache& cache = _nodeSnapshotCaches.localData();
+    if (cache.version != _nodeSnapshotVersion.loadAcquire()) {
+        QMutexLocker locker(&_nodeSnapshotMutex);
+        cache.snapshot = _nodeSnapshot;
+        cache.version = _nodeSnapshotVersion.load();
+    }
+    return cache.snapshot;
+}
+
+void LimitedNodeList::publishNodeSnapshot() {
+    SharedNodeSnapshot newSnapshot(new NodeSnapshot(_nodeHash));
+    
+    QMutexLocker locker(&_nodeSnapshotMutex);
+    _nodeSnapshot.swap(newSnapshot);
+    _nodeSnapshotVersion.fetchAndAddOrdered(1);
+    
+    // the old snapshot is released here, or by the last thread still holding it
 }
 
 void LimitedNodeList::eraseAllNodes() {
@@ -349,6 +459,8 @@ void LimitedNodeList::eraseAllNodes() {
     while (nodeItem != _nodeHash.end()) {
         nodeItem = killNodeAtHashIterator(nodeItem);
     }
+    
+    publishNodeSnapshot();
 }
 
 void LimitedNodeList::reset() {
@@ -361,6 +473,7 @@ void LimitedNodeList::killNodeWithUUID(const QUuid& nodeUUID) {
     NodeHash::iterator nodeItemToKill = _nodeHash.find(nodeUUID);
     if (nodeItemToKill != _nodeHash.end()) {
         killNodeAtHashIterator(nodeItemToKill);
+        publishNodeSnapshot();
     }
 }
 
@@ -389,6 +502,7 @@ SharedNodePointer LimitedNodeList::addOrUpdateNode(const QUuid& uuid, NodeType_t
         SharedNodePointer newNodeSharedPointer(newNode, &QObject::deleteLater);
         
         _nodeHash.insert(newNode->getUUID(), newNodeSharedPointer);
+        publishNodeSnapshot();
         
         _nodeHashMutex.unlock();
         
@@ -470,6 +584,7 @@ void LimitedNodeList::removeSilentNodes() {
     _nodeHashMutex.lock();
     
     NodeHash::iterator nodeItem = _nodeHash.begin();
+    bool killedNodes = false;
 
     while (nodeItem != _nodeHash.end()) {
         SharedNodePointer node = nodeItem.value();
@@ -479,6 +594,7 @@ void LimitedNodeList::removeSilentNodes() {
         if ((usecTimestampNow() - node->getLastHeardMicrostamp()) > (NODE_SILENCE_THRESHOLD_MSECS * 1000)) {
             // call our private method to kill this node (removes it and emits the right signal)
             nodeItem = killNodeAtHashIterator(nodeItem);
+            killedNodes = true;
         } else {
             // we didn't kill this node, push the iterator forwards
             ++nodeItem;
@@ -487,5 +603,9 @@ void LimitedNodeList::removeSilentNodes() {
         node->getMutex().unlock();
     }
     
+    if (killedNodes) {
+        publishNodeSnapshot();
+    }
+    
     _nodeHashMutex.unlock();
 }
@@ -19,33 +19,44 @@
 #include <unistd.h> // not on windows, not needed for mac or windows
 #endif
 
+#include <QtCore/QAtomicInt>
 #include <QtCore/QElapsedTimer>
 #include <QtCore/QMutex>
 #include <QtCore/QSet>
 #include <QtCore/QSettings>
 #include <QtCore/QSharedPointer>
+#include <QtCore/QThreadStorage>
 #include <QtNetwork/QHostAddress>
 #include <QtNetwork/QUdpSocket>
 
+#include "DatagramLog.h"
 #include "DomainHandler.h"
 #include "Node.h"
+#include "NodeSnapshot.h"
 
 const int MAX_PACKET_SIZE = 1500;
 
 const quint64 NODE_SILENCE_THRESHOLD_MSECS = 2 * 1000;
 
+// A domain list is versioned, and a node acks the last version it has every part of in its list requests. When the ack
+// matches the last list sent to it, the domain-server sends only the nodes that changed or went away since then, and
+// otherwise the whole list again. Every packet of a list starts with the node's own UUID, the list version, whether it
+// is a full list, and the part index and count, followed by entries that each start with one of these.
+const quint8 DOMAIN_LIST_NODE_ENTRY = 0;
+const quint8 DOMAIN_LIST_REMOVED_NODE_ENTRY = 1;
+
 extern const char SOLO_NODE_TYPES[2];
 
 extern const QUrl DEFAULT_NODE_AUTH_URL;
 
 const char DEFAULT_ASSIGNMENT_SERVER_HOSTNAME[] = "localhost";
 
+class DatagramSendBatch;
 class HifiSockAddr;
+class PacketBuffer;
 
 typedef QSet<NodeType_t> NodeSet;
 
-typedef QSharedPointer<Node> SharedNodePointer;
-typedef QHash<QUuid, SharedNodePointer> NodeHash;
 Q_DECLARE_METATYPE(SharedNodePointer)
 
 class LimitedNodeList : public QObject {
@@ -75,11 +86,32 @@ public:
     qint64 writeUnverifiedDatagram(const char* data, qint64 size, const SharedNodePointer& destinationNode,
                          const HifiSockAddr& overridenSockAddr = HifiSockAddr());
 
+    /// Hashes the packet in place, instead of hashing a copy of it
+    qint64 writeDatagram(const QSharedPointer<PacketBuffer>& packet, const SharedNodePointer& destinationNode,
+                         const HifiSockAddr& overridenSockAddr = HifiSockAddr());
+
+    /// Datagrams written from the calling thread are queued from here on, and sent with as few system calls as the
+    /// platform allows when the batch fills up or at flushDatagramBatch()
+    void beginDatagramBatch();
+    /// \return the number of datagrams sent
+    int flushDatagramBatch();
+
+    /// Logs every datagram sent and received from here on, with when it was and the node that sent it, to a file the
+    /// datagram-replay tool can play back
+    /// \param ownerType the type of node we are, which replays as
+    bool startDatagramCapture(const QString& filename, NodeType_t ownerType);
+    void stopDatagramCapture();
+    bool isCapturingDatagrams() const { return _datagramCapture.isOpen(); }
+
     void(*linkedDataCreateCallback)(Node *);
 
-    NodeHash getNodeHash();
-    int size() const { return _nodeHash.size(); }
+    /// The nodes as of the last change to them. This doesn't lock unless the nodes changed since the calling thread last
+    /// asked, so it is cheap enough to call for every frame, or every node.
+    SharedNodeSnapshot getNodeSnapshot();
+    NodeHash getNodeHash() { return getNodeSnapshot()->getNodeHash(); }
+    int size() { return getNodeSnapshot()->size(); }
 
+    /// Looks the node up in the current snapshot, which never blocks, so blockingLock no longer changes anything
     SharedNodePointer nodeWithUUID(const QUuid& nodeUUID, bool blockingLock = true);
     SharedNodePointer sendingNodeForPacket(const QByteArray& packet);
     
@@ -91,8 +123,10 @@ public:
     void processNodeData(const HifiSockAddr& senderSockAddr, const QByteArray& packet);
     void processKillNode(const QByteArray& datagram);
 
-    int updateNodeWithDataFromPacket(const SharedNodePointer& matchingNode, const QByteArray& packet);
-    int findNodeAndUpdateWithDataFromPacket(const QByteArray& packet);
+    /// \param receivedUsecs when the packet came off the socket, 0 for now
+    int updateNodeWithDataFromPacket(const SharedNodePointer& matchingNode, const QByteArray& packet,
+                                     quint64 receivedUsecs = 0);
+    int findNodeAndUpdateWithDataFromPacket(const QByteArray& packet, quint64 receivedUsecs = 0);
 
     unsigned broadcastToNodes(const QByteArray& packet, const NodeSet& destinationNodeTypes);
     SharedNodePointer soloNodeOfType(char nodeType);
@@ -119,17 +153,45 @@ protected:
     
     qint64 writeDatagram(const QByteArray& datagram, const HifiSockAddr& destinationSockAddr,
                          const QUuid& connectionSecret);
+    qint64 writeDatagram(const char* data, qint64 size, const HifiSockAddr& destinationSockAddr,
+                         const QUuid& connectionSecret, bool wantsLegacyHash = false);
+    /// sends a datagram that is already hashed, if it needs to be
+    qint64 sendDatagram(const char* data, qint64 size, const HifiSockAddr& destinationSockAddr);
+
+    void captureInboundDatagram(const QByteArray& packet);
+
+    const HifiSockAddr* destinationSockAddrForNode(const SharedNodePointer& destinationNode,
+                                                   const HifiSockAddr& overridenSockAddr);
 
     NodeHash::iterator killNodeAtHashIterator(NodeHash::iterator& nodeItemToKill);
 
+    /// Makes the current contents of _nodeHash the snapshot readers get, must be called with _nodeHashMutex held
+    void publishNodeSnapshot();
+
     
     void changeSendSocketBufferSize(int numSendBytes);
 
     QUuid _sessionUUID;
-    NodeHash _nodeHash;
+    NodeHash _nodeHash; // the nodes as the writers see them, guarded by _nodeHashMutex
     QMutex _nodeHashMutex;
+
+    // the last published snapshot of _nodeHash, which is swapped under _nodeSnapshotMutex. Every thread keeps its own
+    // reference to the snapshot it last read, and only takes the mutex again once the version says there is a new one.
+    class NodeSnapshotCache {
+    public:
+        NodeSnapshotCache() : version(-1), snapshot() {}
+        int version;
+        SharedNodeSnapshot snapshot;
+    };
+    SharedNodeSnapshot _nodeSnapshot;
+    QAtomicInt _nodeSnapshotVersion;
+    QMutex _nodeSnapshotMutex;
+    QThreadStorage<NodeSnapshotCache> _nodeSnapshotCaches;
     QUdpSocket _nodeSocket;
     QUdpSocket* _dtlsSocket;
+    QThreadStorage<DatagramSendBatch*> _datagramSendBatches;
+    DatagramLogWriter _datagramCapture;
+    NodeType_t _datagramCaptureOwnerType;
     int _numCollectedPackets;
     int _numCollectedBytes;
     QElapsedTimer _packetStatTimer;
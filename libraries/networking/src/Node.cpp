@@ -13,6 +13,7 @@
 #include <stdio.h>
 
 #include "Node.h"
+#include "PacketHeaders.h"
 #include "SharedUtil.h"
 
 #include <QtCore/QDataStream>
@@ -53,6 +54,7 @@ Node::Node(const QUuid& uuid, NodeType_t type, const HifiSockAddr& publicSocket,
     _symmetricSocket(),
     _activeSocket(NULL),
     _connectionSecret(),
+    _wantsLegacyPacketHash(0),
     _bytesReceivedMovingAverage(NULL),
     _linkedData(NULL),
     _isAlive(true),
@@ -68,6 +70,15 @@ Node::~Node() {
     delete _bytesReceivedMovingAverage;
 }
 
+void Node::updatePacketHashFromVerifiedPacket(const char* packet) {
+    setWantsLegacyPacketHash(!packetHasKeyedHash(packet));
+}
+
+void Node::replaceHashInPacket(char* packet, int packetLength) const {
+    setPacketHasKeyedHash(packet, !wantsLegacyPacketHash());
+    replaceHashInPacketGivenConnectionUUID(packet, packetLength, _connectionSecret);
+}
+
 void Node::setPublicSocket(const HifiSockAddr& publicSocket) {
     if (_activeSocket == &_publicSocket) {
         // if the active socket was the public socket then reset it to NULL
@@ -15,6 +15,7 @@
 #include <ostream>
 #include <stdint.h>
 
+#include <QtCore/QAtomicInt>
 #include <QtCore/QDebug>
 #include <QtCore/QMutex>
 #include <QtCore/QUuid>
@@ -81,6 +82,17 @@ public:
     const QUuid& getConnectionSecret() const { return _connectionSecret; }
     void setConnectionSecret(const QUuid& connectionSecret) { _connectionSecret = connectionSecret; }
 
+    /// true once the node has sent us a verified packet hashed with MD5, meaning it can't check keyed hashes either -
+    /// every node pings the nodes it hears of until it reaches them, so even a node that only queries tells us early on
+    bool wantsLegacyPacketHash() const { return _wantsLegacyPacketHash.load() != 0; }
+    void setWantsLegacyPacketHash(bool wantsLegacyPacketHash) { _wantsLegacyPacketHash.store(wantsLegacyPacketHash); }
+    
+    /// answers the node with the kind of hash it sent us in a verified packet that matched its connection secret
+    void updatePacketHashFromVerifiedPacket(const char* packet);
+    
+    /// hashes a verified packet for sending to this node, with the kind of hash it can check
+    void replaceHashInPacket(char* packet, int packetLength) const;
+
     NodeData* getLinkedData() const { return _linkedData; }
     void setLinkedData(NodeData* linkedData) { _linkedData = linkedData; }
 
@@ -115,6 +127,7 @@ private:
     HifiSockAddr _symmetricSocket;
     HifiSockAddr* _activeSocket;
     QUuid _connectionSecret;
+    QAtomicInt _wantsLegacyPacketHash; // written by the thread that reads packets, read by the ones that send them
     SimpleMovingAverage* _bytesReceivedMovingAverage;
     NodeData* _linkedData;
     bool _isAlive;
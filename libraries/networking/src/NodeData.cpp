@@ -12,7 +12,8 @@
 #include "NodeData.h"
 
 NodeData::NodeData() :
-    _mutex()
+    _mutex(),
+    _packetReceivedUsecs(0)
 {
     
 }
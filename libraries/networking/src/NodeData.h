@@ -26,8 +26,13 @@ public:
     
     QMutex& getMutex() { return _mutex; }
 
+    /// when the packet about to be parsed came off the socket, 0 if that wasn't recorded
+    void setPacketReceivedUsecs(quint64 packetReceivedUsecs) { _packetReceivedUsecs = packetReceivedUsecs; }
+    quint64 getPacketReceivedUsecs() const { return _packetReceivedUsecs; }
+
 private:
     QMutex _mutex;
+    quint64 _packetReceivedUsecs;
 };
 
 #endif // hifi_NodeData_h
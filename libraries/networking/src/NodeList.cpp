@@ -56,6 +56,9 @@ NodeList::NodeList(char newOwnerType, unsigned short socketListenPort, unsigned
     _nodeTypesOfInterest(),
     _domainHandler(this),
     _numNoReplyDomainCheckIns(0),
+    _domainListVersion(0),
+    _pendingDomainListVersion(0),
+    _pendingDomainListParts(),
     _assignmentServerSocket(),
     _publicSockAddr(),
     _hasCompletedInitialSTUNFailure(false),
@@ -66,6 +69,9 @@ NodeList::NodeList(char newOwnerType, unsigned short socketListenPort, unsigned
     
     // clear our NodeList when logout is requested
     connect(&AccountManager::getInstance(), &AccountManager::logoutComplete , this, &NodeList::reset);
+    
+    // a node we drop ourselves isn't in any list of changes the domain-server would send, so ask for a full one
+    connect(this, &LimitedNodeList::nodeKilled, this, &NodeList::restartDomainListOnNodeKilled);
 }
 
 qint64 NodeList::sendStatsToDomainServer(const QJsonObject& statsObject) {
@@ -169,10 +175,21 @@ void NodeList::processNodeData(const HifiSockAddr& senderSockAddr, const QByteAr
     }
 }
 
+void NodeList::restartDomainListOnNodeKilled() {
+    // a node removed by a list of changes is killed before that list's version is taken, so this only sticks for the
+    // nodes that went silent or were killed by a peer
+    _domainListVersion = 0;
+}
+
 void NodeList::reset() {
     LimitedNodeList::reset();
     
     _numNoReplyDomainCheckIns = 0;
+    
+    // the next domain list is a full one
+    _domainListVersion = 0;
+    _pendingDomainListVersion = 0;
+    _pendingDomainListParts.clear();
 
     // refresh the owner UUID to the NULL UUID
     setSessionUUID(QUuid());
@@ -364,6 +381,11 @@ void NodeList::sendDomainServerCheckIn() {
             packetStream << nodeTypeOfInterest;
         }
         
+        if (domainPacketType == PacketTypeDomainListRequest) {
+            // ack the last list we have all of, so the domain-server can send just what changed since
+            packetStream << _domainListVersion;
+        }
+        
         if (!isUsingDTLS) {
             writeDatagram(domainServerPacket, _domainHandler.getSockAddr(), QUuid());
         }
@@ -412,8 +434,30 @@ int NodeList::processDomainServerList(const QByteArray& packet) {
     packetStream >> newUUID;
     setSessionUUID(newUUID);
     
+    // then which version of the list this is, and which part of it
+    quint32 listVersion = 0;
+    quint8 isFullList = 0;
+    quint16 partIndex = 0;
+    quint16 numParts = 0;
+    packetStream >> listVersion >> isFullList >> partIndex >> numParts;
+    
+    if (listVersion != _pendingDomainListVersion) {
+        _pendingDomainListVersion = listVersion;
+        _pendingDomainListParts.clear();
+    }
+    
     // pull each node in the packet
     while(packetStream.device()->pos() < packet.size()) {
+        quint8 entryType = DOMAIN_LIST_NODE_ENTRY;
+        packetStream >> entryType;
+        
+        if (entryType == DOMAIN_LIST_REMOVED_NODE_ENTRY) {
+            // only a list of changes removes nodes, a full one just doesn't mention them and they go silent
+            packetStream >> nodeUUID;
+            killNodeWithUUID(nodeUUID);
+            continue;
+        }
+        
         packetStream >> nodeType >> nodeUUID >> nodePublicSocket >> nodeLocalSocket;
 
         // if the public socket address is 0 then it's reachable at the same IP
@@ -426,6 +470,14 @@ int NodeList::processDomainServerList(const QByteArray& packet) {
         
         packetStream >> connectionUUID;
         node->setConnectionSecret(connectionUUID);
+        
+        readNodes++;
+    }
+    
+    // once every part of the list is in, that is the version we ack
+    _pendingDomainListParts.insert(partIndex);
+    if (_pendingDomainListParts.size() >= numParts) {
+        _domainListVersion = listVersion;
     }
     
     // ping inactive nodes in conjunction with receipt of list from domain-server
@@ -83,6 +83,8 @@ public slots:
     void pingInactiveNodes();
 signals:
     void limitOfSilentDomainCheckInsReached();
+private slots:
+    void restartDomainListOnNodeKilled();
 private:
     static NodeList* _sharedInstance;
 
@@ -101,6 +103,9 @@ private:
     NodeSet _nodeTypesOfInterest;
     DomainHandler _domainHandler;
     int _numNoReplyDomainCheckIns;
+    quint32 _domainListVersion; // the version of the last domain list we received all of
+    quint32 _pendingDomainListVersion;
+    QSet<quint16> _pendingDomainListParts;
     HifiSockAddr _assignmentServerSocket;
     HifiSockAddr _publicSockAddr;
     bool _hasCompletedInitialSTUNFailure;
@@ -0,0 +1,28 @@
+//
+//  NodeSnapshot.cpp
+//  libraries/networking/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#include "NodeSnapshot.h"
+
+NodeSnapshot::NodeSnapshot() :
+    _nodeHash(),
+    _nodes()
+{
+
+}
+
+NodeSnapshot::NodeSnapshot(const NodeHash& nodeHash) :
+    _nodeHash(nodeHash),
+    _nodes()
+{
+    _nodes.reserve(_nodeHash.size());
+    foreach (const SharedNodePointer& node, _nodeHash) {
+        _nodes.append(node);
+    }
+}
@@ -0,0 +1,45 @@
+//
+//  NodeSnapshot.h
+//  libraries/networking/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#ifndef hifi_NodeSnapshot_h
+#define hifi_NodeSnapshot_h
+
+#include <QtCore/QHash>
+#include <QtCore/QSharedPointer>
+#include <QtCore/QUuid>
+#include <QtCore/QVector>
+
+#include "Node.h"
+
+typedef QSharedPointer<Node> SharedNodePointer;
+typedef QHash<QUuid, SharedNodePointer> NodeHash;
+
+/// The nodes of a LimitedNodeList at one point in time. A snapshot is never changed once it is published, so any number
+/// of threads can read it without locking, and it keeps its nodes alive for as long as it is held. Nodes can be looked
+/// up by UUID, or walked in order through the dense array, which is cheaper than iterating the hash.
+class NodeSnapshot {
+public:
+    NodeSnapshot();
+    NodeSnapshot(const NodeHash& nodeHash);
+
+    const NodeHash& getNodeHash() const { return _nodeHash; }
+    const QVector<SharedNodePointer>& getNodes() const { return _nodes; }
+    int size() const { return _nodes.size(); }
+
+    SharedNodePointer nodeWithUUID(const QUuid& nodeUUID) const { return _nodeHash.value(nodeUUID); }
+
+private:
+    NodeHash _nodeHash;
+    QVector<SharedNodePointer> _nodes;
+};
+
+typedef QSharedPointer<const NodeSnapshot> SharedNodeSnapshot;
+
+#endif // hifi_NodeSnapshot_h
@@ -0,0 +1,63 @@
+//
+//  PacketBuffer.cpp
+//  libraries/networking/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#include "PacketBuffer.h"
+
+QMutex PacketBuffer::_poolMutex;
+QVector<PacketBuffer*> PacketBuffer::_pool;
+
+PacketBuffer::PacketBuffer() :
+    _type(PacketTypeUnknown),
+    _numHeaderBytes(0),
+    _numPayloadBytes(0)
+{
+
+}
+
+SharedPacketBuffer PacketBuffer::create(PacketType type, const QUuid& connectionUUID) {
+    PacketBuffer* buffer = NULL;
+
+    _poolMutex.lock();
+    if (!_pool.isEmpty()) {
+        buffer = _pool.last();
+        _pool.removeLast();
+    }
+    _poolMutex.unlock();
+
+    if (!buffer) {
+        buffer = new PacketBuffer();
+    }
+
+    buffer->_type = type;
+    buffer->_numHeaderBytes = populatePacketHeader(buffer->_data, type, connectionUUID);
+    buffer->_numPayloadBytes = 0;
+
+    return SharedPacketBuffer(buffer, &PacketBuffer::recycle);
+}
+
+void PacketBuffer::setPayloadBytes(int numPayloadBytes) {
+    _numPayloadBytes = qBound(0, numPayloadBytes, getMaxPayloadBytes());
+}
+
+int PacketBuffer::getPooledCount() {
+    QMutexLocker locker(&_poolMutex);
+    return _pool.size();
+}
+
+void PacketBuffer::recycle(PacketBuffer* buffer) {
+    _poolMutex.lock();
+    if (_pool.size() < MAX_POOLED_PACKET_BUFFERS) {
+        _pool.append(buffer);
+        buffer = NULL;
+    }
+    _poolMutex.unlock();
+
+    delete buffer;
+}
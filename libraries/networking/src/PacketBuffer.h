@@ -0,0 +1,67 @@
+//
+//  PacketBuffer.h
+//  libraries/networking/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#ifndef hifi_PacketBuffer_h
+#define hifi_PacketBuffer_h
+
+#include <QtCore/QMutex>
+#include <QtCore/QSharedPointer>
+#include <QtCore/QVector>
+
+#include "LimitedNodeList.h"
+#include "PacketHeaders.h"
+
+class PacketBuffer;
+
+typedef QSharedPointer<PacketBuffer> SharedPacketBuffer;
+
+const int MAX_POOLED_PACKET_BUFFERS = 256;
+
+/// A packet sized buffer that starts with the packet header, so the payload can be packed in place behind it and the
+/// whole packet handed to LimitedNodeList::writeDatagram(), which hashes it in place, without another copy. Buffers come
+/// from a pool and go back to it once the last reference to them is gone.
+class PacketBuffer {
+public:
+    static SharedPacketBuffer create(PacketType type, const QUuid& connectionUUID = nullUUID);
+
+    PacketType getType() const { return _type; }
+
+    char* getData() { return _data; }
+    const char* getData() const { return _data; }
+    int getSize() const { return _numHeaderBytes + _numPayloadBytes; }
+
+    int getNumHeaderBytes() const { return _numHeaderBytes; }
+    char* getPayload() { return _data + _numHeaderBytes; }
+    const char* getPayload() const { return _data + _numHeaderBytes; }
+    int getMaxPayloadBytes() const { return MAX_PACKET_SIZE - _numHeaderBytes; }
+
+    int getPayloadBytes() const { return _numPayloadBytes; }
+    /// sets how much of the payload was packed, which is clamped to getMaxPayloadBytes()
+    void setPayloadBytes(int numPayloadBytes);
+
+    static int getPooledCount();
+
+private:
+    PacketBuffer();
+    PacketBuffer(const PacketBuffer&);
+    PacketBuffer& operator=(const PacketBuffer&);
+
+    static void recycle(PacketBuffer* buffer);
+
+    PacketType _type;
+    char _data[MAX_PACKET_SIZE];
+    int _numHeaderBytes;
+    int _numPayloadBytes;
+
+    static QMutex _poolMutex;
+    static QVector<PacketBuffer*> _pool;
+};
+
+#endif // hifi_PacketBuffer_h
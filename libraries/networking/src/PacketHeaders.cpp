@@ -13,6 +13,8 @@
 
 #include <QtCore/QDebug>
 
+#include <SipHash.h>
+
 #include "NodeList.h"
 
 #include "PacketHeaders.h"
@@ -55,13 +57,15 @@ PacketVersion versionForPacketType(PacketType type) {
             return 1;
         case PacketTypeAvatarData:
             return 3;
+        case PacketTypeBulkAvatarData:
+            return 1;
         case PacketTypeAvatarIdentity:
             return 1;
         case PacketTypeEnvironmentData:
             return 2;
         case PacketTypeDomainList:
         case PacketTypeDomainListRequest:
-            return 3;
+            return 4;
         case PacketTypeCreateAssignment:
         case PacketTypeRequestAssignment:
             return 2;
@@ -69,7 +73,7 @@ PacketVersion versionForPacketType(PacketType type) {
         case PacketTypeVoxelSetDestructive:
             return 1;
         case PacketTypeOctreeStats:
-            return 1;
+            return 2;
         case PacketTypeParticleData:
             return 1;
         case PacketTypeParticleErase:
@@ -80,6 +84,8 @@ PacketVersion versionForPacketType(PacketType type) {
             return 1;
         case PacketTypeAudioStreamStats:
             return 1;
+        case PacketTypeOctreeDataNack:
+            return 1;
         default:
             return 0;
     }
@@ -102,6 +108,9 @@ int populatePacketHeader(QByteArray& packet, PacketType type, const QUuid& conne
 int populatePacketHeader(char* packet, PacketType type, const QUuid& connectionUUID) {
     int numTypeBytes = packArithmeticallyCodedValue(type, packet);
     packet[numTypeBytes] = versionForPacketType(type);
+    if (!NON_VERIFIED_PACKETS.contains(type)) {
+        packet[numTypeBytes] |= PACKET_VERSION_KEYED_HASH_FLAG;
+    }
     
     char* position = packet + numTypeBytes + sizeof(PacketVersion);
     
@@ -112,9 +121,9 @@ int populatePacketHeader(char* packet, PacketType type, const QUuid& connectionU
     position += NUM_BYTES_RFC4122_UUID;
     
     if (!NON_VERIFIED_PACKETS.contains(type)) {
-        // pack 16 bytes of zeros where the md5 hash will be placed once data is packed
-        memset(position, 0, NUM_BYTES_MD5_HASH);
-        position += NUM_BYTES_MD5_HASH;
+        // pack 16 bytes of zeros where the hash will be placed once data is packed
+        memset(position, 0, NUM_BYTES_PACKET_HASH);
+        position += NUM_BYTES_PACKET_HASH;
     }
     
     // return the number of bytes written for pointer pushing
@@ -142,7 +151,7 @@ int numBytesForPacketHeaderGivenPacketType(PacketType type) {
 }
 
 int numHashBytesInPacketHeaderGivenPacketType(PacketType type) {
-    return (NON_VERIFIED_PACKETS.contains(type) ? 0 : NUM_BYTES_MD5_HASH);
+    return (NON_VERIFIED_PACKETS.contains(type) ? 0 : NUM_BYTES_PACKET_HASH);
 }
 
 QUuid uuidFromPacketHeader(const QByteArray& packet) {
@@ -150,18 +159,71 @@ QUuid uuidFromPacketHeader(const QByteArray& packet) {
                                          NUM_BYTES_RFC4122_UUID));
 }
 
+PacketVersion versionFromPacketHeader(const char* packet) {
+    return packet[numBytesArithmeticCodingFromBuffer(packet)] & ~PACKET_VERSION_KEYED_HASH_FLAG;
+}
+
+bool packetHasKeyedHash(const char* packet) {
+    return (packet[numBytesArithmeticCodingFromBuffer(packet)] & PACKET_VERSION_KEYED_HASH_FLAG) != 0;
+}
+
+void setPacketHasKeyedHash(char* packet, bool hasKeyedHash) {
+    char& version = packet[numBytesArithmeticCodingFromBuffer(packet)];
+    version = hasKeyedHash ? (version | PACKET_VERSION_KEYED_HASH_FLAG) : (version & ~PACKET_VERSION_KEYED_HASH_FLAG);
+}
+
 QByteArray hashFromPacketHeader(const QByteArray& packet) {
-    return packet.mid(numBytesForPacketHeader(packet) - NUM_BYTES_MD5_HASH, NUM_BYTES_MD5_HASH);
+    return packet.mid(numBytesForPacketHeader(packet) - NUM_BYTES_PACKET_HASH, NUM_BYTES_PACKET_HASH);
 }
 
 QByteArray hashForPacketAndConnectionUUID(const QByteArray& packet, const QUuid& connectionUUID) {
-    return QCryptographicHash::hash(packet.mid(numBytesForPacketHeader(packet)) + connectionUUID.toRfc4122(),
-                                    QCryptographicHash::Md5);
+    QByteArray hash(NUM_BYTES_PACKET_HASH, 0);
+    hashForPacketAndConnectionUUID(packet.constData(), packet.size(), connectionUUID, hash.data());
+    return hash;
 }
 
 void replaceHashInPacketGivenConnectionUUID(QByteArray& packet, const QUuid& connectionUUID) {
-    packet.replace(numBytesForPacketHeader(packet) - NUM_BYTES_MD5_HASH, NUM_BYTES_MD5_HASH,
-                   hashForPacketAndConnectionUUID(packet, connectionUUID));
+    replaceHashInPacketGivenConnectionUUID(packet.data(), packet.size(), connectionUUID);
+}
+
+void hashForPacketAndConnectionUUID(const char* packet, int packetLength, const QUuid& connectionUUID, char* hash) {
+    int numBytesHeader = numBytesForPacketHeader(packet);
+    const char* payload = packet + numBytesHeader;
+    int payloadLength = packetLength - numBytesHeader;
+
+    if (!packetHasKeyedHash(packet)) {
+        // the hash older peers expect
+        QCryptographicHash md5(QCryptographicHash::Md5);
+        md5.addData(payload, payloadLength);
+        md5.addData(connectionUUID.toRfc4122());
+        memcpy(hash, md5.result().constData(), NUM_BYTES_PACKET_HASH);
+        return;
+    }
+
+    // the key is the connection secret in RFC 4122 byte order, packed without going through a QByteArray
+    unsigned char key[SIPHASH_KEY_BYTES];
+    for (int i = 0; i < 4; i++) {
+        key[i] = (unsigned char)(connectionUUID.data1 >> (8 * (3 - i)));
+    }
+    key[4] = (unsigned char)(connectionUUID.data2 >> 8);
+    key[5] = (unsigned char)connectionUUID.data2;
+    key[6] = (unsigned char)(connectionUUID.data3 >> 8);
+    key[7] = (unsigned char)connectionUUID.data3;
+    memcpy(key + 8, connectionUUID.data4, 8);
+
+    SipHash::hash128(key, payload, payloadLength, reinterpret_cast<unsigned char*>(hash));
+}
+
+void replaceHashInPacketGivenConnectionUUID(char* packet, int packetLength, const QUuid& connectionUUID) {
+    hashForPacketAndConnectionUUID(packet, packetLength, connectionUUID,
+                                   packet + numBytesForPacketHeader(packet) - NUM_BYTES_PACKET_HASH);
+}
+
+bool packetHashMatchesConnectionUUID(const char* packet, int packetLength, const QUuid& connectionUUID) {
+    char expectedHash[NUM_BYTES_PACKET_HASH];
+    hashForPacketAndConnectionUUID(packet, packetLength, connectionUUID, expectedHash);
+    return memcmp(expectedHash, packet + numBytesForPacketHeader(packet) - NUM_BYTES_PACKET_HASH,
+                  NUM_BYTES_PACKET_HASH) == 0;
 }
 
 PacketType packetTypeForPacket(const QByteArray& packet) {
@@ -82,9 +82,14 @@ const QSet<PacketType> NON_VERIFIED_PACKETS = QSet<PacketType>()
     << PacketTypeNodeJsonStats << PacketTypeVoxelQuery << PacketTypeParticleQuery << PacketTypeModelQuery
     << PacketTypeOctreeDataNack << PacketTypeVoxelEditNack << PacketTypeParticleEditNack << PacketTypeModelEditNack;
 
-const int NUM_BYTES_MD5_HASH = 16;
+const int NUM_BYTES_PACKET_HASH = 16;
 const int NUM_STATIC_HEADER_BYTES = sizeof(PacketVersion) + NUM_BYTES_RFC4122_UUID;
-const int MAX_PACKET_HEADER_BYTES = sizeof(PacketType) + NUM_BYTES_MD5_HASH + NUM_STATIC_HEADER_BYTES;
+const int MAX_PACKET_HEADER_BYTES = sizeof(PacketType) + NUM_BYTES_PACKET_HASH + NUM_STATIC_HEADER_BYTES;
+
+/// Verified packets are hashed with a SipHash keyed by the connection secret when this bit is set in their version byte,
+/// and with an MD5 of the payload and the connection secret when it isn't. We always set it, and answer peers that
+/// don't with MD5 hashes.
+const PacketVersion PACKET_VERSION_KEYED_HASH_FLAG = 0x40;
 
 PacketVersion versionForPacketType(PacketType type);
 
@@ -102,10 +107,21 @@ int numBytesForPacketHeaderGivenPacketType(PacketType type);
 
 QUuid uuidFromPacketHeader(const QByteArray& packet);
 
+/// the version of the packet, without the keyed hash flag
+PacketVersion versionFromPacketHeader(const char* packet);
+bool packetHasKeyedHash(const char* packet);
+void setPacketHasKeyedHash(char* packet, bool hasKeyedHash);
+
 QByteArray hashFromPacketHeader(const QByteArray& packet);
 QByteArray hashForPacketAndConnectionUUID(const QByteArray& packet, const QUuid& connectionUUID);
 void replaceHashInPacketGivenConnectionUUID(QByteArray& packet, const QUuid& connectionUUID);
 
+/// Hashes the payload of the packet in place, with the kind of hash its version byte asks for
+/// \param hash NUM_BYTES_PACKET_HASH bytes to write the hash to
+void hashForPacketAndConnectionUUID(const char* packet, int packetLength, const QUuid& connectionUUID, char* hash);
+void replaceHashInPacketGivenConnectionUUID(char* packet, int packetLength, const QUuid& connectionUUID);
+bool packetHashMatchesConnectionUUID(const char* packet, int packetLength, const QUuid& connectionUUID);
+
 PacketType packetTypeForPacket(const QByteArray& packet);
 PacketType packetTypeForPacket(const char* packet);
 
@@ -0,0 +1,198 @@
+//
+//  PacketPacer.cpp
+//  libraries/networking/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#include <algorithm>
+
+#include <QtCore/QMutexLocker>
+
+#include "NodeList.h"
+#include "PacketSender.h"
+#include "SharedUtil.h"
+
+#include "PacketPacer.h"
+
+PacketPacer* PacketPacer::getInstance() {
+    static QMutex instanceMutex;
+    static PacketPacer* instance = NULL;
+
+    QMutexLocker locker(&instanceMutex);
+    if (!instance) {
+        instance = new PacketPacer();
+        instance->initialize(true);
+    }
+    return instance;
+}
+
+PacketPacer::PacketPacer() :
+    _wheel(PACKET_PACER_WHEEL_SLOTS),
+    _currentSlot(0),
+    _currentSlotStart(usecTimestampNow()),
+    _numScheduled(0),
+    _senders(),
+    _scheduledSenders(),
+    _dueSenders()
+{
+}
+
+void PacketPacer::addSender(PacketSender* sender) {
+    lock();
+    _senders.insert(sender);
+    unlock();
+}
+
+void PacketPacer::removeSender(PacketSender* sender) {
+    lock();
+    _senders.remove(sender);
+    if (_scheduledSenders.remove(sender)) {
+        for (int i = 0; i < _wheel.size(); i++) {
+            QVector<Timer>& slot = _wheel[i];
+            for (int j = slot.size() - 1; j >= 0; j--) {
+                if (slot[j].sender == sender) {
+                    slot.remove(j);
+                    _numScheduled--;
+                }
+            }
+        }
+    }
+    unlock();
+
+    // wait for a send that may already have the sender
+    _sendingMutex.lock();
+    _sendingMutex.unlock();
+}
+
+void PacketPacer::senderHasPackets(PacketSender* sender) {
+    lock();
+    bool wasScheduled = _scheduledSenders.contains(sender);
+    schedule(sender, 0); // in the current slot, so it is taken right away
+    unlock();
+
+    if (!wasScheduled) {
+        _hasTimers.wakeAll();
+    }
+}
+
+int PacketPacer::getSenderCount() {
+    QMutexLocker locker(&_mutex);
+    return _senders.size();
+}
+
+int PacketPacer::getScheduledCount() {
+    QMutexLocker locker(&_mutex);
+    return _numScheduled;
+}
+
+void PacketPacer::schedule(PacketSender* sender, quint64 dueAt) {
+    if (!_senders.contains(sender) || _scheduledSenders.contains(sender)) {
+        return;
+    }
+
+    // an idle wheel starts turning again from now
+    if (_numScheduled == 0) {
+        _currentSlotStart = usecTimestampNow();
+    }
+
+    // rounded up to the first tick starting at or after the due time, so a sender is never taken early
+    quint64 ticks = (dueAt > _currentSlotStart)
+        ? (dueAt - _currentSlotStart + PACKET_PACER_TICK_USECS - 1) / PACKET_PACER_TICK_USECS : 0;
+    Timer timer;
+    timer.sender = sender;
+    timer.rounds = ticks / PACKET_PACER_WHEEL_SLOTS;
+    _wheel[(_currentSlot + ticks) % PACKET_PACER_WHEEL_SLOTS].append(timer);
+
+    _scheduledSenders.insert(sender);
+    _numScheduled++;
+}
+
+void PacketPacer::takeDue(quint64 now, QVector<PacketSender*>& due) {
+    if (_numScheduled == 0) {
+        return;
+    }
+
+    while (true) {
+        QVector<Timer>& slot = _wheel[_currentSlot];
+        for (int i = slot.size() - 1; i >= 0; i--) {
+            if (slot[i].rounds == 0) {
+                due.append(slot[i].sender);
+                _scheduledSenders.remove(slot[i].sender);
+                slot.remove(i);
+                _numScheduled--;
+            }
+        }
+
+        if (_numScheduled == 0 || now < _currentSlotStart + PACKET_PACER_TICK_USECS) {
+            break;
+        }
+
+        // the timers left in the slot we're leaving are due on a later turn of the wheel
+        for (int i = 0; i < slot.size(); i++) {
+            slot[i].rounds--;
+        }
+        _currentSlot = (_currentSlot + 1) % PACKET_PACER_WHEEL_SLOTS;
+        _currentSlotStart += PACKET_PACER_TICK_USECS;
+    }
+}
+
+quint64 PacketPacer::getNextTickWithTimers() const {
+    for (int i = 1; i < PACKET_PACER_WHEEL_SLOTS; i++) {
+        const QVector<Timer>& slot = _wheel[(_currentSlot + i) % PACKET_PACER_WHEEL_SLOTS];
+        for (int j = 0; j < slot.size(); j++) {
+            if (slot[j].rounds == 0) {
+                return _currentSlotStart + i * PACKET_PACER_TICK_USECS;
+            }
+        }
+    }
+    // everything is at least one turn of the wheel away
+    return _currentSlotStart + PACKET_PACER_WHEEL_SLOTS * PACKET_PACER_TICK_USECS;
+}
+
+bool PacketPacer::process() {
+    lock();
+    quint64 now = usecTimestampNow();
+    takeDue(now, _dueSenders);
+
+    if (_dueSenders.isEmpty()) {
+        if (_numScheduled == 0) {
+            _hasTimers.wait(&_mutex);
+        } else {
+            quint64 nextTick = getNextTickWithTimers();
+            quint64 usecsToWait = (nextTick > now) ? nextTick - now : 0;
+            _hasTimers.wait(&_mutex, (unsigned long)std::max((quint64)1, (usecsToWait + USECS_PER_MSEC - 1) / USECS_PER_MSEC));
+        }
+        unlock();
+        return isStillRunning();
+    }
+
+    // take the sending lock before letting go of the wheel, so a sender can't be removed in between
+    _sendingMutex.lock();
+    unlock();
+
+    NodeList* nodeList = NodeList::getInstance();
+    nodeList->beginDatagramBatch();
+    for (int i = 0; i < _dueSenders.size(); i++) {
+        PacketSender* sender = _dueSenders[i];
+        quint64 nextDueAt = sender->sendDuePackets(now);
+        if (nextDueAt > 0) {
+            lock();
+            schedule(sender, nextDueAt);
+            unlock();
+        }
+    }
+    nodeList->flushDatagramBatch();
+
+    _sendingMutex.unlock();
+    _dueSenders.clear();
+
+    return isStillRunning();
+}
+
+void PacketPacer::terminating() {
+    _hasTimers.wakeAll();
+}
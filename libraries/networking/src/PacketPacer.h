@@ -0,0 +1,78 @@
+//
+//  PacketPacer.h
+//  libraries/networking/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#ifndef hifi_PacketPacer_h
+#define hifi_PacketPacer_h
+
+#include <QtCore/QMutex>
+#include <QtCore/QSet>
+#include <QtCore/QVector>
+#include <QtCore/QWaitCondition>
+
+#include "GenericThread.h"
+
+class PacketSender;
+
+const quint64 PACKET_PACER_TICK_USECS = 1000;
+const int PACKET_PACER_WHEEL_SLOTS = 1024; // about a second of ticks, senders due later go around more than once
+
+/// Sends for any number of threaded PacketSenders from one thread. Each sender is a token bucket that fills at its
+/// packets per second, and while it has packets queued it sits on a timer wheel in the slot of the tick its next packet
+/// is due in. The thread sleeps until the next slot with a sender in it, and then sends what each sender due has tokens
+/// for, together as one datagram batch.
+class PacketPacer : public GenericThread {
+    Q_OBJECT
+public:
+    /// the pacer is started the first time it is asked for, and runs for the rest of the process
+    static PacketPacer* getInstance();
+
+    void addSender(PacketSender* sender);
+
+    /// Once this returns the pacer is done with the sender, and won't call it again
+    void removeSender(PacketSender* sender);
+
+    /// Schedules the sender to send now, if it isn't waiting on the wheel already
+    /// \thread any thread, typically the thread queueing the packets
+    void senderHasPackets(PacketSender* sender);
+
+    virtual bool process();
+    virtual void terminating();
+
+    int getSenderCount();
+    int getScheduledCount();
+
+private:
+    PacketPacer();
+
+    class Timer {
+    public:
+        PacketSender* sender;
+        int rounds; // times the wheel goes around before this is due
+    };
+
+    // must be called with the lock held
+    void schedule(PacketSender* sender, quint64 dueAt);
+    void takeDue(quint64 now, QVector<PacketSender*>& due);
+    quint64 getNextTickWithTimers() const;
+
+    QVector<QVector<Timer> > _wheel;
+    int _currentSlot;
+    quint64 _currentSlotStart;
+    int _numScheduled;
+
+    QSet<PacketSender*> _senders;
+    QSet<PacketSender*> _scheduledSenders;
+    QVector<PacketSender*> _dueSenders;
+
+    QWaitCondition _hasTimers;
+    QMutex _sendingMutex; // held while sending, so removeSender() can wait for a send in progress
+};
+
+#endif // hifi_PacketPacer_h
@@ -0,0 +1,222 @@
+//
+//  PacketQueue.cpp
+//  libraries/networking/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#include <QtCore/QDebug>
+#include <QtCore/QStringList>
+
+#include "SharedUtil.h"
+
+#include "PacketQueue.h"
+
+const int INITIAL_SENDER_QUEUE_SIZE = 16;
+
+PacketQueue::SenderQueue::SenderQueue(const QUuid& uuid) :
+    uuid(uuid),
+    entries(INITIAL_SENDER_QUEUE_SIZE),
+    head(0),
+    count(0),
+    isRemoved(false)
+{
+
+}
+
+PacketQueue::PacketQueue(int capacity) :
+    _capacity(capacity),
+    _size(0),
+    _mutex(),
+    _senders(),
+    _readySenders(),
+    _droppedCount(0),
+    _maxDepth(0),
+    _depthHistogram(PACKET_QUEUE_HISTOGRAM_BUCKETS),
+    _waitUsecsHistogram(PACKET_QUEUE_HISTOGRAM_BUCKETS)
+{
+
+}
+
+PacketQueue::~PacketQueue() {
+    qDeleteAll(_senders);
+}
+
+bool PacketQueue::push(const SharedNodePointer& node, const QByteArray& packet) {
+    QUuid nodeUUID = node ? node->getUUID() : QUuid();
+
+    QMutexLocker locker(&_mutex);
+
+    // stamped under the lock, so no packet is stamped after a takeBatch() that already has the lock read its time
+    quint64 now = usecTimestampNow();
+
+    if (_size.load() >= _capacity) {
+        if (_droppedCount++ == 0) {
+            qDebug() << "Packet queue is full at" << _capacity << "packets, dropping packets";
+        }
+        return false;
+    }
+
+    SenderQueue* sender = _senders.value(nodeUUID);
+    if (!sender) {
+        sender = new SenderQueue(nodeUUID);
+        _senders.insert(nodeUUID, sender);
+    }
+    sender->isRemoved = false;
+
+    if (sender->count == sender->entries.size()) {
+        // unwrap the ring into one twice the size
+        QVector<Entry> grown(sender->entries.size() * 2);
+        for (int i = 0; i < sender->count; i++) {
+            grown[i] = sender->entries[(sender->head + i) & (sender->entries.size() - 1)];
+        }
+        sender->entries.swap(grown);
+        sender->head = 0;
+    }
+
+    Entry& entry = sender->entries[(sender->head + sender->count) & (sender->entries.size() - 1)];
+    entry.node = node;
+    entry.packet = packet; // shares the data, no copy
+    entry.queuedUsecs = now;
+
+    if (sender->count++ == 0) {
+        _readySenders.enqueue(sender);
+    }
+
+    int depth = _size.fetchAndAddOrdered(1) + 1;
+    _maxDepth = qMax(_maxDepth, depth);
+    return true;
+}
+
+int PacketQueue::takeBatch(QVector<NetworkPacket>& batch, int maxPackets) {
+    batch.clear();
+    if (maxPackets <= 0 || isEmpty()) {
+        return 0;
+    }
+
+    QMutexLocker locker(&_mutex);
+
+    quint64 now = usecTimestampNow();
+
+    _depthHistogram[histogramBucket(_size.load())]++;
+
+    while (batch.size() < maxPackets && !_readySenders.isEmpty()) {
+        SenderQueue* sender = _readySenders.dequeue();
+
+        Entry& entry = sender->entries[sender->head];
+        batch.append(NetworkPacket(entry.node, entry.packet));
+        // the clock usecTimestampNow() reads may still be adjusted backwards
+        quint64 waitUsecs = (now > entry.queuedUsecs) ? now - entry.queuedUsecs : 0;
+        _waitUsecsHistogram[histogramBucket(waitUsecs)]++;
+
+        // let go of the packet now, rather than when the slot is next used
+        entry.node.clear();
+        entry.packet.clear();
+        sender->head = (sender->head + 1) & (sender->entries.size() - 1);
+        sender->count--;
+
+        if (sender->count > 0) {
+            // back of the line for this sender's next packet
+            _readySenders.enqueue(sender);
+        } else if (sender->isRemoved) {
+            _senders.remove(sender->uuid);
+            delete sender;
+        }
+    }
+
+    _size.fetchAndAddOrdered(-batch.size());
+    return batch.size();
+}
+
+int PacketQueue::sizeFrom(const QUuid& nodeUUID) const {
+    QMutexLocker locker(&_mutex);
+    SenderQueue* sender = _senders.value(nodeUUID);
+    return sender ? sender->count : 0;
+}
+
+bool PacketQueue::isKnownSender(const QUuid& nodeUUID) const {
+    QMutexLocker locker(&_mutex);
+    SenderQueue* sender = _senders.value(nodeUUID);
+    return sender && !sender->isRemoved;
+}
+
+void PacketQueue::removeSender(const QUuid& nodeUUID) {
+    QMutexLocker locker(&_mutex);
+    SenderQueue* sender = _senders.value(nodeUUID);
+    if (sender) {
+        if (sender->count == 0) {
+            _senders.remove(nodeUUID);
+            delete sender;
+        } else {
+            // its packets still get their turns, the queue goes once they are taken
+            sender->isRemoved = true;
+        }
+    }
+}
+
+quint64 PacketQueue::getDroppedCount() const {
+    QMutexLocker locker(&_mutex);
+    return _droppedCount;
+}
+
+int PacketQueue::getMaxDepth() const {
+    QMutexLocker locker(&_mutex);
+    return _maxDepth;
+}
+
+QVector<quint64> PacketQueue::getDepthHistogram() const {
+    QMutexLocker locker(&_mutex);
+    return _depthHistogram;
+}
+
+QVector<quint64> PacketQueue::getWaitUsecsHistogram() const {
+    QMutexLocker locker(&_mutex);
+    return _waitUsecsHistogram;
+}
+
+void PacketQueue::resetStats() {
+    QMutexLocker locker(&_mutex);
+    _droppedCount = 0;
+    _maxDepth = 0;
+    _depthHistogram.fill(0);
+    _waitUsecsHistogram.fill(0);
+}
+
+int PacketQueue::histogramBucket(quint64 value) {
+    int bucket = 0;
+    while (value > 0 && bucket < PACKET_QUEUE_HISTOGRAM_BUCKETS - 1) {
+        value >>= 1;
+        bucket++;
+    }
+    return bucket;
+}
+
+quint64 PacketQueue::histogramPercentile(const QVector<quint64>& histogram, float fraction) {
+    quint64 total = 0;
+    foreach (quint64 bucketCount, histogram) {
+        total += bucketCount;
+    }
+
+    quint64 threshold = (quint64)(total * fraction);
+    quint64 counted = 0;
+    for (int i = 0; i < histogram.size(); i++) {
+        counted += histogram[i];
+        if (counted > threshold || (counted == total && counted > 0)) {
+            return i == 0 ? 0 : (1ULL << i);
+        }
+    }
+    return 0;
+}
+
+QString PacketQueue::histogramToString(const QVector<quint64>& histogram) {
+    QStringList buckets;
+    for (int i = 0; i < histogram.size(); i++) {
+        if (histogram[i] > 0) {
+            buckets << (i == 0 ? QString("0: %1").arg(histogram[i]) : QString("<%1: %2").arg(1ULL << i).arg(histogram[i]));
+        }
+    }
+    return buckets.isEmpty() ? QString("none") : buckets.join(", ");
+}
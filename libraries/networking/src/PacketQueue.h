@@ -0,0 +1,106 @@
+//
+//  PacketQueue.h
+//  libraries/networking/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#ifndef hifi_PacketQueue_h
+#define hifi_PacketQueue_h
+
+#include <QtCore/QAtomicInt>
+#include <QtCore/QHash>
+#include <QtCore/QMutex>
+#include <QtCore/QQueue>
+#include <QtCore/QString>
+#include <QtCore/QUuid>
+#include <QtCore/QVector>
+
+#include "NetworkPacket.h"
+
+const int DEFAULT_PACKET_QUEUE_CAPACITY = 8192;
+
+/// bucket 0 counts zeros, and bucket i counts values from 2^(i-1) up to 2^i, with the last bucket taking everything larger
+const int PACKET_QUEUE_HISTOGRAM_BUCKETS = 24;
+
+/// A bounded queue of packets that any number of threads add to and one thread takes from. Every node gets its own ring
+/// of packets, and packets are taken in batches, one from each node in turn, so a node sending a burst can't starve the
+/// others. Adding a packet, and taking one, is constant time, and the packet data itself is never copied.
+class PacketQueue {
+public:
+    PacketQueue(int capacity = DEFAULT_PACKET_QUEUE_CAPACITY);
+    ~PacketQueue();
+
+    /// \return false if the queue was full and the packet was dropped
+    bool push(const SharedNodePointer& node, const QByteArray& packet);
+
+    /// Replaces the contents of batch with up to maxPackets packets
+    /// \return the number of packets taken
+    int takeBatch(QVector<NetworkPacket>& batch, int maxPackets);
+
+    int size() const { return _size.load(); }
+    bool isEmpty() const { return _size.load() == 0; }
+    int sizeFrom(const QUuid& nodeUUID) const;
+
+    /// a node is known from its first packet until it is removed
+    bool isKnownSender(const QUuid& nodeUUID) const;
+
+    /// Forgets the node once the packets it still has queued have been taken
+    void removeSender(const QUuid& nodeUUID);
+
+    int getCapacity() const { return _capacity; }
+    quint64 getDroppedCount() const;
+    int getMaxDepth() const;
+
+    /// the number of packets queued each time a batch was taken
+    QVector<quint64> getDepthHistogram() const;
+    /// how long each packet waited in the queue, in usecs
+    QVector<quint64> getWaitUsecsHistogram() const;
+    void resetStats();
+
+    /// the upper limit of the bucket that holds the given fraction of the samples, e.g. 0.99f for the 99th percentile
+    static quint64 histogramPercentile(const QVector<quint64>& histogram, float fraction);
+    /// the non-empty buckets, formatted as "<limit: count" pairs
+    static QString histogramToString(const QVector<quint64>& histogram);
+
+private:
+    PacketQueue(const PacketQueue&);
+    PacketQueue& operator=(const PacketQueue&);
+
+    class Entry {
+    public:
+        SharedNodePointer node;
+        QByteArray packet;
+        quint64 queuedUsecs;
+    };
+
+    class SenderQueue {
+    public:
+        SenderQueue(const QUuid& uuid);
+
+        QUuid uuid;
+        QVector<Entry> entries; // a ring, always a power of two in size
+        int head;
+        int count;
+        bool isRemoved;
+    };
+
+    static int histogramBucket(quint64 value);
+
+    int _capacity;
+    QAtomicInt _size;
+
+    mutable QMutex _mutex;
+    QHash<QUuid, SenderQueue*> _senders;
+    QQueue<SenderQueue*> _readySenders; // the senders with packets queued, in the order they get their next turn
+
+    quint64 _droppedCount;
+    int _maxDepth;
+    QVector<quint64> _depthHistogram;
+    QVector<quint64> _waitUsecsHistogram;
+};
+
+#endif // hifi_PacketQueue_h
@@ -0,0 +1,203 @@
+//
+//  PacketReceiver.cpp
+//  libraries/networking/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#include <cstring>
+
+#include <QtCore/QDebug>
+#include <QtCore/QMetaObject>
+
+#ifdef Q_OS_LINUX
+#include <errno.h>
+#include <poll.h>
+#endif
+
+#include "LimitedNodeList.h"
+#include "ReceivedPacketProcessor.h"
+#include "SharedUtil.h"
+
+#include "PacketReceiver.h"
+
+// how long the thread waits on a quiet socket before it checks whether it should stop
+const int PACKET_RECEIVER_WAIT_MSECS = 100;
+
+ReceivedPacketRing::ReceivedPacketRing(int capacity) :
+    _entries(),
+    _slots(NULL),
+    _mask(0),
+    _head(0),
+    _tail(0),
+    _droppedCount(0),
+    _notifyTarget(NULL),
+    _notifyMethod(NULL),
+    _isNotifyPending(0)
+{
+    int roundedCapacity = 1;
+    while (roundedCapacity < capacity) {
+        roundedCapacity <<= 1;
+    }
+    _entries.resize(roundedCapacity);
+    _slots = _entries.data();
+    _mask = roundedCapacity - 1;
+}
+
+void ReceivedPacketRing::setNotifyTarget(QObject* target, const char* method) {
+    _notifyTarget = target;
+    _notifyMethod = method;
+}
+
+bool ReceivedPacketRing::push(const QByteArray& packet, const HifiSockAddr& senderSockAddr, quint64 receivedUsecs) {
+    quint32 tail = _tail.load();
+    if (tail - (quint32)_head.loadAcquire() > _mask) {
+        _droppedCount.fetchAndAddRelaxed(1);
+        return false;
+    }
+
+    ReceivedPacket& slot = _slots[tail & _mask];
+    slot.packet = packet;
+    slot.senderSockAddr = senderSockAddr;
+    slot.receivedUsecs = receivedUsecs;
+    _tail.storeRelease(tail + 1);
+
+    // one notification until the consumer has drained the queue, however many packets arrive in the meantime
+    if (_notifyTarget && _isNotifyPending.testAndSetOrdered(0, 1)) {
+        QMetaObject::invokeMethod(_notifyTarget, _notifyMethod, Qt::QueuedConnection);
+    }
+    return true;
+}
+
+bool ReceivedPacketRing::pop(ReceivedPacket& packet) {
+    quint32 head = _head.load();
+    if (head == (quint32)_tail.loadAcquire()) {
+        if (!_notifyTarget) {
+            return false;
+        }
+
+        // a packet pushed after the pending flag is cleared gets a notification of its own, and one pushed before
+        // it is cleared is found by looking again
+        _isNotifyPending.fetchAndStoreOrdered(0);
+        if (head == (quint32)_tail.loadAcquire()) {
+            return false;
+        }
+    }
+
+    ReceivedPacket& slot = _slots[head & _mask];
+    packet = slot;
+    slot.packet = QByteArray(); // the slot doesn't keep the data alive until it is reused
+    _head.storeRelease(head + 1);
+    return true;
+}
+
+int ReceivedPacketRing::size() const {
+    return (quint32)_tail.loadAcquire() - (quint32)_head.loadAcquire();
+}
+
+bool PacketReceiver::isSupported() {
+#ifdef Q_OS_LINUX
+    return true;
+#else
+    return false;
+#endif
+}
+
+PacketReceiver::PacketReceiver(QUdpSocket& socket) :
+    _socketDescriptor(socket.socketDescriptor()),
+    _datagrams(),
+    _routes(),
+    _defaultQueue(),
+    _numReceived(0),
+    _numRejected(0)
+{
+}
+
+PacketReceiver::Route& PacketReceiver::routeForType(PacketType packetType) {
+    if (packetType >= _routes.size()) {
+        _routes.resize(packetType + 1);
+    }
+    return _routes[packetType];
+}
+
+void PacketReceiver::routeToQueue(const QSet<PacketType>& packetTypes, ReceivedPacketRing* queue) {
+    foreach (PacketType packetType, packetTypes) {
+        Route& route = routeForType(packetType);
+        route.queue = queue;
+        route.processor = NULL;
+    }
+}
+
+void PacketReceiver::routeToProcessor(const QSet<PacketType>& packetTypes, ReceivedPacketProcessor* processor) {
+    foreach (PacketType packetType, packetTypes) {
+        Route& route = routeForType(packetType);
+        route.queue = NULL;
+        route.processor = processor;
+    }
+}
+
+bool PacketReceiver::waitForDatagrams() {
+#ifdef Q_OS_LINUX
+    pollfd socketPoll;
+    socketPoll.fd = _socketDescriptor;
+    socketPoll.events = POLLIN;
+    socketPoll.revents = 0;
+
+    int numReady = poll(&socketPoll, 1, PACKET_RECEIVER_WAIT_MSECS);
+    if (numReady < 0 && errno != EINTR) {
+        qDebug() << "ERROR in poll:" << strerror(errno);
+    }
+    return numReady > 0;
+#else
+    return false;
+#endif
+}
+
+void PacketReceiver::dispatch(const QByteArray& packet, const HifiSockAddr& senderSockAddr, quint64 receivedUsecs) {
+    PacketType packetType = packetTypeForPacket(packet);
+    if (packetType < _routes.size()) {
+        const Route& route = _routes.at(packetType);
+        if (route.queue) {
+            route.queue->push(packet, senderSockAddr, receivedUsecs);
+            return;
+        }
+        if (route.processor) {
+            // the hash matched, so the node is there
+            SharedNodePointer sendingNode = LimitedNodeList::getInstance()->sendingNodeForPacket(packet);
+            if (sendingNode) {
+                route.processor->queueReceivedPacket(sendingNode, packet);
+            }
+            return;
+        }
+    }
+    _defaultQueue.push(packet, senderSockAddr, receivedUsecs);
+}
+
+bool PacketReceiver::process() {
+    if (!waitForDatagrams()) {
+        return isStillRunning();
+    }
+
+    LimitedNodeList* nodeList = LimitedNodeList::getInstance();
+    QByteArray datagram;
+    HifiSockAddr senderSockAddr;
+
+    while (_datagrams.readNextFromDescriptor(_socketDescriptor, datagram, senderSockAddr)) {
+        quint64 receivedUsecs = usecTimestampNow();
+        _numReceived.fetchAndAddRelaxed(1);
+
+        if (nodeList->packetVersionAndHashMatch(datagram)) {
+            dispatch(datagram, senderSockAddr, receivedUsecs);
+        } else {
+            _numRejected.fetchAndAddRelaxed(1);
+        }
+
+        // the queues share the datagram's data, the next one gets its own
+        datagram = QByteArray();
+    }
+
+    return isStillRunning();
+}
@@ -0,0 +1,128 @@
+//
+//  PacketReceiver.h
+//  libraries/networking/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#ifndef hifi_PacketReceiver_h
+#define hifi_PacketReceiver_h
+
+#include <QtCore/QAtomicInt>
+#include <QtCore/QByteArray>
+#include <QtCore/QSet>
+#include <QtCore/QVector>
+#include <QtNetwork/QUdpSocket>
+
+#include "DatagramBatch.h"
+#include "GenericThread.h"
+#include "HifiSockAddr.h"
+#include "PacketHeaders.h"
+
+class ReceivedPacketProcessor;
+
+const int DEFAULT_RECEIVED_PACKET_RING_CAPACITY = 4096;
+
+/// A datagram that passed the version and hash checks, with the time it came off the socket
+class ReceivedPacket {
+public:
+    ReceivedPacket() : packet(), senderSockAddr(), receivedUsecs(0) { }
+
+    QByteArray packet;
+    HifiSockAddr senderSockAddr;
+    quint64 receivedUsecs;
+};
+
+/// A bounded queue that the receive thread adds packets to, and one other thread takes them from, without either of
+/// them locking. When the queue is full new packets are dropped, like the socket would drop them.
+class ReceivedPacketRing {
+public:
+    /// \param capacity rounded up to a power of two
+    ReceivedPacketRing(int capacity = DEFAULT_RECEIVED_PACKET_RING_CAPACITY);
+
+    /// Has the method invoked on the target's thread whenever packets arrive in a queue that was drained, for a
+    /// consumer that waits on its event loop rather than taking packets every frame. Set before the receiver starts.
+    void setNotifyTarget(QObject* target, const char* method);
+
+    /// \return false if the queue was full and the packet was dropped
+    /// \thread receive thread
+    bool push(const QByteArray& packet, const HifiSockAddr& senderSockAddr, quint64 receivedUsecs);
+
+    /// \return false once the queue is empty
+    /// \thread the consumer's thread
+    bool pop(ReceivedPacket& packet);
+
+    int size() const;
+    int getCapacity() const { return _entries.size(); }
+    quint64 getDroppedCount() const { return (quint32)_droppedCount.load(); }
+
+private:
+    ReceivedPacketRing(const ReceivedPacketRing&);
+    ReceivedPacketRing& operator=(const ReceivedPacketRing&);
+
+    QVector<ReceivedPacket> _entries;
+    ReceivedPacket* _slots; // the entries' data, which never moves
+    quint32 _mask;
+    QAtomicInt _head; // the count of packets taken, only the consumer moves it
+    QAtomicInt _tail; // the count of packets added, only the receive thread moves it
+    QAtomicInt _droppedCount;
+
+    QObject* _notifyTarget;
+    const char* _notifyMethod;
+    QAtomicInt _isNotifyPending;
+};
+
+/// Reads the node socket on a thread of its own, so packets are taken off the socket as they arrive rather than when
+/// the thread doing the real work gets around to it. Each datagram gets its receive time, is checked for its version
+/// and hash, and then goes where its type is routed: to a ReceivedPacketRing its consumer drains, straight into a
+/// ReceivedPacketProcessor, or to the default queue for everything else. The routes are set up before the thread starts,
+/// and are only read after that, so routing a packet takes no locks.
+///
+/// The socket is read through its descriptor, which only Linux supports. Elsewhere isSupported() is false and the socket
+/// is read on its own thread as before.
+class PacketReceiver : public GenericThread {
+    Q_OBJECT
+public:
+    static bool isSupported();
+
+    PacketReceiver(QUdpSocket& socket);
+
+    void routeToQueue(const QSet<PacketType>& packetTypes, ReceivedPacketRing* queue);
+    /// the processor's queue takes packets from any thread, so these never wait on another thread at all
+    void routeToProcessor(const QSet<PacketType>& packetTypes, ReceivedPacketProcessor* processor);
+
+    /// where the packets of every type that isn't routed go
+    ReceivedPacketRing& getDefaultQueue() { return _defaultQueue; }
+
+    quint64 getNumReceived() const { return (quint32)_numReceived.load(); }
+    quint64 getNumRejected() const { return (quint32)_numRejected.load(); }
+
+protected:
+    virtual bool process();
+
+private:
+    class Route {
+    public:
+        Route() : queue(NULL), processor(NULL) { }
+
+        ReceivedPacketRing* queue;
+        ReceivedPacketProcessor* processor;
+    };
+
+    Route& routeForType(PacketType packetType);
+    bool waitForDatagrams();
+    void dispatch(const QByteArray& packet, const HifiSockAddr& senderSockAddr, quint64 receivedUsecs);
+
+    qintptr _socketDescriptor;
+    DatagramReceiveBatch _datagrams;
+    QVector<Route> _routes; // by packet type, types past the end have no route
+    ReceivedPacketRing _defaultQueue;
+
+    QAtomicInt _numReceived;
+    QAtomicInt _numRejected;
+};
+
+#endif // hifi_PacketReceiver_h
@@ -14,30 +14,33 @@
 #ifndef hifi_PacketSender_h
 #define hifi_PacketSender_h
 
-#include <QWaitCondition>
-
 #include "GenericThread.h"
 #include "NetworkPacket.h"
 #include "NodeList.h"
+#include "PacketQueue.h"
 #include "SharedUtil.h"
 
-/// Generalized threaded processor for queueing and sending of outbound packets.
+/// Generalized processor for queueing and sending of outbound packets at a target rate. The rate is kept with a token
+/// bucket. In threaded mode the sender has no thread of its own, it is paced along with the other threaded senders by
+/// the PacketPacer thread. In non-threaded mode the caller must call process() regularly, and each call sends what the
+/// bucket holds, which is enough to keep up the rate however often process() is called.
 class PacketSender : public GenericThread {
     Q_OBJECT
 public:
 
     static const quint64 USECS_PER_SECOND;
-    static const quint64 SENDING_INTERVAL_ADJUST;
     static const int TARGET_FPS;
-    static const int MAX_SLEEP_INTERVAL;
 
     static const int DEFAULT_PACKETS_PER_SECOND;
     static const int MINIMUM_PACKETS_PER_SECOND;
-    static const int MINIMAL_SLEEP_INTERVAL;
+    static const int MAX_QUEUED_PACKETS;
 
     PacketSender(int packetsPerSecond = DEFAULT_PACKETS_PER_SECOND);
     ~PacketSender();
 
+    /// In threaded mode the sender registers with the PacketPacer rather than starting a thread
+    virtual void initialize(bool isThreaded = true);
+
     /// Add packet to outbound queue.
     /// \param HifiSockAddr& address the destination address
     /// \param packetData pointer to data
@@ -51,14 +54,18 @@ public:
     virtual bool process();
     virtual void terminating();
 
+    /// Sends the packets the token bucket holds, called on the PacketPacer thread in threaded mode
+    /// \return the time the next packet is due, or 0 if there is nothing left to send
+    quint64 sendDuePackets(quint64 now);
+
     /// are there packets waiting in the send queue to be sent
-    bool hasPacketsToSend() const { return _packets.size() > 0; }
+    bool hasPacketsToSend() const { return !_packets.isEmpty(); }
 
     /// how many packets are there in the send queue waiting to be sent
     int packetsToSendCount() const { return _packets.size(); }
 
-    /// If you're running in non-threaded mode, call this to give us a hint as to how frequently you will call process.
-    /// This has no effect in threaded mode. This is only considered a hint in non-threaded mode.
+    /// If you're running in non-threaded mode, call this to give us a hint as to how frequently you will call process, so
+    /// the token bucket can hold enough for the time between calls. This has no effect in threaded mode.
     /// \param int usecsPerProcessCall expected number of usecs between calls to process in non-threaded mode.
     void setProcessCallIntervalHint(int usecsPerProcessCall) { _usecsPerProcessCallHint = usecsPerProcessCall; }
 
@@ -98,20 +105,34 @@ public:
 signals:
     void packetSent(quint64);
 protected:
+    /// Lets a subclass queue the packets it has been holding back, before each send
+    virtual void prepareToSend() { }
+
+    /// \return true if the subclass is holding back packets that a later prepareToSend() may queue
+    virtual bool hasPacketsToPrepare() { return false; }
+
+    /// Call after holding back a packet, so that in threaded mode the pacer comes back to prepare it
+    void packetsToPrepareHeld();
+
     int _packetsPerSecond;
     int _usecsPerProcessCallHint;
     quint64 _lastProcessCallTime;
     SimpleMovingAverage _averageProcessCallTime;
 
 private:
-    std::vector<NetworkPacket> _packets;
-    quint64 _lastSendTime;
-
-    bool threadedProcess();
     bool nonThreadedProcess();
 
-    quint64 _lastPPSCheck;
-    int _packetsOverCheckInterval;
+    /// adds the tokens for the time since the last refill, keeping at most enough for burstUsecs
+    void refillTokens(quint64 now, float burstUsecs);
+
+    /// sends as many packets as there are whole tokens
+    void sendPacketsForTokens(quint64 now);
+
+    PacketQueue _packets; // taken one destination at a time, so a burst to one node doesn't hold up the others
+    QVector<NetworkPacket> _sendBatch;
+
+    float _tokens; // the packets we may send now, one more fills in every 1/_packetsPerSecond seconds
+    quint64 _lastTokenRefill; // 0 until the first send
 
     quint64 _started;
     quint64 _totalPacketsSent;
@@ -119,9 +140,6 @@ private:
 
     quint64 _totalPacketsQueued;
     quint64 _totalBytesQueued;
-
-    QWaitCondition _hasPackets;
-    QMutex _waitingOnPacketsMutex;
 };
 
 #endif // hifi_PacketSender_h
@@ -13,6 +13,8 @@
 #include "ReceivedPacketProcessor.h"
 #include "SharedUtil.h"
 
+const int MAX_PACKETS_PER_PROCESS_BATCH = 64;
+
 void ReceivedPacketProcessor::terminating() {
     _hasPackets.wakeAll();
 }
@@ -21,11 +23,9 @@ void ReceivedPacketProcessor::queueReceivedPacket(const SharedNodePointer& sendi
     // Make sure our Node and NodeList knows we've heard from this node.
     sendingNode->setLastHeardMicrostamp(usecTimestampNow());
 
-    NetworkPacket networkPacket(sendingNode, packet);
-    lock();
-    _packets.push_back(networkPacket);
-    _nodePacketCounts[sendingNode->getUUID()]++;
-    unlock();
+    if (!_packets.push(sendingNode, packet)) {
+        return;
+    }
     
     // Make sure to  wake our actual processing thread because we  now have packets for it to process.
     _hasPackets.wakeAll();
@@ -33,28 +33,24 @@ void ReceivedPacketProcessor::queueReceivedPacket(const SharedNodePointer& sendi
 
 bool ReceivedPacketProcessor::process() {
 
-    if (_packets.size() == 0) {
+    if (_packets.isEmpty()) {
         _waitingOnPacketsMutex.lock();
         _hasPackets.wait(&_waitingOnPacketsMutex, getMaxWait());
         _waitingOnPacketsMutex.unlock();
     }
     preProcess();
-    while (_packets.size() > 0) {
-        lock(); // lock to make sure nothing changes on us
-        NetworkPacket& packet = _packets.front(); // get the oldest packet
-        NetworkPacket temporary = packet; // make a copy of the packet in case the vector is resized on us
-        _packets.erase(_packets.begin()); // remove the oldest packet
-        _nodePacketCounts[temporary.getNode()->getUUID()]--;
-        unlock(); // let others add to the packets
-        processPacket(temporary.getNode(), temporary.getByteArray()); // process our temporary copy
-        midProcess();
+    // take the packets a batch at a time, one from each sender in turn, so a burst from one sender doesn't hold up the rest
+    while (_packets.takeBatch(_processBatch, MAX_PACKETS_PER_PROCESS_BATCH) > 0) {
+        for (int i = 0; i < _processBatch.size(); i++) {
+            processPacket(_processBatch[i].getNode(), _processBatch[i].getByteArray());
+            midProcess();
+        }
     }
+    _processBatch.clear(); // don't hold on to the last batch's nodes while we wait
     postProcess();
     return isStillRunning();  // keep running till they terminate us
 }
 
 void ReceivedPacketProcessor::nodeKilled(SharedNodePointer node) {
-    lock();
-    _nodePacketCounts.remove(node->getUUID());
-    unlock();
+    _packets.removeSender(node->getUUID());
 }
@@ -16,6 +16,7 @@
 
 #include "GenericThread.h"
 #include "NetworkPacket.h"
+#include "PacketQueue.h"
 
 /// Generalized threaded processor for handling received inbound packets. 
 class ReceivedPacketProcessor : public GenericThread {
@@ -31,11 +32,11 @@ public:
     void queueReceivedPacket(const SharedNodePointer& sendingNode, const QByteArray& packet);
 
     /// Are there received packets waiting to be processed
-    bool hasPacketsToProcess() const { return _packets.size() > 0; }
+    bool hasPacketsToProcess() const { return !_packets.isEmpty(); }
 
     /// Is a specified node still alive?
     bool isAlive(const QUuid& nodeUUID) const {
-        return _nodePacketCounts.contains(nodeUUID);
+        return _packets.isKnownSender(nodeUUID);
     }
 
     /// Are there received packets waiting to be processed from a specified node
@@ -45,12 +46,15 @@ public:
 
     /// Are there received packets waiting to be processed from a specified node
     bool hasPacketsToProcessFrom(const QUuid& nodeUUID) const {
-        return _nodePacketCounts[nodeUUID] > 0;
+        return _packets.sizeFrom(nodeUUID) > 0;
     }
 
     /// How many received packets waiting are to be processed
     int packetsToProcessCount() const { return _packets.size(); }
 
+    /// The queue of received packets, for its depth and wait time stats
+    PacketQueue& getPacketQueue() { return _packets; }
+
 public slots:
     void nodeKilled(SharedNodePointer node);
 
@@ -79,8 +83,8 @@ protected:
 
 protected:
 
-    QVector<NetworkPacket> _packets;
-    QHash<QUuid, int> _nodePacketCounts;
+    PacketQueue _packets;
+    QVector<NetworkPacket> _processBatch; // the packets taken from the queue to process next, reused between batches
 
     QWaitCondition _hasPackets;
     QMutex _waitingOnPacketsMutex;
@@ -0,0 +1,165 @@
+//
+//  SendRateController.cpp
+//  libraries/networking/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#include <algorithm>
+
+#include <QtCore/QMutexLocker>
+
+#include "SendRateController.h"
+
+const float DEFAULT_MAX_SEND_RATE_PACKETS_PER_SECOND = 100000.0f;
+
+const float SLOW_START_INCREASE = 2.0f;
+const float INCREASE = 1.1f;
+const float BACKOFF = 0.8f;
+
+// we only grow the rate if the sender actually sent at least this share of it, otherwise the rate was never tested
+const float MIN_USED_SHARE_FOR_INCREASE = 0.5f;
+
+const quint64 MIN_FLIGHT_TIME_WINDOW_USECS = 10 * USECS_PER_SECOND;
+
+SendRateController::SendRateController() :
+    _mutex(),
+    _packetsPerSecond(MIN_SEND_RATE_PACKETS_PER_SECOND),
+    _maxPacketsPerSecond(DEFAULT_MAX_SEND_RATE_PACKETS_PER_SECOND),
+    _inSlowStart(true),
+    _lastFeedbackAt(0),
+    _lastTotalReceived(0),
+    _lastTotalLost(0),
+    _packetsSentSinceFeedback(0),
+    _minFlightTimeWindowStart(0),
+    _minFlightTimeThisWindow(0.0f),
+    _minFlightTimeLastWindow(0.0f),
+    _receivedPacketsPerSecond(0.0f),
+    _lossRate(0.0f),
+    _queuingDelayUsecs(0),
+    _backoffCount(0)
+{
+}
+
+void SendRateController::setInitialPacketsPerSecond(float packetsPerSecond, quint64 now) {
+    QMutexLocker locker(&_mutex);
+    if (!hasFeedbackAt(now)) {
+        _packetsPerSecond = std::max(MIN_SEND_RATE_PACKETS_PER_SECOND, std::min(packetsPerSecond, _maxPacketsPerSecond));
+    }
+}
+
+void SendRateController::setMaxPacketsPerSecond(float packetsPerSecond) {
+    QMutexLocker locker(&_mutex);
+    _maxPacketsPerSecond = std::max(packetsPerSecond, MIN_SEND_RATE_PACKETS_PER_SECOND);
+    _packetsPerSecond = std::min(_packetsPerSecond, _maxPacketsPerSecond);
+}
+
+void SendRateController::packetsSent(int numPackets) {
+    QMutexLocker locker(&_mutex);
+    _packetsSentSinceFeedback += numPackets;
+}
+
+void SendRateController::feedbackReceived(quint32 totalReceived, quint32 totalLost, float flightTimeUsecs, quint64 now) {
+    QMutexLocker locker(&_mutex);
+
+    // the first report, or the first after the receiver went quiet or reset its counts, only sets the starting point
+    bool isStartingOver = !hasFeedbackAt(now) || now <= _lastFeedbackAt || totalReceived < _lastTotalReceived;
+
+    quint64 elapsedUsecs = now - _lastFeedbackAt;
+    int packetsReceived = totalReceived - _lastTotalReceived;
+    // lost packets the receiver later gets are taken off its count, which we don't count against this report
+    int packetsLost = std::max(0, (int)(totalLost - _lastTotalLost));
+    int packetsSent = _packetsSentSinceFeedback;
+
+    _lastFeedbackAt = now;
+    _lastTotalReceived = totalReceived;
+    _lastTotalLost = totalLost;
+    _packetsSentSinceFeedback = 0;
+
+    if (isStartingOver) {
+        _inSlowStart = true;
+        _minFlightTimeWindowStart = now;
+        _minFlightTimeThisWindow = flightTimeUsecs;
+        _minFlightTimeLastWindow = flightTimeUsecs;
+        _receivedPacketsPerSecond = 0.0f;
+        _lossRate = 0.0f;
+        _queuingDelayUsecs = 0;
+        return;
+    }
+
+    float elapsedSeconds = (float)elapsedUsecs / (float)USECS_PER_SECOND;
+    _receivedPacketsPerSecond = packetsReceived / elapsedSeconds;
+    _lossRate = (packetsReceived + packetsLost > 0) ? (float)packetsLost / (packetsReceived + packetsLost) : 0.0f;
+
+    // the flight time includes the clock skew between us and the receiver, so only its rise over the lowest one seen
+    // recently means anything
+    if (now - _minFlightTimeWindowStart > MIN_FLIGHT_TIME_WINDOW_USECS) {
+        _minFlightTimeLastWindow = _minFlightTimeThisWindow;
+        _minFlightTimeThisWindow = flightTimeUsecs;
+        _minFlightTimeWindowStart = now;
+    } else {
+        _minFlightTimeThisWindow = std::min(_minFlightTimeThisWindow, flightTimeUsecs);
+    }
+    float minFlightTime = std::min(_minFlightTimeThisWindow, _minFlightTimeLastWindow);
+    _queuingDelayUsecs = (flightTimeUsecs > minFlightTime) ? (quint64)(flightTimeUsecs - minFlightTime) : 0;
+
+    bool usedItsRate = packetsSent >= MIN_USED_SHARE_FOR_INCREASE * _packetsPerSecond * elapsedSeconds;
+
+    if (_lossRate > SEND_RATE_MAX_LOSS_RATE || _queuingDelayUsecs > SEND_RATE_TARGET_QUEUING_DELAY_USECS) {
+        // back off from what actually got through, if we were sending more than that
+        float fromPacketsPerSecond = _packetsPerSecond;
+        if (usedItsRate && _receivedPacketsPerSecond > 0.0f) {
+            fromPacketsPerSecond = std::min(fromPacketsPerSecond, _receivedPacketsPerSecond);
+        }
+        _packetsPerSecond = fromPacketsPerSecond * BACKOFF;
+        _inSlowStart = false;
+        _backoffCount++;
+
+    } else if (_queuingDelayUsecs < SEND_RATE_TARGET_QUEUING_DELAY_USECS / 2 && usedItsRate) {
+        _packetsPerSecond *= _inSlowStart ? SLOW_START_INCREASE : INCREASE;
+    }
+
+    _packetsPerSecond = std::max(MIN_SEND_RATE_PACKETS_PER_SECOND, std::min(_packetsPerSecond, _maxPacketsPerSecond));
+}
+
+bool SendRateController::hasFeedback(quint64 now) const {
+    QMutexLocker locker(&_mutex);
+    return hasFeedbackAt(now);
+}
+
+bool SendRateController::hasFeedbackAt(quint64 now) const {
+    return _lastFeedbackAt != 0 && (now < _lastFeedbackAt || now - _lastFeedbackAt <= SEND_RATE_FEEDBACK_TIMEOUT_USECS);
+}
+
+float SendRateController::getPacketsPerSecond() const {
+    QMutexLocker locker(&_mutex);
+    return _packetsPerSecond;
+}
+
+bool SendRateController::isInSlowStart() const {
+    QMutexLocker locker(&_mutex);
+    return _inSlowStart;
+}
+
+float SendRateController::getReceivedPacketsPerSecond() const {
+    QMutexLocker locker(&_mutex);
+    return _receivedPacketsPerSecond;
+}
+
+float SendRateController::getLossRate() const {
+    QMutexLocker locker(&_mutex);
+    return _lossRate;
+}
+
+quint64 SendRateController::getQueuingDelayUsecs() const {
+    QMutexLocker locker(&_mutex);
+    return _queuingDelayUsecs;
+}
+
+quint32 SendRateController::getBackoffCount() const {
+    QMutexLocker locker(&_mutex);
+    return _backoffCount;
+}
@@ -0,0 +1,91 @@
+//
+//  SendRateController.h
+//  libraries/networking/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#ifndef hifi_SendRateController_h
+#define hifi_SendRateController_h
+
+#include <QtCore/QMutex>
+
+#include "SharedUtil.h"
+
+const float MIN_SEND_RATE_PACKETS_PER_SECOND = 10.0f;
+
+// how much the receiver's packets may be delayed by queueing before we back off
+const quint64 SEND_RATE_TARGET_QUEUING_DELAY_USECS = 25 * USECS_PER_MSEC;
+
+// the share of the packets sent that may be lost before we back off
+const float SEND_RATE_MAX_LOSS_RATE = 0.02f;
+
+// without feedback for this long, the receiver is treated as not sending any
+const quint64 SEND_RATE_FEEDBACK_TIMEOUT_USECS = 5 * USECS_PER_SECOND;
+
+/// Estimates how many packets per second can be sent to one receiver, from the loss and the flight time it reports back.
+/// The rate starts out doubling on every report, and after the first back off grows by a tenth at a time, as long as the
+/// packets arrive without loss and without their flight time rising above the lowest seen recently. When packets are
+/// lost or start to queue up on the way, the rate is cut back. The controller is thread safe, feedback is usually
+/// reported on the thread receiving packets while the rate is used on the thread sending them.
+class SendRateController {
+public:
+    SendRateController();
+
+    /// The rate to send at until the receiver reports feedback, or after it stops
+    void setInitialPacketsPerSecond(float packetsPerSecond, quint64 now = usecTimestampNow());
+
+    /// The rate will not grow past this
+    void setMaxPacketsPerSecond(float packetsPerSecond);
+
+    void packetsSent(int numPackets);
+
+    /// Takes a report from the receiver
+    /// \param totalReceived the number of packets the receiver has received since it started counting
+    /// \param totalLost the number of packets the receiver is missing since it started counting
+    /// \param flightTimeUsecs the receiver's average flight time for recent packets, which includes the skew between our
+    /// clocks and so may well be negative
+    void feedbackReceived(quint32 totalReceived, quint32 totalLost, float flightTimeUsecs,
+                          quint64 now = usecTimestampNow());
+
+    /// \return true if the receiver reported feedback recently enough for the estimate to be used
+    bool hasFeedback(quint64 now = usecTimestampNow()) const;
+
+    float getPacketsPerSecond() const;
+
+    bool isInSlowStart() const;
+    float getReceivedPacketsPerSecond() const;
+    float getLossRate() const;
+    quint64 getQueuingDelayUsecs() const;
+    quint32 getBackoffCount() const;
+
+private:
+    // must be called with the mutex held
+    bool hasFeedbackAt(quint64 now) const;
+
+    mutable QMutex _mutex;
+
+    float _packetsPerSecond;
+    float _maxPacketsPerSecond;
+    bool _inSlowStart;
+
+    quint64 _lastFeedbackAt; // 0 until the first report
+    quint32 _lastTotalReceived;
+    quint32 _lastTotalLost;
+    int _packetsSentSinceFeedback;
+
+    // the lowest flight time of this window and the last one, anything above is time spent queued on the way
+    quint64 _minFlightTimeWindowStart;
+    float _minFlightTimeThisWindow;
+    float _minFlightTimeLastWindow;
+
+    float _receivedPacketsPerSecond;
+    float _lossRate;
+    quint64 _queuingDelayUsecs;
+    quint32 _backoffCount;
+};
+
+#endif // hifi_SendRateController_h
@@ -9,24 +9,76 @@
 //  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
 //
 
+#include <algorithm>
+#include <limits>
+
 #include <QtCore/QCoreApplication>
 #include <QtCore/QJsonObject>
+#include <QtCore/QMutexLocker>
 #include <QtCore/QTimer>
 
+#include "DatagramBatch.h"
 #include "Logging.h"
+#include "PacketReceiver.h"
 #include "ThreadedAssignment.h"
 
 ThreadedAssignment::ThreadedAssignment(const QByteArray& packet) :
     Assignment(packet),
-    _isFinished(false)
+    _isFinished(false),
+    _receivedDatagrams(NULL),
+    _packetReceiver(NULL),
+    _isPacketReceiverRunning(false),
+    _frameTimesMutex(),
+    _frameUsecs()
 {
     
 }
 
+ThreadedAssignment::~ThreadedAssignment() {
+    delete _packetReceiver;
+    delete _receivedDatagrams;
+}
+
+void ThreadedAssignment::enableBatchedDatagramReads() {
+    if (!_receivedDatagrams) {
+        _receivedDatagrams = new DatagramReceiveBatch();
+    }
+}
+
+PacketReceiver* ThreadedAssignment::createPacketReceiver() {
+    if (!_packetReceiver && PacketReceiver::isSupported()) {
+        _packetReceiver = new PacketReceiver(NodeList::getInstance()->getNodeSocket());
+    }
+    return _packetReceiver;
+}
+
+void ThreadedAssignment::startPacketReceiver() {
+    if (!_packetReceiver || _isPacketReceiverRunning) {
+        return;
+    }
+
+    // the receiver reads the socket from now on, we only hear about what it leaves in the default queue
+    disconnect(&NodeList::getInstance()->getNodeSocket(), &QUdpSocket::readyRead,
+               this, &ThreadedAssignment::readPendingDatagrams);
+
+    // anything already read ahead into the batch is handled here before the receiver takes over the socket
+    readPendingDatagrams();
+
+    _packetReceiver->getDefaultQueue().setNotifyTarget(this, "readPendingDatagrams");
+    _packetReceiver->initialize(true);
+    _isPacketReceiverRunning = true;
+}
+
 void ThreadedAssignment::setFinished(bool isFinished) {
     _isFinished = isFinished;
 
     if (_isFinished) {
+        // the socket goes back to the assignment client, which reads it itself
+        if (_isPacketReceiverRunning) {
+            _packetReceiver->terminate();
+            _isPacketReceiverRunning = false;
+        }
+
         aboutToFinish();
         emit finished();
         
@@ -68,9 +120,44 @@ void ThreadedAssignment::addPacketStatsAndSendStatsPacket(QJsonObject &statsObje
     statsObject["packets_per_second"] = packetsPerSecond;
     statsObject["bytes_per_second"] = bytesPerSecond;
     
+    addFrameTimeStats(statsObject);
+    
     nodeList->sendStatsToDomainServer(statsObject);
 }
 
+// an assignment that never sends stats keeps only this many frame times around
+const int MAX_FRAME_TIMES_PER_STATS_PACKET = 10000;
+
+void ThreadedAssignment::frameCompleted(quint64 frameUsecs) {
+    QMutexLocker locker(&_frameTimesMutex);
+    if (_frameUsecs.size() < MAX_FRAME_TIMES_PER_STATS_PACKET) {
+        _frameUsecs.append((quint32)std::min(frameUsecs, (quint64)std::numeric_limits<quint32>::max()));
+    }
+}
+
+static quint32 frameTimePercentile(QVector<quint32>& frameUsecs, float percentile) {
+    QVector<quint32>::iterator nth = frameUsecs.begin() + (int)(percentile * (frameUsecs.size() - 1));
+    std::nth_element(frameUsecs.begin(), nth, frameUsecs.end());
+    return *nth;
+}
+
+void ThreadedAssignment::addFrameTimeStats(QJsonObject& statsObject) {
+    QVector<quint32> frameUsecs;
+    _frameTimesMutex.lock();
+    frameUsecs.swap(_frameUsecs);
+    _frameTimesMutex.unlock();
+    
+    if (frameUsecs.isEmpty()) {
+        return;
+    }
+    
+    statsObject["frames"] = frameUsecs.size();
+    statsObject["frame_usecs_p50"] = (double) frameTimePercentile(frameUsecs, 0.5f);
+    statsObject["frame_usecs_p90"] = (double) frameTimePercentile(frameUsecs, 0.9f);
+    statsObject["frame_usecs_p99"] = (double) frameTimePercentile(frameUsecs, 0.99f);
+    statsObject["frame_usecs_max"] = (double) *std::max_element(frameUsecs.begin(), frameUsecs.end());
+}
+
 void ThreadedAssignment::sendStatsPacket() {
     QJsonObject statsObject;
     addPacketStatsAndSendStatsPacket(statsObject);
@@ -86,6 +173,10 @@ void ThreadedAssignment::checkInWithDomainServerOrExit() {
 
 bool ThreadedAssignment::readAvailableDatagram(QByteArray& destinationByteArray, HifiSockAddr& senderSockAddr) {
     NodeList* nodeList = NodeList::getInstance();
+
+    if (_receivedDatagrams) {
+        return _receivedDatagrams->readNext(nodeList->getNodeSocket(), destinationByteArray, senderSockAddr);
+    }
     
     if (nodeList->getNodeSocket().hasPendingDatagrams()) {
         destinationByteArray.resize(nodeList->getNodeSocket().pendingDatagramSize());
@@ -96,3 +187,23 @@ bool ThreadedAssignment::readAvailableDatagram(QByteArray& destinationByteArray,
         return false;
     }
 }
+
+bool ThreadedAssignment::readVerifiedDatagram(QByteArray& destinationByteArray, HifiSockAddr& senderSockAddr) {
+    if (_isPacketReceiverRunning) {
+        ReceivedPacket receivedPacket;
+        if (!_packetReceiver->getDefaultQueue().pop(receivedPacket)) {
+            return false;
+        }
+        destinationByteArray = receivedPacket.packet;
+        senderSockAddr = receivedPacket.senderSockAddr;
+        return true;
+    }
+
+    NodeList* nodeList = NodeList::getInstance();
+    while (readAvailableDatagram(destinationByteArray, senderSockAddr)) {
+        if (nodeList->packetVersionAndHashMatch(destinationByteArray)) {
+            return true;
+        }
+    }
+    return false;
+}
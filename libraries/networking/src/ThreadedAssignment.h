@@ -12,18 +12,28 @@
 #ifndef hifi_ThreadedAssignment_h
 #define hifi_ThreadedAssignment_h
 
+#include <QtCore/QMutex>
 #include <QtCore/QSharedPointer>
+#include <QtCore/QVector>
 
 #include "Assignment.h"
 
+class DatagramReceiveBatch;
+class PacketReceiver;
+
 class ThreadedAssignment : public Assignment {
     Q_OBJECT
 public:
     ThreadedAssignment(const QByteArray& packet);
+    ~ThreadedAssignment();
     void setFinished(bool isFinished);
     virtual void aboutToFinish() { };
     void addPacketStatsAndSendStatsPacket(QJsonObject& statsObject);
 
+    /// Adds how long one frame of the assignment's work took, which goes out as percentiles with the next stats packet
+    /// \thread any thread, typically the one running the frames
+    void frameCompleted(quint64 frameUsecs);
+
 public slots:
     /// threaded run of assignment
     virtual void run() = 0;
@@ -32,8 +42,29 @@ public slots:
 
 protected:
     bool readAvailableDatagram(QByteArray& destinationByteArray, HifiSockAddr& senderSockAddr);
+    /// makes readAvailableDatagram() drain the node socket in batches, see DatagramReceiveBatch
+    void enableBatchedDatagramReads();
+
+    /// Has the node socket read on a thread of its own, see PacketReceiver. Route the packet types the assignment takes
+    /// from its own queues on the receiver this returns, and then start it with startPacketReceiver().
+    /// \return NULL where the receiver isn't supported, and the assignment goes on reading the socket itself
+    PacketReceiver* createPacketReceiver();
+    /// From here on readPendingDatagrams() is called for the packets that aren't routed anywhere else
+    void startPacketReceiver();
+    /// Takes the next datagram that passed the version and hash checks, from the receiver's default queue once it
+    /// runs, or from the socket before that
+    bool readVerifiedDatagram(QByteArray& destinationByteArray, HifiSockAddr& senderSockAddr);
+
     void commonInit(const QString& targetName, NodeType_t nodeType, bool shouldSendStats = true);
     bool _isFinished;
+    DatagramReceiveBatch* _receivedDatagrams;
+    PacketReceiver* _packetReceiver;
+    bool _isPacketReceiverRunning;
+private:
+    void addFrameTimeStats(QJsonObject& statsObject);
+
+    QMutex _frameTimesMutex;
+    QVector<quint32> _frameUsecs; // since the last stats packet
 private slots:
     void checkInWithDomainServerOrExit();
 signals:
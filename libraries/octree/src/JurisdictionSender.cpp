@@ -23,6 +23,8 @@ JurisdictionSender::JurisdictionSender(JurisdictionMap* map, NodeType_t type) :
     _nodeType(type),
     _packetSender(JurisdictionSender::DEFAULT_PACKETS_PER_SECOND)
 {
+    // our replies are paced by the shared packet pacer, so this thread only has to answer the requests
+    _packetSender.initialize(true);
 }
 
 JurisdictionSender::~JurisdictionSender() {
@@ -44,7 +46,7 @@ bool JurisdictionSender::process() {
 
     // call our ReceivedPacketProcessor base class process so we'll get any pending packets
     if (continueProcessing && (continueProcessing = ReceivedPacketProcessor::process())) {
-        // add our packet to our own queue, then let the PacketSender class do the rest of the work.
+        // add our packet to our own queue, then let the PacketSender class and its pacer do the rest of the work.
         static unsigned char buffer[MAX_PACKET_SIZE];
         unsigned char* bufferOut = &buffer[0];
         ssize_t sizeOut = 0;
@@ -72,8 +74,6 @@ bool JurisdictionSender::process() {
 
         // set our packets per second to be the number of nodes
         _packetSender.setPacketsPerSecond(nodeCount);
-
-        continueProcessing = _packetSender.process();
     }
     return continueProcessing;
 }
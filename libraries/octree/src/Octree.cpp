@@ -19,6 +19,11 @@
 #include <fstream> // to load voxels from file
 
 #include <QDebug>
+#include <QFile>
+#include <QHash>
+#include <QRunnable>
+#include <QSaveFile>
+#include <QThreadPool>
 
 #include <GeometryUtil.h>
 #include <OctalCode.h>
@@ -32,6 +37,9 @@
 #include "CoverageMap.h"
 #include "OctreeConstants.h"
 #include "OctreeElementBag.h"
+#include "OctreeElementIndex.h"
+#include "OctreeElementReclaimer.h"
+#include "OctreeSubtreeCache.h"
 #include "Octree.h"
 #include "ViewFrustum.h"
 
@@ -41,6 +49,7 @@ float boundaryDistanceForRenderLevel(unsigned int renderLevel, float voxelSizeSc
 
 Octree::Octree(bool shouldReaverage) :
     _rootElement(NULL),
+    _elementIndex(NULL),
     _isDirty(true),
     _shouldReaverage(shouldReaverage),
     _stopImport(false),
@@ -50,11 +59,29 @@ Octree::Octree(bool shouldReaverage) :
 }
 
 Octree::~Octree() {
+    setUseElementIndex(false);
+
     // delete the children of the root element
     // this recursively deletes the tree
     delete _rootElement;
 }
 
+void Octree::setUseElementIndex(bool useElementIndex) {
+    if (useElementIndex == (_elementIndex != NULL)) {
+        return;
+    }
+    if (useElementIndex) {
+        _elementIndex = new OctreeElementIndex();
+        _elementIndex->addSubtree(_rootElement);
+        qDebug() << "Octree::setUseElementIndex() indexed" << _elementIndex->size() << "elements";
+    } else {
+        // the elements forget the index before it goes, so that none of them looks for it after
+        _elementIndex->removeSubtree(_rootElement);
+        delete _elementIndex;
+        _elementIndex = NULL;
+    }
+}
+
 // Recurses voxel tree calling the RecurseOctreeOperation function for each element.
 // stops recursion if operation function returns false.
 void Octree::recurseTreeWithOperation(RecurseOctreeOperation operation, void* extraData) {
@@ -145,6 +172,36 @@ void Octree::recurseElementWithOperationDistanceSorted(OctreeElement* element, R
     }
 }
 
+void Octree::recurseTreeInViewWithOperation(const ViewFrustum& viewFrustum, RecurseOctreeInViewOperation operation,
+                                            void* extraData) {
+    recurseElementInViewWithOperation(_rootElement, viewFrustum, _rootElement->inFrustum(viewFrustum),
+                                      _rootElement->furthestDistanceToCamera(viewFrustum), operation, extraData);
+}
+
+// Recurses voxel element with an operation function, classifying all the children against the view at once
+void Octree::recurseElementInViewWithOperation(OctreeElement* element, const ViewFrustum& viewFrustum,
+                                               ViewFrustum::location location, float furthestDistance,
+                                               RecurseOctreeInViewOperation operation, void* extraData,
+                                               int recursionCount) {
+    if (recursionCount > DANGEROUSLY_DEEP_RECURSION) {
+        qDebug() << "Octree::recurseElementInViewWithOperation() reached DANGEROUSLY_DEEP_RECURSION, bailing!";
+        return;
+    }
+
+    if (operation(element, location, furthestDistance, extraData) && !element->isLeaf()) {
+        ChildCubeLocations childLocations;
+        element->childrenInFrustum(viewFrustum, childLocations);
+        for (int i = 0; i < NUMBER_OF_CHILDREN; i++) {
+            OctreeElement* child = element->getChildAtIndex(i);
+            if (child) {
+                recurseElementInViewWithOperation(child, viewFrustum, childLocations.getLocation(i),
+                                                  childLocations.furthestDistances[i], operation, extraData,
+                                                  recursionCount + 1);
+            }
+        }
+    }
+}
+
 void Octree::recurseTreeWithOperator(RecurseOctreeOperator* operatorObject) {
     recurseElementWithOperator(_rootElement, operatorObject);
 }
@@ -177,6 +234,14 @@ OctreeElement* Octree::nodeForOctalCode(OctreeElement* ancestorElement,
         return _rootElement;
     }
 
+    // an indexed element is found without descending to it, and an element that isn't is looked for as before
+    if (_elementIndex && ancestorElement == _rootElement && !parentOfFoundElement) {
+        OctreeElement* indexedElement = _elementIndex->find(needleCode);
+        if (indexedElement) {
+            return indexedElement;
+        }
+    }
+
     // find the appropriate branch index based on this ancestorElement
     if (*needleCode > 0) {
         int branchForNeedle = branchIndexWithDescendant(ancestorElement->getOctalCode(), needleCode);
@@ -248,7 +313,7 @@ int Octree::readElementData(OctreeElement* destinationElement, const unsigned ch
             bool nodeIsDirty = false;
             if (childElementAt) {
                 bytesRead += childElementAt->readElementDataFromBuffer(nodeData + bytesRead, bytesLeftToRead, args);
-                childElementAt->setSourceUUID(args.sourceUUID);
+                childElementAt->setSourceUUIDKey(args.sourceUUIDKey);
 
                 // if we had a local version of the element already, it's possible that we have it already but
                 // with the same color data, so this won't count as a change. To address this we check the following
@@ -321,6 +386,11 @@ void Octree::readBitstreamToTree(const unsigned char * bitstream, unsigned long
         args.destinationElement = _rootElement;
     }
 
+    // look the source up once rather than for every element
+    if (args.sourceUUIDKey == KEY_FOR_NULL) {
+        args.sourceUUIDKey = OctreeElement::keyForSourceUUID(args.sourceUUID);
+    }
+
     // Keep looping through the buffer calling readElementData() this allows us to pack multiple root-relative Octal codes
     // into a single network packet. readElementData() basically goes down a tree from the root, and fills things in from there
     // if there are more bytes after that, it's assumed to be another root relative tree
@@ -476,11 +546,31 @@ void Octree::deleteOctalCodeFromTreeRecursion(OctreeElement* element, void* extr
 }
 
 void Octree::eraseAllOctreeElements() {
-    delete _rootElement; // this will recurse and delete all children
+    OctreeElement* oldRoot = _rootElement;
     _rootElement = createNewElement();
+    if (_elementIndex) {
+        _elementIndex->addSubtree(_rootElement); // the old root only gives up its key if it still has it
+    }
+    OctreeElementReclaimer::retire(oldRoot); // this will recurse and delete all children
     _isDirty = true;
 }
 
+quint64 Octree::beginRead() {
+    if (supportsSnapshotReads()) {
+        return OctreeElementReclaimer::beginRead();
+    }
+    lockForRead();
+    return 0;
+}
+
+void Octree::endRead(quint64 readEpoch) {
+    if (supportsSnapshotReads()) {
+        OctreeElementReclaimer::endRead(readEpoch);
+    } else {
+        unlock();
+    }
+}
+
 void Octree::processRemoveOctreeElementsBitstream(const unsigned char* bitstream, int bufferSizeBytes) {
     //unsigned short int itemNumber = (*((unsigned short int*)&bitstream[sizeof(PACKET_HEADER)]));
 
@@ -557,11 +647,6 @@ OctreeElement* Octree::getOctreeElementAt(float x, float y, float z, float s) co
         element = NULL;
     }
     delete[] octalCode; // cleanup memory
-#ifdef HAS_AUDIT_CHILDREN
-    if (element) {
-        element->auditChildren("Octree::getOctreeElementAt()");
-    }
-#endif // def HAS_AUDIT_CHILDREN
     return element;
 }
 
@@ -570,11 +655,6 @@ OctreeElement* Octree::getOctreeEnclosingElementAt(float x, float y, float z, fl
     OctreeElement* element = nodeForOctalCode(_rootElement, octalCode, NULL);
     
     delete[] octalCode; // cleanup memory
-#ifdef HAS_AUDIT_CHILDREN
-    if (element) {
-        element->auditChildren("Octree::getOctreeElementAt()");
-    }
-#endif // def HAS_AUDIT_CHILDREN
     return element;
 }
 
@@ -938,6 +1018,7 @@ int Octree::encodeTreeBitstream(OctreeElement* element,
     if (!roomForOctalCode) {
         bag.insert(element); // add the element back to the bag so it will eventually get included
         params.stopReason = EncodeBitstreamParams::DIDNT_FIT;
+        params.numDidntFit++;
         return bytesWritten;
     }
 
@@ -1155,6 +1236,16 @@ int Octree::encodeTreeBitstreamRecursion(OctreeElement* element,
     int indexOfChildren[NUMBER_OF_CHILDREN] = { 0, 0, 0, 0, 0, 0, 0, 0 };
     int currentCount = 0;
 
+    // where all the children are in the views, found at once rather than one child at a time
+    ChildCubeLocations childLocations;
+    if (params.viewFrustum) {
+        element->childrenInFrustum(*params.viewFrustum, childLocations);
+    }
+    ChildCubeLocations lastChildLocations;
+    if (params.deltaViewFrustum && params.lastViewFrustum) {
+        element->childrenInFrustum(*params.lastViewFrustum, lastChildLocations);
+    }
+
     for (int i = 0; i < NUMBER_OF_CHILDREN; i++) {
         OctreeElement* childElement = element->getChildAtIndex(i);
 
@@ -1174,7 +1265,7 @@ int Octree::encodeTreeBitstreamRecursion(OctreeElement* element,
 
         if (params.wantOcclusionCulling) {
             if (childElement) {
-                float distance = params.viewFrustum ? childElement->distanceToCamera(*params.viewFrustum) : 0;
+                float distance = params.viewFrustum ? childLocations.distances[i] : 0;
 
                 currentCount = insertIntoSortedArrays((void*)childElement, distance, i,
                                                       (void**)&sortedChildren, (float*)&distancesToChildren,
@@ -1204,7 +1295,7 @@ int Octree::encodeTreeBitstreamRecursion(OctreeElement* element,
                 ( !params.viewFrustum || // no view frustum was given, everything is assumed in view
                   (nodeLocationThisView == ViewFrustum::INSIDE) || // parent was fully in view, we can assume ALL children are
                   (nodeLocationThisView == ViewFrustum::INTERSECT && 
-                        childElement->isInView(*params.viewFrustum)) // the parent intersects and the child is in view
+                        childLocations.isInView(originalIndex)) // the parent intersects and the child is in view
                 ));
 
         if (!childIsInView) {
@@ -1270,7 +1361,8 @@ int Octree::encodeTreeBitstreamRecursion(OctreeElement* element,
 
                 bool shouldRender = !params.viewFrustum
                                     ? true
-                                    : childElement->calculateShouldRender(params.viewFrustum,
+                                    : childElement->calculateShouldRenderAtDistance(
+                                                    childLocations.furthestDistances[originalIndex],
                                                     params.octreeElementSizeScale, params.boundaryLevelAdjust);
 
                 // track some stats
@@ -1290,7 +1382,7 @@ int Octree::encodeTreeBitstreamRecursion(OctreeElement* element,
                     bool childWasInView = false;
 
                     if (childElement && params.deltaViewFrustum && params.lastViewFrustum) {
-                        ViewFrustum::location location = childElement->inFrustum(*params.lastViewFrustum);
+                        ViewFrustum::location location = lastChildLocations.getLocation(originalIndex);
 
                         // If we're a leaf, then either intersect or inside is considered "formerly in view"
                         if (childElement->isLeaf()) {
@@ -1447,8 +1539,19 @@ int Octree::encodeTreeBitstreamRecursion(OctreeElement* element,
                 // called databits), then we wouldn't send the children. So those types of Octree's should tell us to keep
                 // recursing, by returning TRUE in recurseChildrenWithData().
                 if (recurseChildrenWithData() || !params.viewFrustum || !oneAtBit(childrenColoredBits, originalIndex)) {
-                    childTreeBytesOut = encodeTreeBitstreamRecursion(childElement, packetData, bag, params, 
-                                                                            thisLevel, nodeLocationThisView);
+                    // a child entirely inside the view encodes the same for every viewer it's at the same LOD for
+                    if (params.subtreeCache && nodeLocationThisView == ViewFrustum::INSIDE) {
+                        childTreeBytesOut = encodeTreeBitstreamRecursionWithCache(childElement, packetData, bag, params,
+                                                                                  thisLevel);
+                    } else {
+                        // a child found INSIDE with its siblings doesn't have to be tested again on its own
+                        ViewFrustum::location childLocationThisView = nodeLocationThisView;
+                        if (params.viewFrustum && nodeLocationThisView == ViewFrustum::INTERSECT) {
+                            childLocationThisView = childLocations.getLocation(originalIndex);
+                        }
+                        childTreeBytesOut = encodeTreeBitstreamRecursion(childElement, packetData, bag, params,
+                                                                         thisLevel, childLocationThisView);
+                    }
                 }
 
                 // remember this for reshuffling
@@ -1564,32 +1667,112 @@ int Octree::encodeTreeBitstreamRecursion(OctreeElement* element,
         }
 
         params.stopReason = EncodeBitstreamParams::DIDNT_FIT;
+        params.numDidntFit++;
         bytesAtThisLevel = 0; // didn't fit
     }
 
     return bytesAtThisLevel;
 }
 
-bool Octree::readFromSVOFile(const char* fileName) {
+// Returns the deepest level at which the viewer's LOD renders any part of this element's subtree, or -1 if the LOD
+// boundary for some level of the subtree passes through the element, in which case how the subtree encodes depends on
+// exactly where the viewer is. Elements below the returned level are never rendered, elements at or above it always are.
+static int cacheableLODLevelForElement(const OctreeElement* element, const EncodeBitstreamParams& params) {
+    // leave room for the rounding between the voxel scale and tree scale distances used by the encode
+    const float LOD_BOUNDARY_MARGIN = 0.01f;
+
+    const AACube& cube = element->getAACube();
+    glm::vec3 cameraPosition = params.viewFrustum->getPositionVoxelScale();
+    glm::vec3 closestPoint = glm::clamp(cameraPosition, cube.getCorner(), cube.getCorner() + glm::vec3(cube.getScale()));
+    float closestDistance = glm::distance(cameraPosition, closestPoint) * (float)TREE_SCALE * (1.0f - LOD_BOUNDARY_MARGIN);
+    float furthestDistance = element->furthestDistanceToCamera(*params.viewFrustum) * (1.0f + LOD_BOUNDARY_MARGIN);
+
+    int lodLevel = element->getLevel();
+    if (boundaryDistanceForRenderLevel(lodLevel + params.boundaryLevelAdjust, params.octreeElementSizeScale)
+            <= furthestDistance) {
+        return -1;
+    }
+    while (boundaryDistanceForRenderLevel(lodLevel + 1 + params.boundaryLevelAdjust, params.octreeElementSizeScale)
+            > furthestDistance) {
+        lodLevel++;
+    }
+    if (boundaryDistanceForRenderLevel(lodLevel + 1 + params.boundaryLevelAdjust, params.octreeElementSizeScale)
+            >= closestDistance) {
+        return -1;
+    }
+    return lodLevel;
+}
+
+// Encodes an element that is entirely inside the view, copying the bytes from the subtree cache if another viewer
+// already had the same subtree encoded at the same LOD since it last changed
+int Octree::encodeTreeBitstreamRecursionWithCache(OctreeElement* element,
+                                                  OctreePacketData* packetData, OctreeElementBag& bag,
+                                                  EncodeBitstreamParams& params, int& currentEncodeLevel) const {
+    // anything that makes the encode depend on more than the subtree and its LOD, like what the viewer was last sent
+    // or what is in front of the subtree, makes the bytes specific to this viewer
+    bool canUseCache = canCacheEncodedSubtrees() && params.forceSendScene && !params.deltaViewFrustum
+        && !params.wantOcclusionCulling && params.maxEncodeLevel == INT_MAX;
+
+    int lodLevel = canUseCache ? cacheableLODLevelForElement(element, params) : -1;
+    if (lodLevel < 0) {
+        return encodeTreeBitstreamRecursion(element, packetData, bag, params, currentEncodeLevel, ViewFrustum::INSIDE);
+    }
+
+    QByteArray key = OctreeSubtreeCache::keyFor(element->getOctalCode(), lodLevel,
+                                                params.includeColor, params.includeExistsBits);
+    // a writer may change the subtree while we encode it, in which case the slice is stored with the time from before
+    // the change and will never be found
+    quint64 lastChanged = element->getLastChanged();
+    QByteArray slice;
+    int levelsBelow;
+    if (params.subtreeCache->find(key, lastChanged, slice, levelsBelow)
+            && packetData->appendRawData(reinterpret_cast<const unsigned char*>(slice.constData()), slice.size())) {
+        params.maxLevelReached = std::max(currentEncodeLevel + levelsBelow, params.maxLevelReached);
+        return slice.size();
+    }
+
+    int sliceStart = packetData->getUncompressedSize();
+    int didntFitBefore = params.numDidntFit;
+    int maxLevelReachedBefore = params.maxLevelReached;
+    int levelAbove = currentEncodeLevel;
+    params.maxLevelReached = 0;
+
+    int bytesOut = encodeTreeBitstreamRecursion(element, packetData, bag, params, currentEncodeLevel, ViewFrustum::INSIDE);
+
+    levelsBelow = params.maxLevelReached - levelAbove;
+    params.maxLevelReached = std::max(params.maxLevelReached, maxLevelReachedBefore);
+
+    // only a subtree that was sent whole can be given to other viewers
+    if (bytesOut >= MIN_CACHED_SUBTREE_BYTES && params.numDidntFit == didntFitBefore
+            && packetData->getUncompressedSize() - sliceStart == bytesOut) {
+        params.subtreeCache->insert(key, lastChanged, packetData->getUncompressedData() + sliceStart,
+                                    bytesOut, levelsBelow);
+    }
+    return bytesOut;
+}
+
+bool Octree::readFromSVOFile(const char* fileName, int readThreads) {
     bool fileOk = false;
     PacketVersion gotVersion = 0;
-    std::ifstream file(fileName, std::ios::in|std::ios::binary|std::ios::ate);
-    if(file.is_open()) {
+    QFile file(fileName);
+    if (file.open(QIODevice::ReadOnly)) {
         emit importSize(1.0f, 1.0f, 1.0f);
         emit importProgress(0);
 
         qDebug("Loading file %s...", fileName);
 
-        // get file length....
-        unsigned long fileLength = file.tellg();
-        file.seekg( 0, std::ios::beg );
-
-        // read the entire file into a buffer, WHAT!? Why not.
-        unsigned char* entireFile = new unsigned char[fileLength];
-        file.read((char*)entireFile, fileLength);
+        // map the file rather than read it in, so that loading it doesn't take its size in memory on top of the tree
+        unsigned long fileLength = file.size();
+        const unsigned char* entireFile = (fileLength > 0) ? file.map(0, fileLength) : NULL;
+        QByteArray fileContents;
+        if (!entireFile) {
+            fileContents = file.readAll(); // not every file can be mapped
+            entireFile = reinterpret_cast<const unsigned char*>(fileContents.constData());
+            fileLength = fileContents.size();
+        }
         bool wantImportProgress = true;
 
-        unsigned char* dataAt = entireFile;
+        const unsigned char* dataAt = entireFile;
         unsigned long  dataLength = fileLength;
 
         // before reading the file, check to see if this version of the Octree supports file versions
@@ -1598,24 +1781,28 @@ bool Octree::readFromSVOFile(const char* fileName) {
             PacketType expectedType = expectedDataPacketType();
             
             PacketType gotType;
-            memcpy(&gotType, dataAt, sizeof(gotType));
-            
-            if (gotType == expectedType) {
-                dataAt += sizeof(expectedType);
-                dataLength -= sizeof(expectedType);
-                gotVersion = *dataAt;
-                if (canProcessVersion(gotVersion)) {
-                    dataAt += sizeof(gotVersion);
-                    dataLength -= sizeof(gotVersion);
-                    fileOk = true;
-                    qDebug("SVO file version match. Expected: %d Got: %d", 
-                                versionForPacketType(expectedDataPacketType()), gotVersion);
+            if (dataLength < sizeof(gotType) + sizeof(gotVersion)) {
+                qDebug("SVO file is too short to have a version, %lu bytes", dataLength);
+            } else {
+                memcpy(&gotType, dataAt, sizeof(gotType));
+
+                if (gotType == expectedType) {
+                    dataAt += sizeof(expectedType);
+                    dataLength -= sizeof(expectedType);
+                    gotVersion = *dataAt;
+                    if (canProcessVersion(gotVersion)) {
+                        dataAt += sizeof(gotVersion);
+                        dataLength -= sizeof(gotVersion);
+                        fileOk = true;
+                        qDebug("SVO file version match. Expected: %d Got: %d",
+                                    versionForPacketType(expectedDataPacketType()), gotVersion);
+                    } else {
+                        qDebug("SVO file version mismatch. Expected: %d Got: %d",
+                                    versionForPacketType(expectedDataPacketType()), gotVersion);
+                    }
                 } else {
-                    qDebug("SVO file version mismatch. Expected: %d Got: %d", 
-                                versionForPacketType(expectedDataPacketType()), gotVersion);
+                    qDebug("SVO file type mismatch. Expected: %c Got: %c", expectedType, gotType);
                 }
-            } else {
-                qDebug("SVO file type mismatch. Expected: %c Got: %c", expectedType, gotType);
             }
         } else {
             fileOk = true; // assume the file is ok
@@ -1623,9 +1810,13 @@ bool Octree::readFromSVOFile(const char* fileName) {
         if (fileOk) {
             ReadBitstreamToTreeParams args(WANT_COLOR, NO_EXISTS_BITS, NULL, 0, 
                                                 SharedNodePointer(), wantImportProgress, gotVersion);
-            readBitstreamToTree(dataAt, dataLength, args);
+            if (!(readThreads > 1 && readSubtreesInParallel(dataAt, dataLength, args, readThreads))) {
+                readBitstreamToTree(dataAt, dataLength, args);
+            }
+        }
+        if (fileContents.isEmpty() && fileLength > 0) {
+            file.unmap(const_cast<unsigned char*>(entireFile));
         }
-        delete[] entireFile;
 
         emit importProgress(100);
 
@@ -1634,10 +1825,158 @@ bool Octree::readFromSVOFile(const char* fileName) {
     return fileOk;
 }
 
-void Octree::writeToSVOFile(const char* fileName, OctreeElement* element) {
-    std::ofstream file(fileName, std::ios::out|std::ios::binary);
+// an SVO file is split into subtrees below this many levels, which are read in parallel
+const int PARALLEL_SUBTREE_LEVELS = 2;
+
+/// A root relative subtree in a bitstream, its octal code followed by its elements
+class BitstreamSubtree {
+public:
+    const unsigned char* data;
+    int length;
+};
+
+/// Walks the children of an element in a bitstream without exists bits, the way Octree::readElementData() reads them,
+/// but without reading them into the tree.
+/// \return the bytes readElementData() reads, or -1 if the bitstream ends in the middle of an element
+static int scanElementData(const unsigned char* nodeData, int bytesLeftToRead, int elementDataBytes) {
+    if (bytesLeftToRead < (int)sizeof(unsigned char)) {
+        return -1;
+    }
+    unsigned char colorInPacketMask = *nodeData;
+    int bytesRead = sizeof(colorInPacketMask) + numberOfOnes(colorInPacketMask) * elementDataBytes;
+
+    unsigned char childMask;
+    if (bytesRead + (int)sizeof(childMask) > bytesLeftToRead) {
+        return -1;
+    }
+    childMask = *(nodeData + bytesRead);
+    bytesRead += sizeof(childMask);
+
+    for (int childIndex = 0; bytesLeftToRead - bytesRead > 0 && childIndex < NUMBER_OF_CHILDREN; childIndex++) {
+        if (oneAtBit(childMask, childIndex)) {
+            int childBytesRead = scanElementData(nodeData + bytesRead, bytesLeftToRead - bytesRead, elementDataBytes);
+            if (childBytesRead < 0) {
+                return -1;
+            }
+            bytesRead += childBytesRead;
+        }
+    }
+    return bytesRead;
+}
+
+/// Reads the subtrees of a bitstream that are all below one element of the tree
+class BitstreamSubtreeReader : public QRunnable {
+public:
+    BitstreamSubtreeReader(Octree* tree, const ReadBitstreamToTreeParams& args) : _tree(tree), _args(args) { }
+
+    QVector<BitstreamSubtree> subtrees; // in the order of the bitstream
+
+    virtual void run() {
+        OctreeElement::beginThreadStatistics();
+        foreach (const BitstreamSubtree& subtree, subtrees) {
+            _tree->readBitstreamToTree(subtree.data, subtree.length, _args);
+        }
+        OctreeElement::endThreadStatistics();
+    }
+
+private:
+    Octree* _tree;
+    ReadBitstreamToTreeParams _args;
+};
 
-    if(file.is_open()) {
+bool Octree::readSubtreesInParallel(const unsigned char* bitstream, unsigned long int bufferSizeBytes,
+                                    ReadBitstreamToTreeParams& args, int readThreads) {
+    int elementDataBytes = getFixedElementDataBytes();
+    if (elementDataBytes < 0 || rootElementHasData() || args.includeExistsBits) {
+        return false;
+    }
+
+    // find the subtrees in the bitstream from their framing alone
+    QVector<BitstreamSubtree> subtrees;
+    const unsigned char* bitstreamAt = bitstream;
+    const unsigned char* bitstreamEnd = bitstream + bufferSizeBytes;
+    while (bitstreamAt < bitstreamEnd) {
+        int octalCodeBytes = bytesRequiredForCodeLength(*bitstreamAt);
+        int elementBytes = (octalCodeBytes < bitstreamEnd - bitstreamAt) ? scanElementData(bitstreamAt + octalCodeBytes,
+            bitstreamEnd - bitstreamAt - octalCodeBytes, elementDataBytes) : -1;
+        if (elementBytes < 0) {
+            qDebug() << "Octree::readSubtreesInParallel() bitstream is cut off" << (bitstreamAt - bitstream)
+                << "bytes in, reading it serially";
+            return false;
+        }
+        BitstreamSubtree subtree = { bitstreamAt, octalCodeBytes + elementBytes };
+        subtrees.append(subtree);
+        bitstreamAt += subtree.length;
+    }
+
+    args.destinationElement = _rootElement;
+    args.wantImportProgress = false;
+    args.sourceUUIDKey = OctreeElement::keyForSourceUUID(args.sourceUUID);
+
+    // the subtrees near the root are read first, and the elements the deeper ones are below are made for them, so that
+    // each thread only ever changes the elements below its own, and only reads the ones above them. A file has each
+    // element in one subtree only, so reading them in another order than the file's makes the same tree.
+    QVector<BitstreamSubtreeReader*> readers;
+    QHash<OctreeElement*, BitstreamSubtreeReader*> readerForElement;
+    QVector<BitstreamSubtree> deepSubtrees;
+    foreach (const BitstreamSubtree& subtree, subtrees) {
+        if (*subtree.data < PARALLEL_SUBTREE_LEVELS) {
+            readBitstreamToTree(subtree.data, subtree.length, args);
+        } else {
+            deepSubtrees.append(subtree);
+        }
+    }
+    foreach (const BitstreamSubtree& subtree, deepSubtrees) {
+        OctreeElement* element = _rootElement;
+        for (int level = 0; level < PARALLEL_SUBTREE_LEVELS; level++) {
+            // the same as createMissingElement() does on the way down
+            if (element->requiresSplit()) {
+                element->splitChildren();
+            }
+            element = element->addChildAtIndex(branchIndexWithDescendant(element->getOctalCode(), subtree.data));
+        }
+
+        BitstreamSubtreeReader* reader = readerForElement.value(element);
+        if (!reader) {
+            reader = new BitstreamSubtreeReader(this, args);
+            readerForElement.insert(element, reader);
+            readers.append(reader);
+        }
+        reader->subtrees.append(subtree);
+    }
+
+    // each reader changes the tree's dirty bit, but only ever sets it
+    if (!subtrees.isEmpty()) {
+        _isDirty = true;
+    }
+
+    // the readers would only wait on each other to add their elements to the index, it is made again once they're done
+    if (_elementIndex) {
+        _elementIndex->suspend();
+    }
+
+    QThreadPool readerPool;
+    readerPool.setMaxThreadCount(readThreads);
+    foreach (BitstreamSubtreeReader* reader, readers) {
+        readerPool.start(reader); // the pool deletes it once it has run
+    }
+    readerPool.waitForDone();
+
+    if (_elementIndex) {
+        _elementIndex->resume(_rootElement);
+    }
+
+    qDebug() << "Octree::readSubtreesInParallel() read" << subtrees.size() << "subtrees," << deepSubtrees.size()
+        << "of them on" << readers.size() << "readers with" << readThreads << "threads";
+    return true;
+}
+
+bool Octree::writeToSVOFile(const char* fileName, OctreeElement* element, quint64* lockedUsecs) {
+    QSaveFile file(fileName);
+    quint64 totalLockedUsecs = 0;
+    bool holdsTreeLock = !supportsSnapshotReads();
+
+    if (file.open(QIODevice::WriteOnly)) {
         qDebug("Saving to file %s...", fileName);
 
         // before reading the file, check to see if this version of the Octree supports file versions
@@ -1662,20 +2001,36 @@ void Octree::writeToSVOFile(const char* fileName, OctreeElement* element) {
         bool lastPacketWritten = false;
 
         while (!nodeBag.isEmpty()) {
+            // do tree locking down here so that we have shorter slices and less thread contention
+            quint64 readEpoch = beginRead();
+            quint64 readStart = usecTimestampNow();
             OctreeElement* subTree = nodeBag.extract();
-            lockForRead(); // do tree locking down here so that we have shorter slices and less thread contention
-            EncodeBitstreamParams params(INT_MAX, IGNORE_VIEW_FRUSTUM, WANT_COLOR, NO_EXISTS_BITS);
-            bytesWritten = encodeTreeBitstream(subTree, &packetData, nodeBag, params);
-            unlock();
+            bool subTreeDidntFit = false;
+            if (subTree) {
+                EncodeBitstreamParams params(INT_MAX, IGNORE_VIEW_FRUSTUM, WANT_COLOR, NO_EXISTS_BITS);
+                bytesWritten = encodeTreeBitstream(subTree, &packetData, nodeBag, params);
+                subTreeDidntFit = (bytesWritten == 0 && (params.stopReason == EncodeBitstreamParams::DIDNT_FIT));
+                if (subTreeDidntFit) {
+                    nodeBag.insert(subTree);
+                }
+            }
+            if (holdsTreeLock) {
+                totalLockedUsecs += usecTimestampNow() - readStart;
+            }
+            endRead(readEpoch);
 
-            // if the subTree couldn't fit, and so we should reset the packet and reinsert the element in our bag and try again
-            if (bytesWritten == 0 && (params.stopReason == EncodeBitstreamParams::DIDNT_FIT)) {
+            // the file is written outside of the lock
+            if (!subTree) {
+                continue; // deleted since we put it in the bag
+            }
+
+            // if the subTree couldn't fit, and so we should reset the packet and try again with the element we put back in our bag
+            if (subTreeDidntFit) {
                 if (packetData.hasContent()) {
                     file.write((const char*)packetData.getFinalizedData(), packetData.getFinalizedSize());
                     lastPacketWritten = true;
                 }
                 packetData.reset(); // is there a better way to do this? could we fit more?
-                nodeBag.insert(subTree);
             } else {
                 lastPacketWritten = false;
             }
@@ -1685,7 +2040,17 @@ void Octree::writeToSVOFile(const char* fileName, OctreeElement* element) {
             file.write((const char*)packetData.getFinalizedData(), packetData.getFinalizedSize());
         }
     }
-    file.close();
+
+    if (lockedUsecs) {
+        *lockedUsecs = totalLockedUsecs;
+    }
+
+    // commit() syncs the temporary file and renames it over the old one, unless any write failed
+    bool fileOk = file.commit();
+    if (!fileOk) {
+        qDebug() << "Failed to save to file" << fileName << ":" << file.errorString();
+    }
+    return fileOk;
 }
 
 unsigned long Octree::getOctreeElementsCount() {
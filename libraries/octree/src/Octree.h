@@ -20,7 +20,9 @@ class ReadBitstreamToTreeParams;
 class Octree;
 class OctreeElement;
 class OctreeElementBag;
+class OctreeElementIndex;
 class OctreePacketData;
+class OctreeSubtreeCache;
 class Shape;
 
 
@@ -45,6 +47,10 @@ public:
 
 // Callback function, for recuseTreeWithOperation
 typedef bool (*RecurseOctreeOperation)(OctreeElement* element, void* extraData);
+
+// Callback function, for recurseTreeInViewWithOperation, given where the element is in the view
+typedef bool (*RecurseOctreeInViewOperation)(OctreeElement* element, ViewFrustum::location location,
+                                             float furthestDistance, void* extraData);
 typedef enum {GRADIENT, RANDOM, NATURAL} creationMode;
 
 const bool NO_EXISTS_BITS         = false;
@@ -65,6 +71,7 @@ const quint64 IGNORE_LAST_SENT  = 0;
 #define IGNORE_VIEW_FRUSTUM      NULL
 #define IGNORE_COVERAGE_MAP      NULL
 #define IGNORE_JURISDICTION_MAP  NULL
+#define NO_SUBTREE_CACHE         NULL
 
 class EncodeBitstreamParams {
 public:
@@ -84,6 +91,10 @@ public:
     OctreeSceneStats* stats;
     CoverageMap* map;
     JurisdictionMap* jurisdictionMap;
+    OctreeSubtreeCache* subtreeCache;
+
+    // number of elements that were put back in the bag because they didn't fit
+    int numDidntFit;
 
     // output hints from the encode process
     typedef enum {
@@ -115,7 +126,8 @@ public:
         quint64 lastViewFrustumSent = IGNORE_LAST_SENT,
         bool forceSendScene = true,
         OctreeSceneStats* stats = IGNORE_SCENE_STATS,
-        JurisdictionMap* jurisdictionMap = IGNORE_JURISDICTION_MAP) :
+        JurisdictionMap* jurisdictionMap = IGNORE_JURISDICTION_MAP,
+        OctreeSubtreeCache* subtreeCache = NO_SUBTREE_CACHE) :
             maxEncodeLevel(maxEncodeLevel),
             maxLevelReached(0),
             viewFrustum(viewFrustum),
@@ -132,6 +144,8 @@ public:
             stats(stats),
             map(map),
             jurisdictionMap(jurisdictionMap),
+            subtreeCache(subtreeCache),
+            numDidntFit(0),
             stopReason(UNKNOWN)
     {}
 
@@ -171,6 +185,7 @@ public:
     SharedNodePointer sourceNode;
     bool wantImportProgress;
     PacketVersion bitstreamVersion;
+    uint16_t sourceUUIDKey; // the key for sourceUUID, looked up once by readBitstreamToTree()
 
     ReadBitstreamToTreeParams(
         bool includeColor = WANT_COLOR,
@@ -186,7 +201,8 @@ public:
             sourceUUID(sourceUUID),
             sourceNode(sourceNode),
             wantImportProgress(wantImportProgress),
-            bitstreamVersion(bitstreamVersion)
+            bitstreamVersion(bitstreamVersion),
+            sourceUUIDKey(KEY_FOR_NULL)
     {}
 };
 
@@ -213,11 +229,32 @@ public:
     virtual bool recurseChildrenWithData() const { return true; }
     virtual bool rootElementHasData() const { return false; }
 
+    /// Return true if an element's encoded subtree depends only on the elements in it, the LOD level it is cut off at
+    /// and the color and exists bits flags, so that it can be shared between viewers through an OctreeSubtreeCache
+    virtual bool canCacheEncodedSubtrees() const { return false; }
+
+    /// Return true if readers can walk this tree without the tree lock while writers change it, which needs every
+    /// change to the elements to go through setChildAtIndex() and the OctreeElementReclaimer
+    virtual bool supportsSnapshotReads() const { return false; }
+
+    /// Return the bytes of data each element has in a bitstream, if they all have the same and reading them changes
+    /// nothing but the element, so that the subtrees of a file can be found without reading them and be read in
+    /// parallel. -1 otherwise.
+    virtual int getFixedElementDataBytes() const { return -1; }
+
 
     virtual void update() { }; // nothing to do by default
 
     OctreeElement* getRoot() { return _rootElement; }
 
+    /// Keeps an OctreeElementIndex of the elements, so that the lookups by octal code from the root find an element
+    /// without descending the tree to it. The index costs memory and time on every element created and deleted, so
+    /// the trees that mostly look elements up, like a server's that edits are applied to, are the ones that want it.
+    /// Call with the tree locked for writing.
+    void setUseElementIndex(bool useElementIndex);
+    bool getUseElementIndex() const { return _elementIndex != NULL; }
+    OctreeElementIndex* getElementIndex() const { return _elementIndex; }
+
     void eraseAllOctreeElements();
 
     void processRemoveOctreeElementsBitstream(const unsigned char* bitstream, int bufferSizeBytes);
@@ -246,6 +283,11 @@ public:
 
     void recurseTreeWithOperator(RecurseOctreeOperator* operatorObject);
 
+    /// Recurses like recurseTreeWithOperation(), and tells the operation where each element is in the view and how
+    /// far its furthest corner is from the camera, found for all the children of an element at once
+    void recurseTreeInViewWithOperation(const ViewFrustum& viewFrustum, RecurseOctreeInViewOperation operation,
+                                        void* extraData = NULL);
+
     int encodeTreeBitstream(OctreeElement* element, OctreePacketData* packetData, OctreeElementBag& bag,
                             EncodeBitstreamParams& params) ;
 
@@ -259,6 +301,13 @@ public:
     void lockForWrite() { _lock.lockForWrite(); }
     bool tryLockForWrite() { return _lock.tryLockForWrite(); }
     void unlock() { _lock.unlock(); }
+
+    /// Starts reading the tree from outside the thread that changes it. Trees that support snapshot reads are read
+    /// without the tree lock, and the elements the reader finds stay valid until endRead(), other trees are locked for
+    /// read. Elements taken from an OctreeElementBag must be taken after beginRead().
+    /// \return the value to pass to endRead()
+    quint64 beginRead();
+    void endRead(quint64 readEpoch);
     // output hints from the encode process
     typedef enum {
         Lock,
@@ -287,8 +336,14 @@ public:
     void loadOctreeFile(const char* fileName, bool wantColorRandomizer);
 
     // these will read/write files that match the wireformat, excluding the 'V' leading
-    void writeToSVOFile(const char* filename, OctreeElement* element = NULL);
-    bool readFromSVOFile(const char* filename);
+    /// Writes the tree, or the subtree at element, to a temporary file that replaces filename once it is complete and
+    /// synced to disk, so a crash while saving never leaves a partial file behind
+    /// \param lockedUsecs if not NULL, set to the time spent holding the tree lock, which is 0 for snapshot read trees
+    /// \return false if the file could not be written
+    bool writeToSVOFile(const char* filename, OctreeElement* element = NULL, quint64* lockedUsecs = NULL);
+    /// \param readThreads the threads to read the subtrees of the file on, for trees that support it, see
+    /// getFixedElementDataBytes(). The elements are changed on those threads, so any update hooks are called there.
+    bool readFromSVOFile(const char* filename, int readThreads = 1);
     
 
     unsigned long getOctreeElementsCount();
@@ -311,6 +366,10 @@ public:
 
     bool recurseElementWithOperator(OctreeElement* element, RecurseOctreeOperator* operatorObject, int recursionCount = 0);
 
+    void recurseElementInViewWithOperation(OctreeElement* element, const ViewFrustum& viewFrustum,
+                ViewFrustum::location location, float furthestDistance, RecurseOctreeInViewOperation operation,
+                void* extraData, int recursionCount = 0);
+
     bool getIsViewing() const { return _isViewing; }
     void setIsViewing(bool isViewing) { _isViewing = isViewing; }
     
@@ -331,14 +390,22 @@ protected:
                                      EncodeBitstreamParams& params, int& currentEncodeLevel,
                                      const ViewFrustum::location& parentLocationThisView) const;
 
+    int encodeTreeBitstreamRecursionWithCache(OctreeElement* element,
+                                              OctreePacketData* packetData, OctreeElementBag& bag,
+                                              EncodeBitstreamParams& params, int& currentEncodeLevel) const;
+
     static bool countOctreeElementsOperation(OctreeElement* element, void* extraData);
 
     OctreeElement* nodeForOctalCode(OctreeElement* ancestorElement, const unsigned char* needleCode, OctreeElement** parentOfFoundElement) const;
     OctreeElement* createMissingElement(OctreeElement* lastParentElement, const unsigned char* codeToReach);
     int readElementData(OctreeElement *destinationElement, const unsigned char* nodeData,
                 int bufferSizeBytes, ReadBitstreamToTreeParams& args);
+    /// \return false if the bitstream can't be read in parallel, and nothing was read
+    bool readSubtreesInParallel(const unsigned char* bitstream, unsigned long int bufferSizeBytes,
+                                ReadBitstreamToTreeParams& args, int readThreads);
 
     OctreeElement* _rootElement;
+    OctreeElementIndex* _elementIndex;
 
     bool _isDirty;
     bool _shouldReaverage;
@@ -33,6 +33,9 @@ OctreeEditPacketSender::OctreeEditPacketSender() :
 }
 
 OctreeEditPacketSender::~OctreeEditPacketSender() {
+    // stop the pacer from sending for us before the packets we hold back go away
+    terminate();
+
     _pendingPacketsLock.lock();
     while (!_preServerSingleMessagePackets.empty()) {
         EditPacketBuffer* packet = _preServerSingleMessagePackets.front();
@@ -176,6 +179,7 @@ void OctreeEditPacketSender::queuePendingPacketToNodes(PacketType type, unsigned
             _preServerSingleMessagePackets.erase(_preServerSingleMessagePackets.begin());
         }
         _pendingPacketsLock.unlock();
+        packetsToPrepareHeld();
     }
 }
 
@@ -237,6 +241,7 @@ void OctreeEditPacketSender::queueOctreeEditMessage(PacketType type, unsigned ch
                 _preServerPackets.erase(_preServerPackets.begin());
             }
             _pendingPacketsLock.unlock();
+            packetsToPrepareHeld();
         }
         return; // bail early
     }
@@ -339,14 +344,23 @@ void OctreeEditPacketSender::initializePacket(EditPacketBuffer& packetBuffer, Pa
 }
 
 bool OctreeEditPacketSender::process() {
+    prepareToSend();
+
+    // base class does most of the work.
+    return PacketSender::process();
+}
+
+void OctreeEditPacketSender::prepareToSend() {
     // if we have server jurisdiction details, and we have pending pre-jurisdiction packets, then process those
     // before doing our normal process step. This processPreJurisdictionPackets()
-    if (serversExist() && (!_preServerPackets.empty() || !_preServerSingleMessagePackets.empty() )) {
+    if (hasPacketsToPrepare() && serversExist()) {
         processPreServerExistsPackets();
     }
+}
 
-    // base class does most of the work.
-    return PacketSender::process();
+bool OctreeEditPacketSender::hasPacketsToPrepare() {
+    QMutexLocker locker(&_pendingPacketsLock);
+    return !_preServerPackets.empty() || !_preServerSingleMessagePackets.empty();
 }
 
 void OctreeEditPacketSender::processNackPacket(const QByteArray& packet) {
@@ -105,6 +105,9 @@ protected:
     
     void processPreServerExistsPackets();
 
+    virtual void prepareToSend();
+    virtual bool hasPacketsToPrepare();
+
     // These are packets which are destined from know servers but haven't been released because they're still too small
     QHash<QUuid, EditPacketBuffer> _pendingEditPackets;
     
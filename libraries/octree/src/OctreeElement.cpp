@@ -13,7 +13,14 @@
 #include <cstring>
 #include <stdio.h>
 
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
 #include <QtCore/QDebug>
+#include <QtCore/QMutexLocker>
+#include <QtCore/QThread>
+#include <QtCore/QThreadStorage>
 
 #include <NodeList.h>
 #include <PerfStat.h>
@@ -23,18 +30,70 @@
 #include "OctalCode.h"
 #include "OctreeConstants.h"
 #include "OctreeElement.h"
+#include "OctreeElementIndex.h"
+#include "OctreeElementReclaimer.h"
+#include "OctreeElementSlab.h"
 #include "Octree.h"
 #include "SharedUtil.h"
 
-quint64 OctreeElement::_voxelMemoryUsage = 0;
-quint64 OctreeElement::_octcodeMemoryUsage = 0;
-quint64 OctreeElement::_externalChildrenMemoryUsage = 0;
-quint64 OctreeElement::_voxelNodeCount = 0;
-quint64 OctreeElement::_voxelNodeLeafCount = 0;
+OctreeElementStatistics::OctreeElementStatistics() :
+    nodeCount(0),
+    leafCount(0),
+    voxelMemoryUsage(0),
+    octcodeMemoryUsage(0),
+    externalChildrenMemoryUsage(0),
+    externalChildrenCount(0)
+{
+    memset(childrenCount, 0, sizeof(childrenCount));
+}
+
+void OctreeElementStatistics::add(const OctreeElementStatistics& other) {
+    // a thread's counts may have gone below zero, which wraps around, and wraps back when added
+    nodeCount += other.nodeCount;
+    leafCount += other.leafCount;
+    voxelMemoryUsage += other.voxelMemoryUsage;
+    octcodeMemoryUsage += other.octcodeMemoryUsage;
+    externalChildrenMemoryUsage += other.externalChildrenMemoryUsage;
+    externalChildrenCount += other.externalChildrenCount;
+    for (int i = 0; i <= NUMBER_OF_CHILDREN; i++) {
+        childrenCount[i] += other.childrenCount[i];
+    }
+}
+
+OctreeElementStatistics OctreeElement::_statistics;
+QAtomicInt OctreeElement::_threadStatisticsCount;
+
+static QThreadStorage<OctreeElementStatistics*> threadStatistics;
+static QMutex threadStatisticsMutex;
 
 void OctreeElement::resetPopulationStatistics() {
-    _voxelNodeCount = 0;
-    _voxelNodeLeafCount = 0;
+    _statistics.nodeCount = 0;
+    _statistics.leafCount = 0;
+}
+
+void OctreeElement::beginThreadStatistics() {
+    threadStatistics.setLocalData(new OctreeElementStatistics());
+    _threadStatisticsCount.fetchAndAddOrdered(1);
+}
+
+void OctreeElement::endThreadStatistics() {
+    {
+        QMutexLocker locker(&threadStatisticsMutex);
+        _statistics.add(*threadStatistics.localData());
+    }
+    _threadStatisticsCount.fetchAndAddOrdered(-1);
+    threadStatistics.setLocalData(NULL);
+}
+
+OctreeElementStatistics& OctreeElement::statistics() {
+    // only look for this thread's own while some thread has them, which is only while a tree is loaded in parallel
+    if (_threadStatisticsCount.load() > 0 && threadStatistics.hasLocalData()) {
+        OctreeElementStatistics* localStatistics = threadStatistics.localData();
+        if (localStatistics) {
+            return *localStatistics;
+        }
+    }
+    return _statistics;
 }
 
 OctreeElement::OctreeElement() {
@@ -48,65 +107,52 @@ void OctreeElement::init(unsigned char * octalCode) {
         octalCode = new unsigned char[1];
         *octalCode = 0;
     }
-    _voxelNodeCount++;
-    _voxelNodeLeafCount++; // all nodes start as leaf nodes
+    OctreeElementStatistics& elementStatistics = statistics();
+    elementStatistics.nodeCount++;
+    elementStatistics.leafCount++; // all nodes start as leaf nodes
 
 
     size_t octalCodeLength = bytesRequiredForCodeLength(numberOfThreeBitSectionsInCode(octalCode));
     if (octalCodeLength > sizeof(_octalCode)) {
-        _octalCode.pointer = octalCode;
+        // the long codes come from a slab too, so they sit near the elements rather than wherever the heap put them
+        OctreeElementSlab* slab = OctreeElementSlab::forSize(octalCodeLength);
+        _octalCode.pointer = static_cast<unsigned char*>(slab->allocate());
+        memcpy(_octalCode.pointer, octalCode, octalCodeLength);
         _octcodePointer = true;
-        _octcodeMemoryUsage += octalCodeLength;
+        elementStatistics.octcodeMemoryUsage += slab->getBlockSize();
     } else {
         _octcodePointer = false;
         memcpy(_octalCode.buffer, octalCode, octalCodeLength);
-        delete[] octalCode;
     }
+    delete[] octalCode;
 
-    // set up the _children union
     _childBitmask = 0;
-    _childrenExternal = false;
-
-#ifdef BLENDED_UNION_CHILDREN
-    _children.external = NULL;
-    _singleChildrenCount++;
-#endif
-    _childrenCount[0]++;
-
-    // default pointers to child nodes to NULL
-#ifdef HAS_AUDIT_CHILDREN
-    for (int i = 0; i < NUMBER_OF_CHILDREN; i++) {
-        _childrenArray[i] = NULL;
-    }
-#endif // def HAS_AUDIT_CHILDREN
-
-#ifdef SIMPLE_CHILD_ARRAY
-    for (int i = 0; i < NUMBER_OF_CHILDREN; i++) {
-        _simpleChildArray[i] = NULL;
-    }
-#endif
-
-#ifdef SIMPLE_EXTERNAL_CHILDREN
-    _children.single = NULL;
-#endif
+    _children = 0;
+    _childrenVersion.store(0);
+    elementStatistics.childrenCount[0]++;
 
     _isDirty = true;
     _shouldRender = false;
+    _isRetired = false;
+    _elementIndexNumber = NO_ELEMENT_INDEX;
     _sourceUUIDKey = 0;
     calculateAACube();
     markWithChangedTime();
 }
 
 OctreeElement::~OctreeElement() {
-    notifyDeleteHooks();
-    _voxelNodeCount--;
+    if (!_isRetired) {
+        notifyDeleteHooks();
+    }
+    OctreeElementStatistics& elementStatistics = statistics();
+    elementStatistics.nodeCount--;
     if (isLeaf()) {
-        _voxelNodeLeafCount--;
+        elementStatistics.leafCount--;
     }
 
     if (_octcodePointer) {
-        _octcodeMemoryUsage -= bytesRequiredForCodeLength(numberOfThreeBitSectionsInCode(getOctalCode()));
-        delete[] _octalCode.pointer;
+        elementStatistics.octcodeMemoryUsage -= OctreeElementSlab::slabFor(_octalCode.pointer)->getBlockSize();
+        OctreeElementSlab::release(_octalCode.pointer);
     }
 
     // delete all of this node's children, this also takes care of all population tracking data
@@ -133,12 +179,15 @@ void OctreeElement::handleSubtreeChanged(Octree* myTree) {
     markWithChangedTime();
 }
 
-const uint16_t KEY_FOR_NULL = 0;
 uint16_t OctreeElement::_nextUUIDKey = KEY_FOR_NULL + 1; // start at 1, 0 is reserved for NULL
 std::map<QString, uint16_t> OctreeElement::_mapSourceUUIDsToKeys;
 std::map<uint16_t, QString> OctreeElement::_mapKeysToSourceUUIDs;
 
 void OctreeElement::setSourceUUID(const QUuid& sourceUUID) {
+    _sourceUUIDKey = keyForSourceUUID(sourceUUID);
+}
+
+uint16_t OctreeElement::keyForSourceUUID(const QUuid& sourceUUID) {
     uint16_t key;
     QString sourceUUIDString = sourceUUID.toString();
     if (_mapSourceUUIDsToKeys.end() != _mapSourceUUIDsToKeys.find(sourceUUIDString)) {
@@ -149,7 +198,7 @@ void OctreeElement::setSourceUUID(const QUuid& sourceUUID) {
         _mapSourceUUIDsToKeys[sourceUUIDString] = key;
         _mapKeysToSourceUUIDs[key] = sourceUUIDString;
     }
-    _sourceUUIDKey = key;
+    return key;
 }
 
 QUuid OctreeElement::getSourceUUID() const {
@@ -204,20 +253,17 @@ void OctreeElement::calculateAACube() {
 void OctreeElement::deleteChildAtIndex(int childIndex) {
     OctreeElement* childAt = getChildAtIndex(childIndex);
     if (childAt) {
-        //qDebug("deleteChildAtIndex()... about to call delete childAt=%p",childAt);
-        delete childAt;
+        // unlink the child before retiring it, so that snapshot readers that start from here on can't reach it
         setChildAtIndex(childIndex, NULL);
+        OctreeElementReclaimer::retire(childAt);
         _isDirty = true;
         markWithChangedTime();
 
         // after deleting the child, check to see if we're a leaf
         if (isLeaf()) {
-            _voxelNodeLeafCount++;
+            statistics().leafCount++;
         }
     }
-#ifdef HAS_AUDIT_CHILDREN
-    auditChildren("deleteChildAtIndex()");
-#endif // def HAS_AUDIT_CHILDREN
 }
 
 // does not delete the node!
@@ -225,418 +271,171 @@ OctreeElement* OctreeElement::removeChildAtIndex(int childIndex) {
     OctreeElement* returnedChild = getChildAtIndex(childIndex);
     if (returnedChild) {
         setChildAtIndex(childIndex, NULL);
+        if (_elementIndexNumber != NO_ELEMENT_INDEX) {
+            // the caller keeps the child, which can no longer be found from its octal code
+            OctreeElementIndex::forNumber(_elementIndexNumber)->removeSubtree(returnedChild);
+        }
         _isDirty = true;
         markWithChangedTime();
 
         // after removing the child, check to see if we're a leaf
         if (isLeaf()) {
-            _voxelNodeLeafCount++;
+            statistics().leafCount++;
         }
     }
-
-#ifdef HAS_AUDIT_CHILDREN
-    auditChildren("removeChildAtIndex()");
-#endif // def HAS_AUDIT_CHILDREN
     return returnedChild;
 }
 
-#ifdef HAS_AUDIT_CHILDREN
-void OctreeElement::auditChildren(const char* label) const {
-    bool auditFailed = false;
-    for (int childIndex = 0; childIndex < NUMBER_OF_CHILDREN; childIndex++) {
-        OctreeElement* testChildNew = getChildAtIndex(childIndex);
-        OctreeElement* testChildOld = _childrenArray[childIndex];
-
-        if (testChildNew != testChildOld) {
-            auditFailed = true;
-        }
-    }
-
-    const bool alwaysReport = false; // set this to true to get additional debugging
-    if (alwaysReport || auditFailed) {
-        qDebug("%s... auditChildren() %s <<<<", label, (auditFailed ? "FAILED" : "PASSED"));
-        qDebug("    _childrenExternal=%s", debug::valueOf(_childrenExternal));
-        qDebug("    childCount=%d", getChildCount());
-
-        QDebug bitOutput = qDebug().nospace();
-        bitOutput << "    _childBitmask=";
-        outputBits(_childBitmask, bitOutput);
-
-
-        for (int childIndex = 0; childIndex < NUMBER_OF_CHILDREN; childIndex++) {
-            OctreeElement* testChildNew = getChildAtIndex(childIndex);
-            OctreeElement* testChildOld = _childrenArray[childIndex];
-
-            qDebug("child at index %d... testChildOld=%p testChildNew=%p %s",
-                    childIndex, testChildOld, testChildNew ,
-                    ((testChildNew != testChildOld) ? " DOES NOT MATCH <<<< BAD <<<<" : " - OK ")
-            );
-        }
-        qDebug("%s... auditChildren() <<<< DONE <<<<", label);
-    }
-}
-#endif // def HAS_AUDIT_CHILDREN
-
-
 quint64 OctreeElement::_getChildAtIndexTime = 0;
 quint64 OctreeElement::_getChildAtIndexCalls = 0;
 quint64 OctreeElement::_setChildAtIndexTime = 0;
 quint64 OctreeElement::_setChildAtIndexCalls = 0;
 
-#ifdef BLENDED_UNION_CHILDREN
-quint64 OctreeElement::_singleChildrenCount = 0;
-quint64 OctreeElement::_twoChildrenOffsetCount = 0;
-quint64 OctreeElement::_twoChildrenExternalCount = 0;
-quint64 OctreeElement::_threeChildrenOffsetCount = 0;
-quint64 OctreeElement::_threeChildrenExternalCount = 0;
-quint64 OctreeElement::_couldStoreFourChildrenInternally = 0;
-quint64 OctreeElement::_couldNotStoreFourChildrenInternally = 0;
-#endif
+// _children keeps up to two slab indices itself, the first one shifted past the flag bits and the second one in the
+// upper half. With more children it points at a block of indices, which is at least SLAB_BLOCK_ALIGNMENT aligned, so
+// the flags fit in the low bits of the pointer. Everything a reader needs to decide how to read the children is in the
+// one word, so a reader that races a writer reads something harmless, and then retries.
+const quint64 CHILDREN_EXTERNAL_FLAG = 0x1;
+const quint64 CHILDREN_LARGE_BLOCK_FLAG = 0x2;
+const quint64 CHILDREN_FLAGS = CHILDREN_EXTERNAL_FLAG | CHILDREN_LARGE_BLOCK_FLAG;
+const int CHILDREN_FLAG_BITS = 2;
 
-quint64 OctreeElement::_externalChildrenCount = 0;
-quint64 OctreeElement::_childrenCount[NUMBER_OF_CHILDREN + 1] = { 0, 0, 0, 0, 0, 0, 0, 0, 0 };
+const int MAX_INLINE_CHILDREN = 2;
+const int SMALL_CHILD_BLOCK_ENTRIES = 4;
+const int LARGE_CHILD_BLOCK_ENTRIES = NUMBER_OF_CHILDREN;
 
-OctreeElement* OctreeElement::getChildAtIndex(int childIndex) const {
-#ifdef SIMPLE_CHILD_ARRAY
-    return _simpleChildArray[childIndex];
-#endif // SIMPLE_CHILD_ARRAY
-
-#ifdef SIMPLE_EXTERNAL_CHILDREN
-    int childCount = getChildCount();
-
-    switch (childCount) {
-        case 0: {
-            return NULL;
-        } break;
-
-        case 1: {
-            // if our single child is the one being requested, return it, otherwise
-            // return null
-            int firstIndex = getNthBit(_childBitmask, 1);
-            if (firstIndex == childIndex) {
-                return _children.single;
-            } else {
-                return NULL;
-            }
-        } break;
+static inline quint32* childBlock(quint64 children) {
+    return reinterpret_cast<quint32*>(static_cast<quintptr>(children & ~CHILDREN_FLAGS));
+}
 
-        default : {
-            return _children.external[childIndex];
-        } break;
-    }
-#endif // def SIMPLE_EXTERNAL_CHILDREN
+static inline int childBlockEntries(quint64 children) {
+    return (children & CHILDREN_LARGE_BLOCK_FLAG) ? LARGE_CHILD_BLOCK_ENTRIES : SMALL_CHILD_BLOCK_ENTRIES;
+}
 
-#ifdef BLENDED_UNION_CHILDREN
-    PerformanceWarning warn(false,"getChildAtIndex",false,&_getChildAtIndexTime,&_getChildAtIndexCalls);
-    OctreeElement* result = NULL;
-    int childCount = getChildCount();
+void* OctreeElement::operator new(size_t size) {
+    return OctreeElementSlab::forSize(size)->allocate();
+}
 
-#ifdef HAS_AUDIT_CHILDREN
-    const char* caseStr = NULL;
-#endif
+void OctreeElement::operator delete(void* element) {
+    OctreeElementSlab::release(element);
+}
 
-    switch (childCount) {
-        case 0:
-#ifdef HAS_AUDIT_CHILDREN
-            caseStr = "0 child case";
-#endif
-            break;
-        case 1: {
-#ifdef HAS_AUDIT_CHILDREN
-            caseStr = "1 child case";
-#endif
-            int indexOne = getNthBit(_childBitmask, 1);
-            if (indexOne == childIndex) {
-                result = _children.single;
-            }
-        } break;
-        case 2: {
-#ifdef HAS_AUDIT_CHILDREN
-            caseStr = "2 child case";
-#endif
-            int indexOne = getNthBit(_childBitmask, 1);
-            int indexTwo = getNthBit(_childBitmask, 2);
-
-            if (_childrenExternal) {
-                //assert(_children.external);
-                if (indexOne == childIndex) {
-                    result = _children.external[0];
-                } else if (indexTwo == childIndex) {
-                    result = _children.external[1];
-                }
-            } else {
-                if (indexOne == childIndex) {
-                    int32_t offset = _children.offsetsTwoChildren[0];
-                    result = (OctreeElement*)((uint8_t*)this + offset);
-                } else if (indexTwo == childIndex) {
-                    int32_t offset = _children.offsetsTwoChildren[1];
-                    result = (OctreeElement*)((uint8_t*)this + offset);
-                }
-            }
-        } break;
-        case 3: {
-#ifdef HAS_AUDIT_CHILDREN
-            caseStr = "3 child case";
-#endif
-            int indexOne = getNthBit(_childBitmask, 1);
-            int indexTwo = getNthBit(_childBitmask, 2);
-            int indexThree = getNthBit(_childBitmask, 3);
-
-            if (_childrenExternal) {
-                //assert(_children.external);
-                if (indexOne == childIndex) {
-                    result = _children.external[0];
-                } else if (indexTwo == childIndex) {
-                    result = _children.external[1];
-                } else if (indexThree == childIndex) {
-                    result = _children.external[2];
-                } else {
-                }
-            } else {
-                int64_t offsetOne, offsetTwo, offsetThree;
-                decodeThreeOffsets(offsetOne, offsetTwo, offsetThree);
-
-                if (indexOne == childIndex) {
-                    result = (OctreeElement*)((uint8_t*)this + offsetOne);
-                } else if (indexTwo == childIndex) {
-                    result = (OctreeElement*)((uint8_t*)this + offsetTwo);
-                } else if (indexThree == childIndex) {
-                    result = (OctreeElement*)((uint8_t*)this + offsetThree);
-                }
-            }
-        } break;
-        default: {
-#ifdef HAS_AUDIT_CHILDREN
-            caseStr = "default";
-#endif
-            // if we have 4 or more, we know we're in external mode, so we just need to figure out which
-            // slot in our external array this child is.
-            if (oneAtBit(_childBitmask, childIndex)) {
-                childCount = getChildCount();
-                for (int ordinal = 1; ordinal <= childCount; ordinal++) {
-                    int index = getNthBit(_childBitmask, ordinal);
-                    if (index == childIndex) {
-                        int externalIndex = ordinal-1;
-                        if (externalIndex < childCount && externalIndex >= 0) {
-                            result = _children.external[externalIndex];
-                        } else {
-                            qDebug("getChildAtIndex() attempt to access external client out of "
-                                "bounds externalIndex=%d <<<<<<<<<< WARNING!!!", externalIndex);
-                        }
-                        break;
-                    }
-                }
-            }
-        } break;
-    }
-#ifdef HAS_AUDIT_CHILDREN
-    if (result != _childrenArray[childIndex]) {
-        qDebug("getChildAtIndex() case:%s result<%p> != _childrenArray[childIndex]<%p> <<<<<<<<<< WARNING!!!",
-            caseStr, result,_childrenArray[childIndex]);
-    }
-#endif // def HAS_AUDIT_CHILDREN
-    return result;
+// keeps the plain reads a seqlock reader made of the children from moving after its re-check of the version, which an
+// acquire load of the version doesn't stop
+static inline void childrenReadFence() {
+#ifdef _MSC_VER
+    // the x86 processors MSVC builds for keep loads in order, so only the compiler has to be kept from moving them
+    _ReadWriteBarrier();
+#else
+    __sync_synchronize();
 #endif
 }
 
-#ifdef BLENDED_UNION_CHILDREN
-void OctreeElement::storeTwoChildren(OctreeElement* childOne, OctreeElement* childTwo) {
-    int64_t offsetOne = (uint8_t*)childOne - (uint8_t*)this;
-    int64_t offsetTwo = (uint8_t*)childTwo - (uint8_t*)this;
-
-    const int64_t minOffset = std::numeric_limits<int32_t>::min();
-    const int64_t maxOffset = std::numeric_limits<int32_t>::max();
-
-    bool forceExternal = true;
-    if (!forceExternal && isBetween(offsetOne, maxOffset, minOffset) && isBetween(offsetTwo, maxOffset, minOffset)) {
-        // if previously external, then clean it up...
-        if (_childrenExternal) {
-            //assert(_children.external);
-            const int previousChildCount = 2;
-            _externalChildrenMemoryUsage -= previousChildCount * sizeof(OctreeElement*);
-            delete[] _children.external;
-            _children.external = NULL; // probably not needed!
-            _childrenExternal = false;
+OctreeElement* OctreeElement::getChildAtIndex(int childIndex) const {
+    // a writer changing our children bumps the version before and after, so if the version was even and didn't change
+    // while we read the child, we read a consistent child
+    const int SPINS_BEFORE_YIELD = 16;
+    int spins = 0;
+    forever {
+        int version = _childrenVersion.loadAcquire();
+        if (version & 1) {
+            // the writer may have been preempted mid-change, so give up the CPU rather than spin on it
+            if (++spins >= SPINS_BEFORE_YIELD) {
+                QThread::yieldCurrentThread();
+            }
+            continue;
         }
-
-        // encode in union
-        _children.offsetsTwoChildren[0] = offsetOne;
-        _children.offsetsTwoChildren[1] = offsetTwo;
-
-        _twoChildrenOffsetCount++;
-    } else {
-        // encode in array
-
-        // if not previously external, then allocate appropriately
-        if (!_childrenExternal) {
-            _childrenExternal = true;
-            const int newChildCount = 2;
-            _externalChildrenMemoryUsage += newChildCount * sizeof(OctreeElement*);
-            _children.external = new OctreeElement*[newChildCount];
-            memset(_children.external, 0, sizeof(OctreeElement*) * newChildCount);
+        OctreeElement* child = readChildAtIndex(childIndex);
+        childrenReadFence();
+        if (_childrenVersion.loadAcquire() == version) {
+            return child;
         }
-        _children.external[0] = childOne;
-        _children.external[1] = childTwo;
-        _twoChildrenExternalCount++;
     }
 }
 
-void OctreeElement::retrieveTwoChildren(OctreeElement*& childOne, OctreeElement*& childTwo) {
-    // If we previously had an external array, then get the
-    if (_childrenExternal) {
-        childOne = _children.external[0];
-        childTwo = _children.external[1];
-        delete[] _children.external;
-        _children.external = NULL; // probably not needed!
-        _childrenExternal = false;
-        _twoChildrenExternalCount--;
-        const int newChildCount = 2;
-        _externalChildrenMemoryUsage -= newChildCount * sizeof(OctreeElement*);
-    } else {
-        int64_t offsetOne = _children.offsetsTwoChildren[0];
-        int64_t offsetTwo = _children.offsetsTwoChildren[1];
-        childOne = (OctreeElement*)((uint8_t*)this + offsetOne);
-        childTwo = (OctreeElement*)((uint8_t*)this + offsetTwo);
-        _twoChildrenOffsetCount--;
+OctreeElement* OctreeElement::readChildAtIndex(int childIndex) const {
+    unsigned char childBitmask = _childBitmask;
+    if (!oneAtBit(childBitmask, childIndex)) {
+        return NULL;
     }
-}
-
-void OctreeElement::decodeThreeOffsets(int64_t& offsetOne, int64_t& offsetTwo, int64_t& offsetThree) const {
-    const quint64 ENCODE_BITS = 21;
-    const quint64 ENCODE_MASK = 0xFFFFF;
-    const quint64 ENCODE_MASK_SIGN = 0x100000;
-
-    quint64 offsetEncodedOne = (_children.offsetsThreeChildrenEncoded >> (ENCODE_BITS * 2)) & ENCODE_MASK;
-    quint64 offsetEncodedTwo = (_children.offsetsThreeChildrenEncoded >> (ENCODE_BITS * 1)) & ENCODE_MASK;
-    quint64 offsetEncodedThree = (_children.offsetsThreeChildrenEncoded & ENCODE_MASK);
 
-    quint64 signEncodedOne = (_children.offsetsThreeChildrenEncoded >> (ENCODE_BITS * 2)) & ENCODE_MASK_SIGN;
-    quint64 signEncodedTwo = (_children.offsetsThreeChildrenEncoded >> (ENCODE_BITS * 1)) & ENCODE_MASK_SIGN;
-    quint64 signEncodedThree = (_children.offsetsThreeChildrenEncoded & ENCODE_MASK_SIGN);
+    // the children are kept in the order of their index, so this child comes after the ones with lower indices, which
+    // have the higher bits
+    int childPlace = numberOfOnes(childBitmask >> (NUMBER_OF_CHILDREN - childIndex));
 
-    bool oneNegative = signEncodedOne == ENCODE_MASK_SIGN;
-    bool twoNegative = signEncodedTwo == ENCODE_MASK_SIGN;
-    bool threeNegative = signEncodedThree == ENCODE_MASK_SIGN;
+    quint64 children = _children;
+    quint32 slabIndex;
+    if (children & CHILDREN_EXTERNAL_FLAG) {
+        if (childPlace >= childBlockEntries(children)) {
+            return NULL; // only when racing a writer
+        }
+        slabIndex = childBlock(children)[childPlace];
 
-    offsetOne = oneNegative ? -offsetEncodedOne : offsetEncodedOne;
-    offsetTwo = twoNegative ? -offsetEncodedTwo : offsetEncodedTwo;
-    offsetThree = threeNegative ? -offsetEncodedThree : offsetEncodedThree;
-}
+    } else if (childPlace == 0) {
+        slabIndex = (quint32)children >> CHILDREN_FLAG_BITS;
 
-void OctreeElement::encodeThreeOffsets(int64_t offsetOne, int64_t offsetTwo, int64_t offsetThree) {
-    const quint64 ENCODE_BITS = 21;
-    const quint64 ENCODE_MASK = 0xFFFFF;
-    const quint64 ENCODE_MASK_SIGN = 0x100000;
+    } else if (childPlace == 1) {
+        slabIndex = (quint32)(children >> 32);
 
-    quint64 offsetEncodedOne, offsetEncodedTwo, offsetEncodedThree;
-    if (offsetOne < 0) {
-        offsetEncodedOne = ((-offsetOne & ENCODE_MASK) | ENCODE_MASK_SIGN);
     } else {
-        offsetEncodedOne = offsetOne & ENCODE_MASK;
+        return NULL; // only when racing a writer
     }
-    offsetEncodedOne = offsetEncodedOne << (ENCODE_BITS * 2);
 
-    if (offsetTwo < 0) {
-        offsetEncodedTwo = ((-offsetTwo & ENCODE_MASK) | ENCODE_MASK_SIGN);
-    } else {
-        offsetEncodedTwo = offsetTwo & ENCODE_MASK;
-    }
-    offsetEncodedTwo = offsetEncodedTwo << ENCODE_BITS;
+    // our children are of our own kind, so they come from our slab
+    return static_cast<OctreeElement*>(OctreeElementSlab::slabFor(this)->blockAt(slabIndex));
+}
 
-    if (offsetThree < 0) {
-        offsetEncodedThree = ((-offsetThree & ENCODE_MASK) | ENCODE_MASK_SIGN);
-    } else {
-        offsetEncodedThree = offsetThree & ENCODE_MASK;
+quint32 OctreeElement::getChildSlabIndex(int childPlace) const {
+    if (_children & CHILDREN_EXTERNAL_FLAG) {
+        return childBlock(_children)[childPlace];
     }
-    _children.offsetsThreeChildrenEncoded = offsetEncodedOne | offsetEncodedTwo | offsetEncodedThree;
+    return (childPlace == 0) ? (quint32)_children >> CHILDREN_FLAG_BITS : (quint32)(_children >> 32);
 }
 
-void OctreeElement::storeThreeChildren(OctreeElement* childOne, OctreeElement* childTwo, OctreeElement* childThree) {
-    int64_t offsetOne = (uint8_t*)childOne - (uint8_t*)this;
-    int64_t offsetTwo = (uint8_t*)childTwo - (uint8_t*)this;
-    int64_t offsetThree = (uint8_t*)childThree - (uint8_t*)this;
-
-    const int64_t minOffset = -1048576; // what can fit in 20 bits // std::numeric_limits<int16_t>::min();
-    const int64_t maxOffset = 1048576; // what can fit in 20 bits  // std::numeric_limits<int16_t>::max();
-
-    bool forceExternal = true;
-    if (!forceExternal &&
-            isBetween(offsetOne, maxOffset, minOffset) &&
-            isBetween(offsetTwo, maxOffset, minOffset) &&
-            isBetween(offsetThree, maxOffset, minOffset)) {
-        // if previously external, then clean it up...
-        if (_childrenExternal) {
-            delete[] _children.external;
-            _children.external = NULL; // probably not needed!
-            _childrenExternal = false;
-            const int previousChildCount = 3;
-            _externalChildrenMemoryUsage -= previousChildCount * sizeof(OctreeElement*);
+void OctreeElement::storeChildSlabIndices(const quint32* childSlabIndices, int childCount) {
+    OctreeElementStatistics& elementStatistics = statistics();
+    quint64 previousChildren = _children;
+    quint32* previousBlock = (previousChildren & CHILDREN_EXTERNAL_FLAG) ? childBlock(previousChildren) : NULL;
+
+    if (childCount <= MAX_INLINE_CHILDREN) {
+        quint64 children = 0;
+        if (childCount > 0) {
+            children |= (quint64)childSlabIndices[0] << CHILDREN_FLAG_BITS;
         }
-        // encode in union
-        encodeThreeOffsets(offsetOne, offsetTwo, offsetThree);
-        _threeChildrenOffsetCount++;
-    } else {
-        // encode in array
-
-        // if not previously external, then allocate appropriately
-        if (!_childrenExternal) {
-            _childrenExternal = true;
-            const int newChildCount = 3;
-            _externalChildrenMemoryUsage += newChildCount * sizeof(OctreeElement*);
-            _children.external = new OctreeElement*[newChildCount];
-            memset(_children.external, 0, sizeof(OctreeElement*) * newChildCount);
+        if (childCount > 1) {
+            children |= (quint64)childSlabIndices[1] << 32;
         }
-        _children.external[0] = childOne;
-        _children.external[1] = childTwo;
-        _children.external[2] = childThree;
-        _threeChildrenExternalCount++;
-    }
-}
+        _children = children;
 
-void OctreeElement::retrieveThreeChildren(OctreeElement*& childOne, OctreeElement*& childTwo, OctreeElement*& childThree) {
-    // If we previously had an external array, then get the
-    if (_childrenExternal) {
-        childOne = _children.external[0];
-        childTwo = _children.external[1];
-        childThree = _children.external[2];
-        delete[] _children.external;
-        _children.external = NULL; // probably not needed!
-        _childrenExternal = false;
-        _threeChildrenExternalCount--;
-        _externalChildrenMemoryUsage -= 3 * sizeof(OctreeElement*);
     } else {
-        int64_t offsetOne, offsetTwo, offsetThree;
-        decodeThreeOffsets(offsetOne, offsetTwo, offsetThree);
+        int blockEntries = (childCount <= SMALL_CHILD_BLOCK_ENTRIES) ? SMALL_CHILD_BLOCK_ENTRIES : LARGE_CHILD_BLOCK_ENTRIES;
+        quint32* block;
+        if (previousBlock && childBlockEntries(previousChildren) == blockEntries) {
+            // a reader racing us may read a mix of the old and new indices, but will retry
+            block = previousBlock;
+            previousBlock = NULL;
+        } else {
+            block = static_cast<quint32*>(OctreeElementSlab::forSize(blockEntries * sizeof(quint32))->allocate());
+            elementStatistics.externalChildrenMemoryUsage += blockEntries * sizeof(quint32);
+            if (!previousBlock) {
+                elementStatistics.externalChildrenCount++;
+            }
+        }
+        memcpy(block, childSlabIndices, childCount * sizeof(quint32));
 
-        childOne = (OctreeElement*)((uint8_t*)this + offsetOne);
-        childTwo = (OctreeElement*)((uint8_t*)this + offsetTwo);
-        childThree = (OctreeElement*)((uint8_t*)this + offsetThree);
-        _threeChildrenOffsetCount--;
+        _children = reinterpret_cast<quintptr>(block) | CHILDREN_EXTERNAL_FLAG
+            | ((blockEntries == LARGE_CHILD_BLOCK_ENTRIES) ? CHILDREN_LARGE_BLOCK_FLAG : 0);
     }
-}
 
-void OctreeElement::checkStoreFourChildren(OctreeElement* childOne, OctreeElement* childTwo, OctreeElement* childThree, OctreeElement* childFour) {
-    int64_t offsetOne = (uint8_t*)childOne - (uint8_t*)this;
-    int64_t offsetTwo = (uint8_t*)childTwo - (uint8_t*)this;
-    int64_t offsetThree = (uint8_t*)childThree - (uint8_t*)this;
-    int64_t offsetFour = (uint8_t*)childFour - (uint8_t*)this;
-
-    const int64_t minOffset = std::numeric_limits<int16_t>::min();
-    const int64_t maxOffset = std::numeric_limits<int16_t>::max();
-
-    bool forceExternal = true;
-    if (!forceExternal &&
-            isBetween(offsetOne, maxOffset, minOffset) &&
-            isBetween(offsetTwo, maxOffset, minOffset) &&
-            isBetween(offsetThree, maxOffset, minOffset) &&
-            isBetween(offsetFour, maxOffset, minOffset)
-        ) {
-        _couldStoreFourChildrenInternally++;
-    } else {
-        _couldNotStoreFourChildrenInternally++;
+    if (previousBlock) {
+        // a snapshot reader may still be reading the old block
+        elementStatistics.externalChildrenMemoryUsage -= childBlockEntries(previousChildren) * sizeof(quint32);
+        if (!(_children & CHILDREN_EXTERNAL_FLAG)) {
+            elementStatistics.externalChildrenCount--;
+        }
+        OctreeElementReclaimer::retire(previousBlock);
     }
 }
-#endif
 
 void OctreeElement::deleteAllChildren() {
     // first delete all the OctreeElement objects...
@@ -647,468 +446,62 @@ void OctreeElement::deleteAllChildren() {
         }
     }
 
-#ifdef BLENDED_UNION_CHILDREN
-    // now, reset our internal state and ANY and all population data
-    int childCount = getChildCount();
-    switch (childCount) {
-        case 0: {
-            _singleChildrenCount--;
-            _childrenCount[0]--;
-        } break;
-        case 1: {
-            _singleChildrenCount--;
-            _childrenCount[1]--;
-        } break;
-
-        case 2: {
-            if (_childrenExternal) {
-                _twoChildrenExternalCount--;
-            } else {
-                _twoChildrenOffsetCount--;
-            }
-            _childrenCount[2]--;
-        } break;
-
-        case 3: {
-            if (_childrenExternal) {
-                _threeChildrenExternalCount--;
-            } else {
-                _threeChildrenOffsetCount--;
-            }
-            _childrenCount[3]--;
-        } break;
-
-        default: {
-            _externalChildrenCount--;
-            _childrenCount[childCount]--;
-        } break;
-
-
-    }
-
-    // If we had externally stored children, clean them too.
-    if (_childrenExternal && _children.external) {
-        delete[] _children.external;
+    // ...then the block of their indices, nothing can be reading it once we are being deleted
+    OctreeElementStatistics& elementStatistics = statistics();
+    elementStatistics.childrenCount[getChildCount()]--;
+    if (_children & CHILDREN_EXTERNAL_FLAG) {
+        elementStatistics.externalChildrenMemoryUsage -= childBlockEntries(_children) * sizeof(quint32);
+        elementStatistics.externalChildrenCount--;
+        OctreeElementSlab::release(childBlock(_children));
     }
-    _children.single = NULL;
-#endif // BLENDED_UNION_CHILDREN
+    _children = 0;
 }
 
 void OctreeElement::setChildAtIndex(int childIndex, OctreeElement* child) {
-#ifdef SIMPLE_CHILD_ARRAY
-    int previousChildCount = getChildCount();
-    if (child) {
-        setAtBit(_childBitmask, childIndex);
-    } else {
-        clearAtBit(_childBitmask, childIndex);
-    }
-    int newChildCount = getChildCount();
-
-    // store the child in our child array
-    _simpleChildArray[childIndex] = child;
-
-    // track our population data
-    if (previousChildCount != newChildCount) {
-        _childrenCount[previousChildCount]--;
-        _childrenCount[newChildCount]++;
-    }
-#endif
+    // children are found in our own slab by their index, so they must be the same size as we are
+    assert(!child || OctreeElementSlab::slabFor(child) == OctreeElementSlab::slabFor(this));
 
-#ifdef SIMPLE_EXTERNAL_CHILDREN
+    _childrenVersion.fetchAndAddOrdered(1);
 
-    int firstIndex = getNthBit(_childBitmask, 1);
-    int secondIndex = getNthBit(_childBitmask, 2);
-
-    int previousChildCount = getChildCount();
-    if (child) {
-        setAtBit(_childBitmask, childIndex);
-    } else {
-        clearAtBit(_childBitmask, childIndex);
-    }
-    int newChildCount = getChildCount();
-
-    // track our population data
-    if (previousChildCount != newChildCount) {
-        _childrenCount[previousChildCount]--;
-        _childrenCount[newChildCount]++;
-    }
-
-    if ((previousChildCount == 0 || previousChildCount == 1) && newChildCount == 0) {
-        _children.single = NULL;
-    } else if (previousChildCount == 0 && newChildCount == 1) {
-        _children.single = child;
-    } else if (previousChildCount == 1 && newChildCount == 2) {
-        OctreeElement* previousChild = _children.single;
-        _children.external = new OctreeElement*[NUMBER_OF_CHILDREN];
-        memset(_children.external, 0, sizeof(OctreeElement*) * NUMBER_OF_CHILDREN);
-        _children.external[firstIndex] = previousChild;
-        _children.external[childIndex] = child;
-
-        _externalChildrenMemoryUsage += NUMBER_OF_CHILDREN * sizeof(OctreeElement*);
-
-    } else if (previousChildCount == 2 && newChildCount == 1) {
-        assert(!child); // we are removing a child, so this must be true!
-        OctreeElement* previousFirstChild = _children.external[firstIndex];
-        OctreeElement* previousSecondChild = _children.external[secondIndex];
-        delete[] _children.external;
-        _externalChildrenMemoryUsage -= NUMBER_OF_CHILDREN * sizeof(OctreeElement*);
-        if (childIndex == firstIndex) {
-            _children.single = previousSecondChild;
-        } else {
-            _children.single = previousFirstChild;
+    // collect the slab indices of the children as they will be, in the order of their index
+    quint32 childSlabIndices[NUMBER_OF_CHILDREN];
+    int childCount = 0;
+    int childPlace = 0;
+    for (int i = 0; i < NUMBER_OF_CHILDREN; i++) {
+        bool hadChild = oneAtBit(_childBitmask, i);
+        if (i == childIndex) {
+            if (child) {
+                childSlabIndices[childCount++] = OctreeElementSlab::slabFor(child)->indexOf(child);
+            }
+        } else if (hadChild) {
+            childSlabIndices[childCount++] = getChildSlabIndex(childPlace);
+        }
+        if (hadChild) {
+            childPlace++;
         }
-    } else {
-        _children.external[childIndex] = child;
     }
 
-#endif // def SIMPLE_EXTERNAL_CHILDREN
-
-#ifdef BLENDED_UNION_CHILDREN
-    PerformanceWarning warn(false,"setChildAtIndex",false,&_setChildAtIndexTime,&_setChildAtIndexCalls);
-
-    // Here's how we store things...
-    // If we have 0 or 1 children, then we just store them in the _children.single;
-    // If we have 2 children,
-    //     then if we can we store them as 32 bit signed offsets from our own this pointer,
-    //     _children.offsetsTwoChildren[0]-[1]
-    //     these are 32 bit offsets
-
-    unsigned char previousChildMask = _childBitmask;
     int previousChildCount = getChildCount();
     if (child) {
         setAtBit(_childBitmask, childIndex);
     } else {
         clearAtBit(_childBitmask, childIndex);
     }
-    int newChildCount = getChildCount();
 
     // track our population data
-    if (previousChildCount != newChildCount) {
-        _childrenCount[previousChildCount]--;
-        _childrenCount[newChildCount]++;
+    if (previousChildCount != childCount) {
+        OctreeElementStatistics& elementStatistics = statistics();
+        elementStatistics.childrenCount[previousChildCount]--;
+        elementStatistics.childrenCount[childCount]++;
     }
 
-    // If we had 0 children and we still have 0 children, then there is nothing to do.
-    if (previousChildCount == 0 && newChildCount == 0) {
-        // nothing to do...
-    } else if ((previousChildCount == 0 || previousChildCount == 1) && newChildCount == 1) {
-        // If we had 0 children, and we're setting our first child or if we had 1 child, or we're resetting the same child,
-        // then we can just store it in _children.single
-        _children.single = child;
-    } else if (previousChildCount == 1 && newChildCount == 0) {
-        // If we had 1 child, and we've removed our last child, then we can just store NULL in _children.single
-        _children.single = NULL;
-    } else if (previousChildCount == 1 && newChildCount == 2) {
-        // If we had 1 child, and we're adding a second child, then we need to determine
-        // if we can use offsets to store them
-
-        OctreeElement* childOne;
-        OctreeElement* childTwo;
-
-        if (getNthBit(previousChildMask, 1) < childIndex) {
-            childOne = _children.single;
-            childTwo = child;
-        } else {
-            childOne = child;
-            childTwo = _children.single;
-        }
-
-        _singleChildrenCount--;
-        storeTwoChildren(childOne, childTwo);
-    } else if (previousChildCount == 2 && newChildCount == 1) {
-        // If we had 2 children, and we're removing one, then we know we can go down to single mode
-        //assert(child == NULL); // this is the only logical case
-
-        int indexTwo = getNthBit(previousChildMask, 2);
-        bool keepChildOne = indexTwo == childIndex;
-
-        OctreeElement* childOne;
-        OctreeElement* childTwo;
-
-        retrieveTwoChildren(childOne, childTwo);
-
-        _singleChildrenCount++;
-
-        if (keepChildOne) {
-            _children.single = childOne;
-        } else {
-            _children.single = childTwo;
-        }
-    } else if (previousChildCount == 2 && newChildCount == 2) {
-        // If we had 2 children, and still have 2, then we know we are resetting one of our existing children
-
-        int indexOne = getNthBit(previousChildMask, 1);
-        bool replaceChildOne = indexOne == childIndex;
-
-        // Get the existing two children out of their encoding...
-        OctreeElement* childOne;
-        OctreeElement* childTwo;
-        retrieveTwoChildren(childOne, childTwo);
-
-        if (replaceChildOne) {
-            childOne = child;
-        } else {
-            childTwo = child;
-        }
-
-        storeTwoChildren(childOne, childTwo);
-
-    } else if (previousChildCount == 2 && newChildCount == 3) {
-        // If we had 2 children, and now have 3, then we know we are going to an external case...
-
-        // First, decode the children...
-        OctreeElement* childOne;
-        OctreeElement* childTwo;
-        OctreeElement* childThree;
-
-        // Get the existing two children out of their encoding...
-        retrieveTwoChildren(childOne, childTwo);
-
-        // determine order of the existing children
-        int indexOne = getNthBit(previousChildMask, 1);
-        int indexTwo = getNthBit(previousChildMask, 2);
-
-        if (childIndex < indexOne) {
-            childThree = childTwo;
-            childTwo = childOne;
-            childOne = child;
-        } else if (childIndex < indexTwo) {
-            childThree = childTwo;
-            childTwo = child;
-        } else {
-            childThree = child;
-        }
-        storeThreeChildren(childOne, childTwo, childThree);
-    } else if (previousChildCount == 3 && newChildCount == 2) {
-        // If we had 3 children, and now have 2, then we know we are going from an external case to a potential internal case
-
-        // We need to determine which children we had, and which one we got rid of...
-        int indexOne = getNthBit(previousChildMask, 1);
-        int indexTwo = getNthBit(previousChildMask, 2);
-
-        bool removeChildOne = indexOne == childIndex;
-        bool removeChildTwo = indexTwo == childIndex;
-
-        OctreeElement* childOne;
-        OctreeElement* childTwo;
-        OctreeElement* childThree;
-
-        // Get the existing two children out of their encoding...
-        retrieveThreeChildren(childOne, childTwo, childThree);
-
-        if (removeChildOne) {
-            childOne = childTwo;
-            childTwo = childThree;
-        } else if (removeChildTwo) {
-            childTwo = childThree;
-        } else {
-            // removing child three, nothing to do.
-        }
-
-        storeTwoChildren(childOne, childTwo);
-    } else if (previousChildCount == 3 && newChildCount == 3) {
-        // If we had 3 children, and now have 3, then we need to determine which item we're replacing...
-
-        // We need to determine which children we had, and which one we got rid of...
-        int indexOne = getNthBit(previousChildMask, 1);
-        int indexTwo = getNthBit(previousChildMask, 2);
-
-        bool replaceChildOne = indexOne == childIndex;
-        bool replaceChildTwo = indexTwo == childIndex;
-
-        OctreeElement* childOne;
-        OctreeElement* childTwo;
-        OctreeElement* childThree;
-
-        // Get the existing two children out of their encoding...
-        retrieveThreeChildren(childOne, childTwo, childThree);
-
-        if (replaceChildOne) {
-            childOne = child;
-        } else if (replaceChildTwo) {
-            childTwo = child;
-        } else {
-            childThree = child;
-        }
-
-        storeThreeChildren(childOne, childTwo, childThree);
-    } else if (previousChildCount == 3 && newChildCount == 4) {
-        // If we had 3 children, and now have 4, then we know we are going to an external case...
-
-        // First, decode the children...
-        OctreeElement* childOne;
-        OctreeElement* childTwo;
-        OctreeElement* childThree;
-        OctreeElement* childFour;
-
-        // Get the existing two children out of their encoding...
-        retrieveThreeChildren(childOne, childTwo, childThree);
-
-        // determine order of the existing children
-        int indexOne = getNthBit(previousChildMask, 1);
-        int indexTwo = getNthBit(previousChildMask, 2);
-        int indexThree = getNthBit(previousChildMask, 3);
-
-        if (childIndex < indexOne) {
-            childFour = childThree;
-            childThree = childTwo;
-            childTwo = childOne;
-            childOne = child;
-        } else if (childIndex < indexTwo) {
-            childFour = childThree;
-            childThree = childTwo;
-            childTwo = child;
-        } else if (childIndex < indexThree) {
-            childFour = childThree;
-            childThree = child;
-        } else {
-            childFour = child;
-        }
-
-        // now, allocate the external...
-        _childrenExternal = true;
-        const int newChildCount = 4;
-        _children.external = new OctreeElement*[newChildCount];
-        memset(_children.external, 0, sizeof(OctreeElement*) * newChildCount);
-
-        _externalChildrenMemoryUsage += newChildCount * sizeof(OctreeElement*);
-
-        _children.external[0] = childOne;
-        _children.external[1] = childTwo;
-        _children.external[2] = childThree;
-        _children.external[3] = childFour;
-        _externalChildrenCount++;
-    } else if (previousChildCount == 4 && newChildCount == 3) {
-        // If we had 4 children, and now have 3, then we know we are going from an external case to a potential internal case
-        //assert(_children.external && _childrenExternal && previousChildCount == 4);
-
-        // We need to determine which children we had, and which one we got rid of...
-        int indexOne = getNthBit(previousChildMask, 1);
-        int indexTwo = getNthBit(previousChildMask, 2);
-        int indexThree = getNthBit(previousChildMask, 3);
-
-        bool removeChildOne = indexOne == childIndex;
-        bool removeChildTwo = indexTwo == childIndex;
-        bool removeChildThree = indexThree == childIndex;
-
-        OctreeElement* childOne = _children.external[0];
-        OctreeElement* childTwo = _children.external[1];
-        OctreeElement* childThree = _children.external[2];
-        OctreeElement* childFour = _children.external[3];
-
-        if (removeChildOne) {
-            childOne = childTwo;
-            childTwo = childThree;
-            childThree = childFour;
-        } else if (removeChildTwo) {
-            childTwo = childThree;
-            childThree = childFour;
-        } else if (removeChildThree) {
-            childThree = childFour;
-        } else {
-            // removing child four, nothing to do.
-        }
-
-        // clean up the external children...
-        _childrenExternal = false;
-        delete[] _children.external;
-        _children.external = NULL;
-        _externalChildrenCount--;
-        _externalChildrenMemoryUsage -= previousChildCount * sizeof(OctreeElement*);
-        storeThreeChildren(childOne, childTwo, childThree);
-    } else if (previousChildCount == newChildCount) {
-        //assert(_children.external && _childrenExternal && previousChildCount >= 4);
-        //assert(previousChildCount == newChildCount);
-
-        // 4 or more children, one item being replaced, we know we're stored externally, we just need to find the one
-        // that needs to be replaced and replace it.
-        for (int ordinal = 1; ordinal <= 8; ordinal++) {
-            int index = getNthBit(previousChildMask, ordinal);
-            if (index == childIndex) {
-                // this is our child to be replaced
-                int nthChild = ordinal-1;
-                _children.external[nthChild] = child;
-                break;
-            }
-        }
-    } else if (previousChildCount < newChildCount) {
-        // Growing case... previous must be 4 or greater
-        //assert(_children.external && _childrenExternal && previousChildCount >= 4);
-        //assert(previousChildCount == newChildCount-1);
-
-        // 4 or more children, one item being added, we know we're stored externally, we just figure out where to insert
-        // this child pointer into our external list
-        OctreeElement** newExternalList = new OctreeElement*[newChildCount];
-        memset(newExternalList, 0, sizeof(OctreeElement*) * newChildCount);
-
-        int copiedCount = 0;
-        for (int ordinal = 1; ordinal <= newChildCount; ordinal++) {
-            int index = getNthBit(previousChildMask, ordinal);
-            if (index != -1 && index < childIndex) {
-                newExternalList[ordinal - 1] = _children.external[ordinal - 1];
-                copiedCount++;
-            } else {
+    storeChildSlabIndices(childSlabIndices, childCount);
 
-                // insert our new child here...
-                newExternalList[ordinal - 1] = child;
-
-                // if we didn't copy all of our previous children, then we need to
-                if (copiedCount < previousChildCount) {
-                    // our child needs to be inserted before this index, and everything else pushed out...
-                    for (int oldOrdinal = ordinal; oldOrdinal <= previousChildCount; oldOrdinal++) {
-                        newExternalList[oldOrdinal] = _children.external[oldOrdinal - 1];
-                    }
-                }
-                break;
-            }
-        }
-        delete[] _children.external;
-        _children.external = newExternalList;
-        _externalChildrenMemoryUsage -= previousChildCount * sizeof(OctreeElement*);
-        _externalChildrenMemoryUsage += newChildCount * sizeof(OctreeElement*);
-
-    } else if (previousChildCount > newChildCount) {
-        //assert(_children.external && _childrenExternal && previousChildCount >= 4);
-        //assert(previousChildCount == newChildCount+1);
-
-        // 4 or more children, one item being removed, we know we're stored externally, we just figure out which
-        // item to remove from our external list
-        OctreeElement** newExternalList = new OctreeElement*[newChildCount];
-
-        for (int ordinal = 1; ordinal <= previousChildCount; ordinal++) {
-            int index = getNthBit(previousChildMask, ordinal);
-            //assert(index != -1);
-            if (index < childIndex) {
-                newExternalList[ordinal - 1] = _children.external[ordinal - 1];
-            } else {
-                // our child needs to be removed from here, and everything else pulled in...
-                for (int moveOrdinal = ordinal; moveOrdinal <= newChildCount; moveOrdinal++) {
-                    newExternalList[moveOrdinal - 1] = _children.external[moveOrdinal];
-                }
-                break;
-            }
-        }
-        delete[] _children.external;
-        _children.external = newExternalList;
-        _externalChildrenMemoryUsage -= previousChildCount * sizeof(OctreeElement*);
-        _externalChildrenMemoryUsage += newChildCount * sizeof(OctreeElement*);
-    } else {
-        //assert(false);
-        qDebug("THIS SHOULD NOT HAPPEN previousChildCount == %d && newChildCount == %d",previousChildCount, newChildCount);
-    }
+    _childrenVersion.fetchAndAddOrdered(1);
 
-    // check to see if we could store these 4 children locally
-    if (getChildCount() == 4 && _childrenExternal && _children.external) {
-        checkStoreFourChildren(_children.external[0], _children.external[1], _children.external[2], _children.external[3]);
+    if (child && _elementIndexNumber != NO_ELEMENT_INDEX) {
+        OctreeElementIndex::forNumber(_elementIndexNumber)->addSubtree(child);
     }
-
-
-#ifdef HAS_AUDIT_CHILDREN
-    _childrenArray[childIndex] = child;
-    auditChildren("setChildAtIndex()");
-#endif // def HAS_AUDIT_CHILDREN
-
-#endif
 }
 
 
@@ -1117,7 +510,7 @@ OctreeElement* OctreeElement::addChildAtIndex(int childIndex) {
     if (!childAt) {
         // before adding a child, see if we're currently a leaf
         if (isLeaf()) {
-            _voxelNodeLeafCount--;
+            statistics().leafCount--;
         }
 
         unsigned char* newChildCode = childOctalCode(getOctalCode(), childIndex);
@@ -1197,6 +590,12 @@ ViewFrustum::location OctreeElement::inFrustum(const ViewFrustum& viewFrustum) c
     return viewFrustum.cubeInFrustum(cube);
 }
 
+void OctreeElement::childrenInFrustum(const ViewFrustum& viewFrustum, ChildCubeLocations& locations) const {
+    AACube cube = _cube; // use temporary cube so we can scale it
+    cube.scale(TREE_SCALE);
+    viewFrustum.childCubesInFrustum(cube, locations);
+}
+
 // There are two types of nodes for which we want to "render"
 // 1) Leaves that are in the LOD
 // 2) Non-leaves are more complicated though... usually you don't want to render them, but if their children
@@ -1207,10 +606,15 @@ ViewFrustum::location OctreeElement::inFrustum(const ViewFrustum& viewFrustum) c
 //    corner. We can use we can use this corner as our "voxel position" to do our distance calculations off of.
 //    By doing this, we don't need to test each child voxel's position vs the LOD boundary
 bool OctreeElement::calculateShouldRender(const ViewFrustum* viewFrustum, float voxelScaleSize, int boundaryLevelAdjust) const {
+    return hasContent()
+        && calculateShouldRenderAtDistance(furthestDistanceToCamera(*viewFrustum), voxelScaleSize, boundaryLevelAdjust);
+}
+
+bool OctreeElement::calculateShouldRenderAtDistance(float furthestDistance, float voxelScaleSize,
+                                                    int boundaryLevelAdjust) const {
     bool shouldRender = false;
     
     if (hasContent()) {
-        float furthestDistance = furthestDistanceToCamera(*viewFrustum);
         float childBoundary = boundaryDistanceForRenderLevel(getLevel() + 1 + boundaryLevelAdjust, voxelScaleSize);
         bool inChildBoundary = (furthestDistance <= childBoundary);
         if (hasDetailedContent() && inChildBoundary) {
@@ -1274,6 +678,10 @@ void OctreeElement::removeDeleteHook(OctreeElementDeleteHook* hook) {
 }
 
 void OctreeElement::notifyDeleteHooks() {
+    if (_elementIndexNumber != NO_ELEMENT_INDEX) {
+        OctreeElementIndex::forNumber(_elementIndexNumber)->remove(this);
+    }
+
     _deleteHooksLock.lockForRead();
     for (unsigned int i = 0; i < _deleteHooks.size(); i++) {
         _deleteHooks[i]->elementDeleted(this);
@@ -1281,6 +689,18 @@ void OctreeElement::notifyDeleteHooks() {
     _deleteHooksLock.unlock();
 }
 
+void OctreeElement::notifySubtreeDeleted() {
+    for (int i = 0; i < NUMBER_OF_CHILDREN; i++) {
+        OctreeElement* childAt = getChildAtIndex(i);
+        if (childAt) {
+            childAt->notifySubtreeDeleted();
+        }
+    }
+    // mark it first, so that a hook that checks isRetired() under its own lock won't pick it up again after this
+    _isRetired = true;
+    notifyDeleteHooks();
+}
+
 std::vector<OctreeElementUpdateHook*> OctreeElement::_updateHooks;
 
 void OctreeElement::addUpdateHook(OctreeElementUpdateHook* hook) {
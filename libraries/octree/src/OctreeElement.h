@@ -12,10 +12,7 @@
 #ifndef hifi_OctreeElement_h
 #define hifi_OctreeElement_h
 
-//#define HAS_AUDIT_CHILDREN
-//#define SIMPLE_CHILD_ARRAY
-#define SIMPLE_EXTERNAL_CHILDREN
-
+#include <QAtomicInt>
 #include <QReadWriteLock>
 
 #include <SharedUtil.h>
@@ -32,8 +29,26 @@ class OctreePacketData;
 class ReadBitstreamToTreeParams;
 class VoxelSystem;
 
+const uint16_t KEY_FOR_NULL = 0; // the source UUID key of elements without a source, which no source is given
+
 const float SMALLEST_REASONABLE_OCTREE_ELEMENT_SCALE = (1.0f / TREE_SCALE) / 10000.0f; // 1/10,000th of a meter
 
+/// The population and memory statistics of the elements
+class OctreeElementStatistics {
+public:
+    OctreeElementStatistics();
+
+    void add(const OctreeElementStatistics& other);
+
+    quint64 nodeCount;
+    quint64 leafCount;
+    quint64 voxelMemoryUsage;
+    quint64 octcodeMemoryUsage;
+    quint64 externalChildrenMemoryUsage;
+    quint64 externalChildrenCount;
+    quint64 childrenCount[NUMBER_OF_CHILDREN + 1];
+};
+
 // Callers who want delete hook callbacks should implement this class
 class OctreeElementDeleteHook {
 public:
@@ -48,6 +63,8 @@ public:
 
 
 class OctreeElement {
+    friend class OctreeElementIndex;
+    friend class OctreeElementReclaimer;
 
 protected:
     // can only be constructed by derived implementation
@@ -59,6 +76,10 @@ public:
     virtual void init(unsigned char * octalCode); /// Your subclass must call init on construction.
     virtual ~OctreeElement();
 
+    /// Elements of every subclass come from the OctreeElementSlab for their size
+    static void* operator new(size_t size);
+    static void operator delete(void* element);
+
     // methods you can and should override to implement your tree functionality
     
     /// Adds a child to the current element. Override this if there is additional child initialization your class needs.
@@ -132,11 +153,18 @@ public:
     float getEnclosingRadius() const;
     bool isInView(const ViewFrustum& viewFrustum) const { return inFrustum(viewFrustum) != ViewFrustum::OUTSIDE; }
     ViewFrustum::location inFrustum(const ViewFrustum& viewFrustum) const;
+
+    /// where the children's cubes are in the view and how far they are from the camera, whether the children exist or not
+    void childrenInFrustum(const ViewFrustum& viewFrustum, ChildCubeLocations& locations) const;
     float distanceToCamera(const ViewFrustum& viewFrustum) const; 
     float furthestDistanceToCamera(const ViewFrustum& viewFrustum) const;
 
     bool calculateShouldRender(const ViewFrustum* viewFrustum, 
                 float voxelSizeScale = DEFAULT_OCTREE_SIZE_SCALE, int boundaryLevelAdjust = 0) const;
+
+    /// calculateShouldRender() for an element whose furthestDistanceToCamera() is already known
+    bool calculateShouldRenderAtDistance(float furthestDistance,
+                float voxelSizeScale = DEFAULT_OCTREE_SIZE_SCALE, int boundaryLevelAdjust = 0) const;
     
     // points are assumed to be in Voxel Coordinates (not TREE_SCALE'd)
     float distanceSquareToPoint(const glm::vec3& point) const; // when you don't need the actual distance, use this.
@@ -145,6 +173,9 @@ public:
     bool isLeaf() const { return _childBitmask == 0; }
     int getChildCount() const { return numberOfOnes(_childBitmask); }
     void printDebugDetails(const char* label) const;
+    /// Is this element unlinked from its tree and waiting for the snapshot readers that may still use it to finish
+    bool isRetired() const { return _isRetired; }
+
     bool isDirty() const { return _isDirty; }
     void clearDirtyBit() { _isDirty = false; }
     void setDirtyBit() { _isDirty = true; }
@@ -159,10 +190,13 @@ public:
     
     
     void setSourceUUID(const QUuid& sourceID);
+    void setSourceUUIDKey(uint16_t sourceUUIDKey) { _sourceUUIDKey = sourceUUIDKey; }
     QUuid getSourceUUID() const;
     uint16_t getSourceUUIDKey() const { return _sourceUUIDKey; }
     bool matchesSourceUUID(const QUuid& sourceUUID) const;
     static uint16_t getSourceNodeUUIDKey(const QUuid& sourceUUID);
+    /// \return the key for the source, which is given one if it has none yet
+    static uint16_t keyForSourceUUID(const QUuid& sourceUUID);
 
     static void addDeleteHook(OctreeElementDeleteHook* hook);
     static void removeDeleteHook(OctreeElementDeleteHook* hook);
@@ -171,38 +205,29 @@ public:
     static void removeUpdateHook(OctreeElementUpdateHook* hook);
     
     static void resetPopulationStatistics();
-    static unsigned long getNodeCount() { return _voxelNodeCount; }
-    static unsigned long getInternalNodeCount() { return _voxelNodeCount - _voxelNodeLeafCount; }
-    static unsigned long getLeafNodeCount() { return _voxelNodeLeafCount; }
+    static unsigned long getNodeCount() { return _statistics.nodeCount; }
+    static unsigned long getInternalNodeCount() { return _statistics.nodeCount - _statistics.leafCount; }
+    static unsigned long getLeafNodeCount() { return _statistics.leafCount; }
+
+    static quint64 getVoxelMemoryUsage() { return _statistics.voxelMemoryUsage; }
+    static quint64 getOctcodeMemoryUsage() { return _statistics.octcodeMemoryUsage; }
+    static quint64 getExternalChildrenMemoryUsage() { return _statistics.externalChildrenMemoryUsage; }
+    static quint64 getTotalMemoryUsage() { return _statistics.voxelMemoryUsage + _statistics.octcodeMemoryUsage
+        + _statistics.externalChildrenMemoryUsage; }
 
-    static quint64 getVoxelMemoryUsage() { return _voxelMemoryUsage; }
-    static quint64 getOctcodeMemoryUsage() { return _octcodeMemoryUsage; }
-    static quint64 getExternalChildrenMemoryUsage() { return _externalChildrenMemoryUsage; }
-    static quint64 getTotalMemoryUsage() { return _voxelMemoryUsage + _octcodeMemoryUsage + _externalChildrenMemoryUsage; }
+    /// Has the statistics of the elements this thread changes kept apart from the other threads' until
+    /// endThreadStatistics(), for threads that populate separate parts of a tree at the same time
+    static void beginThreadStatistics();
+    static void endThreadStatistics();
 
     static quint64 getGetChildAtIndexTime() { return _getChildAtIndexTime; }
     static quint64 getGetChildAtIndexCalls() { return _getChildAtIndexCalls; }
     static quint64 getSetChildAtIndexTime() { return _setChildAtIndexTime; }
     static quint64 getSetChildAtIndexCalls() { return _setChildAtIndexCalls; }
 
-#ifdef BLENDED_UNION_CHILDREN
-    static quint64 getSingleChildrenCount() { return _singleChildrenCount; }
-    static quint64 getTwoChildrenOffsetCount() { return _twoChildrenOffsetCount; }
-    static quint64 getTwoChildrenExternalCount() { return _twoChildrenExternalCount; }
-    static quint64 getThreeChildrenOffsetCount() { return _threeChildrenOffsetCount; }
-    static quint64 getThreeChildrenExternalCount() { return _threeChildrenExternalCount; }
-    static quint64 getCouldStoreFourChildrenInternally() { return _couldStoreFourChildrenInternally; }
-    static quint64 getCouldNotStoreFourChildrenInternally() { return _couldNotStoreFourChildrenInternally; }
-#endif
-
-    static quint64 getExternalChildrenCount() { return _externalChildrenCount; }
-    static quint64 getChildrenCount(int childCount) { return _childrenCount[childCount]; }
-    
-#ifdef BLENDED_UNION_CHILDREN
-#ifdef HAS_AUDIT_CHILDREN
-    void auditChildren(const char* label) const;
-#endif // def HAS_AUDIT_CHILDREN
-#endif // def BLENDED_UNION_CHILDREN
+    /// the number of elements with more children than fit in the element itself
+    static quint64 getExternalChildrenCount() { return _statistics.externalChildrenCount; }
+    static quint64 getChildrenCount(int childCount) { return _statistics.childrenCount[childCount]; }
 
     enum ChildIndex {
         CHILD_BOTTOM_RIGHT_NEAR = 0,
@@ -237,19 +262,15 @@ public:
 protected:
 
     void deleteAllChildren();
+    OctreeElement* readChildAtIndex(int childIndex) const; /// getChildAtIndex() without retrying a racing writer
     void setChildAtIndex(int childIndex, OctreeElement* child);
 
-#ifdef BLENDED_UNION_CHILDREN
-    void storeTwoChildren(OctreeElement* childOne, OctreeElement* childTwo);
-    void retrieveTwoChildren(OctreeElement*& childOne, OctreeElement*& childTwo);
-    void storeThreeChildren(OctreeElement* childOne, OctreeElement* childTwo, OctreeElement* childThree);
-    void retrieveThreeChildren(OctreeElement*& childOne, OctreeElement*& childTwo, OctreeElement*& childThree);
-    void decodeThreeOffsets(int64_t& offsetOne, int64_t& offsetTwo, int64_t& offsetThree) const;
-    void encodeThreeOffsets(int64_t offsetOne, int64_t offsetTwo, int64_t offsetThree);
-    void checkStoreFourChildren(OctreeElement* childOne, OctreeElement* childTwo, OctreeElement* childThree, OctreeElement* childFour);
-#endif
+    quint32 getChildSlabIndex(int childPlace) const; /// the slab index of the child with childPlace children before it
+    void storeChildSlabIndices(const quint32* childSlabIndices, int childCount);
+
     void calculateAACube();
     void notifyDeleteHooks();
+    void notifySubtreeDeleted(); /// notifies the delete hooks for this element and all its descendants ahead of deleting them
     void notifyUpdateHooks();
 
     AACube _cube; /// Client and server, axis aligned box for bounds of this voxel, 48 bytes
@@ -262,30 +283,13 @@ protected:
 
     quint64 _lastChanged; /// Client and server, timestamp this node was last changed, 8 bytes
 
-    /// Client and server, pointers to child nodes, various encodings
-#ifdef SIMPLE_CHILD_ARRAY
-    OctreeElement* _simpleChildArray[8]; /// Only used when SIMPLE_CHILD_ARRAY is enabled
-#endif
-
-#ifdef SIMPLE_EXTERNAL_CHILDREN
-    union children_t {
-      OctreeElement* single;
-      OctreeElement** external;
-    } _children;
-#endif
-    
-#ifdef BLENDED_UNION_CHILDREN
-    union children_t {
-      OctreeElement* single;
-      int32_t offsetsTwoChildren[2];
-      quint64 offsetsThreeChildrenEncoded;
-      OctreeElement** external;
-    } _children;
-#ifdef HAS_AUDIT_CHILDREN
-    OctreeElement* _childrenArray[8]; /// Only used when HAS_AUDIT_CHILDREN is enabled to help debug children encoding
-#endif // def HAS_AUDIT_CHILDREN
-
-#endif //def BLENDED_UNION_CHILDREN
+    /// Client and server, the slab indices of the children in the order of their child index, 8 bytes. Up to two are
+    /// kept right here, more in a block of child indices from a slab that this points to. See setChildAtIndex().
+    quint64 _children;
+
+    /// Client and server, odd while setChildAtIndex() is changing the children, so that snapshot readers can walk the
+    /// children without the tree lock and retry when they raced with a writer
+    QAtomicInt _childrenVersion;
 
     uint16_t _sourceUUIDKey; /// Client only, stores node id of voxel server that sent his voxel, 2 bytes
 
@@ -302,8 +306,10 @@ protected:
          _isDirty : 1, /// Client only, has this voxel changed since being rendered, 1 bit
          _shouldRender : 1, /// Client only, should this voxel render at this time, 1 bit
          _octcodePointer : 1, /// Client and Server only, is this voxel's octal code a pointer or buffer, 1 bit
-         _unknownBufferIndex : 1,
-         _childrenExternal : 1; /// Client only, is this voxel's VBO buffer the unknown buffer index, 1 bit
+         _unknownBufferIndex : 1, /// Client only, is this voxel's VBO buffer the unknown buffer index, 1 bit
+         _isRetired : 1; /// Client and server, the delete hooks already know this voxel is going away, 1 bit
+
+    quint8 _elementIndexNumber; /// Client and server, the number of the OctreeElementIndex this voxel is in, 1 byte
 
     static QReadWriteLock _deleteHooksLock;
     static std::vector<OctreeElementDeleteHook*> _deleteHooks;
@@ -311,29 +317,16 @@ protected:
     //static QReadWriteLock _updateHooksLock;
     static std::vector<OctreeElementUpdateHook*> _updateHooks;
 
-    static quint64 _voxelNodeCount;
-    static quint64 _voxelNodeLeafCount;
+    /// the statistics to count this thread's changes in
+    static OctreeElementStatistics& statistics();
 
-    static quint64 _voxelMemoryUsage;
-    static quint64 _octcodeMemoryUsage;
-    static quint64 _externalChildrenMemoryUsage;
+    static OctreeElementStatistics _statistics;
+    static QAtomicInt _threadStatisticsCount; // the threads keeping statistics of their own
 
     static quint64 _getChildAtIndexTime;
     static quint64 _getChildAtIndexCalls;
     static quint64 _setChildAtIndexTime;
     static quint64 _setChildAtIndexCalls;
-
-#ifdef BLENDED_UNION_CHILDREN
-    static quint64 _singleChildrenCount;
-    static quint64 _twoChildrenOffsetCount;
-    static quint64 _twoChildrenExternalCount;
-    static quint64 _threeChildrenOffsetCount;
-    static quint64 _threeChildrenExternalCount;
-    static quint64 _couldStoreFourChildrenInternally;
-    static quint64 _couldNotStoreFourChildrenInternally;
-#endif
-    static quint64 _externalChildrenCount;
-    static quint64 _childrenCount[NUMBER_OF_CHILDREN + 1];
 };
 
 #endif // hifi_OctreeElement_h
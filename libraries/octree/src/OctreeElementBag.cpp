@@ -10,10 +10,21 @@
 //
 
 #include "OctreeElementBag.h"
+#include "ViewFrustum.h"
 #include <OctalCode.h>
 
+// the heap is rebuilt without the entries of removed elements once they are more than this many
+const int MIN_STALE_HEAP_ENTRIES = 64;
+
 OctreeElementBag::OctreeElementBag() : 
-    _bagElements()
+    _mutex(),
+    _bagElements(),
+    _heap(),
+    _nextSerial(0),
+    _hasView(false),
+    _isInViewOrder(false),
+    _viewPosition(),
+    _usefulCount(0)
 {
     OctreeElement::addDeleteHook(this);
     _hooked = true;
@@ -37,29 +48,148 @@ void OctreeElementBag::elementDeleted(OctreeElement* element) {
 
 
 void OctreeElementBag::deleteAll() {
+    QMutexLocker locker(&_mutex);
     _bagElements.clear();
+    _heap.clear();
+    _usefulCount = 0;
+}
+
+void OctreeElementBag::setView(const ViewFrustum& view, bool extractInViewOrder) {
+    QMutexLocker locker(&_mutex);
+    _hasView = true;
+    _isInViewOrder = extractInViewOrder;
+    _viewPosition = view.getPositionVoxelScale();
+
+    // the elements already in the bag look as big as they do from the new view
+    _usefulCount = 0;
+    for (QHash<OctreeElement*, BagEntry>::iterator entry = _bagElements.begin(); entry != _bagElements.end(); ++entry) {
+        entry->apparentSize = apparentSizeOf(entry.key());
+        if (entry->apparentSize >= USEFUL_ELEMENT_APPARENT_SIZE) {
+            _usefulCount++;
+        }
+    }
+    rebuildHeap();
 }
 
+float OctreeElementBag::apparentSizeOf(const OctreeElement* element) const {
+    const AACube& cube = element->getAACube();
+    return cube.getScale() / (cube.getScale() + glm::distance(cube.calcCenter(), _viewPosition));
+}
 
 void OctreeElementBag::insert(OctreeElement* element) {
-    _bagElements.insert(element);
+    QMutexLocker locker(&_mutex);
+    // a snapshot reader may still be walking a subtree a writer deleted, but the bag must not keep any of it
+    if (element->isRetired() || _bagElements.contains(element)) {
+        return;
+    }
+
+    BagEntry entry = { _nextSerial++, 0.0f };
+    if (_hasView) {
+        entry.apparentSize = apparentSizeOf(element);
+        if (entry.apparentSize >= USEFUL_ELEMENT_APPARENT_SIZE) {
+            _usefulCount++;
+        }
+        if (_isInViewOrder) {
+            HeapEntry heapEntry = { entry.apparentSize, entry.serial, element };
+            pushHeap(heapEntry);
+        }
+    }
+    _bagElements.insert(element, entry);
 }
 
 OctreeElement* OctreeElementBag::extract() {
+    QMutexLocker locker(&_mutex);
     OctreeElement* result = NULL;
 
-    if (_bagElements.size() > 0) {
-        QSet<OctreeElement*>::iterator front = _bagElements.begin();
-        result = *front;
-        _bagElements.erase(front);
+    if (_isInViewOrder) {
+        while (!_heap.isEmpty()) {
+            HeapEntry top = popHeap();
+            QHash<OctreeElement*, BagEntry>::iterator entry = _bagElements.find(top.element);
+            if (entry != _bagElements.end() && entry->serial == top.serial) {
+                result = top.element;
+                removeEntry(entry);
+                break;
+            }
+        }
+    } else if (_bagElements.size() > 0) {
+        result = _bagElements.begin().key();
+        removeEntry(_bagElements.begin());
     }
     return result;
 }
 
 bool OctreeElementBag::contains(OctreeElement* element) {
+    QMutexLocker locker(&_mutex);
     return _bagElements.contains(element);
 }
 
 void OctreeElementBag::remove(OctreeElement* element) {
-    _bagElements.remove(element);
+    QMutexLocker locker(&_mutex);
+    QHash<OctreeElement*, BagEntry>::iterator entry = _bagElements.find(element);
+    if (entry != _bagElements.end()) {
+        removeEntry(entry);
+        if (_heap.size() - _bagElements.size() > qMax(_bagElements.size(), MIN_STALE_HEAP_ENTRIES)) {
+            rebuildHeap();
+        }
+    }
+}
+
+void OctreeElementBag::removeEntry(QHash<OctreeElement*, BagEntry>::iterator entry) {
+    if (_hasView && entry->apparentSize >= USEFUL_ELEMENT_APPARENT_SIZE) {
+        _usefulCount--;
+    }
+    _bagElements.erase(entry);
+}
+
+void OctreeElementBag::pushHeap(const HeapEntry& heapEntry) {
+    int child = _heap.size();
+    _heap.append(heapEntry);
+    while (child > 0) {
+        int parent = (child - 1) / 2;
+        if (_heap.at(parent).apparentSize >= heapEntry.apparentSize) {
+            break;
+        }
+        _heap[child] = _heap.at(parent);
+        child = parent;
+    }
+    _heap[child] = heapEntry;
+}
+
+OctreeElementBag::HeapEntry OctreeElementBag::popHeap() {
+    HeapEntry top = _heap.first();
+    HeapEntry last = _heap.last();
+    _heap.removeLast();
+
+    int size = _heap.size();
+    if (size > 0) {
+        int parent = 0;
+        while (true) {
+            int child = 2 * parent + 1;
+            if (child >= size) {
+                break;
+            }
+            if (child + 1 < size && _heap.at(child + 1).apparentSize > _heap.at(child).apparentSize) {
+                child++;
+            }
+            if (last.apparentSize >= _heap.at(child).apparentSize) {
+                break;
+            }
+            _heap[parent] = _heap.at(child);
+            parent = child;
+        }
+        _heap[parent] = last;
+    }
+    return top;
+}
+
+void OctreeElementBag::rebuildHeap() {
+    _heap.clear();
+    if (!_isInViewOrder) {
+        return;
+    }
+    for (QHash<OctreeElement*, BagEntry>::const_iterator entry = _bagElements.constBegin();
+            entry != _bagElements.constEnd(); ++entry) {
+        HeapEntry heapEntry = { entry->apparentSize, entry->serial, entry.key() };
+        pushHeap(heapEntry);
+    }
 }
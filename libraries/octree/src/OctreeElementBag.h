@@ -9,6 +9,7 @@
 //  it's a generic bag style storage mechanism. But It has the property that you can't put the same node into the bag
 //  more than once (in other words, it de-dupes automatically), also, it supports collapsing it's several peer nodes
 //  into a parent node in cases where you add enough peers that it makes more sense to just add the parent.
+//  Given a view, it hands out the elements that look biggest from it first, so a viewer gets what matters most first.
 //
 //  Distributed under the Apache License, Version 2.0.
 //  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
@@ -17,8 +18,21 @@
 #ifndef hifi_OctreeElementBag_h
 #define hifi_OctreeElementBag_h
 
+#include <QtCore/QHash>
+#include <QtCore/QMutex>
+#include <QtCore/QMutexLocker>
+#include <QtCore/QVector>
+
+#include <glm/glm.hpp>
+
 #include "OctreeElement.h"
 
+class ViewFrustum;
+
+/// How big an element has to look from the view for the view to be of little use without it. An element's apparent size
+/// is its scale over its scale plus its distance, which is 1/65th for an element 64 of its own sizes away.
+const float USEFUL_ELEMENT_APPARENT_SIZE = 1.0f / 65.0f;
+
 class OctreeElementBag : public OctreeElementDeleteHook {
 
 public:
@@ -26,12 +40,21 @@ public:
     ~OctreeElementBag();
     
     void insert(OctreeElement* element); // put a element into the bag
-    OctreeElement* extract(); // pull a element out of the bag (could come in any order)
+    OctreeElement* extract(); // pull a element out of the bag (in view order, or in any order without one)
     bool contains(OctreeElement* element); // is this element in the bag?
     void remove(OctreeElement* element); // remove a specific element from the bag
     
-    bool isEmpty() const { return _bagElements.isEmpty(); }
-    int count() const { return _bagElements.size(); }
+    bool isEmpty() const { QMutexLocker locker(&_mutex); return _bagElements.isEmpty(); }
+    int count() const { QMutexLocker locker(&_mutex); return _bagElements.size(); }
+
+    /// Has the elements that look biggest from the view, the nearest and the coarsest, extracted first, including the
+    /// ones already in the bag. Without extractInViewOrder they still come out in any order, but getUsefulCount() is
+    /// kept, so that the two can be compared.
+    void setView(const ViewFrustum& view, bool extractInViewOrder = true);
+    bool hasView() const { QMutexLocker locker(&_mutex); return _hasView; }
+
+    /// \return the number of elements in the bag that look at least USEFUL_ELEMENT_APPARENT_SIZE big from the view
+    int getUsefulCount() const { QMutexLocker locker(&_mutex); return _usefulCount; }
 
     void deleteAll();
     virtual void elementDeleted(OctreeElement* element);
@@ -39,7 +62,39 @@ public:
     void unhookNotifications();
 
 private:
-    QSet<OctreeElement*> _bagElements;
+    class BagEntry {
+    public:
+        quint32 serial; // which of the element's heap entries is its current one
+        float apparentSize;
+    };
+
+    class HeapEntry {
+    public:
+        float apparentSize;
+        quint32 serial;
+        OctreeElement* element;
+    };
+
+    float apparentSizeOf(const OctreeElement* element) const;
+    void removeEntry(QHash<OctreeElement*, BagEntry>::iterator entry);
+    void pushHeap(const HeapEntry& heapEntry);
+    HeapEntry popHeap();
+    void rebuildHeap();
+
+    // snapshot readers fill the bag while writers on other threads delete elements and remove them through the hook
+    mutable QMutex _mutex;
+    QHash<OctreeElement*, BagEntry> _bagElements;
+
+    // a binary max heap of the elements by apparent size when extracting in view order. Removing an element leaves its
+    // entry, which extract() skips, so that removal doesn't have to find it.
+    QVector<HeapEntry> _heap;
+    quint32 _nextSerial;
+
+    bool _hasView;
+    bool _isInViewOrder;
+    glm::vec3 _viewPosition; // in tree units
+    int _usefulCount;
+
     bool _hooked;
 };
 
@@ -0,0 +1,225 @@
+//
+//  OctreeElementIndex.cpp
+//  libraries/octree/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#include <new>
+
+#include <QtCore/QDebug>
+#include <QtCore/QMutexLocker>
+
+#include <OctalCode.h>
+#include <SharedUtil.h>
+
+#include "OctreeElement.h"
+#include "OctreeElementIndex.h"
+
+const int INITIAL_ELEMENT_INDEX_CAPACITY = 1024; // a power of two
+
+QMutex OctreeElementIndex::_indicesMutex;
+OctreeElementIndex* OctreeElementIndex::_indices[MAX_ELEMENT_INDICES + 1];
+
+quint64 OctreeElementIndex::keyForOctalCode(const unsigned char* octalCode) {
+    int sections = numberOfThreeBitSectionsInCode(octalCode);
+    if (sections > MAX_INDEXED_LEVELS) {
+        return 0;
+    }
+
+    // the sections are packed from the top of the bytes after the length, and all of them fit in 64 bits
+    int sectionBits = sections * BITS_IN_OCTAL;
+    int sectionBytes = (sectionBits + BITS_IN_BYTE - 1) / BITS_IN_BYTE;
+    quint64 sectionValues = 0;
+    for (int i = 0; i < sectionBytes; i++) {
+        sectionValues = (sectionValues << BITS_IN_BYTE) | octalCode[1 + i];
+    }
+    sectionValues >>= sectionBytes * BITS_IN_BYTE - sectionBits;
+
+    return (Q_UINT64_C(1) << sectionBits) | sectionValues;
+}
+
+OctreeElementIndex::OctreeElementIndex() :
+    _lock(),
+    _entries(),
+    _mask(0),
+    _hashShift(0),
+    _size(0),
+    _isSuspended(false),
+    _number(NO_ELEMENT_INDEX)
+{
+    QMutexLocker locker(&_indicesMutex);
+    for (int number = NO_ELEMENT_INDEX + 1; number <= MAX_ELEMENT_INDICES; number++) {
+        if (!_indices[number]) {
+            _number = number;
+            _indices[number] = this;
+            break;
+        }
+    }
+    if (_number == NO_ELEMENT_INDEX) {
+        qDebug() << "OctreeElementIndex is out of index numbers, there are" << MAX_ELEMENT_INDICES << "indices already";
+        throw std::bad_alloc();
+    }
+
+    resize(INITIAL_ELEMENT_INDEX_CAPACITY);
+}
+
+OctreeElementIndex::~OctreeElementIndex() {
+    QMutexLocker locker(&_indicesMutex);
+    _indices[_number] = NULL;
+}
+
+int OctreeElementIndex::size() const {
+    QReadLocker locker(&_lock);
+    return _size;
+}
+
+int OctreeElementIndex::getCapacity() const {
+    QReadLocker locker(&_lock);
+    return _entries.size();
+}
+
+OctreeElement* OctreeElementIndex::find(quint64 key) const {
+    if (key == 0) {
+        return NULL;
+    }
+    QReadLocker locker(&_lock);
+    const Entry* entries = _entries.constData();
+    for (int slot = slotFor(key); entries[slot].key != 0; slot = (slot + 1) & _mask) {
+        if (entries[slot].key == key) {
+            return entries[slot].element;
+        }
+    }
+    return NULL;
+}
+
+OctreeElement* OctreeElementIndex::find(const unsigned char* octalCode) const {
+    return find(keyForOctalCode(octalCode));
+}
+
+void OctreeElementIndex::addSubtree(OctreeElement* element) {
+    // only changed while no elements are being added, so it is read without the lock, which all the threads adding
+    // elements while the index is suspended would otherwise wait on
+    if (_isSuspended) {
+        return;
+    }
+    QWriteLocker locker(&_lock);
+    addSubtreeRecursion(element);
+}
+
+void OctreeElementIndex::removeSubtree(OctreeElement* element) {
+    QWriteLocker locker(&_lock);
+    removeSubtreeRecursion(element);
+}
+
+void OctreeElementIndex::remove(OctreeElement* element) {
+    QWriteLocker locker(&_lock);
+    removeEntry(element);
+}
+
+void OctreeElementIndex::suspend() {
+    QWriteLocker locker(&_lock);
+    _isSuspended = true;
+}
+
+void OctreeElementIndex::resume(OctreeElement* rootElement) {
+    QWriteLocker locker(&_lock);
+    _isSuspended = false;
+    _entries.fill(Entry());
+    _size = 0;
+    addSubtreeRecursion(rootElement);
+}
+
+void OctreeElementIndex::insert(quint64 key, OctreeElement* element) {
+    // kept at most three quarters full, so that the probes stay short
+    if ((_size + 1) * 4 > _entries.size() * 3) {
+        resize(_entries.size() * 2);
+    }
+    int slot = slotFor(key);
+    while (_entries[slot].key != 0 && _entries[slot].key != key) {
+        slot = (slot + 1) & _mask;
+    }
+    if (_entries[slot].key == 0) {
+        _size++;
+    }
+    _entries[slot].key = key;
+    _entries[slot].element = element;
+}
+
+void OctreeElementIndex::removeEntry(OctreeElement* element) {
+    quint64 key = keyForOctalCode(element->getOctalCode());
+    element->_elementIndexNumber = NO_ELEMENT_INDEX;
+    if (key == 0) {
+        return;
+    }
+    for (int slot = slotFor(key); _entries[slot].key != 0; slot = (slot + 1) & _mask) {
+        if (_entries[slot].key == key) {
+            // a new root may have taken the key before the old one is retired
+            if (_entries[slot].element == element) {
+                erase(slot);
+            }
+            return;
+        }
+    }
+}
+
+void OctreeElementIndex::erase(int slot) {
+    // move the entries after the slot back into it if their probe passed it, so that no probe stops short of them
+    int hole = slot;
+    for (int next = (hole + 1) & _mask; _entries[next].key != 0; next = (next + 1) & _mask) {
+        int home = slotFor(_entries[next].key);
+        if (((next - home) & _mask) >= ((next - hole) & _mask)) {
+            _entries[hole] = _entries[next];
+            hole = next;
+        }
+    }
+    _entries[hole] = Entry();
+    _size--;
+}
+
+void OctreeElementIndex::resize(int capacity) {
+    QVector<Entry> oldEntries = _entries;
+    _entries = QVector<Entry>(capacity);
+    _mask = capacity - 1;
+    _hashShift = 64;
+    for (int slots = capacity; slots > 1; slots >>= 1) {
+        _hashShift--;
+    }
+    _size = 0;
+    foreach (const Entry& entry, oldEntries) {
+        if (entry.key != 0) {
+            insert(entry.key, entry.element);
+        }
+    }
+}
+
+void OctreeElementIndex::addSubtreeRecursion(OctreeElement* element) {
+    quint64 key = keyForOctalCode(element->getOctalCode());
+    if (key == 0) {
+        return; // too deep, and so are its descendants
+    }
+    element->_elementIndexNumber = _number;
+    insert(key, element);
+    for (int i = 0; i < NUMBER_OF_CHILDREN; i++) {
+        OctreeElement* childAt = element->getChildAtIndex(i);
+        if (childAt) {
+            addSubtreeRecursion(childAt);
+        }
+    }
+}
+
+void OctreeElementIndex::removeSubtreeRecursion(OctreeElement* element) {
+    if (element->_elementIndexNumber != _number) {
+        return;
+    }
+    removeEntry(element);
+    for (int i = 0; i < NUMBER_OF_CHILDREN; i++) {
+        OctreeElement* childAt = element->getChildAtIndex(i);
+        if (childAt) {
+            removeSubtreeRecursion(childAt);
+        }
+    }
+}
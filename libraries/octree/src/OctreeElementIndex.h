@@ -0,0 +1,104 @@
+//
+//  OctreeElementIndex.h
+//  libraries/octree/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#ifndef hifi_OctreeElementIndex_h
+#define hifi_OctreeElementIndex_h
+
+#include <QtCore/QMutex>
+#include <QtCore/QReadWriteLock>
+#include <QtCore/QVector>
+
+class OctreeElement;
+
+const quint8 NO_ELEMENT_INDEX = 0; // the index number of elements that aren't in an index
+const int MAX_ELEMENT_INDICES = 255;
+
+/// A hash from the level and Morton code of the elements of one tree to the elements, so that an element is found
+/// from its octal code without descending the tree to it. The key of an element is its octal code's three bit sections
+/// below a one bit that marks the level, the root's key being 1, which fits the elements down to MAX_INDEXED_LEVELS
+/// below the root. Deeper elements aren't indexed, and are found by descending the tree as before.
+///
+/// The index is kept up to date by the elements themselves: each element knows the number of the index it is in, a
+/// child linked to it with setChildAtIndex() is added to the same index, and an element is removed when its delete
+/// hooks are notified. The table uses open addressing with linear probing, so a lookup is mostly one cache line.
+class OctreeElementIndex {
+public:
+    static const int MAX_INDEXED_LEVELS = 21;
+
+    /// \return the key of the octal code, or 0 if it is too deep to be indexed
+    static quint64 keyForOctalCode(const unsigned char* octalCode);
+
+    /// \return the key of the parent of the element with the key, or 0 for the root's
+    static quint64 parentKey(quint64 key) { return key >> 3; }
+
+    /// \return the index with the number, which elements keep in place of a pointer to it
+    static OctreeElementIndex* forNumber(quint8 number) { return _indices[number]; }
+
+    /// \throw std::bad_alloc if there are MAX_ELEMENT_INDICES indices already
+    OctreeElementIndex();
+    ~OctreeElementIndex();
+
+    quint8 getNumber() const { return _number; }
+    int size() const;
+    int getCapacity() const;
+
+    /// \return the element with the key, or NULL if there is none or it isn't indexed
+    OctreeElement* find(quint64 key) const;
+    OctreeElement* find(const unsigned char* octalCode) const;
+
+    /// Adds the element and its descendants, and has their children added as they are linked to them. Called by the
+    /// tree for its root, and by the elements in the index for the children linked to them.
+    void addSubtree(OctreeElement* element);
+
+    /// Removes the element and its descendants, which then aren't added to an index again until addSubtree()
+    void removeSubtree(OctreeElement* element);
+
+    /// Removes the element, if the index has it and not another element with its octal code. Called by the element
+    /// when it is deleted or retired.
+    void remove(OctreeElement* element);
+
+    /// Has addSubtree() do nothing until resume(), which adds the whole subtree of the root again, for when many threads
+    /// create elements at the same time and would only wait on each other for the index
+    void suspend();
+    void resume(OctreeElement* rootElement);
+
+private:
+    class Entry {
+    public:
+        Entry() : key(0), element(NULL) { }
+
+        quint64 key; // 0 for an empty entry
+        OctreeElement* element;
+    };
+
+    OctreeElementIndex(const OctreeElementIndex&);
+    OctreeElementIndex& operator=(const OctreeElementIndex&);
+
+    int slotFor(quint64 key) const { return (int)((key * Q_UINT64_C(0x9E3779B97F4A7C15)) >> _hashShift); }
+    void insert(quint64 key, OctreeElement* element);
+    void removeEntry(OctreeElement* element);
+    void erase(int slot);
+    void resize(int capacity);
+    void addSubtreeRecursion(OctreeElement* element);
+    void removeSubtreeRecursion(OctreeElement* element);
+
+    mutable QReadWriteLock _lock;
+    QVector<Entry> _entries;
+    int _mask;
+    int _hashShift; // the top bits of the hashed key pick the slot
+    int _size;
+    bool _isSuspended;
+    quint8 _number;
+
+    static QMutex _indicesMutex;
+    static OctreeElementIndex* _indices[MAX_ELEMENT_INDICES + 1]; // by number, NO_ELEMENT_INDEX is always NULL
+};
+
+#endif // hifi_OctreeElementIndex_h
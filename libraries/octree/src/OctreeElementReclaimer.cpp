@@ -0,0 +1,109 @@
+//
+//  OctreeElementReclaimer.cpp
+//  libraries/octree/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#include <QtCore/QMutexLocker>
+
+#include "OctreeElement.h"
+#include "OctreeElementReclaimer.h"
+#include "OctreeElementSlab.h"
+
+QMutex OctreeElementReclaimer::_mutex;
+quint64 OctreeElementReclaimer::_epoch = 0;
+QMap<quint64, int> OctreeElementReclaimer::_activeReaders;
+QVector<OctreeElementReclaimer::Retired> OctreeElementReclaimer::_retired;
+
+quint64 OctreeElementReclaimer::beginRead() {
+    QMutexLocker locker(&_mutex);
+    _activeReaders[_epoch]++;
+    return _epoch;
+}
+
+void OctreeElementReclaimer::endRead(quint64 epoch) {
+    QVector<Retired> reclaimable;
+    {
+        QMutexLocker locker(&_mutex);
+        QMap<quint64, int>::iterator readers = _activeReaders.find(epoch);
+        if (readers != _activeReaders.end() && --readers.value() <= 0) {
+            _activeReaders.erase(readers);
+            reclaimable = takeReclaimable();
+        }
+    }
+    free(reclaimable);
+}
+
+void OctreeElementReclaimer::retire(OctreeElement* element) {
+    // a running reader may keep using the subtree, but a reader that starts from here on can't find it through the
+    // tree or through anything the hooks keep track of
+    element->notifySubtreeDeleted();
+
+    Retired retired = { 0, element, NULL };
+    retire(retired);
+}
+
+void OctreeElementReclaimer::retire(quint32* childSlabIndices) {
+    Retired retired = { 0, NULL, childSlabIndices };
+    retire(retired);
+}
+
+void OctreeElementReclaimer::retire(Retired& retired) {
+    QVector<Retired> reclaimable;
+    {
+        QMutexLocker locker(&_mutex);
+        retired.epoch = _epoch++;
+        _retired.append(retired);
+        reclaimable = takeReclaimable();
+    }
+    free(reclaimable);
+}
+
+QVector<OctreeElementReclaimer::Retired> OctreeElementReclaimer::takeReclaimable() {
+    QVector<Retired> reclaimable;
+
+    // anything retired before the oldest running reader started can't be reached by any reader
+    int numReclaimable = 0;
+    if (_activeReaders.isEmpty()) {
+        numReclaimable = _retired.size();
+    } else {
+        quint64 oldestReaderEpoch = _activeReaders.firstKey();
+        while (numReclaimable < _retired.size() && _retired[numReclaimable].epoch < oldestReaderEpoch) {
+            numReclaimable++;
+        }
+    }
+
+    if (numReclaimable > 0) {
+        reclaimable = _retired.mid(0, numReclaimable);
+        _retired.remove(0, numReclaimable);
+    }
+    return reclaimable;
+}
+
+void OctreeElementReclaimer::free(const QVector<Retired>& reclaimable) {
+    foreach (const Retired& retired, reclaimable) {
+        if (retired.element) {
+            delete retired.element;
+        } else {
+            OctreeElementSlab::release(retired.childSlabIndices);
+        }
+    }
+}
+
+int OctreeElementReclaimer::getActiveReaderCount() {
+    QMutexLocker locker(&_mutex);
+    int numReaders = 0;
+    foreach (int readersInEpoch, _activeReaders) {
+        numReaders += readersInEpoch;
+    }
+    return numReaders;
+}
+
+int OctreeElementReclaimer::getRetiredCount() {
+    QMutexLocker locker(&_mutex);
+    return _retired.size();
+}
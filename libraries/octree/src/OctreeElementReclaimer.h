@@ -0,0 +1,61 @@
+//
+//  OctreeElementReclaimer.h
+//  libraries/octree/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#ifndef hifi_OctreeElementReclaimer_h
+#define hifi_OctreeElementReclaimer_h
+
+#include <QtCore/QMap>
+#include <QtCore/QMutex>
+#include <QtCore/QVector>
+
+class OctreeElement;
+
+/// Epoch based reclamation of the memory of deleted octree elements. Snapshot readers walk the tree without holding the
+/// tree lock, so an element a writer deletes, or a child array it replaces, may still be in use by a reader that started
+/// before the delete. Those are retired with the current epoch and only freed once every reader that started in or
+/// before that epoch is done. When no snapshot readers are running, retired memory is freed right away.
+class OctreeElementReclaimer {
+public:
+    /// \return the epoch the reader started in, which must be passed to endRead()
+    static quint64 beginRead();
+    static void endRead(quint64 epoch);
+
+    /// Retires an element that is no longer reachable from the tree, along with its subtree. The delete hooks are
+    /// told about the subtree right away, so that nothing new picks it up, and the elements are deleted once no reader
+    /// that started before now is still running.
+    static void retire(OctreeElement* element);
+
+    /// Retires a block of child slab indices that an element no longer uses
+    static void retire(quint32* childSlabIndices);
+
+    static int getActiveReaderCount();
+    static int getRetiredCount();
+
+private:
+    class Retired {
+    public:
+        quint64 epoch;
+        OctreeElement* element;
+        quint32* childSlabIndices;
+    };
+
+    static void retire(Retired& retired);
+
+    // must be called with the mutex held, removes the retired memory no running reader can still be using
+    static QVector<Retired> takeReclaimable();
+    static void free(const QVector<Retired>& reclaimable);
+
+    static QMutex _mutex;
+    static quint64 _epoch;
+    static QMap<quint64, int> _activeReaders; // number of readers still running, by the epoch they started in
+    static QVector<Retired> _retired; // in the order they were retired, so also by epoch
+};
+
+#endif // hifi_OctreeElementReclaimer_h
@@ -0,0 +1,191 @@
+//
+//  OctreeElementSlab.cpp
+//  libraries/octree/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#include <new>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#endif
+
+#include <QtCore/QDebug>
+#include <QtCore/QMutexLocker>
+
+#include "OctreeElementSlab.h"
+
+QMutex OctreeElementSlab::_slabsMutex;
+QAtomicPointer<OctreeElementSlab> OctreeElementSlab::_slabs[MAX_SLAB_BLOCK_SIZE / SLAB_BLOCK_ALIGNMENT];
+
+OctreeElementSlab* OctreeElementSlab::forSize(size_t size) {
+    if (size == 0 || size > MAX_SLAB_BLOCK_SIZE) {
+        qDebug() << "OctreeElementSlab::forSize() has no slab for blocks of" << size << "bytes";
+        throw std::bad_alloc();
+    }
+
+    int slabIndex = (size + SLAB_BLOCK_ALIGNMENT - 1) / SLAB_BLOCK_ALIGNMENT - 1;
+    OctreeElementSlab* slab = _slabs[slabIndex].loadAcquire();
+    if (!slab) {
+        QMutexLocker locker(&_slabsMutex);
+        slab = _slabs[slabIndex].load();
+        if (!slab) {
+            slab = new OctreeElementSlab((slabIndex + 1) * SLAB_BLOCK_ALIGNMENT);
+            _slabs[slabIndex].storeRelease(slab);
+        }
+    }
+    return slab;
+}
+
+void OctreeElementSlab::release(void* block) {
+    if (!block) {
+        return;
+    }
+    OctreeElementSlab* slab = slabFor(block);
+
+    QMutexLocker locker(&slab->_mutex);
+    *reinterpret_cast<char**>(block) = slab->_freeBlocks;
+    slab->_freeBlocks = static_cast<char*>(block);
+    slab->_blocksInUse--;
+}
+
+quint64 OctreeElementSlab::getTotalReservedBytes() {
+    quint64 reservedBytes = 0;
+    for (size_t i = 0; i < MAX_SLAB_BLOCK_SIZE / SLAB_BLOCK_ALIGNMENT; i++) {
+        OctreeElementSlab* slab = _slabs[i].loadAcquire();
+        if (slab) {
+            reservedBytes += slab->getReservedBytes();
+        }
+    }
+    return reservedBytes;
+}
+
+OctreeElementSlab::OctreeElementSlab(size_t blockSize) :
+    _blockSize(blockSize),
+    _blocksPerChunk((SLAB_CHUNK_BYTES - SLAB_CHUNK_HEADER_BYTES) / blockSize),
+    _indexShift(0),
+    _indexMask(0),
+    _maxChunks(0),
+    _chunkPages(NULL),
+    _mutex(),
+    _numChunks(0),
+    _freeBlocks(NULL),
+    _nextUnusedBlock(NULL),
+    _chunkEnd(NULL),
+    _blocksInUse(0)
+{
+    while ((1u << _indexShift) < _blocksPerChunk) {
+        _indexShift++;
+    }
+    _indexMask = (1u << _indexShift) - 1;
+    _maxChunks = 1u << (SLAB_INDEX_BITS - _indexShift);
+    _chunkPages = new QAtomicPointer<QAtomicPointer<char> >[(_maxChunks + SLAB_CHUNKS_PER_PAGE - 1) / SLAB_CHUNKS_PER_PAGE];
+}
+
+void* OctreeElementSlab::allocate() {
+    QMutexLocker locker(&_mutex);
+
+    char* block;
+    if (_freeBlocks) {
+        block = _freeBlocks;
+        _freeBlocks = *reinterpret_cast<char**>(block);
+    } else {
+        if (_nextUnusedBlock == _chunkEnd) {
+            addChunk();
+        }
+        // blocks allocated one after the other are next to each other, as siblings and their subtrees mostly are
+        block = _nextUnusedBlock;
+        _nextUnusedBlock += _blockSize;
+    }
+    _blocksInUse++;
+    return block;
+}
+
+char* OctreeElementSlab::reserveChunk() {
+    // ask for a chunk more than we need, then give back everything but the aligned chunk inside of it - aligned
+    // allocators keep the padding instead, which would reserve twice what the slabs use
+#ifdef _WIN32
+    // another thread can take the address between giving back the padded range and reserving the chunk in it
+    const int MAX_RESERVE_ATTEMPTS = 8;
+    for (int i = 0; i < MAX_RESERVE_ATTEMPTS; i++) {
+        char* padded = static_cast<char*>(VirtualAlloc(NULL, 2 * SLAB_CHUNK_BYTES, MEM_RESERVE, PAGE_NOACCESS));
+        if (!padded) {
+            return NULL;
+        }
+        VirtualFree(padded, 0, MEM_RELEASE);
+
+        void* aligned = reinterpret_cast<void*>((reinterpret_cast<quintptr>(padded) + SLAB_CHUNK_BYTES - 1)
+            & ~(quintptr)(SLAB_CHUNK_BYTES - 1));
+        char* chunk = static_cast<char*>(VirtualAlloc(aligned, SLAB_CHUNK_BYTES, MEM_RESERVE | MEM_COMMIT,
+                                                      PAGE_READWRITE));
+        if (chunk) {
+            return chunk;
+        }
+    }
+    return NULL;
+#else
+    size_t paddedBytes = 2 * SLAB_CHUNK_BYTES;
+    void* mapped = mmap(NULL, paddedBytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANON, -1, 0);
+    if (mapped == MAP_FAILED) {
+        return NULL;
+    }
+    char* padded = static_cast<char*>(mapped);
+    char* chunk = reinterpret_cast<char*>((reinterpret_cast<quintptr>(padded) + SLAB_CHUNK_BYTES - 1)
+        & ~(quintptr)(SLAB_CHUNK_BYTES - 1));
+
+    if (chunk > padded) {
+        munmap(padded, chunk - padded);
+    }
+    char* paddedEnd = padded + paddedBytes;
+    char* chunkEnd = chunk + SLAB_CHUNK_BYTES;
+    if (paddedEnd > chunkEnd) {
+        munmap(chunkEnd, paddedEnd - chunkEnd);
+    }
+    return chunk;
+#endif
+}
+
+void OctreeElementSlab::addChunk() {
+    if ((quint32)_numChunks == _maxChunks) {
+        qDebug() << "OctreeElementSlab for blocks of" << _blockSize << "bytes is out of chunks";
+        throw std::bad_alloc();
+    }
+
+    QAtomicPointer<char>* chunkPage = _chunkPages[_numChunks / SLAB_CHUNKS_PER_PAGE].load();
+    if (!chunkPage) {
+        chunkPage = new QAtomicPointer<char>[SLAB_CHUNKS_PER_PAGE];
+        _chunkPages[_numChunks / SLAB_CHUNKS_PER_PAGE].storeRelease(chunkPage);
+    }
+
+    char* chunk = reserveChunk();
+    if (!chunk) {
+        throw std::bad_alloc();
+    }
+
+    ChunkHeader* header = reinterpret_cast<ChunkHeader*>(chunk);
+    header->slab = this;
+    header->chunkNumber = _numChunks;
+
+    // readers only look a chunk up by the index of a block that was handed out after this
+    chunkPage[_numChunks % SLAB_CHUNKS_PER_PAGE].storeRelease(chunk);
+    _numChunks++;
+
+    _nextUnusedBlock = chunk + SLAB_CHUNK_HEADER_BYTES;
+    _chunkEnd = _nextUnusedBlock + _blocksPerChunk * _blockSize;
+}
+
+quint64 OctreeElementSlab::getReservedBytes() const {
+    QMutexLocker locker(&_mutex);
+    return (quint64)_numChunks * SLAB_CHUNK_BYTES;
+}
+
+quint64 OctreeElementSlab::getBlocksInUse() const {
+    QMutexLocker locker(&_mutex);
+    return _blocksInUse;
+}
@@ -0,0 +1,121 @@
+//
+//  OctreeElementSlab.h
+//  libraries/octree/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#ifndef hifi_OctreeElementSlab_h
+#define hifi_OctreeElementSlab_h
+
+#include <QtCore/QAtomicPointer>
+#include <QtCore/QMutex>
+
+const size_t SLAB_CHUNK_BYTES = 256 * 1024; // a power of two, chunks are aligned to their size
+const size_t SLAB_CHUNK_HEADER_BYTES = 64;
+const size_t SLAB_BLOCK_ALIGNMENT = 16;
+const size_t MAX_SLAB_BLOCK_SIZE = 4096;
+
+// an element keeps its first child's index shifted up past two flag bits in 32, so indices must fit in the rest
+const int SLAB_INDEX_BITS = 30;
+
+// the table of chunks grows by pages of this many as chunks are added
+const quint32 SLAB_CHUNKS_PER_PAGE = 1024;
+
+/// Hands out blocks of one size from large chunks, for the many small objects an octree is made of: the elements
+/// themselves, the blocks of child indices of elements with more than two children, and the octal codes too long to
+/// keep in the element. There is one slab for each block size, shared by everything of that size.
+///
+/// Each block also has a 32 bit index, so an element can refer to its children in half the space of a pointer. Since
+/// the chunks are aligned to their size, the chunk a block is in, and so its slab and index, are found from its address
+/// alone. Chunks are kept for reuse once their blocks are released, and are never given back to the system.
+class OctreeElementSlab {
+public:
+    /// \return the slab for blocks of the given size, rounded up to SLAB_BLOCK_ALIGNMENT
+    static OctreeElementSlab* forSize(size_t size);
+
+    /// \return the slab the block was allocated from
+    static OctreeElementSlab* slabFor(const void* block) {
+        return reinterpret_cast<const ChunkHeader*>(reinterpret_cast<quintptr>(block) & ~(SLAB_CHUNK_BYTES - 1))->slab;
+    }
+
+    /// gives a block back to the slab it was allocated from
+    static void release(void* block);
+
+    /// the bytes of all the chunks of all the slabs
+    static quint64 getTotalReservedBytes();
+
+    /// \throw std::bad_alloc if the slab has as many chunks as its indices can address
+    void* allocate();
+
+    quint32 indexOf(const void* block) const {
+        quintptr address = reinterpret_cast<quintptr>(block);
+        const ChunkHeader* header = reinterpret_cast<const ChunkHeader*>(address & ~(SLAB_CHUNK_BYTES - 1));
+        quint32 blockInChunk = ((address & (SLAB_CHUNK_BYTES - 1)) - SLAB_CHUNK_HEADER_BYTES) / _blockSize;
+        return (header->chunkNumber << _indexShift) | blockInChunk;
+    }
+
+    /// \return the block with the index, or NULL for an index that can't be one of this slab's, which a reader that
+    /// raced a writer may come up with
+    void* blockAt(quint32 index) const {
+        quint32 chunkNumber = index >> _indexShift;
+        quint32 blockInChunk = index & _indexMask;
+        if (chunkNumber >= _maxChunks || blockInChunk >= _blocksPerChunk) {
+            return NULL;
+        }
+        QAtomicPointer<char>* chunkPage = _chunkPages[chunkNumber / SLAB_CHUNKS_PER_PAGE].loadAcquire();
+        if (!chunkPage) {
+            return NULL;
+        }
+        char* chunk = chunkPage[chunkNumber % SLAB_CHUNKS_PER_PAGE].load();
+        return chunk ? chunk + SLAB_CHUNK_HEADER_BYTES + blockInChunk * _blockSize : NULL;
+    }
+
+    size_t getBlockSize() const { return _blockSize; }
+    quint32 getMaxChunks() const { return _maxChunks; }
+    quint64 getReservedBytes() const;
+    quint64 getBlocksInUse() const;
+
+private:
+    class ChunkHeader {
+    public:
+        OctreeElementSlab* slab;
+        quint32 chunkNumber;
+    };
+
+    OctreeElementSlab(size_t blockSize);
+
+    // the slabs are shared by everything of their size and live as long as the process
+    OctreeElementSlab(const OctreeElementSlab&);
+    OctreeElementSlab& operator=(const OctreeElementSlab&);
+
+    void addChunk();
+
+    /// \return a chunk of SLAB_CHUNK_BYTES aligned to its size, taken from the system without reserving any more
+    static char* reserveChunk();
+
+    size_t _blockSize;
+    quint32 _blocksPerChunk;
+    int _indexShift; // the index is the chunk number above this many bits, and the block in the chunk below them
+    quint32 _indexMask;
+    quint32 _maxChunks; // as many as the index bits above _indexShift can address
+
+    // pages of SLAB_CHUNKS_PER_PAGE chunks, added as they are needed - pages and chunks are set once and read without
+    // the mutex
+    QAtomicPointer<QAtomicPointer<char> >* _chunkPages;
+
+    mutable QMutex _mutex;
+    int _numChunks;
+    char* _freeBlocks; // released blocks, each holding a pointer to the next
+    char* _nextUnusedBlock; // in the newest chunk
+    char* _chunkEnd;
+    quint64 _blocksInUse;
+
+    static QMutex _slabsMutex;
+    static QAtomicPointer<OctreeElementSlab> _slabs[MAX_SLAB_BLOCK_SIZE / SLAB_BLOCK_ALIGNMENT];
+};
+
+#endif // hifi_OctreeElementSlab_h
@@ -33,6 +33,14 @@ typedef quint64 OCTREE_PACKET_SENT_TIME;
 typedef uint16_t OCTREE_PACKET_INTERNAL_SECTION_SIZE;
 const int MAX_OCTREE_PACKET_SIZE = MAX_PACKET_SIZE;
 
+// the first octree NACK packet a client sends each time also reports how its receiving is going, after the sequence
+// numbers: the packets it has received, the packets it is missing and the average flight time of its packets in usecs
+typedef quint32 OCTREE_NACK_FEEDBACK_COUNT;
+typedef qint32 OCTREE_NACK_FEEDBACK_FLIGHT_TIME; // signed, it includes the clock skew between client and server
+const unsigned int OCTREE_NACK_FEEDBACK_SIZE = 2 * sizeof(OCTREE_NACK_FEEDBACK_COUNT)
+    + sizeof(OCTREE_NACK_FEEDBACK_FLIGHT_TIME);
+const float MAX_OCTREE_NACK_FEEDBACK_FLIGHT_TIME_USECS = 1.0e9f;
+
 // this is overly conservative - sizeof(PacketType) is 8 bytes but a packed PacketType could be as small as one byte
 const unsigned int OCTREE_PACKET_EXTRA_HEADERS_SIZE = sizeof(OCTREE_PACKET_FLAGS)
                 + sizeof(OCTREE_PACKET_SEQUENCE) + sizeof(OCTREE_PACKET_SENT_TIME);
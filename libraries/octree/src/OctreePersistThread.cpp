@@ -10,17 +10,29 @@
 //
 
 #include <QDebug>
+#include <QFile>
+#include <QFileInfo>
+#include <QStringList>
+#include <QThread>
+
 #include <PerfStat.h>
 #include <SharedUtil.h>
 
 #include "OctreePersistThread.h"
 
-OctreePersistThread::OctreePersistThread(Octree* tree, const QString& filename, int persistInterval) :
+OctreePersistThread::OctreePersistThread(Octree* tree, const QString& filename, int persistInterval, int numBackups) :
     _tree(tree),
     _filename(filename),
     _persistInterval(persistInterval),
+    _numBackups(numBackups),
     _initialLoadComplete(false),
-    _loadTimeUSecs(0) 
+    _loadTimeUSecs(0),
+    _lastCheck(0),
+    _saveCount(0),
+    _failedSaveCount(0),
+    _lastSaveUSecs(0),
+    _lastSaveLockUSecs(0),
+    _lastSaveBytes(0)
 {
 }
 
@@ -30,12 +42,29 @@ bool OctreePersistThread::process() {
         quint64 loadStarted = usecTimestampNow();
         qDebug() << "loading Octrees from file: " << _filename << "...";
 
-        bool persistantFileRead;
+        bool persistantFileRead = false;
+
+        // if we crashed while moving a save into place, the newest complete file is the one we were saving, and
+        // after that the backups, newest first
+        QStringList filenames;
+        filenames << _filename << getSavingFilename();
+        for (int i = 1; i <= _numBackups; i++) {
+            filenames << getBackupFilename(i);
+        }
 
         _tree->lockForWrite();
         {
             PerformanceWarning warn(true, "Loading Octree File", true);
-            persistantFileRead = _tree->readFromSVOFile(_filename.toLocal8Bit().constData());
+            foreach (const QString& filename, filenames) {
+                if (QFile::exists(filename)) {
+                    if (filename != _filename) {
+                        qDebug() << "persist file " << _filename << " is missing, loading " << filename << " instead";
+                    }
+                    persistantFileRead = _tree->readFromSVOFile(filename.toLocal8Bit().constData(),
+                                                                QThread::idealThreadCount());
+                    break;
+                }
+            }
         }
         _tree->unlock();
 
@@ -43,7 +72,8 @@ bool OctreePersistThread::process() {
         _loadTimeUSecs = loadDone - loadStarted;
 
         _tree->clearDirtyBit(); // the tree is clean since we just loaded it
-        qDebug("DONE loading Octrees from file... fileRead=%s", debug::valueOf(persistantFileRead));
+        qDebug("DONE loading Octrees from file... fileRead=%s in %llu usecs", debug::valueOf(persistantFileRead),
+               _loadTimeUSecs);
 
         unsigned long nodeCount = OctreeElement::getNodeCount();
         unsigned long internalNodeCount = OctreeElement::getInternalNodeCount();
@@ -80,12 +110,70 @@ bool OctreePersistThread::process() {
             // check the dirty bit and persist here...
             _lastCheck = usecTimestampNow();
             if (_tree->isDirty()) {
-                qDebug() << "saving Octrees to file " << _filename << "...";
-                _tree->writeToSVOFile(_filename.toLocal8Bit().constData());
-                _tree->clearDirtyBit(); // tree is clean after saving
-                qDebug("DONE saving Octrees to file...");
+                persist();
             }
         }
     }
     return isStillRunning();  // keep running till they terminate us
 }
+
+void OctreePersistThread::persist() {
+    qDebug() << "saving Octrees to file " << _filename << "...";
+    quint64 saveStarted = usecTimestampNow();
+
+    // clear the dirty bit before we start, edits that come in while we save will set it again
+    _tree->clearDirtyBit();
+
+    QString savingFilename = getSavingFilename();
+    quint64 lockUSecs = 0;
+    if (!_tree->writeToSVOFile(savingFilename.toLocal8Bit().constData(), NULL, &lockUSecs)) {
+        _failedSaveCount++;
+        _tree->setDirtyBit(); // try again next time
+        qDebug() << "FAILED saving Octrees to file " << savingFilename;
+        return;
+    }
+
+    rotateBackups();
+    if (!QFile::rename(savingFilename, _filename)) {
+        _failedSaveCount++;
+        _tree->setDirtyBit();
+        qDebug() << "FAILED moving " << savingFilename << " to " << _filename;
+        return;
+    }
+
+    _saveCount++;
+    _lastSaveUSecs = usecTimestampNow() - saveStarted;
+    _lastSaveLockUSecs = lockUSecs;
+    _lastSaveBytes = QFileInfo(_filename).size();
+    qDebug("DONE saving Octrees to file... %lld bytes in %llu usecs", _lastSaveBytes, _lastSaveUSecs);
+}
+
+void OctreePersistThread::rotateBackups() {
+    if (!QFile::exists(_filename)) {
+        return;
+    }
+    if (_numBackups <= 0) {
+        QFile::remove(_filename);
+        return;
+    }
+
+    // drop the oldest backup and shift the rest down, so the current persist file becomes backup 1
+    QFile::remove(getBackupFilename(_numBackups));
+    for (int i = _numBackups - 1; i >= 1; i--) {
+        QString backupFilename = getBackupFilename(i);
+        if (QFile::exists(backupFilename)) {
+            QFile::rename(backupFilename, getBackupFilename(i + 1));
+        }
+    }
+    if (!QFile::rename(_filename, getBackupFilename(1))) {
+        QFile::remove(_filename);
+    }
+}
+
+QString OctreePersistThread::getBackupFilename(int backupNumber) const {
+    return QString("%1.backup.%2").arg(_filename).arg(backupNumber);
+}
+
+QString OctreePersistThread::getSavingFilename() const {
+    return _filename + ".saving";
+}
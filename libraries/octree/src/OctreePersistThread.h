@@ -23,12 +23,20 @@ class OctreePersistThread : public GenericThread {
     Q_OBJECT
 public:
     static const int DEFAULT_PERSIST_INTERVAL = 1000 * 30; // every 30 seconds
+    static const int DEFAULT_PERSIST_BACKUPS = 2;
 
-    OctreePersistThread(Octree* tree, const QString& filename, int persistInterval = DEFAULT_PERSIST_INTERVAL);
+    OctreePersistThread(Octree* tree, const QString& filename, int persistInterval = DEFAULT_PERSIST_INTERVAL,
+                        int numBackups = DEFAULT_PERSIST_BACKUPS);
 
     bool isInitialLoadComplete() const { return _initialLoadComplete; }
     quint64 getLoadElapsedTime() const { return _loadTimeUSecs; }
 
+    int getSaveCount() const { return _saveCount; }
+    int getFailedSaveCount() const { return _failedSaveCount; }
+    quint64 getLastSaveElapsedTime() const { return _lastSaveUSecs; }
+    quint64 getLastSaveLockTime() const { return _lastSaveLockUSecs; }
+    qint64 getLastSaveBytes() const { return _lastSaveBytes; }
+
 signals:
     void loadCompleted();
 
@@ -36,13 +44,28 @@ protected:
     /// Implements generic processing behavior for this thread.
     virtual bool process();
 private:
+    /// Saves the tree next to the persist file and, once that is complete and on disk, moves it into place, keeping
+    /// the previous persist files as numbered backups. Readers keep encoding while we save, and edits made during the
+    /// save leave the tree dirty for the next one.
+    void persist();
+    void rotateBackups();
+    QString getBackupFilename(int backupNumber) const;
+    QString getSavingFilename() const;
+
     Octree* _tree;
     QString _filename;
     int _persistInterval;
+    int _numBackups;
     bool _initialLoadComplete;
 
     quint64 _loadTimeUSecs;
     quint64 _lastCheck;
+
+    int _saveCount;
+    int _failedSaveCount;
+    quint64 _lastSaveUSecs;
+    quint64 _lastSaveLockUSecs;
+    qint64 _lastSaveBytes;
 };
 
 #endif // hifi_OctreePersistThread_h
@@ -139,11 +139,12 @@ void OctreeRenderer::processDatagram(const QByteArray& dataByteArray, const Shar
     }
 }
 
-bool OctreeRenderer::renderOperation(OctreeElement* element, void* extraData) {
+bool OctreeRenderer::renderOperation(OctreeElement* element, ViewFrustum::location location, float furthestDistance,
+                                     void* extraData) {
     RenderArgs* args = static_cast<RenderArgs*>(extraData);
-    if (element->isInView(*args->_viewFrustum)) {
+    if (location != ViewFrustum::OUTSIDE) {
         if (element->hasContent()) {
-            if (element->calculateShouldRender(args->_viewFrustum, args->_sizeScale, args->_boundaryLevelAdjust)) {
+            if (element->calculateShouldRenderAtDistance(furthestDistance, args->_sizeScale, args->_boundaryLevelAdjust)) {
                 args->_renderer->renderElement(element, args);
             } else {
                 return false; // if we shouldn't render, then we also should stop recursing.
@@ -159,7 +160,7 @@ void OctreeRenderer::render(RenderMode renderMode) {
     RenderArgs args = { this, _viewFrustum, getSizeScale(), getBoundaryLevelAdjust(), renderMode, 0, 0, 0 };
     if (_tree) {
         _tree->lockForRead();
-        _tree->recurseTreeWithOperation(renderOperation, &args);
+        _tree->recurseTreeInViewWithOperation(*_viewFrustum, renderOperation, &args);
         _tree->unlock();
     }
 }
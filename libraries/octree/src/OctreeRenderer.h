@@ -59,7 +59,8 @@ public:
     ViewFrustum* getViewFrustum() const { return _viewFrustum; }
     void setViewFrustum(ViewFrustum* viewFrustum) { _viewFrustum = viewFrustum; }
 
-    static bool renderOperation(OctreeElement* element, void* extraData);
+    static bool renderOperation(OctreeElement* element, ViewFrustum::location location, float furthestDistance,
+                                void* extraData);
 
     /// clears the tree
     virtual void clear();
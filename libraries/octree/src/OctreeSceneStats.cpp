@@ -57,6 +57,7 @@ OctreeSceneStats& OctreeSceneStats::operator=(const OctreeSceneStats& other) {
 void OctreeSceneStats::copyFromOther(const OctreeSceneStats& other) {
     _totalEncodeTime = other._totalEncodeTime;
     _elapsed = other._elapsed;
+    _usefulElapsed = other._usefulElapsed;
     _lastFullElapsed = other._lastFullElapsed;
     _lastFullTotalEncodeTime = other._lastFullTotalEncodeTime;
     _lastFullTotalPackets = other._lastFullTotalPackets;
@@ -199,6 +200,9 @@ void OctreeSceneStats::sceneCompleted() {
         _end = usecTimestampNow();
         _elapsed = _end - _start;
         _elapsedAverage.updateAverage((float)_elapsed);
+        if (_usefulElapsed == 0) {
+            _usefulElapsed = _elapsed;
+        }
         
         if (_isFullScene) {
             _lastFullElapsed = _elapsed;
@@ -211,6 +215,12 @@ void OctreeSceneStats::sceneCompleted() {
     }
 }
 
+void OctreeSceneStats::sceneUseful() {
+    if (_isStarted && _usefulElapsed == 0) {
+        _usefulElapsed = usecTimestampNow() - _start;
+    }
+}
+
 void OctreeSceneStats::encodeStarted() {
     _encodeStart = usecTimestampNow();
 }
@@ -221,6 +231,7 @@ void OctreeSceneStats::encodeStopped() {
 
 void OctreeSceneStats::reset() {
     _totalEncodeTime = 0;
+    _usefulElapsed = 0;
     _encodeStart = 0;
 
     _packets = 0;
@@ -394,6 +405,8 @@ int OctreeSceneStats::packIntoMessage(unsigned char* destinationBuffer, int avai
     destinationBuffer += sizeof(_elapsed);
     memcpy(destinationBuffer, &_totalEncodeTime, sizeof(_totalEncodeTime));
     destinationBuffer += sizeof(_totalEncodeTime);
+    memcpy(destinationBuffer, &_usefulElapsed, sizeof(_usefulElapsed));
+    destinationBuffer += sizeof(_usefulElapsed);
     memcpy(destinationBuffer, &_isFullScene, sizeof(_isFullScene));
     destinationBuffer += sizeof(_isFullScene);
     memcpy(destinationBuffer, &_isMoving, sizeof(_isMoving));
@@ -495,6 +508,8 @@ int OctreeSceneStats::unpackFromMessage(const unsigned char* sourceBuffer, int a
     sourceBuffer += sizeof(_elapsed);
     memcpy(&_totalEncodeTime, sourceBuffer, sizeof(_totalEncodeTime));
     sourceBuffer += sizeof(_totalEncodeTime);
+    memcpy(&_usefulElapsed, sourceBuffer, sizeof(_usefulElapsed));
+    sourceBuffer += sizeof(_usefulElapsed);
 
     memcpy(&_isFullScene, sourceBuffer, sizeof(_isFullScene));
     sourceBuffer += sizeof(_isFullScene);
@@ -635,6 +650,7 @@ void OctreeSceneStats::printDebugDetails() {
     qDebug() << "end: " << _end;
     qDebug() << "elapsed: " << _elapsed;
     qDebug() << "encoding: " << _totalEncodeTime;
+    qDebug() << "useful: " << _usefulElapsed;
     qDebug();
     qDebug() << "full scene: " << debug::valueOf(_isFullScene);
     qDebug() << "moving: " << debug::valueOf(_isMoving);
@@ -859,6 +875,7 @@ void OctreeSceneStats::trackIncomingOctreePacket(const QByteArray& packet,
     }
     
     _incomingOctreeSequenceNumberStats.sequenceNumberReceived(sequence);
+    _incomingFlightTimeAverage.updateAverage(flightTime);
 
     // track packets here...
     _incomingPacket++;
@@ -42,6 +42,10 @@ public:
     /// Call when the computation of a scene is completed. Finalizes internal structures
     void sceneCompleted();
 
+    /// Call when everything that looks big enough from the view to matter has been sent. Only the first call of a
+    /// scene counts, and a scene completed without one counts as useful only when it is complete.
+    void sceneUseful();
+
     void printDebugDetails();
     
     /// Track that a packet was sent as part of the scene.
@@ -148,11 +152,13 @@ public:
     const std::vector<unsigned char*>& getJurisdictionEndNodes() const { return _jurisdictionEndNodes; }
     
     bool isMoving() const { return _isMoving; };
+    bool isFullScene() const { return _isFullScene; }
     quint64 getTotalElements() const { return _totalElements; }
     quint64 getTotalInternal() const { return _totalInternal; }
     quint64 getTotalLeaves() const { return _totalLeaves; }
     quint64 getTotalEncodeTime() const { return _totalEncodeTime; }
     quint64 getElapsedTime() const { return _elapsed; }
+    quint64 getUsefulElapsedTime() const { return _usefulElapsed; }
 
     quint64 getLastFullElapsedTime() const { return _lastFullElapsed; }
     quint64 getLastFullTotalEncodeTime() const { return _lastFullTotalEncodeTime; }
@@ -184,6 +190,7 @@ private:
     quint64 _start;
     quint64 _end;
     quint64 _elapsed;
+    quint64 _usefulElapsed; // from the start until the elements that matter most to the view were sent, 0 until then
 
     quint64 _lastFullElapsed;
     quint64 _lastFullTotalEncodeTime;
@@ -0,0 +1,95 @@
+//
+//  OctreeSubtreeCache.cpp
+//  libraries/octree/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#include <QtCore/QMutexLocker>
+
+#include <OctalCode.h>
+
+#include "OctreeSubtreeCache.h"
+
+OctreeSubtreeCache::OctreeSubtreeCache(int maxSizeBytes) :
+    _mutex(),
+    _slices(maxSizeBytes),
+    _hits(0),
+    _misses(0),
+    _bytesServed(0)
+{
+}
+
+QByteArray OctreeSubtreeCache::keyFor(const unsigned char* octalCode, int lodLevel,
+                                      bool includeColor, bool includeExistsBits) {
+    int octalCodeBytes = bytesRequiredForCodeLength(numberOfThreeBitSectionsInCode(octalCode));
+
+    QByteArray key;
+    key.reserve(octalCodeBytes + 2);
+    key.append(reinterpret_cast<const char*>(octalCode), octalCodeBytes);
+    key.append((char) lodLevel);
+    key.append((char) ((includeColor ? 1 : 0) | (includeExistsBits ? 2 : 0)));
+    return key;
+}
+
+bool OctreeSubtreeCache::find(const QByteArray& key, quint64 lastChanged, QByteArray& slice, int& levelsBelow) {
+    QMutexLocker locker(&_mutex);
+
+    Slice* cached = _slices.object(key);
+    if (!cached || cached->lastChanged != lastChanged) {
+        if (cached) {
+            // the subtree has changed since it was encoded, this slice will never be valid again
+            _slices.remove(key);
+        }
+        _misses++;
+        return false;
+    }
+
+    _hits++;
+    _bytesServed += cached->data.size();
+    slice = cached->data;
+    levelsBelow = cached->levelsBelow;
+    return true;
+}
+
+void OctreeSubtreeCache::insert(const QByteArray& key, quint64 lastChanged, const unsigned char* slice, int length,
+                                int levelsBelow) {
+    Slice* cached = new Slice();
+    cached->data = QByteArray(reinterpret_cast<const char*>(slice), length);
+    cached->lastChanged = lastChanged;
+    cached->levelsBelow = levelsBelow;
+
+    QMutexLocker locker(&_mutex);
+    _slices.insert(key, cached, key.size() + length);
+}
+
+void OctreeSubtreeCache::clear() {
+    QMutexLocker locker(&_mutex);
+    _slices.clear();
+}
+
+void OctreeSubtreeCache::resetStats() {
+    QMutexLocker locker(&_mutex);
+    _hits = 0;
+    _misses = 0;
+    _bytesServed = 0;
+}
+
+float OctreeSubtreeCache::getHitRatio() const {
+    QMutexLocker locker(&_mutex);
+    quint64 lookups = _hits + _misses;
+    return (lookups > 0) ? ((float)_hits / (float)lookups) : 0.0f;
+}
+
+int OctreeSubtreeCache::getSizeBytes() const {
+    QMutexLocker locker(&_mutex);
+    return _slices.totalCost();
+}
+
+int OctreeSubtreeCache::getSliceCount() const {
+    QMutexLocker locker(&_mutex);
+    return _slices.count();
+}
@@ -0,0 +1,65 @@
+//
+//  OctreeSubtreeCache.h
+//  libraries/octree/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#ifndef hifi_OctreeSubtreeCache_h
+#define hifi_OctreeSubtreeCache_h
+
+#include <QtCore/QByteArray>
+#include <QtCore/QCache>
+#include <QtCore/QMutex>
+
+const int DEFAULT_SUBTREE_CACHE_SIZE_BYTES = 32 * 1024 * 1024;
+
+// slices smaller than this are cheaper to encode again than to look up
+const int MIN_CACHED_SUBTREE_BYTES = 64;
+
+/// Holds encoded subtree bitstreams so that send threads encoding the same part of the tree for different viewers can
+/// copy the bytes instead of walking the subtree again. A slice is keyed by the octal code of its root element, the
+/// level below which the viewer's LOD cuts the subtree off, and the encode flags, and it is only valid for as long as
+/// the root element's last changed time matches the one it was encoded at. Safe to use from several threads.
+class OctreeSubtreeCache {
+public:
+    OctreeSubtreeCache(int maxSizeBytes = DEFAULT_SUBTREE_CACHE_SIZE_BYTES);
+
+    static QByteArray keyFor(const unsigned char* octalCode, int lodLevel, bool includeColor, bool includeExistsBits);
+
+    /// \return true and the slice if one is cached for the key, and it was encoded when the root element last changed
+    bool find(const QByteArray& key, quint64 lastChanged, QByteArray& slice, int& levelsBelow);
+
+    void insert(const QByteArray& key, quint64 lastChanged, const unsigned char* slice, int length, int levelsBelow);
+
+    void clear();
+    void resetStats();
+
+    quint64 getHits() const { return _hits; }
+    quint64 getMisses() const { return _misses; }
+    float getHitRatio() const;
+    quint64 getBytesServed() const { return _bytesServed; }
+    int getSizeBytes() const;
+    int getMaxSizeBytes() const { return _slices.maxCost(); }
+    int getSliceCount() const;
+
+private:
+    class Slice {
+    public:
+        QByteArray data;
+        quint64 lastChanged;
+        int levelsBelow;
+    };
+
+    mutable QMutex _mutex;
+    QCache<QByteArray, Slice> _slices;
+
+    quint64 _hits;
+    quint64 _misses;
+    quint64 _bytesServed;
+};
+
+#endif // hifi_OctreeSubtreeCache_h
@@ -11,6 +11,11 @@
 
 #include <algorithm>
 
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define VIEW_FRUSTUM_SSE
+#include <xmmintrin.h>
+#endif
+
 #include <glm/glm.hpp>
 #include <glm/gtx/quaternion.hpp>
 #include <glm/gtx/transform.hpp>
@@ -392,6 +397,158 @@ ViewFrustum::location ViewFrustum::cubeInFrustum(const AACube& cube) const {
     return regularResult;
 }
 
+const char* ViewFrustum::getChildCubesInstructionSetName() {
+#ifdef VIEW_FRUSTUM_SSE
+    return "sse";
+#else
+    return "scalar";
+#endif
+}
+
+// the child's corner is at the upper half of its parent on the axis if this bit of its index is set, the same as
+// copyFirstVertexForCode() has it: x in the high bit, z in the low one
+static bool isChildUpperOnAxis(int childIndex, int axis) {
+    return (childIndex >> (2 - axis)) & 1;
+}
+
+#ifdef VIEW_FRUSTUM_SSE
+
+static inline __m128 selectLanes(__m128 mask, __m128 ifSet, __m128 ifClear) {
+    return _mm_or_ps(_mm_and_ps(mask, ifSet), _mm_andnot_ps(mask, ifClear));
+}
+
+// the same order of operations as glm::dot() on each lane, so that the results are the same as the scalar ones
+static inline __m128 dotLanes(__m128 ax, __m128 ay, __m128 az, __m128 bx, __m128 by, __m128 bz) {
+    return _mm_add_ps(_mm_add_ps(_mm_mul_ps(ax, bx), _mm_mul_ps(ay, by)), _mm_mul_ps(az, bz));
+}
+
+// moves the lane bits of a movemask of the half of the children to their child bits
+static inline unsigned char childBitsForLanes(int laneBits, int half) {
+    const int CHILDREN_PER_HALF = 4;
+    unsigned char childBits = 0;
+    for (int lane = 0; lane < CHILDREN_PER_HALF; lane++) {
+        if (laneBits & (1 << lane)) {
+            childBits |= 1 << (7 - (half * CHILDREN_PER_HALF + lane));
+        }
+    }
+    return childBits;
+}
+
+#endif
+
+void ViewFrustum::childCubesInFrustum(const AACube& cube, ChildCubeLocations& locations) const {
+    float childScale = cube.getScale() * 0.5f;
+    const glm::vec3& lowerCorner = cube.getCorner();
+    glm::vec3 upperCorner = lowerCorner + childScale;
+
+#ifdef VIEW_FRUSTUM_SSE
+    // a child can only be in the keyhole if the keyhole's bounding cube contains it, so if the parent doesn't even
+    // touch that, none of the children are. The children of the few that do are tested one at a time.
+    unsigned char keyholeInsideBits = 0;
+    unsigned char keyholeIntersectBits = 0;
+    if (_keyholeRadius >= 0.0f && _keyholeBoundingCube.touches(cube)) {
+        for (int i = 0; i < NUMBER_OF_CHILDREN; i++) {
+            glm::vec3 childCorner(isChildUpperOnAxis(i, 0) ? upperCorner.x : lowerCorner.x,
+                                  isChildUpperOnAxis(i, 1) ? upperCorner.y : lowerCorner.y,
+                                  isChildUpperOnAxis(i, 2) ? upperCorner.z : lowerCorner.z);
+            ViewFrustum::location keyholeResult = cubeInKeyhole(AACube(childCorner, childScale));
+            if (keyholeResult == INSIDE) {
+                keyholeInsideBits |= 1 << (7 - i);
+            } else if (keyholeResult == INTERSECT) {
+                keyholeIntersectBits |= 1 << (7 - i);
+            }
+        }
+    }
+
+    // the children are in two halves of four lanes, the lower half on x and the upper one. In each half y is lower for
+    // the first two and z alternates, and _mm_set_ps() takes the lanes from the last.
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 scale = _mm_set1_ps(childScale);
+    const __m128 halfScale = _mm_set1_ps(childScale * 0.5f);
+    const __m128 positionX = _mm_set1_ps(_position.x);
+    const __m128 positionY = _mm_set1_ps(_position.y);
+    const __m128 positionZ = _mm_set1_ps(_position.z);
+    const __m128 y = _mm_set_ps(upperCorner.y, upperCorner.y, lowerCorner.y, lowerCorner.y);
+    const __m128 z = _mm_set_ps(upperCorner.z, lowerCorner.z, upperCorner.z, lowerCorner.z);
+    const __m128 yUp = _mm_add_ps(y, scale);
+    const __m128 zUp = _mm_add_ps(z, scale);
+
+    unsigned char frustumOutsideBits = 0;
+    unsigned char frustumIntersectBits = 0;
+    for (int half = 0; half < 2; half++) {
+        const __m128 x = _mm_set1_ps(half ? upperCorner.x : lowerCorner.x);
+        const __m128 xUp = _mm_add_ps(x, scale);
+
+        // a child is outside if its corner furthest along a plane's normal is behind the plane, and intersects it if
+        // only the nearest one is, as in cubeInFrustum()
+        __m128 outside = zero;
+        __m128 intersect = zero;
+        for (int i = 0; i < 6; i++) {
+            const glm::vec3& normal = _planes[i].getNormal();
+            const __m128 normalX = _mm_set1_ps(normal.x);
+            const __m128 normalY = _mm_set1_ps(normal.y);
+            const __m128 normalZ = _mm_set1_ps(normal.z);
+            const __m128 dCoefficient = _mm_set1_ps(_planes[i].getDCoefficient());
+
+            __m128 vertexPDistance = _mm_add_ps(dCoefficient, dotLanes(normalX, normalY, normalZ,
+                normal.x > 0 ? xUp : x, normal.y > 0 ? yUp : y, normal.z > 0 ? zUp : z));
+            __m128 vertexNDistance = _mm_add_ps(dCoefficient, dotLanes(normalX, normalY, normalZ,
+                normal.x < 0 ? xUp : x, normal.y < 0 ? yUp : y, normal.z < 0 ? zUp : z));
+            outside = _mm_or_ps(outside, _mm_cmplt_ps(vertexPDistance, zero));
+            intersect = _mm_or_ps(intersect, _mm_cmplt_ps(vertexNDistance, zero));
+        }
+        frustumOutsideBits |= childBitsForLanes(_mm_movemask_ps(outside), half);
+        frustumIntersectBits |= childBitsForLanes(_mm_movemask_ps(intersect), half);
+
+        // the distances to the centers, and to the corners on the far side of the centers from the camera
+        __m128 toCenterX = _mm_sub_ps(positionX, _mm_add_ps(x, halfScale));
+        __m128 toCenterY = _mm_sub_ps(positionY, _mm_add_ps(y, halfScale));
+        __m128 toCenterZ = _mm_sub_ps(positionZ, _mm_add_ps(z, halfScale));
+        _mm_storeu_ps(locations.distances + half * 4,
+                      _mm_sqrt_ps(dotLanes(toCenterX, toCenterY, toCenterZ, toCenterX, toCenterY, toCenterZ)));
+
+        __m128 toFurthestX = _mm_sub_ps(positionX,
+                                        selectLanes(_mm_cmplt_ps(positionX, _mm_add_ps(x, halfScale)), xUp, x));
+        __m128 toFurthestY = _mm_sub_ps(positionY,
+                                        selectLanes(_mm_cmplt_ps(positionY, _mm_add_ps(y, halfScale)), yUp, y));
+        __m128 toFurthestZ = _mm_sub_ps(positionZ,
+                                        selectLanes(_mm_cmplt_ps(positionZ, _mm_add_ps(z, halfScale)), zUp, z));
+        _mm_storeu_ps(locations.furthestDistances + half * 4,
+                      _mm_sqrt_ps(dotLanes(toFurthestX, toFurthestY, toFurthestZ, toFurthestX, toFurthestY, toFurthestZ)));
+    }
+
+    // inside the keyhole wins, outside the planes leaves what the keyhole says, and otherwise the planes decide
+    unsigned char frustumInsideBits = ~(frustumOutsideBits | frustumIntersectBits);
+    locations.insideBits = keyholeInsideBits | frustumInsideBits;
+    locations.intersectBits = ~locations.insideBits
+        & ((frustumOutsideBits & keyholeIntersectBits) | (~frustumOutsideBits & frustumIntersectBits));
+#else
+    locations.insideBits = 0;
+    locations.intersectBits = 0;
+    for (int i = 0; i < NUMBER_OF_CHILDREN; i++) {
+        glm::vec3 childCorner(isChildUpperOnAxis(i, 0) ? upperCorner.x : lowerCorner.x,
+                              isChildUpperOnAxis(i, 1) ? upperCorner.y : lowerCorner.y,
+                              isChildUpperOnAxis(i, 2) ? upperCorner.z : lowerCorner.z);
+        AACube childCube(childCorner, childScale);
+
+        ViewFrustum::location location = cubeInFrustum(childCube);
+        if (location == INSIDE) {
+            locations.insideBits |= 1 << (7 - i);
+        } else if (location == INTERSECT) {
+            locations.intersectBits |= 1 << (7 - i);
+        }
+
+        glm::vec3 toCenter = _position - childCube.calcCenter();
+        locations.distances[i] = sqrtf(glm::dot(toCenter, toCenter));
+
+        glm::vec3 furthestPoint;
+        getFurthestPointFromCamera(childCube, furthestPoint);
+        glm::vec3 toFurthest = _position - furthestPoint;
+        locations.furthestDistances[i] = sqrtf(glm::dot(toFurthest, toFurthest));
+    }
+#endif
+}
+
 bool testMatches(glm::quat lhs, glm::quat rhs, float epsilon = EPSILON) {
     return (fabs(lhs.x - rhs.x) <= epsilon && fabs(lhs.y - rhs.y) <= epsilon && fabs(lhs.z - rhs.z) <= epsilon
             && fabs(lhs.w - rhs.w) <= epsilon);
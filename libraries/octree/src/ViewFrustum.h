@@ -17,6 +17,8 @@
 #include <glm/glm.hpp>
 #include <glm/gtc/quaternion.hpp>
 
+#include <SharedUtil.h>
+
 #include "AABox.h"
 #include "AACube.h"
 #include "Plane.h"
@@ -30,6 +32,8 @@ const float DEFAULT_ASPECT_RATIO = 16.f/9.f;
 const float DEFAULT_NEAR_CLIP = 0.08f;
 const float DEFAULT_FAR_CLIP = TREE_SCALE;
 
+class ChildCubeLocations;
+
 class ViewFrustum {
 public:
     // setters for camera attributes
@@ -98,6 +102,14 @@ public:
     ViewFrustum::location cubeInFrustum(const AACube& cube) const;
     ViewFrustum::location boxInFrustum(const AABox& box) const;
 
+    /// Finds where each of the eight children of the cube is, with the same results as cubeInFrustum() on each of them,
+    /// and how far each is from the camera. The children are tested against the planes together, four at a time with
+    /// SSE where the library is compiled with it.
+    void childCubesInFrustum(const AACube& cube, ChildCubeLocations& locations) const;
+
+    /// the instruction set childCubesInFrustum() was compiled for: "sse" or "scalar"
+    static const char* getChildCubesInstructionSetName();
+
     // some frustum comparisons
     bool matches(const ViewFrustum& compareTo, bool debug = false) const;
     bool matches(const ViewFrustum* compareTo, bool debug = false) const { return matches(*compareTo, debug); }
@@ -178,4 +190,21 @@ private:
 };
 
 
+/// Where the children of a cube are relative to a view frustum, from ViewFrustum::childCubesInFrustum(). The bits are
+/// by child index with child 0 in the high bit, like the octree's child bit masks, and the distances are in TREE_SCALE.
+class ChildCubeLocations {
+public:
+    unsigned char insideBits;
+    unsigned char intersectBits; // the children in neither are OUTSIDE
+    float distances[NUMBER_OF_CHILDREN]; // from the camera to the center of each child
+    float furthestDistances[NUMBER_OF_CHILDREN]; // from the camera to the corner of each child furthest from it
+
+    unsigned char getInViewBits() const { return insideBits | intersectBits; }
+    bool isInView(int childIndex) const { return oneAtBit(getInViewBits(), childIndex); }
+    ViewFrustum::location getLocation(int childIndex) const {
+        return oneAtBit(insideBits, childIndex) ? ViewFrustum::INSIDE
+            : (oneAtBit(intersectBits, childIndex) ? ViewFrustum::INTERSECT : ViewFrustum::OUTSIDE);
+    }
+};
+
 #endif // hifi_ViewFrustum_h
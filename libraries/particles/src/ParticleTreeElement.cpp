@@ -19,7 +19,7 @@ ParticleTreeElement::ParticleTreeElement(unsigned char* octalCode) : OctreeEleme
 };
 
 ParticleTreeElement::~ParticleTreeElement() {
-    _voxelMemoryUsage -= sizeof(ParticleTreeElement);
+    statistics().voxelMemoryUsage -= sizeof(ParticleTreeElement);
     QList<Particle>* tmpParticles = _particles;
     _particles = NULL;
     delete tmpParticles;
@@ -38,7 +38,7 @@ OctreeElement* ParticleTreeElement::createNewElement(unsigned char* octalCode) {
 void ParticleTreeElement::init(unsigned char* octalCode) {
     OctreeElement::init(octalCode);
     _particles = new QList<Particle>;
-    _voxelMemoryUsage += sizeof(ParticleTreeElement);
+    statistics().voxelMemoryUsage += sizeof(ParticleTreeElement);
 }
 
 ParticleTreeElement* ParticleTreeElement::addChildAtIndex(int index) {
@@ -16,7 +16,8 @@
 
 GenericThread::GenericThread() :
     _stopThread(false),
-    _isThreaded(false) // assume non-threaded, must call initialize()
+    _isThreaded(false), // assume non-threaded, must call initialize()
+    _thread(NULL)
 {
 }
 
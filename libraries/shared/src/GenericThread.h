@@ -28,7 +28,7 @@ public:
 
     /// Call to start the thread.
     /// \param bool isThreaded true by default. false for non-threaded mode and caller must call threadRoutine() regularly.
-    void initialize(bool isThreaded = true);
+    virtual void initialize(bool isThreaded = true);
 
     /// Call to stop the thread
     void terminate();
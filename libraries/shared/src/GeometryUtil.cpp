@@ -278,6 +278,18 @@ int computeDirection(float xi, float yi, float xj, float yj, float xk, float yk)
   return a < b ? -1 : a > b ? 1 : 0;
 }
 
+glm::ivec3 gridCellForPosition(const glm::vec3& position, float cellSize) {
+    return glm::ivec3(floorf(position.x / cellSize), floorf(position.y / cellSize), floorf(position.z / cellSize));
+}
+
+quint64 gridCellKey(const glm::ivec3& cell) {
+    // 21 bits per axis is plenty for the size of a domain at the grid cell sizes the mixers use
+    const quint64 AXIS_MASK = (1 << 21) - 1;
+    return ((quint64) (cell.x & AXIS_MASK) << 42)
+        | ((quint64) (cell.y & AXIS_MASK) << 21)
+        | (quint64) (cell.z & AXIS_MASK);
+}
+
 
 //
 // Polygon Clipping routines inspired by, pseudo code found here: http://www.cs.rit.edu/~icss571/clipTrans/PolyClipBack.html
@@ -14,6 +14,8 @@
 
 #include <glm/glm.hpp>
 
+#include <QtGlobal>
+
 glm::vec3 computeVectorFromPointToSegment(const glm::vec3& point, const glm::vec3& start, const glm::vec3& end);
 
 /// Computes the penetration between a point and a sphere (centered at the origin)
@@ -80,6 +82,12 @@ bool doLineSegmentsIntersect(glm::vec2 r1p1, glm::vec2 r1p2, glm::vec2 r2p1, glm
 bool isOnSegment(float xi, float yi, float xj, float yj, float xk, float yk);
 int computeDirection(float xi, float yi, float xj, float yj, float xk, float yk);
 
+/// the coordinates of the cell that contains the position in a uniform grid with the given cell size
+glm::ivec3 gridCellForPosition(const glm::vec3& position, float cellSize);
+
+/// packs the coordinates of a uniform grid cell into a key for hashing the occupied cells of a sparse grid
+quint64 gridCellKey(const glm::ivec3& cell);
+
 
 typedef glm::vec2 LineSegment2[2];
 
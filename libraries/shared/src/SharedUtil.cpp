@@ -556,6 +556,68 @@ int unpackOrientationQuatFromBytes(const unsigned char* buffer, glm::quat& quatO
     return sizeof(quatParts);
 }
 
+const int SMALLEST_THREE_COMPONENT_BITS = 10;
+const quint32 SMALLEST_THREE_MAX_PART = (1 << SMALLEST_THREE_COMPONENT_BITS) - 1;
+const quint32 SMALLEST_THREE_INDEX_MASK = 3;
+
+// none of the three smallest components of a unit quat can be larger than 1 / sqrt(2)
+const float SMALLEST_THREE_COMPONENT_RANGE = 0.70710678f;
+
+int packOrientationQuatToSmallestThree(unsigned char* buffer, const glm::quat& quatInput) {
+    glm::quat quat = glm::normalize(quatInput);
+    float components[4] = { quat.x, quat.y, quat.z, quat.w };
+    
+    int largestIndex = 0;
+    for (int i = 1; i < 4; i++) {
+        if (fabsf(components[i]) > fabsf(components[largestIndex])) {
+            largestIndex = i;
+        }
+    }
+    
+    // q and -q are the same orientation, so flip the quat to make the dropped component positive
+    float sign = (components[largestIndex] < 0.0f) ? -1.0f : 1.0f;
+    
+    quint32 packedQuat = largestIndex;
+    int shift = 2;
+    for (int i = 0; i < 4; i++) {
+        if (i != largestIndex) {
+            float ratio = (sign * components[i] + SMALLEST_THREE_COMPONENT_RANGE) / (2.0f * SMALLEST_THREE_COMPONENT_RANGE);
+            float part = glm::clamp(floorf(ratio * SMALLEST_THREE_MAX_PART + 0.5f), 0.0f, (float) SMALLEST_THREE_MAX_PART);
+            packedQuat |= ((quint32) part) << shift;
+            shift += SMALLEST_THREE_COMPONENT_BITS;
+        }
+    }
+    
+    memcpy(buffer, &packedQuat, sizeof(packedQuat));
+    return sizeof(packedQuat);
+}
+
+int unpackOrientationQuatFromSmallestThree(const unsigned char* buffer, glm::quat& quatOutput) {
+    quint32 packedQuat;
+    memcpy(&packedQuat, buffer, sizeof(packedQuat));
+    
+    int largestIndex = packedQuat & SMALLEST_THREE_INDEX_MASK;
+    float components[4];
+    float sumOfSquares = 0.0f;
+    int shift = 2;
+    for (int i = 0; i < 4; i++) {
+        if (i != largestIndex) {
+            quint32 part = (packedQuat >> shift) & SMALLEST_THREE_MAX_PART;
+            components[i] = ((part / (float) SMALLEST_THREE_MAX_PART) * 2.0f - 1.0f) * SMALLEST_THREE_COMPONENT_RANGE;
+            sumOfSquares += components[i] * components[i];
+            shift += SMALLEST_THREE_COMPONENT_BITS;
+        }
+    }
+    components[largestIndex] = sqrtf(std::max(1.0f - sumOfSquares, 0.0f));
+    
+    quatOutput.x = components[0];
+    quatOutput.y = components[1];
+    quatOutput.z = components[2];
+    quatOutput.w = components[3];
+    
+    return sizeof(packedQuat);
+}
+
 float SMALL_LIMIT = 10.f;
 float LARGE_LIMIT = 1000.f;
 
@@ -136,6 +136,11 @@ int unpackFloatAngleFromTwoByte(const uint16_t* byteAnglePointer, float* destina
 int packOrientationQuatToBytes(unsigned char* buffer, const glm::quat& quatInput);
 int unpackOrientationQuatFromBytes(const unsigned char* buffer, glm::quat& quatOutput);
 
+// Smallest-three orientation quats drop the largest component, which the unit length lets us recover, and encode
+// the other three in 10 bits each along with the 2 bit index of the one that was dropped, for 4 bytes in total
+int packOrientationQuatToSmallestThree(unsigned char* buffer, const glm::quat& quatInput);
+int unpackOrientationQuatFromSmallestThree(const unsigned char* buffer, glm::quat& quatOutput);
+
 // Ratios need the be highly accurate when less than 10, but not very accurate above 10, and they
 // are never greater than 1000 to 1, this allows us to encode each component in 16bits
 int packFloatRatioToTwoByte(unsigned char* buffer, float ratio);
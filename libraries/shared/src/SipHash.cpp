@@ -0,0 +1,118 @@
+//
+//  SipHash.cpp
+//  libraries/shared/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#include <cstring>
+
+#include "SipHash.h"
+
+static inline uint64_t rotateLeft(uint64_t value, int bits) {
+    return (value << bits) | (value >> (64 - bits));
+}
+
+static inline uint64_t readLittleEndian64(const unsigned char* bytes) {
+    uint64_t value = 0;
+    for (int i = 7; i >= 0; i--) {
+        value = (value << 8) | bytes[i];
+    }
+    return value;
+}
+
+static inline void writeLittleEndian64(uint64_t value, unsigned char* bytes) {
+    for (int i = 0; i < 8; i++) {
+        bytes[i] = (unsigned char)(value >> (8 * i));
+    }
+}
+
+#define SIPROUND \
+    do { \
+        _v0 += _v1; _v1 = rotateLeft(_v1, 13); _v1 ^= _v0; _v0 = rotateLeft(_v0, 32); \
+        _v2 += _v3; _v3 = rotateLeft(_v3, 16); _v3 ^= _v2; \
+        _v0 += _v3; _v3 = rotateLeft(_v3, 21); _v3 ^= _v0; \
+        _v2 += _v1; _v1 = rotateLeft(_v1, 17); _v1 ^= _v2; _v2 = rotateLeft(_v2, 32); \
+    } while (0)
+
+SipHash::SipHash(const unsigned char* key) :
+    _tailLength(0),
+    _totalLength(0)
+{
+    uint64_t k0 = readLittleEndian64(key);
+    uint64_t k1 = readLittleEndian64(key + 8);
+
+    _v0 = 0x736f6d6570736575ULL ^ k0;
+    _v1 = 0x646f72616e646f6dULL ^ k1;
+    _v2 = 0x6c7967656e657261ULL ^ k0;
+    _v3 = 0x7465646279746573ULL ^ k1;
+
+    // the 128 bit variant
+    _v1 ^= 0xee;
+}
+
+void SipHash::compress(uint64_t message) {
+    _v3 ^= message;
+    SIPROUND;
+    SIPROUND;
+    _v0 ^= message;
+}
+
+void SipHash::addData(const char* data, int length) {
+    const unsigned char* bytes = reinterpret_cast<const unsigned char*>(data);
+    _totalLength += length;
+
+    // finish a word started by the last call
+    if (_tailLength > 0) {
+        while (_tailLength < 8 && length > 0) {
+            _tail[_tailLength++] = *bytes++;
+            length--;
+        }
+        if (_tailLength < 8) {
+            return;
+        }
+        compress(readLittleEndian64(_tail));
+        _tailLength = 0;
+    }
+
+    while (length >= 8) {
+        compress(readLittleEndian64(bytes));
+        bytes += 8;
+        length -= 8;
+    }
+
+    memcpy(_tail, bytes, length);
+    _tailLength = length;
+}
+
+void SipHash::result128(unsigned char* result) {
+    // the last word holds the leftover bytes and the low byte of the length
+    uint64_t last = ((uint64_t)(_totalLength & 0xff)) << 56;
+    for (int i = 0; i < _tailLength; i++) {
+        last |= ((uint64_t)_tail[i]) << (8 * i);
+    }
+    compress(last);
+
+    _v2 ^= 0xee;
+    SIPROUND;
+    SIPROUND;
+    SIPROUND;
+    SIPROUND;
+    writeLittleEndian64(_v0 ^ _v1 ^ _v2 ^ _v3, result);
+
+    _v1 ^= 0xdd;
+    SIPROUND;
+    SIPROUND;
+    SIPROUND;
+    SIPROUND;
+    writeLittleEndian64(_v0 ^ _v1 ^ _v2 ^ _v3, result + 8);
+}
+
+void SipHash::hash128(const unsigned char* key, const char* data, int length, unsigned char* result) {
+    SipHash hash(key);
+    hash.addData(data, length);
+    hash.result128(result);
+}
@@ -0,0 +1,45 @@
+//
+//  SipHash.h
+//  libraries/shared/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#ifndef hifi_SipHash_h
+#define hifi_SipHash_h
+
+#include <stdint.h>
+
+const int SIPHASH_KEY_BYTES = 16;
+const int SIPHASH_128_BYTES = 16;
+
+/// SipHash-2-4 with a 128 bit result, a keyed hash that is fast on short inputs like packets. Data can be added in as
+/// many pieces as convenient, the result only depends on the bytes added.
+class SipHash {
+public:
+    SipHash(const unsigned char* key);
+
+    void addData(const char* data, int length);
+
+    /// writes SIPHASH_128_BYTES bytes of result, after which no more data can be added
+    void result128(unsigned char* result);
+
+    static void hash128(const unsigned char* key, const char* data, int length, unsigned char* result);
+
+private:
+    void compress(uint64_t message);
+
+    uint64_t _v0;
+    uint64_t _v1;
+    uint64_t _v2;
+    uint64_t _v3;
+
+    unsigned char _tail[8]; // bytes not yet compressed, always fewer than 8
+    int _tailLength;
+    int _totalLength;
+};
+
+#endif // hifi_SipHash_h
@@ -16,6 +16,8 @@
 #include <QRgb>
 
 
+#include <OctreeElementIndex.h>
+
 #include "VoxelTree.h"
 #include "Tags.h"
 
@@ -429,10 +431,55 @@ void VoxelTree::readCodeColorBufferToTree(const unsigned char* codeColorBuffer,
     args.lengthOfCode = numberOfThreeBitSectionsInCode(codeColorBuffer);
     args.destructive = destructive;
     args.pathChanged = false;
+    if (_elementIndex && readCodeColorBufferToIndexedLeaf(args)) {
+        return;
+    }
     VoxelTreeElement* node = getRoot();
     readCodeColorBufferToTreeRecursion(node, args);
 }
 
+// Colors a leaf that is already in the tree without descending to it, and then does what the recursion does unwinding
+// to its ancestors, which the index finds too. Returns false, having changed nothing, if the edit needs elements made
+// or deleted, which the recursion does.
+bool VoxelTree::readCodeColorBufferToIndexedLeaf(ReadCodeColorBufferToTreeArgs& args) {
+    quint64 key = OctreeElementIndex::keyForOctalCode(args.codeColorBuffer);
+    VoxelTreeElement* node = static_cast<VoxelTreeElement*>(_elementIndex->find(key));
+    if (!node || !node->isLeaf()) {
+        return false;
+    }
+
+    colorLeafFromCodeColorBuffer(node, args);
+    if (args.pathChanged) {
+        for (quint64 ancestorKey = OctreeElementIndex::parentKey(key); ancestorKey;
+                ancestorKey = OctreeElementIndex::parentKey(ancestorKey)) {
+            OctreeElement* ancestor = _elementIndex->find(ancestorKey);
+            if (ancestor) {
+                ancestor->handleSubtreeChanged(this);
+            }
+        }
+    }
+    return true;
+}
+
+void VoxelTree::colorLeafFromCodeColorBuffer(VoxelTreeElement* node, ReadCodeColorBufferToTreeArgs& args) {
+    // give this node its color
+    int octalCodeBytes = bytesRequiredForCodeLength(args.lengthOfCode);
+
+    nodeColor newColor;
+    memcpy(newColor, args.codeColorBuffer + octalCodeBytes, SIZE_OF_COLOR_DATA);
+    newColor[SIZE_OF_COLOR_DATA] = 1;
+    node->setColor(newColor);
+
+    // It's possible we just reset the node to it's exact same color, in
+    // which case we don't consider this to be dirty...
+    if (node->isDirty()) {
+        // track our tree dirtiness
+        _isDirty = true;
+        // track that path has changed
+        args.pathChanged = true;
+    }
+}
+
 void VoxelTree::readCodeColorBufferToTreeRecursion(VoxelTreeElement* node, ReadCodeColorBufferToTreeArgs& args) {
     int lengthOfNodeCode = numberOfThreeBitSectionsInCode(node->getOctalCode());
 
@@ -456,22 +503,7 @@ void VoxelTree::readCodeColorBufferToTreeRecursion(VoxelTreeElement* node, ReadC
         // If we get here, then it means, we either had a true leaf to begin with, or we were in
         // destructive mode and we deleted all the child trees. So we can color.
         if (node->isLeaf()) {
-            // give this node its color
-            int octalCodeBytes = bytesRequiredForCodeLength(args.lengthOfCode);
-
-            nodeColor newColor;
-            memcpy(newColor, args.codeColorBuffer + octalCodeBytes, SIZE_OF_COLOR_DATA);
-            newColor[SIZE_OF_COLOR_DATA] = 1;
-            node->setColor(newColor);
-
-            // It's possible we just reset the node to it's exact same color, in
-            // which case we don't consider this to be dirty...
-            if (node->isDirty()) {
-                // track our tree dirtiness
-                _isDirty = true;
-                // track that path has changed
-                args.pathChanged = true;
-            }
+            colorLeafFromCodeColorBuffer(node, args);
         }
         return;
     }
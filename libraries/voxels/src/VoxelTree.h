@@ -56,6 +56,9 @@ public:
     virtual int processEditPacketData(PacketType packetType, const unsigned char* packetData, int packetLength,
                     const unsigned char* editData, int maxLength, const SharedNodePointer& node);
     virtual bool recurseChildrenWithData() const { return false; }
+    virtual bool canCacheEncodedSubtrees() const { return true; }
+    virtual bool supportsSnapshotReads() const { return true; }
+    virtual int getFixedElementDataBytes() const { return BYTES_PER_COLOR; }
 
 private:
     // helper functions for nudgeSubTree
@@ -64,6 +67,8 @@ private:
     void nudgeLeaf(VoxelTreeElement* element, void* extraData);
     void chunkifyLeaf(VoxelTreeElement* element);
     void readCodeColorBufferToTreeRecursion(VoxelTreeElement* node, ReadCodeColorBufferToTreeArgs& args);
+    bool readCodeColorBufferToIndexedLeaf(ReadCodeColorBufferToTreeArgs& args);
+    void colorLeafFromCodeColorBuffer(VoxelTreeElement* node, ReadCodeColorBufferToTreeArgs& args);
 };
 
 #endif // hifi_VoxelTree_h
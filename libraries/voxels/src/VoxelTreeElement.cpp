@@ -10,6 +10,7 @@
 //
 
 #include <NodeList.h>
+#include <OctreeElementReclaimer.h>
 #include <PerfStat.h>
 
 #include "VoxelConstants.h"
@@ -25,7 +26,7 @@ VoxelTreeElement::VoxelTreeElement(unsigned char* octalCode) :
 };
 
 VoxelTreeElement::~VoxelTreeElement() {
-    _voxelMemoryUsage -= sizeof(VoxelTreeElement);
+    statistics().voxelMemoryUsage -= sizeof(VoxelTreeElement);
 }
 
 // This will be called primarily on addChildAt(), which means we're adding a child of our
@@ -45,7 +46,7 @@ void VoxelTreeElement::init(unsigned char* octalCode) {
     _color[0] = _color[1] = _color[2] = _color[3] = 0;
     _density = 0.0f;
     OctreeElement::init(octalCode);
-    _voxelMemoryUsage += sizeof(VoxelTreeElement);
+    statistics().voxelMemoryUsage += sizeof(VoxelTreeElement);
 }
 
 bool VoxelTreeElement::requiresSplit() const {
@@ -208,8 +209,9 @@ bool VoxelTreeElement::collapseChildren() {
         //qDebug("allChildrenMatch: pruning tree\n");
         for (int i = 0; i < NUMBER_OF_CHILDREN; i++) {
             OctreeElement* childAt = getChildAtIndex(i);
-            delete childAt; // delete all the child nodes
-            setChildAtIndex(i, NULL); // set it to NULL
+            // unlink the child before retiring it, snapshot readers may still be walking it
+            setChildAtIndex(i, NULL);
+            OctreeElementReclaimer::retire(childAt);
         }
         nodeColor collapsedColor;
         collapsedColor[0]=red;
@@ -12,10 +12,6 @@
 #ifndef hifi_VoxelTreeElement_h
 #define hifi_VoxelTreeElement_h
 
-//#define HAS_AUDIT_CHILDREN
-//#define SIMPLE_CHILD_ARRAY
-#define SIMPLE_EXTERNAL_CHILDREN
-
 #include <QReadWriteLock>
 
 #include <AACube.h>
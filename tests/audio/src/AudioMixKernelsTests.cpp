@@ -0,0 +1,177 @@
+//
+//  AudioMixKernelsTests.cpp
+//  tests/audio/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <AudioMixKernels.h>
+#include <AudioRingBuffer.h>
+#include <SharedUtil.h>
+
+#include "AudioMixKernelsTests.h"
+
+const int NUM_TEST_STREAMS = 64;
+const int MAX_TEST_DELAY_SAMPLES = 20;
+const int STREAM_SAMPLES = NETWORK_BUFFER_LENGTH_SAMPLES_STEREO + MAX_TEST_DELAY_SAMPLES;
+
+static int16_t testStreams[NUM_TEST_STREAMS][STREAM_SAMPLES];
+static float testGains[NUM_TEST_STREAMS];
+static int testDelays[NUM_TEST_STREAMS];
+
+static void fillTestStreams() {
+    srand(1);
+    for (int i = 0; i < NUM_TEST_STREAMS; i++) {
+        for (int s = 0; s < STREAM_SAMPLES; s++) {
+            testStreams[i][s] = (rand() % (MAX_SAMPLE_VALUE - MIN_SAMPLE_VALUE)) + MIN_SAMPLE_VALUE;
+        }
+        testGains[i] = randFloat();
+        testDelays[i] = rand() % (MAX_TEST_DELAY_SAMPLES + 1);
+    }
+}
+
+void AudioMixKernelsTests::testKernelsMatchScalar() {
+    // odd lengths so that the scalar tails of the vector kernels are covered too
+    const int NUM_FRAMES = NETWORK_BUFFER_LENGTH_SAMPLES_PER_CHANNEL - 3;
+    const int NUM_SAMPLES = NUM_FRAMES * 2;
+
+    float vectorMix[NETWORK_BUFFER_LENGTH_SAMPLES_STEREO];
+    float scalarMix[NETWORK_BUFFER_LENGTH_SAMPLES_STEREO];
+    memset(vectorMix, 0, sizeof(vectorMix));
+    memset(scalarMix, 0, sizeof(scalarMix));
+
+    for (int i = 0; i < NUM_TEST_STREAMS; i++) {
+        const int16_t* delayed = testStreams[i];
+        const int16_t* good = testStreams[i] + testDelays[i];
+
+        if (i % 3 == 0) {
+            AudioMixKernels::mixWithGain(vectorMix, good, testGains[i], NUM_SAMPLES);
+            AudioMixKernels::mixWithGainScalar(scalarMix, good, testGains[i], NUM_SAMPLES);
+        } else {
+            AudioMixKernels::mixMonoToStereo(vectorMix, good, testGains[i], delayed, testGains[i] * 0.5f, NUM_FRAMES);
+            AudioMixKernels::mixMonoToStereoScalar(scalarMix, good, testGains[i], delayed, testGains[i] * 0.5f,
+                                                   NUM_FRAMES);
+        }
+    }
+
+    const float MAX_ACCUMULATED_ERROR = 0.5f;
+    for (int s = 0; s < NUM_SAMPLES; s++) {
+        if (fabsf(vectorMix[s] - scalarMix[s]) > MAX_ACCUMULATED_ERROR) {
+            qDebug("FAIL: %s mix sample %d is %f, scalar mix is %f", AudioMixKernels::getInstructionSetName(),
+                   s, vectorMix[s], scalarMix[s]);
+            return;
+        }
+    }
+
+    int16_t vectorOutput[NETWORK_BUFFER_LENGTH_SAMPLES_STEREO];
+    int16_t scalarOutput[NETWORK_BUFFER_LENGTH_SAMPLES_STEREO];
+    AudioMixKernels::saturateMix(vectorOutput, scalarMix, NUM_SAMPLES);
+    AudioMixKernels::saturateMixScalar(scalarOutput, scalarMix, NUM_SAMPLES);
+
+    int numSaturated = 0;
+    for (int s = 0; s < NUM_SAMPLES; s++) {
+        if (vectorOutput[s] != scalarOutput[s]) {
+            qDebug("FAIL: %s saturated sample %d is %d, scalar is %d", AudioMixKernels::getInstructionSetName(),
+                   s, vectorOutput[s], scalarOutput[s]);
+            return;
+        }
+        if (scalarOutput[s] == MAX_SAMPLE_VALUE || scalarOutput[s] == MIN_SAMPLE_VALUE) {
+            ++numSaturated;
+        }
+    }
+
+    qDebug("%s mix kernels match the scalar kernels, %d of %d samples saturated", AudioMixKernels::getInstructionSetName(),
+           numSaturated, NUM_SAMPLES);
+}
+
+// the mono and stereo loops from AudioMixer::addStreamToMixForListeningNodeWithStream before the mix kernels
+static void legacyMixMono(int16_t* clientSamples, const int16_t* streamPopOutput, float attenuationCoefficient,
+                          float weakChannelAmplitudeRatio, int numSamplesDelay, int delayedChannelOffset) {
+    int goodChannelOffset = delayedChannelOffset == 0 ? 1 : 0;
+    int16_t correctStreamSample[2], delayStreamSample[2];
+    const int SINGLE_STEREO_OFFSET = 2;
+
+    for (int s = 0; s < NETWORK_BUFFER_LENGTH_SAMPLES_STEREO; s += 4) {
+        correctStreamSample[0] = streamPopOutput[s / 2] * attenuationCoefficient;
+        correctStreamSample[1] = streamPopOutput[(s / 2) + 1] * attenuationCoefficient;
+
+        int delayedChannelIndex = s + (numSamplesDelay * 2) + delayedChannelOffset;
+
+        delayStreamSample[0] = correctStreamSample[0] * weakChannelAmplitudeRatio;
+        delayStreamSample[1] = correctStreamSample[1] * weakChannelAmplitudeRatio;
+
+        clientSamples[s + goodChannelOffset] += correctStreamSample[0];
+        clientSamples[s + goodChannelOffset + SINGLE_STEREO_OFFSET] += correctStreamSample[1];
+        clientSamples[delayedChannelIndex] += delayStreamSample[0];
+        clientSamples[delayedChannelIndex + SINGLE_STEREO_OFFSET] += delayStreamSample[1];
+    }
+
+    float attenuationAndWeakChannelRatio = attenuationCoefficient * weakChannelAmplitudeRatio;
+    for (int i = 0; i < numSamplesDelay; i++) {
+        clientSamples[(i * 2) + delayedChannelOffset] += streamPopOutput[i - numSamplesDelay]
+            * attenuationAndWeakChannelRatio;
+    }
+}
+
+static void legacyMixStereo(int16_t* clientSamples, const int16_t* streamPopOutput, float attenuationCoefficient) {
+    for (int s = 0; s < NETWORK_BUFFER_LENGTH_SAMPLES_STEREO; s++) {
+        clientSamples[s] = glm::clamp(clientSamples[s] + (int)(streamPopOutput[s] * attenuationCoefficient),
+                                      MIN_SAMPLE_VALUE, MAX_SAMPLE_VALUE);
+    }
+}
+
+void AudioMixKernelsTests::benchmarkKernels() {
+    const int NUM_BENCHMARK_MIXES = 2000;
+
+    int16_t clientSamples[NETWORK_BUFFER_LENGTH_SAMPLES_STEREO + (MAX_TEST_DELAY_SAMPLES * 2)];
+    float mixSamples[NETWORK_BUFFER_LENGTH_SAMPLES_STEREO];
+    int16_t mixedOutput[NETWORK_BUFFER_LENGTH_SAMPLES_STEREO];
+
+    quint64 legacyStart = usecTimestampNow();
+    for (int m = 0; m < NUM_BENCHMARK_MIXES; m++) {
+        memset(clientSamples, 0, sizeof(clientSamples));
+        for (int i = 0; i < NUM_TEST_STREAMS; i++) {
+            if (i % 3 == 0) {
+                legacyMixStereo(clientSamples, testStreams[i], testGains[i]);
+            } else {
+                legacyMixMono(clientSamples, testStreams[i] + testDelays[i], testGains[i], 0.5f, testDelays[i], i % 2);
+            }
+        }
+    }
+    quint64 legacyUsecs = usecTimestampNow() - legacyStart;
+
+    quint64 kernelStart = usecTimestampNow();
+    for (int m = 0; m < NUM_BENCHMARK_MIXES; m++) {
+        memset(mixSamples, 0, sizeof(mixSamples));
+        for (int i = 0; i < NUM_TEST_STREAMS; i++) {
+            if (i % 3 == 0) {
+                AudioMixKernels::mixWithGain(mixSamples, testStreams[i], testGains[i], NETWORK_BUFFER_LENGTH_SAMPLES_STEREO);
+            } else {
+                AudioMixKernels::mixMonoToStereo(mixSamples, testStreams[i] + testDelays[i], testGains[i],
+                                                 testStreams[i], testGains[i] * 0.5f,
+                                                 NETWORK_BUFFER_LENGTH_SAMPLES_PER_CHANNEL);
+            }
+        }
+        AudioMixKernels::saturateMix(mixedOutput, mixSamples, NETWORK_BUFFER_LENGTH_SAMPLES_STEREO);
+    }
+    quint64 kernelUsecs = usecTimestampNow() - kernelStart;
+
+    // use the outputs so the compiler can't throw the loops away
+    int checksum = clientSamples[0] + mixedOutput[0];
+
+    qDebug("%d mixes of %d streams: int16 loops %llu usecs, %s kernels %llu usecs (%.2fx) [%d]",
+           NUM_BENCHMARK_MIXES, NUM_TEST_STREAMS, legacyUsecs, AudioMixKernels::getInstructionSetName(), kernelUsecs,
+           (kernelUsecs > 0) ? (float) legacyUsecs / (float) kernelUsecs : 0.0f, checksum);
+}
+
+void AudioMixKernelsTests::runAllTests() {
+    fillTestStreams();
+    testKernelsMatchScalar();
+    benchmarkKernels();
+}
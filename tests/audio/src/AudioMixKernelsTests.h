@@ -0,0 +1,25 @@
+//
+//  AudioMixKernelsTests.h
+//  tests/audio/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#ifndef hifi_AudioMixKernelsTests_h
+#define hifi_AudioMixKernelsTests_h
+
+namespace AudioMixKernelsTests {
+
+    void runAllTests();
+
+    /// checks the vectorized kernels against their scalar versions
+    void testKernelsMatchScalar();
+
+    /// times a full listener mix with the kernels against the int16 loops the AudioMixer used before them
+    void benchmarkKernels();
+};
+
+#endif // hifi_AudioMixKernelsTests_h
@@ -0,0 +1,277 @@
+//
+//  AvatarBroadcastStateTests.cpp
+//  tests/avatars/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#include <stdlib.h>
+
+#include <QtCore/QDebug>
+#include <QtCore/QUuid>
+
+#include <AvatarBroadcastState.h>
+#include <AvatarData.h>
+#include <PacketHeaders.h>
+#include <SharedUtil.h>
+#include <UUID.h>
+
+#include "AvatarBroadcastStateTests.h"
+
+const int NUM_TEST_JOINTS = 60;
+
+static glm::quat randomRotation() {
+    return glm::normalize(glm::quat(randFloatInRange(-1.0f, 1.0f), randFloatInRange(-1.0f, 1.0f),
+                                    randFloatInRange(-1.0f, 1.0f), randFloatInRange(-1.0f, 1.0f)));
+}
+
+// q and -q are the same rotation, so compare them by the angle between them
+static bool rotationsMatch(const glm::quat& first, const glm::quat& second) {
+    const float MIN_ROTATION_DOT = 0.99999f;
+    return fabsf(glm::dot(first, second)) >= MIN_ROTATION_DOT;
+}
+
+void AvatarBroadcastStateTests::testSmallestThreeRotations() {
+    const int NUM_TEST_ROTATIONS = 100000;
+
+    float minDot = 1.0f;
+    for (int i = 0; i < NUM_TEST_ROTATIONS; i++) {
+        glm::quat rotation = randomRotation();
+
+        unsigned char packedRotation[sizeof(quint32)];
+        glm::quat unpackedRotation;
+        packOrientationQuatToSmallestThree(packedRotation, rotation);
+        unpackOrientationQuatFromSmallestThree(packedRotation, unpackedRotation);
+
+        if (!rotationsMatch(rotation, unpackedRotation)) {
+            qDebug() << "FAIL: rotation" << i << "unpacked with a dot of" << glm::dot(rotation, unpackedRotation);
+            return;
+        }
+        minDot = std::min(minDot, fabsf(glm::dot(rotation, unpackedRotation)));
+    }
+
+    qDebug() << NUM_TEST_ROTATIONS << "smallest-three rotations round trip, min dot" << minDot;
+}
+
+static QByteArray bulkAvatarPacketWithRecord(const AvatarBroadcastState& state, const AvatarBroadcastState* keyframe,
+                                             quint8 sequence, int& numHeaderBytes) {
+    QByteArray packet = byteArrayWithPopulatedHeader(PacketTypeBulkAvatarData, QUuid::createUuid());
+    numHeaderBytes = packet.size();
+    if (keyframe) {
+        state.appendDelta(packet, *keyframe, sequence);
+    } else {
+        state.appendKeyframe(packet, sequence);
+    }
+    return packet;
+}
+
+static bool avatarsMatch(AvatarData& sender, AvatarData& receiver) {
+    if (glm::distance(sender.getPosition(), receiver.getPosition()) > AVATAR_DELTA_POSITION_QUANTUM) {
+        qDebug() << "FAIL: received position" << receiver.getPosition().x << receiver.getPosition().y
+            << receiver.getPosition().z << "does not match the sent position";
+        return false;
+    }
+
+    const float MAX_ANGLE_ERROR = 0.01f;
+    if (fabsf(sender.getBodyYaw() - receiver.getBodyYaw()) > MAX_ANGLE_ERROR) {
+        qDebug() << "FAIL: received body yaw" << receiver.getBodyYaw() << "should be" << sender.getBodyYaw();
+        return false;
+    }
+
+    if (sender.getJointData().size() != receiver.getJointData().size()) {
+        qDebug() << "FAIL: received" << receiver.getJointData().size() << "joints, sent" << sender.getJointData().size();
+        return false;
+    }
+    for (int i = 0; i < sender.getJointData().size(); i++) {
+        if (sender.isJointDataValid(i) != receiver.isJointDataValid(i)) {
+            qDebug() << "FAIL: joint" << i << "validity does not match";
+            return false;
+        }
+        if (sender.isJointDataValid(i) && !rotationsMatch(sender.getJointRotation(i), receiver.getJointRotation(i))) {
+            qDebug() << "FAIL: joint" << i << "rotation does not match";
+            return false;
+        }
+    }
+    return true;
+}
+
+void AvatarBroadcastStateTests::testRecordRoundTrip() {
+    AvatarData sender;
+    AvatarData receiver;
+
+    sender.setPosition(glm::vec3(12.5f, 3.25f, -40.0f));
+    sender.setBodyYaw(45.0f);
+    for (int i = 0; i < NUM_TEST_JOINTS; i++) {
+        if (i % 7 == 0) {
+            sender.clearJointData(i);
+        } else {
+            sender.setJointData(i, randomRotation());
+        }
+    }
+
+    AvatarBroadcastState keyframe;
+    sender.toBroadcastState(keyframe);
+
+    int numHeaderBytes;
+    const quint8 KEYFRAME_SEQUENCE = 1;
+    QByteArray packet = bulkAvatarPacketWithRecord(keyframe, NULL, KEYFRAME_SEQUENCE, numHeaderBytes);
+    if (receiver.parseDataAtOffset(packet, numHeaderBytes) != packet.size() - numHeaderBytes) {
+        qDebug() << "FAIL: keyframe record was not parsed to its end";
+        return;
+    }
+    if (!avatarsMatch(sender, receiver)) {
+        qDebug() << "FAIL: after keyframe";
+        return;
+    }
+    int keyframeSize = packet.size() - numHeaderBytes;
+
+    // a small move and a couple of joints, then the joints moving back while a new one becomes valid
+    sender.setPosition(glm::vec3(12.75f, 3.25f, -39.5f));
+    sender.setJointData(3, randomRotation());
+    sender.setJointData(11, randomRotation());
+
+    AvatarBroadcastState state;
+    sender.toBroadcastState(state);
+    packet = bulkAvatarPacketWithRecord(state, &keyframe, KEYFRAME_SEQUENCE, numHeaderBytes);
+    if (receiver.parseDataAtOffset(packet, numHeaderBytes) != packet.size() - numHeaderBytes) {
+        qDebug() << "FAIL: first delta record was not parsed to its end";
+        return;
+    }
+    if (!avatarsMatch(sender, receiver)) {
+        qDebug() << "FAIL: after first delta";
+        return;
+    }
+    int deltaSize = packet.size() - numHeaderBytes;
+
+    sender.setJointData(0, randomRotation());
+    sender.setJointData(3, glm::quat());
+    sender.setJointData(11, glm::quat());
+    sender.setJointData(NUM_TEST_JOINTS, randomRotation());
+
+    sender.toBroadcastState(state);
+    packet = bulkAvatarPacketWithRecord(state, &keyframe, KEYFRAME_SEQUENCE, numHeaderBytes);
+    receiver.parseDataAtOffset(packet, numHeaderBytes);
+    if (!avatarsMatch(sender, receiver)) {
+        qDebug() << "FAIL: after second delta";
+        return;
+    }
+
+    // a delta against a keyframe the receiver never got must be skipped, not applied
+    glm::vec3 receivedPosition = receiver.getPosition();
+    sender.setPosition(glm::vec3(0.0f));
+    sender.toBroadcastState(state);
+    packet = bulkAvatarPacketWithRecord(state, &keyframe, KEYFRAME_SEQUENCE + 1, numHeaderBytes);
+    if (receiver.parseDataAtOffset(packet, numHeaderBytes) != packet.size() - numHeaderBytes
+        || receiver.getPosition() != receivedPosition) {
+        qDebug() << "FAIL: delta against an unknown keyframe was applied";
+        return;
+    }
+
+    qDebug() << "keyframe and delta records round trip, keyframe" << keyframeSize << "bytes, delta" << deltaSize << "bytes";
+}
+
+void AvatarBroadcastStateTests::benchmarkIdleCrowd() {
+    const int NUM_AVATARS = 100;
+    const int NUM_FRAMES = 60 * 10;
+    const int KEYFRAME_INTERVAL_FRAMES = 120;
+
+    // most of the crowd stands around, shifting a joint or two now and then, and a few walk about
+    const float JOINT_CHANGE_PROBABILITY = 0.02f;
+    const float WALKING_AVATAR_RATIO = 0.05f;
+    const float WALK_SPEED_PER_FRAME = 1.4f / 60.0f;
+
+    srand(1);
+
+    QVector<AvatarBroadcastState> states(NUM_AVATARS);
+    QVector<AvatarBroadcastState> keyframes(NUM_AVATARS);
+    QVector<int> keyframeFrames(NUM_AVATARS);
+
+    // position, body, head and audio, then the chat message size, bit items and pupil dilation with no face data
+    const int NUM_FIELD_BYTES = sizeof(glm::vec3) + NUM_BYTES_AVATAR_BODY_DATA + NUM_BYTES_AVATAR_HEAD_DATA
+        + NUM_BYTES_AVATAR_AUDIO_DATA + 3;
+    unsigned char fieldData[NUM_FIELD_BYTES];
+
+    for (int a = 0; a < NUM_AVATARS; a++) {
+        for (int b = 0; b < NUM_FIELD_BYTES; b++) {
+            fieldData[b] = rand();
+        }
+        glm::vec3 position(randFloatInRange(-50.0f, 50.0f), 0.0f, randFloatInRange(-50.0f, 50.0f));
+        memcpy(fieldData, &position, sizeof(position));
+
+        AvatarBroadcastState& state = states[a];
+        state.setFieldData(fieldData, NUM_FIELD_BYTES);
+        state.numJoints = NUM_TEST_JOINTS;
+        state.jointValidity.fill((char) 0xff, (NUM_TEST_JOINTS + BITS_IN_BYTE - 1) / BITS_IN_BYTE);
+        state.jointRotations.resize(NUM_TEST_JOINTS);
+        for (int j = 0; j < NUM_TEST_JOINTS; j++) {
+            packOrientationQuatToSmallestThree(reinterpret_cast<unsigned char*>(&state.jointRotations[j]),
+                                               randomRotation());
+        }
+    }
+
+    quint64 fullBytes = 0;
+    quint64 recordBytes = 0;
+    int numKeyframes = 0;
+
+    QByteArray record;
+    AvatarBroadcastState decoded;
+    bool isKeyframe;
+    quint8 sequence;
+
+    quint64 encodeStart = usecTimestampNow();
+    for (int frame = 1; frame <= NUM_FRAMES; frame++) {
+        for (int a = 0; a < NUM_AVATARS; a++) {
+            AvatarBroadcastState& state = states[a];
+
+            if (a < NUM_AVATARS * WALKING_AVATAR_RATIO) {
+                state.position.x += WALK_SPEED_PER_FRAME;
+            }
+            for (int j = 0; j < NUM_TEST_JOINTS; j++) {
+                if (randFloat() < JOINT_CHANGE_PROBABILITY) {
+                    packOrientationQuatToSmallestThree(reinterpret_cast<unsigned char*>(&state.jointRotations[j]),
+                                                       randomRotation());
+                }
+            }
+
+            fullBytes += NUM_BYTES_RFC4122_UUID + state.toAvatarDataByteArray().size();
+
+            // same keyframe policy as the avatar mixer
+            record.resize(0);
+            bool sendKeyframe = keyframeFrames[a] == 0 || frame - keyframeFrames[a] >= KEYFRAME_INTERVAL_FRAMES;
+            if (!sendKeyframe) {
+                sendKeyframe = !state.appendDelta(record, keyframes[a], 0);
+            }
+
+            QByteArray keyframeRecord;
+            state.appendKeyframe(keyframeRecord, 0);
+            if (sendKeyframe || record.size() >= keyframeRecord.size() / 2) {
+                record = keyframeRecord;
+                keyframes[a] = state;
+                keyframeFrames[a] = frame;
+                ++numKeyframes;
+            }
+            recordBytes += NUM_BYTES_RFC4122_UUID + record.size();
+
+            if (decoded.parseRecord(reinterpret_cast<const unsigned char*>(record.constData()), record.size(),
+                                    keyframes[a], isKeyframe, sequence) != record.size()
+                || decoded.jointRotations != state.jointRotations) {
+                qDebug() << "FAIL: avatar" << a << "did not decode in frame" << frame;
+                return;
+            }
+        }
+    }
+    quint64 encodeUsecs = usecTimestampNow() - encodeStart;
+
+    qDebug() << NUM_AVATARS << "avatars over" << NUM_FRAMES << "frames:" << fullBytes << "bytes as full avatar data,"
+        << recordBytes << "bytes as keyframes and deltas (" << (float) fullBytes / (float) recordBytes << "x ),"
+        << numKeyframes << "keyframes," << encodeUsecs << "usecs";
+}
+
+void AvatarBroadcastStateTests::runAllTests() {
+    testSmallestThreeRotations();
+    testRecordRoundTrip();
+    benchmarkIdleCrowd();
+}
@@ -0,0 +1,28 @@
+//
+//  AvatarBroadcastStateTests.h
+//  tests/avatars/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#ifndef hifi_AvatarBroadcastStateTests_h
+#define hifi_AvatarBroadcastStateTests_h
+
+namespace AvatarBroadcastStateTests {
+
+    void runAllTests();
+
+    /// checks that smallest-three packed rotations come back within the precision of their 10 bit components
+    void testSmallestThreeRotations();
+
+    /// sends an avatar through a keyframe and a few deltas and checks the receiving AvatarData ends up matching it
+    void testRecordRoundTrip();
+
+    /// compares the bytes sent for a mostly idle crowd using full avatar data against keyframes and deltas
+    void benchmarkIdleCrowd();
+};
+
+#endif // hifi_AvatarBroadcastStateTests_h
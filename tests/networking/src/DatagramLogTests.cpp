@@ -0,0 +1,130 @@
+//
+//  DatagramLogTests.cpp
+//  tests/networking/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#include "DatagramLogTests.h"
+
+#include <assert.h>
+
+#include <QtCore/QDir>
+#include <QtCore/QFile>
+
+#include "DatagramLog.h"
+
+const int LARGE_DATAGRAM_BYTES = 1500;
+
+static QString testLogFilename() {
+    return QDir::temp().filePath("datagram-log-tests.hfdl");
+}
+
+static void writeTestLog(const QUuid& agentUUID, const QUuid& mixerUUID) {
+    DatagramLogWriter writer;
+    bool opened = writer.open(testLogFilename(), NodeType::AudioMixer);
+    assert(opened);
+    assert(writer.isOpen());
+
+    QByteArray small(10, 'a');
+    QByteArray large(LARGE_DATAGRAM_BYTES, 'b');
+    writer.write(DatagramDirection::Inbound, NodeType::Agent, agentUUID, small.constData(), small.size(), 1000);
+    writer.write(DatagramDirection::Outbound, NodeType::AudioMixer, mixerUUID, large.constData(), large.size(), 2000);
+    writer.write(DatagramDirection::Inbound, NodeType::Unassigned, QUuid(), NULL, 0, 3000);
+    assert(writer.getNumRecords() == 3);
+
+    writer.close();
+    assert(!writer.isOpen());
+
+    // nothing goes in once it's closed
+    writer.write(DatagramDirection::Inbound, NodeType::Agent, agentUUID, small.constData(), small.size(), 4000);
+}
+
+void DatagramLogTests::runAllTests() {
+    roundTripTest();
+    truncatedLogTest();
+}
+
+void DatagramLogTests::roundTripTest() {
+    QUuid agentUUID = QUuid::createUuid();
+    QUuid mixerUUID = QUuid::createUuid();
+    writeTestLog(agentUUID, mixerUUID);
+
+    DatagramLogReader reader;
+    bool opened = reader.open(testLogFilename());
+    assert(opened);
+    assert(reader.getOwnerType() == NodeType::AudioMixer);
+    assert(reader.getStartTimestamp() > 0);
+
+    DatagramLogRecord record;
+    bool hasRecord = reader.readNext(record);
+    assert(hasRecord);
+    assert(record.timestamp == 1000);
+    assert(record.direction == DatagramDirection::Inbound);
+    assert(record.nodeType == NodeType::Agent);
+    assert(record.senderUUID == agentUUID);
+    assert(record.datagram == QByteArray(10, 'a'));
+
+    hasRecord = reader.readNext(record);
+    assert(hasRecord);
+    assert(record.timestamp == 2000);
+    assert(record.direction == DatagramDirection::Outbound);
+    assert(record.senderUUID == mixerUUID);
+    assert(record.datagram == QByteArray(LARGE_DATAGRAM_BYTES, 'b'));
+
+    hasRecord = reader.readNext(record);
+    assert(hasRecord);
+    assert(record.timestamp == 3000);
+    assert(record.senderUUID.isNull());
+    assert(record.datagram.isEmpty());
+
+    hasRecord = reader.readNext(record);
+    assert(!hasRecord);
+    assert(reader.getErrorString().isEmpty());
+
+    // and once more from the top
+    bool rewound = reader.rewind();
+    assert(rewound);
+    hasRecord = reader.readNext(record);
+    assert(hasRecord);
+    assert(record.timestamp == 1000);
+
+    reader.close();
+    QFile::remove(testLogFilename());
+}
+
+void DatagramLogTests::truncatedLogTest() {
+    writeTestLog(QUuid::createUuid(), QUuid::createUuid());
+
+    // cut the log off in the middle of the second datagram, as a killed process would leave it
+    QFile logFile(testLogFilename());
+    logFile.resize(DATAGRAM_LOG_HEADER_BYTES + DATAGRAM_LOG_RECORD_HEADER_BYTES + 10
+                   + DATAGRAM_LOG_RECORD_HEADER_BYTES + 100);
+
+    DatagramLogReader reader;
+    bool opened = reader.open(testLogFilename());
+    assert(opened);
+
+    DatagramLogRecord record;
+    bool hasRecord = reader.readNext(record);
+    assert(hasRecord);
+    hasRecord = reader.readNext(record);
+    assert(!hasRecord);
+    assert(!reader.getErrorString().isEmpty());
+
+    reader.close();
+    QFile::remove(testLogFilename());
+
+    // anything that isn't a log is turned away
+    QFile notALog(testLogFilename());
+    notALog.open(QIODevice::WriteOnly);
+    notALog.write("not a datagram log at all");
+    notALog.close();
+    opened = reader.open(testLogFilename());
+    assert(!opened);
+
+    QFile::remove(testLogFilename());
+}
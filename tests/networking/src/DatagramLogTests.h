@@ -0,0 +1,22 @@
+//
+//  DatagramLogTests.h
+//  tests/networking/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#ifndef hifi_DatagramLogTests_h
+#define hifi_DatagramLogTests_h
+
+namespace DatagramLogTests {
+
+    void runAllTests();
+
+    void roundTripTest();
+    void truncatedLogTest();
+};
+
+#endif // hifi_DatagramLogTests_h
@@ -0,0 +1,206 @@
+//
+//  PacketHashTests.cpp
+//  tests/networking/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#include "PacketHashTests.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <QtCore/QCryptographicHash>
+#include <QtCore/QElapsedTimer>
+
+#include "LimitedNodeList.h"
+#include "Node.h"
+#include "PacketHeaders.h"
+#include "SharedUtil.h"
+#include "SipHash.h"
+
+void PacketHashTests::runAllTests() {
+    sipHashVectorTest();
+    incrementalSipHashTest();
+    keyedHashTest();
+    legacyHashTest();
+    hashNegotiationTest();
+    hashThroughputBenchmark();
+}
+
+// a key of 0x00 to 0x0f, and messages of 0x00, 0x01, ... - the test vectors published with SipHash
+static void fillTestVectorBytes(unsigned char* bytes, int length) {
+    for (int i = 0; i < length; i++) {
+        bytes[i] = i;
+    }
+}
+
+void PacketHashTests::sipHashVectorTest() {
+    const int NUM_VECTORS = 4;
+    const int LENGTHS[NUM_VECTORS] = { 0, 1, 15, 63 };
+    const unsigned char EXPECTED[NUM_VECTORS][SIPHASH_128_BYTES] = {
+        { 0xa3, 0x81, 0x7f, 0x04, 0xba, 0x25, 0xa8, 0xe6, 0x6d, 0xf6, 0x72, 0x14, 0xc7, 0x55, 0x02, 0x93 },
+        { 0xda, 0x87, 0xc1, 0xd8, 0x6b, 0x99, 0xaf, 0x44, 0x34, 0x76, 0x59, 0x11, 0x9b, 0x22, 0xfc, 0x45 },
+        { 0x54, 0x93, 0xe9, 0x99, 0x33, 0xb0, 0xa8, 0x11, 0x7e, 0x08, 0xec, 0x0f, 0x97, 0xcf, 0xc3, 0xd9 },
+        { 0x51, 0x50, 0xd1, 0x77, 0x2f, 0x50, 0x83, 0x4a, 0x50, 0x3e, 0x06, 0x9a, 0x97, 0x3f, 0xbd, 0x7c }
+    };
+
+    unsigned char key[SIPHASH_KEY_BYTES];
+    fillTestVectorBytes(key, SIPHASH_KEY_BYTES);
+    unsigned char message[64];
+    fillTestVectorBytes(message, sizeof(message));
+
+    for (int i = 0; i < NUM_VECTORS; i++) {
+        unsigned char result[SIPHASH_128_BYTES];
+        SipHash::hash128(key, reinterpret_cast<const char*>(message), LENGTHS[i], result);
+        assert(memcmp(result, EXPECTED[i], SIPHASH_128_BYTES) == 0);
+    }
+}
+
+void PacketHashTests::incrementalSipHashTest() {
+    unsigned char key[SIPHASH_KEY_BYTES];
+    fillTestVectorBytes(key, SIPHASH_KEY_BYTES);
+    unsigned char message[64];
+    fillTestVectorBytes(message, sizeof(message));
+    const char* data = reinterpret_cast<const char*>(message);
+
+    unsigned char expected[SIPHASH_128_BYTES];
+    SipHash::hash128(key, data, sizeof(message), expected);
+
+    // every way of splitting the message in three gives the same hash
+    for (int first = 0; first <= (int)sizeof(message); first++) {
+        for (int second = first; second <= (int)sizeof(message); second += 7) {
+            SipHash hash(key);
+            hash.addData(data, first);
+            hash.addData(data + first, second - first);
+            hash.addData(data + second, sizeof(message) - second);
+
+            unsigned char result[SIPHASH_128_BYTES];
+            hash.result128(result);
+            assert(memcmp(result, expected, SIPHASH_128_BYTES) == 0);
+        }
+    }
+}
+
+// a verified packet with a payload of payloadBytes bytes
+static QByteArray createTestPacket(int payloadBytes) {
+    QByteArray packet = byteArrayWithPopulatedHeader(PacketTypeMixedAudio);
+    for (int i = 0; i < payloadBytes; i++) {
+        packet.append((char)(i * 31));
+    }
+    return packet;
+}
+
+void PacketHashTests::keyedHashTest() {
+    QUuid connectionSecret = QUuid::createUuid();
+    QByteArray packet = createTestPacket(1026);
+    assert(packetHasKeyedHash(packet.constData()));
+    assert(versionFromPacketHeader(packet.constData()) == versionForPacketType(PacketTypeMixedAudio));
+
+    replaceHashInPacketGivenConnectionUUID(packet.data(), packet.size(), connectionSecret);
+    assert(packetHashMatchesConnectionUUID(packet.constData(), packet.size(), connectionSecret));
+
+    // the QByteArray version agrees
+    assert(hashFromPacketHeader(packet) == hashForPacketAndConnectionUUID(packet, connectionSecret));
+
+    // any other secret or a change to the payload doesn't match
+    assert(!packetHashMatchesConnectionUUID(packet.constData(), packet.size(), QUuid::createUuid()));
+    packet[packet.size() - 1] = packet[packet.size() - 1] + 1;
+    assert(!packetHashMatchesConnectionUUID(packet.constData(), packet.size(), connectionSecret));
+}
+
+void PacketHashTests::legacyHashTest() {
+    QUuid connectionSecret = QUuid::createUuid();
+    QByteArray packet = createTestPacket(1026);
+    setPacketHasKeyedHash(packet.data(), false);
+    assert(!packetHasKeyedHash(packet.constData()));
+    assert(versionFromPacketHeader(packet.constData()) == versionForPacketType(PacketTypeMixedAudio));
+
+    replaceHashInPacketGivenConnectionUUID(packet.data(), packet.size(), connectionSecret);
+
+    // without the flag the hash is the MD5 peers without keyed hashes compute
+    int numBytesHeader = numBytesForPacketHeader(packet);
+    QByteArray md5 = QCryptographicHash::hash(packet.mid(numBytesHeader) + connectionSecret.toRfc4122(),
+                                              QCryptographicHash::Md5);
+    assert(hashFromPacketHeader(packet) == md5);
+    assert(packetHashMatchesConnectionUUID(packet.constData(), packet.size(), connectionSecret));
+}
+
+// sends a packet to the node the way LimitedNodeList does, and has the receiving side check it and learn from it
+static QByteArray exchangeTestPacket(const Node& destinationNode, Node& sourceNodeAtDestination) {
+    QByteArray packet = createTestPacket(64);
+    destinationNode.replaceHashInPacket(packet.data(), packet.size());
+
+    assert(packetHashMatchesConnectionUUID(packet.constData(), packet.size(),
+                                           sourceNodeAtDestination.getConnectionSecret()));
+    sourceNodeAtDestination.updatePacketHashFromVerifiedPacket(packet.constData());
+    return packet;
+}
+
+void PacketHashTests::hashNegotiationTest() {
+    QUuid connectionSecret = QUuid::createUuid();
+
+    // each side's view of the other, as they get them from the domain-server
+    Node firstAtSecond(QUuid::createUuid(), NodeType::Agent, HifiSockAddr(), HifiSockAddr());
+    Node secondAtFirst(QUuid::createUuid(), NodeType::AvatarMixer, HifiSockAddr(), HifiSockAddr());
+    firstAtSecond.setConnectionSecret(connectionSecret);
+    secondAtFirst.setConnectionSecret(connectionSecret);
+
+    // two peers that both know keyed hashes stay on them in both directions
+    for (int i = 0; i < 3; i++) {
+        assert(packetHasKeyedHash(exchangeTestPacket(secondAtFirst, firstAtSecond).constData()));
+        assert(packetHasKeyedHash(exchangeTestPacket(firstAtSecond, secondAtFirst).constData()));
+    }
+    assert(!firstAtSecond.wantsLegacyPacketHash());
+    assert(!secondAtFirst.wantsLegacyPacketHash());
+
+    // a peer that only knows MD5 gets answered with MD5 once it has sent us a verified packet
+    QByteArray legacyPacket = createTestPacket(64);
+    setPacketHasKeyedHash(legacyPacket.data(), false);
+    replaceHashInPacketGivenConnectionUUID(legacyPacket.data(), legacyPacket.size(), connectionSecret);
+    assert(packetHashMatchesConnectionUUID(legacyPacket.constData(), legacyPacket.size(), connectionSecret));
+    firstAtSecond.updatePacketHashFromVerifiedPacket(legacyPacket.constData());
+
+    assert(firstAtSecond.wantsLegacyPacketHash());
+    assert(!packetHasKeyedHash(exchangeTestPacket(firstAtSecond, secondAtFirst).constData()));
+}
+
+void PacketHashTests::hashThroughputBenchmark() {
+    const int NUM_PACKETS = 200000;
+    QUuid connectionSecret = QUuid::createUuid();
+    QByteArray packet = createTestPacket(1026);
+    int numBytesHeader = numBytesForPacketHeader(packet);
+
+    // read a byte of every hash so the loops aren't optimized away
+    volatile char lastHashByte = 0;
+
+    // what writeDatagram() used to do for every packet - copy it, then MD5 a second copy of the payload and the secret
+    QElapsedTimer timer;
+    timer.start();
+    for (int i = 0; i < NUM_PACKETS; i++) {
+        QByteArray datagramCopy = packet;
+        datagramCopy.replace(numBytesHeader - NUM_BYTES_PACKET_HASH, NUM_BYTES_PACKET_HASH,
+                             QCryptographicHash::hash(datagramCopy.mid(numBytesHeader) + connectionSecret.toRfc4122(),
+                                                      QCryptographicHash::Md5));
+        lastHashByte = datagramCopy[numBytesHeader - 1];
+    }
+    qint64 md5Usecs = timer.nsecsElapsed() / 1000;
+
+    // what it does now - copy it to the stack and hash it in place
+    timer.restart();
+    for (int i = 0; i < NUM_PACKETS; i++) {
+        char datagramCopy[MAX_PACKET_SIZE];
+        memcpy(datagramCopy, packet.constData(), packet.size());
+        replaceHashInPacketGivenConnectionUUID(datagramCopy, packet.size(), connectionSecret);
+        lastHashByte = datagramCopy[numBytesHeader - 1];
+    }
+    qint64 keyedUsecs = timer.nsecsElapsed() / 1000;
+
+    printf("hashing %d byte packets on one core: %.0f packets/s with MD5, %.0f packets/s with SipHash in place\n",
+           packet.size(), NUM_PACKETS / (md5Usecs / (float)USECS_PER_SECOND),
+           NUM_PACKETS / (keyedUsecs / (float)USECS_PER_SECOND));
+}
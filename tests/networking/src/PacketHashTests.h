@@ -0,0 +1,28 @@
+//
+//  PacketHashTests.h
+//  tests/networking/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#ifndef hifi_PacketHashTests_h
+#define hifi_PacketHashTests_h
+
+namespace PacketHashTests {
+
+    void runAllTests();
+
+    void sipHashVectorTest();
+    void incrementalSipHashTest();
+    void keyedHashTest();
+    void legacyHashTest();
+    void hashNegotiationTest();
+
+    // prints the packets per second one core can hash for sending, the way it was done with MD5 and the way it is now
+    void hashThroughputBenchmark();
+};
+
+#endif // hifi_PacketHashTests_h
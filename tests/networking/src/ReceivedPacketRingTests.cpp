@@ -0,0 +1,113 @@
+//
+//  ReceivedPacketRingTests.cpp
+//  tests/networking/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#include "ReceivedPacketRingTests.h"
+
+#include <assert.h>
+
+#include "PacketReceiver.h"
+
+static QByteArray packetNumbered(int number) {
+    return QByteArray::number(number);
+}
+
+void ReceivedPacketRingTests::runAllTests() {
+    capacityTest();
+    orderTest();
+    overflowTest();
+    wraparoundTest();
+}
+
+void ReceivedPacketRingTests::capacityTest() {
+    ReceivedPacketRing ring(100);
+    assert(ring.getCapacity() == 128);
+    assert(ring.size() == 0);
+
+    ReceivedPacketRing exactRing(64);
+    assert(exactRing.getCapacity() == 64);
+}
+
+void ReceivedPacketRingTests::orderTest() {
+    const int NUM_PACKETS = 10;
+    ReceivedPacketRing ring(16);
+    HifiSockAddr sender(QHostAddress::LocalHost, 40102);
+
+    for (int i = 0; i < NUM_PACKETS; i++) {
+        bool pushed = ring.push(packetNumbered(i), sender, 1000 + i);
+        assert(pushed);
+    }
+    assert(ring.size() == NUM_PACKETS);
+
+    ReceivedPacket receivedPacket;
+    for (int i = 0; i < NUM_PACKETS; i++) {
+        bool popped = ring.pop(receivedPacket);
+        assert(popped);
+        assert(receivedPacket.packet == packetNumbered(i));
+        assert(receivedPacket.senderSockAddr == sender);
+        assert(receivedPacket.receivedUsecs == (quint64)(1000 + i));
+    }
+
+    bool poppedFromEmpty = ring.pop(receivedPacket);
+    assert(!poppedFromEmpty);
+    assert(ring.size() == 0);
+}
+
+void ReceivedPacketRingTests::overflowTest() {
+    const int CAPACITY = 8;
+    const int NUM_OVER = 3;
+    ReceivedPacketRing ring(CAPACITY);
+    HifiSockAddr sender(QHostAddress::LocalHost, 40102);
+
+    int numPushed = 0;
+    for (int i = 0; i < CAPACITY + NUM_OVER; i++) {
+        if (ring.push(packetNumbered(i), sender, i)) {
+            numPushed++;
+        }
+    }
+    assert(numPushed == CAPACITY);
+    assert(ring.getDroppedCount() == (quint64)NUM_OVER);
+
+    // the packets that were queued stay, the ones that didn't fit are the ones dropped
+    ReceivedPacket receivedPacket;
+    bool popped = ring.pop(receivedPacket);
+    assert(popped);
+    assert(receivedPacket.packet == packetNumbered(0));
+
+    // taking one makes room for one more
+    bool pushedAfterPop = ring.push(packetNumbered(CAPACITY + NUM_OVER), sender, 0);
+    assert(pushedAfterPop);
+    bool pushedWhenFull = ring.push(packetNumbered(CAPACITY + NUM_OVER + 1), sender, 0);
+    assert(!pushedWhenFull);
+}
+
+void ReceivedPacketRingTests::wraparoundTest() {
+    const int CAPACITY = 4;
+    const int NUM_ROUNDS = 50;
+    ReceivedPacketRing ring(CAPACITY);
+    HifiSockAddr sender(QHostAddress::LocalHost, 40102);
+
+    int nextPushed = 0;
+    int nextPopped = 0;
+    ReceivedPacket receivedPacket;
+    for (int round = 0; round < NUM_ROUNDS; round++) {
+        // push a different number each round so the slots are reused at every offset
+        int numToPush = 1 + round % CAPACITY;
+        for (int i = 0; i < numToPush; i++) {
+            bool pushed = ring.push(packetNumbered(nextPushed++), sender, 0);
+            assert(pushed);
+        }
+        while (ring.pop(receivedPacket)) {
+            assert(receivedPacket.packet == packetNumbered(nextPopped));
+            nextPopped++;
+        }
+        assert(nextPopped == nextPushed);
+    }
+    assert(ring.getDroppedCount() == 0);
+}
@@ -0,0 +1,24 @@
+//
+//  ReceivedPacketRingTests.h
+//  tests/networking/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#ifndef hifi_ReceivedPacketRingTests_h
+#define hifi_ReceivedPacketRingTests_h
+
+namespace ReceivedPacketRingTests {
+
+    void runAllTests();
+
+    void capacityTest();
+    void orderTest();
+    void overflowTest();
+    void wraparoundTest();
+};
+
+#endif // hifi_ReceivedPacketRingTests_h
@@ -0,0 +1,193 @@
+//
+//  SendRateControllerTests.cpp
+//  tests/networking/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#include "SendRateControllerTests.h"
+
+#include <assert.h>
+
+#include "SendRateController.h"
+
+const float START_RATE = 600.0f;
+const float MAX_RATE = 6000.0f;
+const float FLIGHT_TIME = 40000.0f;
+
+// a receiver with a link that takes up to a given rate, reporting once a second, with the packets over that rate
+// either lost or queued on the way
+class SimulatedReceiver {
+public:
+    SimulatedReceiver(quint64 now, float clockSkew = 0.0f) : now(now), received(0), lost(0), clockSkew(clockSkew) { }
+
+    void second(SendRateController& controller, float capacity, bool overflowIsLost, bool sendAll = true) {
+        float rate = controller.getPacketsPerSecond();
+        int sent = sendAll ? (int)rate : (int)(rate / 4.0f);
+        controller.packetsSent(sent);
+
+        float flightTime = FLIGHT_TIME + clockSkew;
+        if (sent > capacity) {
+            if (overflowIsLost) {
+                received += (quint32)capacity;
+                lost += sent - (quint32)capacity;
+            } else {
+                received += (quint32)capacity;
+                flightTime += (sent - capacity) / capacity * USECS_PER_SECOND;
+            }
+        } else {
+            received += sent;
+        }
+
+        now += USECS_PER_SECOND;
+        controller.feedbackReceived(received, lost, flightTime, now);
+    }
+
+    quint64 now;
+    quint32 received;
+    quint32 lost;
+    float clockSkew; // added to every flight time the receiver reports
+};
+
+static SendRateController* createController(SimulatedReceiver& receiver) {
+    SendRateController* controller = new SendRateController();
+    controller->setMaxPacketsPerSecond(MAX_RATE);
+    controller->setInitialPacketsPerSecond(START_RATE);
+    controller->feedbackReceived(receiver.received, receiver.lost, FLIGHT_TIME + receiver.clockSkew, receiver.now);
+    assert(controller->hasFeedback(receiver.now));
+    return controller;
+}
+
+void SendRateControllerTests::runAllTests() {
+    slowStartTest();
+    lossBackoffTest();
+    delayBackoffTest();
+    unusedRateTest();
+    feedbackTimeoutTest();
+    clockSkewTest();
+}
+
+void SendRateControllerTests::slowStartTest() {
+    SimulatedReceiver receiver(usecTimestampNow());
+    SendRateController* controller = createController(receiver);
+    assert(controller->getPacketsPerSecond() == START_RATE);
+
+    // a link with room to spare doubles the rate on each report, up to the max
+    receiver.second(*controller, MAX_RATE * 2.0f, true);
+    assert(controller->getPacketsPerSecond() == START_RATE * 2.0f);
+    for (int i = 0; i < 5; i++) {
+        receiver.second(*controller, MAX_RATE * 2.0f, true);
+    }
+    assert(controller->getPacketsPerSecond() == MAX_RATE);
+    assert(controller->isInSlowStart());
+    assert(controller->getBackoffCount() == 0);
+
+    delete controller;
+}
+
+void SendRateControllerTests::lossBackoffTest() {
+    const float CAPACITY = 200.0f;
+
+    SimulatedReceiver receiver(usecTimestampNow());
+    SendRateController* controller = createController(receiver);
+
+    // sending well over what the link takes loses packets, so we back off below what got through
+    receiver.second(*controller, CAPACITY, true);
+    assert(controller->getLossRate() > SEND_RATE_MAX_LOSS_RATE);
+    assert(controller->getPacketsPerSecond() < CAPACITY);
+    assert(!controller->isInSlowStart());
+    assert(controller->getBackoffCount() == 1);
+
+    // from there the rate settles around the link's capacity, rather than growing past it
+    for (int i = 0; i < 60; i++) {
+        receiver.second(*controller, CAPACITY, true);
+        assert(controller->getPacketsPerSecond() < CAPACITY * 1.2f);
+    }
+    assert(controller->getPacketsPerSecond() > CAPACITY * 0.5f);
+
+    delete controller;
+}
+
+void SendRateControllerTests::delayBackoffTest() {
+    const float CAPACITY = 300.0f;
+
+    SimulatedReceiver receiver(usecTimestampNow());
+    SendRateController* controller = createController(receiver);
+
+    // nothing is lost, but the packets queue up on the way
+    receiver.second(*controller, CAPACITY, false);
+    assert(controller->getLossRate() == 0.0f);
+    assert(controller->getQueuingDelayUsecs() > SEND_RATE_TARGET_QUEUING_DELAY_USECS);
+    assert(controller->getPacketsPerSecond() < CAPACITY);
+    assert(controller->getBackoffCount() == 1);
+
+    for (int i = 0; i < 60; i++) {
+        receiver.second(*controller, CAPACITY, false);
+        assert(controller->getPacketsPerSecond() < CAPACITY * 1.2f);
+    }
+    assert(controller->getPacketsPerSecond() > CAPACITY * 0.5f);
+
+    delete controller;
+}
+
+void SendRateControllerTests::unusedRateTest() {
+    SimulatedReceiver receiver(usecTimestampNow());
+    SendRateController* controller = createController(receiver);
+
+    // a sender with little to send never tests its rate, so the rate doesn't grow
+    for (int i = 0; i < 10; i++) {
+        receiver.second(*controller, MAX_RATE * 2.0f, true, false);
+    }
+    assert(controller->getPacketsPerSecond() == START_RATE);
+
+    delete controller;
+}
+
+void SendRateControllerTests::feedbackTimeoutTest() {
+    SimulatedReceiver receiver(usecTimestampNow());
+    SendRateController* controller = createController(receiver);
+
+    receiver.second(*controller, MAX_RATE * 2.0f, true);
+    assert(controller->getPacketsPerSecond() == START_RATE * 2.0f);
+
+    // the initial rate is only used while there is no feedback
+    controller->setInitialPacketsPerSecond(START_RATE, receiver.now);
+    assert(controller->getPacketsPerSecond() == START_RATE * 2.0f);
+
+    // once the receiver goes quiet for a while, its feedback no longer counts, and the next report starts over
+    quint64 later = receiver.now + SEND_RATE_FEEDBACK_TIMEOUT_USECS + USECS_PER_SECOND;
+    assert(!controller->hasFeedback(later));
+    receiver.now = later;
+    receiver.second(*controller, MAX_RATE * 2.0f, true);
+    assert(controller->hasFeedback(receiver.now));
+    assert(controller->isInSlowStart());
+
+    delete controller;
+}
+
+void SendRateControllerTests::clockSkewTest() {
+    // a receiver whose clock is well behind ours reports negative flight times
+    const float CLOCK_SKEW = -5.0f * USECS_PER_SECOND;
+
+    SimulatedReceiver receiver(usecTimestampNow(), CLOCK_SKEW);
+    SendRateController* controller = createController(receiver);
+
+    // that alone is no reason to back off
+    for (int i = 0; i < 6; i++) {
+        receiver.second(*controller, MAX_RATE * 2.0f, true);
+        assert(controller->getQueuingDelayUsecs() == 0);
+    }
+    assert(controller->getPacketsPerSecond() == MAX_RATE);
+    assert(controller->getBackoffCount() == 0);
+
+    // but the flight time rising over its lowest still is
+    const float CAPACITY = 300.0f;
+    receiver.second(*controller, CAPACITY, false);
+    assert(controller->getQueuingDelayUsecs() > SEND_RATE_TARGET_QUEUING_DELAY_USECS);
+    assert(controller->getBackoffCount() == 1);
+
+    delete controller;
+}
@@ -0,0 +1,28 @@
+//
+//  SendRateControllerTests.h
+//  tests/networking/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#ifndef hifi_SendRateControllerTests_h
+#define hifi_SendRateControllerTests_h
+
+namespace SendRateControllerTests {
+
+    void runAllTests();
+
+    void slowStartTest();
+    void lossBackoffTest();
+    void delayBackoffTest();
+    void unusedRateTest();
+    void feedbackTimeoutTest();
+
+    // the flight times a receiver reports include the skew between our clocks, which can make them negative
+    void clockSkewTest();
+};
+
+#endif // hifi_SendRateControllerTests_h
@@ -8,11 +8,19 @@
 //  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
 //
 
+#include "DatagramLogTests.h"
+#include "PacketHashTests.h"
+#include "ReceivedPacketRingTests.h"
+#include "SendRateControllerTests.h"
 #include "SequenceNumberStatsTests.h"
 #include <stdio.h>
 
 int main(int argc, char** argv) {
     SequenceNumberStatsTests::runAllTests();
+    PacketHashTests::runAllTests();
+    SendRateControllerTests::runAllTests();
+    DatagramLogTests::runAllTests();
+    ReceivedPacketRingTests::runAllTests();
     printf("tests passed! press enter to exit");
     getchar();
     return 0;
@@ -0,0 +1,238 @@
+//
+//  OctreeElementBagTests.cpp
+//  tests/octree/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#include <QDebug>
+#include <QSet>
+#include <QVector>
+
+#include <ModelTree.h>
+#include <ModelTreeElement.h>
+#include <OctreeConstants.h>
+#include <OctreeElementBag.h>
+#include <ViewFrustum.h>
+
+#include "OctreeElementBagTests.h"
+
+static void addDescendants(OctreeElement* element, int levels, QVector<OctreeElement*>& added) {
+    for (int i = 0; i < NUMBER_OF_CHILDREN; i++) {
+        OctreeElement* child = element->addChildAtIndex(i);
+        added.append(child);
+        if (levels > 1) {
+            addDescendants(child, levels - 1, added);
+        }
+    }
+}
+
+static float apparentSizeFrom(const glm::vec3& position, const OctreeElement* element) {
+    const AACube& cube = element->getAACube();
+    return cube.getScale() / (cube.getScale() + glm::distance(cube.calcCenter(), position));
+}
+
+void OctreeElementBagTests::bagTests(bool verbose) {
+    int testsTaken = 0;
+    int testsPassed = 0;
+    int testsFailed = 0;
+
+    qDebug() << "OctreeElementBagTests::bagTests()";
+
+    {
+        testsTaken++;
+        QString testName = "without a view every element comes out once, and removed ones don't";
+        if (verbose) {
+            qDebug() << "Test" << testsTaken <<":" << qPrintable(testName);
+        }
+
+        ModelTree tree;
+        QVector<OctreeElement*> elements;
+        addDescendants(tree.getRoot(), 2, elements);
+
+        OctreeElementBag bag;
+        foreach (OctreeElement* element, elements) {
+            bag.insert(element);
+            bag.insert(element);
+        }
+        bool result = bag.count() == elements.size() && !bag.hasView() && bag.getUsefulCount() == 0;
+
+        QSet<OctreeElement*> expected;
+        for (int i = 0; i < elements.size(); i++) {
+            if (i % 3 == 0) {
+                bag.remove(elements[i]);
+            } else {
+                expected.insert(elements[i]);
+            }
+        }
+
+        QSet<OctreeElement*> extracted;
+        while (OctreeElement* element = bag.extract()) {
+            if (extracted.contains(element)) {
+                result = false;
+            }
+            extracted.insert(element);
+        }
+        result = result && extracted == expected && bag.isEmpty();
+
+        if (result) {
+            testsPassed++;
+        } else {
+            testsFailed++;
+            qDebug() << "FAILED - Test" << testsTaken <<":" << qPrintable(testName);
+        }
+    }
+
+    qDebug() << "   tests passed:" << testsPassed << "out of" << testsTaken;
+    if (testsFailed > 0) {
+        qDebug() << "   tests failed:" << testsFailed;
+    }
+}
+
+void OctreeElementBagTests::viewOrderTests(bool verbose) {
+    int testsTaken = 0;
+    int testsPassed = 0;
+    int testsFailed = 0;
+
+    qDebug() << "OctreeElementBagTests::viewOrderTests()";
+
+    ModelTree tree;
+    QVector<OctreeElement*> elements;
+    addDescendants(tree.getRoot(), 3, elements);
+
+    ViewFrustum view;
+    view.setPosition(glm::vec3(0.1f, 0.2f, 0.3f) * (float)TREE_SCALE);
+    glm::vec3 position = view.getPositionVoxelScale();
+
+    int expectedUsefulCount = 0;
+    foreach (OctreeElement* element, elements) {
+        if (apparentSizeFrom(position, element) >= USEFUL_ELEMENT_APPARENT_SIZE) {
+            expectedUsefulCount++;
+        }
+    }
+
+    {
+        testsTaken++;
+        QString testName = "elements come out biggest first from the view, the ones inserted before it was set included";
+        if (verbose) {
+            qDebug() << "Test" << testsTaken <<":" << qPrintable(testName);
+        }
+
+        OctreeElementBag bag;
+        int half = elements.size() / 2;
+        for (int i = 0; i < half; i++) {
+            bag.insert(elements[i]);
+        }
+        bag.setView(view);
+        for (int i = half; i < elements.size(); i++) {
+            bag.insert(elements[i]);
+        }
+        bool result = bag.getUsefulCount() == expectedUsefulCount;
+
+        int extractedCount = 0;
+        float lastApparentSize = 1.0f;
+        while (OctreeElement* element = bag.extract()) {
+            float apparentSize = apparentSizeFrom(position, element);
+            if (apparentSize > lastApparentSize) {
+                result = false;
+            }
+            lastApparentSize = apparentSize;
+            extractedCount++;
+        }
+        result = result && extractedCount == elements.size() && bag.getUsefulCount() == 0;
+
+        if (result) {
+            testsPassed++;
+        } else {
+            testsFailed++;
+            qDebug() << "FAILED - Test" << testsTaken <<":" << qPrintable(testName);
+        }
+    }
+
+    {
+        testsTaken++;
+        QString testName = "removed elements are skipped and no longer counted as useful";
+        if (verbose) {
+            qDebug() << "Test" << testsTaken <<":" << qPrintable(testName);
+        }
+
+        OctreeElementBag bag;
+        bag.setView(view);
+        foreach (OctreeElement* element, elements) {
+            bag.insert(element);
+        }
+
+        // enough removals that the heap drops the entries they leave behind
+        int removedUsefulCount = 0;
+        QSet<OctreeElement*> removed;
+        for (int i = 0; i < elements.size(); i++) {
+            if (i % 3 == 0) {
+                continue;
+            }
+            bag.remove(elements[i]);
+            removed.insert(elements[i]);
+            if (apparentSizeFrom(position, elements[i]) >= USEFUL_ELEMENT_APPARENT_SIZE) {
+                removedUsefulCount++;
+            }
+        }
+        bool result = bag.getUsefulCount() == expectedUsefulCount - removedUsefulCount
+            && bag.count() == elements.size() - removed.size();
+
+        int extractedCount = 0;
+        while (OctreeElement* element = bag.extract()) {
+            if (removed.contains(element)) {
+                result = false;
+            }
+            extractedCount++;
+        }
+        result = result && extractedCount == elements.size() - removed.size() && bag.getUsefulCount() == 0;
+
+        if (result) {
+            testsPassed++;
+        } else {
+            testsFailed++;
+            qDebug() << "FAILED - Test" << testsTaken <<":" << qPrintable(testName);
+        }
+    }
+
+    {
+        testsTaken++;
+        QString testName = "out of view order the useful elements are still counted";
+        if (verbose) {
+            qDebug() << "Test" << testsTaken <<":" << qPrintable(testName);
+        }
+
+        OctreeElementBag bag;
+        bag.setView(view, false);
+        foreach (OctreeElement* element, elements) {
+            bag.insert(element);
+        }
+        bool result = bag.getUsefulCount() == expectedUsefulCount;
+
+        int extractedCount = 0;
+        while (bag.extract()) {
+            extractedCount++;
+        }
+        result = result && extractedCount == elements.size() && bag.getUsefulCount() == 0;
+
+        if (result) {
+            testsPassed++;
+        } else {
+            testsFailed++;
+            qDebug() << "FAILED - Test" << testsTaken <<":" << qPrintable(testName);
+        }
+    }
+
+    qDebug() << "   tests passed:" << testsPassed << "out of" << testsTaken;
+    if (testsFailed > 0) {
+        qDebug() << "   tests failed:" << testsFailed;
+    }
+}
+
+void OctreeElementBagTests::runAllTests(bool verbose) {
+    bagTests(verbose);
+    viewOrderTests(verbose);
+}
@@ -0,0 +1,263 @@
+//
+//  OctreeElementIndexTests.cpp
+//  tests/octree/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#include <cstring>
+
+#include <QDebug>
+#include <QVector>
+
+#include <ModelTree.h>
+#include <ModelTreeElement.h>
+#include <OctalCode.h>
+#include <OctreeConstants.h>
+#include <OctreeElementIndex.h>
+
+#include "OctreeElementIndexTests.h"
+
+void OctreeElementIndexTests::keyTests(bool verbose) {
+    int testsTaken = 0;
+    int testsPassed = 0;
+    int testsFailed = 0;
+
+    qDebug() << "OctreeElementIndexTests::keyTests()";
+
+    {
+        testsTaken++;
+        QString testName = "each level's key is its parent's with the child's three bits below it";
+        if (verbose) {
+            qDebug() << "Test" << testsTaken <<":" << qPrintable(testName);
+        }
+
+        unsigned char rootCode[1] = { 0 };
+        unsigned char* code = rootCode;
+        bool result = OctreeElementIndex::keyForOctalCode(code) == 1;
+        quint64 expectedKey = 1;
+        for (int level = 0; level < OctreeElementIndex::MAX_INDEXED_LEVELS; level++) {
+            int childIndex = (level * 5 + 3) % NUMBER_OF_CHILDREN;
+            unsigned char* childCode = childOctalCode(code, childIndex);
+            if (code != rootCode) {
+                delete[] code;
+            }
+            code = childCode;
+
+            expectedKey = (expectedKey << BITS_IN_OCTAL) | childIndex;
+            quint64 key = OctreeElementIndex::keyForOctalCode(code);
+            if (key != expectedKey || OctreeElementIndex::parentKey(key) != (expectedKey >> BITS_IN_OCTAL)) {
+                result = false;
+            }
+        }
+
+        // one level deeper doesn't fit the key
+        unsigned char* tooDeepCode = childOctalCode(code, 0);
+        result = result && OctreeElementIndex::keyForOctalCode(tooDeepCode) == 0;
+        delete[] tooDeepCode;
+        delete[] code;
+
+        if (result) {
+            testsPassed++;
+        } else {
+            testsFailed++;
+            qDebug() << "FAILED - Test" << testsTaken <<":" << qPrintable(testName);
+        }
+    }
+
+    qDebug() << "   tests passed:" << testsPassed << "out of" << testsTaken;
+    if (testsFailed > 0) {
+        qDebug() << "   tests failed:" << testsFailed;
+    }
+}
+
+static OctreeElement* addDescendants(OctreeElement* element, int levels, QVector<OctreeElement*>& added) {
+    for (int i = 0; i < NUMBER_OF_CHILDREN; i++) {
+        OctreeElement* child = element->addChildAtIndex(i);
+        added.append(child);
+        if (levels > 1) {
+            addDescendants(child, levels - 1, added);
+        }
+    }
+    return element;
+}
+
+void OctreeElementIndexTests::indexTests(bool verbose) {
+    int testsTaken = 0;
+    int testsPassed = 0;
+    int testsFailed = 0;
+
+    qDebug() << "OctreeElementIndexTests::indexTests()";
+
+    {
+        testsTaken++;
+        QString testName = "the elements there are when the index is made are indexed, and the ones added after";
+        if (verbose) {
+            qDebug() << "Test" << testsTaken <<":" << qPrintable(testName);
+        }
+
+        ModelTree tree;
+        QVector<OctreeElement*> added;
+        addDescendants(tree.getRoot()->addChildAtIndex(1), 2, added);
+        tree.setUseElementIndex(true);
+        addDescendants(tree.getRoot()->addChildAtIndex(6), 3, added);
+
+        OctreeElementIndex* index = tree.getElementIndex();
+        bool result = index->size() == added.size() + 3 && index->find(tree.getRoot()->getOctalCode()) == tree.getRoot();
+        foreach (OctreeElement* element, added) {
+            if (index->find(element->getOctalCode()) != element) {
+                result = false;
+            }
+        }
+        tree.setUseElementIndex(false);
+
+        if (result) {
+            testsPassed++;
+        } else {
+            testsFailed++;
+            qDebug() << "FAILED - Test" << testsTaken <<":" << qPrintable(testName);
+        }
+    }
+
+    {
+        testsTaken++;
+        QString testName = "deleted elements are gone from the index, and the others are still found";
+        if (verbose) {
+            qDebug() << "Test" << testsTaken <<":" << qPrintable(testName);
+        }
+
+        ModelTree tree;
+        tree.setUseElementIndex(true);
+        QVector<OctreeElement*> added;
+        OctreeElement* kept = addDescendants(tree.getRoot()->addChildAtIndex(2), 3, added);
+        OctreeElement* deleted = tree.getRoot()->addChildAtIndex(5);
+        addDescendants(deleted, 3, added);
+
+        QVector<QByteArray> deletedCodes;
+        deletedCodes.append(QByteArray((const char*)deleted->getOctalCode(),
+            bytesRequiredForCodeLength(numberOfThreeBitSectionsInCode(deleted->getOctalCode()))));
+        QVector<OctreeElement*> keptElements;
+        foreach (OctreeElement* element, added) {
+            QByteArray code((const char*)element->getOctalCode(),
+                bytesRequiredForCodeLength(numberOfThreeBitSectionsInCode(element->getOctalCode())));
+            if (branchIndexWithDescendant(tree.getRoot()->getOctalCode(), element->getOctalCode()) == 5) {
+                deletedCodes.append(code);
+            } else {
+                keptElements.append(element);
+            }
+        }
+        tree.getRoot()->deleteChildAtIndex(5);
+
+        OctreeElementIndex* index = tree.getElementIndex();
+        bool result = index->size() == keptElements.size() + 2 && index->find(kept->getOctalCode()) == kept;
+        foreach (OctreeElement* element, keptElements) {
+            if (index->find(element->getOctalCode()) != element) {
+                result = false;
+            }
+        }
+        foreach (const QByteArray& code, deletedCodes) {
+            if (index->find((const unsigned char*)code.constData())) {
+                result = false;
+            }
+        }
+
+        if (result) {
+            testsPassed++;
+        } else {
+            testsFailed++;
+            qDebug() << "FAILED - Test" << testsTaken <<":" << qPrintable(testName);
+        }
+    }
+
+    {
+        testsTaken++;
+        QString testName = "a removed child and its children are no longer found";
+        if (verbose) {
+            qDebug() << "Test" << testsTaken <<":" << qPrintable(testName);
+        }
+
+        ModelTree tree;
+        tree.setUseElementIndex(true);
+        QVector<OctreeElement*> added;
+        OctreeElement* parent = tree.getRoot()->addChildAtIndex(0);
+        addDescendants(parent, 2, added);
+        OctreeElement* removed = parent->removeChildAtIndex(3);
+
+        OctreeElementIndex* index = tree.getElementIndex();
+        bool result = removed != NULL && index->find(removed->getOctalCode()) == NULL
+            && index->find(removed->getChildAtIndex(0)->getOctalCode()) == NULL
+            && index->find(parent->getChildAtIndex(4)->getOctalCode()) == parent->getChildAtIndex(4);
+        delete removed;
+        result = result && index->size() == 2 + added.size() - (NUMBER_OF_CHILDREN + 1);
+
+        if (result) {
+            testsPassed++;
+        } else {
+            testsFailed++;
+            qDebug() << "FAILED - Test" << testsTaken <<":" << qPrintable(testName);
+        }
+    }
+
+    {
+        testsTaken++;
+        QString testName = "erasing the tree leaves its new root in the index";
+        if (verbose) {
+            qDebug() << "Test" << testsTaken <<":" << qPrintable(testName);
+        }
+
+        ModelTree tree;
+        tree.setUseElementIndex(true);
+        QVector<OctreeElement*> added;
+        addDescendants(tree.getRoot(), 2, added);
+        tree.eraseAllOctreeElements();
+
+        OctreeElementIndex* index = tree.getElementIndex();
+        bool result = index->size() == 1 && index->find(tree.getRoot()->getOctalCode()) == tree.getRoot();
+
+        if (result) {
+            testsPassed++;
+        } else {
+            testsFailed++;
+            qDebug() << "FAILED - Test" << testsTaken <<":" << qPrintable(testName);
+        }
+    }
+
+    {
+        testsTaken++;
+        QString testName = "elements below the indexed levels are found by descending the tree";
+        if (verbose) {
+            qDebug() << "Test" << testsTaken <<":" << qPrintable(testName);
+        }
+
+        ModelTree tree;
+        tree.setUseElementIndex(true);
+        OctreeElement* element = tree.getRoot();
+        for (int level = 0; level <= OctreeElementIndex::MAX_INDEXED_LEVELS; level++) {
+            element = element->addChildAtIndex(level % NUMBER_OF_CHILDREN);
+        }
+
+        OctreeElementIndex* index = tree.getElementIndex();
+        bool result = index->size() == OctreeElementIndex::MAX_INDEXED_LEVELS + 1
+            && index->find(element->getOctalCode()) == NULL;
+
+        if (result) {
+            testsPassed++;
+        } else {
+            testsFailed++;
+            qDebug() << "FAILED - Test" << testsTaken <<":" << qPrintable(testName);
+        }
+    }
+
+    qDebug() << "   tests passed:" << testsPassed << "out of" << testsTaken;
+    if (testsFailed > 0) {
+        qDebug() << "   tests failed:" << testsFailed;
+    }
+}
+
+void OctreeElementIndexTests::runAllTests(bool verbose) {
+    keyTests(verbose);
+    indexTests(verbose);
+}
@@ -0,0 +1,20 @@
+//
+//  OctreeElementIndexTests.h
+//  tests/octree/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#ifndef hifi_OctreeElementIndexTests_h
+#define hifi_OctreeElementIndexTests_h
+
+namespace OctreeElementIndexTests {
+    void keyTests(bool verbose);
+    void indexTests(bool verbose);
+    void runAllTests(bool verbose);
+}
+
+#endif // hifi_OctreeElementIndexTests_h
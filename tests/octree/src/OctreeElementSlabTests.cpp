@@ -0,0 +1,296 @@
+//
+//  OctreeElementSlabTests.cpp
+//  tests/octree/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#include <cstring>
+
+#include <QDebug>
+#include <QVector>
+
+#include <ModelTree.h>
+#include <ModelTreeElement.h>
+#include <OctalCode.h>
+#include <OctreeConstants.h>
+#include <OctreeElementSlab.h>
+
+#include "OctreeElementSlabTests.h"
+
+void OctreeElementSlabTests::slabTests(bool verbose) {
+    int testsTaken = 0;
+    int testsPassed = 0;
+    int testsFailed = 0;
+
+    qDebug() << "OctreeElementSlabTests::slabTests()";
+
+    {
+        testsTaken++;
+        QString testName = "slabs are shared by sizes that round up to the same block size";
+        if (verbose) {
+            qDebug() << "Test" << testsTaken <<":" << qPrintable(testName);
+        }
+
+        OctreeElementSlab* slab = OctreeElementSlab::forSize(24);
+        bool result = slab->getBlockSize() == 32
+            && OctreeElementSlab::forSize(17) == slab
+            && OctreeElementSlab::forSize(32) == slab
+            && OctreeElementSlab::forSize(33) != slab;
+
+        if (result) {
+            testsPassed++;
+        } else {
+            testsFailed++;
+            qDebug() << "FAILED - Test" << testsTaken <<":" << qPrintable(testName);
+        }
+    }
+
+    {
+        testsTaken++;
+        QString testName = "blocks are found again from their index, across chunks";
+        if (verbose) {
+            qDebug() << "Test" << testsTaken <<":" << qPrintable(testName);
+        }
+
+        OctreeElementSlab* slab = OctreeElementSlab::forSize(48);
+        int numBlocks = 2 * SLAB_CHUNK_BYTES / slab->getBlockSize();
+        QVector<void*> blocks;
+        for (int i = 0; i < numBlocks; i++) {
+            blocks.append(slab->allocate());
+        }
+
+        bool result = true;
+        foreach (void* block, blocks) {
+            if (OctreeElementSlab::slabFor(block) != slab || slab->blockAt(slab->indexOf(block)) != block
+                    || (reinterpret_cast<quintptr>(block) % SLAB_BLOCK_ALIGNMENT) != 0) {
+                result = false;
+            }
+        }
+        foreach (void* block, blocks) {
+            OctreeElementSlab::release(block);
+        }
+
+        if (result) {
+            testsPassed++;
+        } else {
+            testsFailed++;
+            qDebug() << "FAILED - Test" << testsTaken <<":" << qPrintable(testName);
+        }
+    }
+
+    {
+        testsTaken++;
+        QString testName = "released blocks are reused";
+        if (verbose) {
+            qDebug() << "Test" << testsTaken <<":" << qPrintable(testName);
+        }
+
+        OctreeElementSlab* slab = OctreeElementSlab::forSize(64);
+        void* block = slab->allocate();
+        quint64 blocksInUse = slab->getBlocksInUse();
+        quint64 reservedBytes = slab->getReservedBytes();
+        OctreeElementSlab::release(block);
+        void* reusedBlock = slab->allocate();
+
+        bool result = reusedBlock == block && slab->getBlocksInUse() == blocksInUse
+            && slab->getReservedBytes() == reservedBytes;
+        OctreeElementSlab::release(reusedBlock);
+
+        if (result) {
+            testsPassed++;
+        } else {
+            testsFailed++;
+            qDebug() << "FAILED - Test" << testsTaken <<":" << qPrintable(testName);
+        }
+    }
+
+    {
+        testsTaken++;
+        QString testName = "an index that isn't one of the slab's is no block";
+        if (verbose) {
+            qDebug() << "Test" << testsTaken <<":" << qPrintable(testName);
+        }
+
+        OctreeElementSlab* slab = OctreeElementSlab::forSize(80);
+        bool result = slab->blockAt(0xffffffff) == NULL;
+
+        if (result) {
+            testsPassed++;
+        } else {
+            testsFailed++;
+            qDebug() << "FAILED - Test" << testsTaken <<":" << qPrintable(testName);
+        }
+    }
+
+    {
+        testsTaken++;
+        QString testName = "every slab addresses as many chunks as its indices have bits for, well past 4 GB";
+        if (verbose) {
+            qDebug() << "Test" << testsTaken <<":" << qPrintable(testName);
+        }
+
+        const quint64 MIN_ADDRESSABLE_BYTES = 16ULL * 1024 * 1024 * 1024;
+        bool result = true;
+        for (size_t blockSize = SLAB_BLOCK_ALIGNMENT; blockSize <= MAX_SLAB_BLOCK_SIZE; blockSize += SLAB_BLOCK_ALIGNMENT) {
+            OctreeElementSlab* slab = OctreeElementSlab::forSize(blockSize);
+            // the index of the last block of the last chunk has to fit below the children flag bits
+            quint32 blocksPerChunk = (SLAB_CHUNK_BYTES - SLAB_CHUNK_HEADER_BYTES) / slab->getBlockSize();
+            int indexShift = 0;
+            while ((1u << indexShift) < blocksPerChunk) {
+                indexShift++;
+            }
+            quint64 lastBlockIndex = ((quint64)(slab->getMaxChunks() - 1) << indexShift) | (blocksPerChunk - 1);
+            result = result && lastBlockIndex < (1ULL << SLAB_INDEX_BITS)
+                && (quint64)slab->getMaxChunks() * SLAB_CHUNK_BYTES >= MIN_ADDRESSABLE_BYTES;
+        }
+
+        if (result) {
+            testsPassed++;
+        } else {
+            testsFailed++;
+            qDebug() << "FAILED - Test" << testsTaken <<":" << qPrintable(testName);
+        }
+    }
+
+    qDebug() << "   tests passed:" << testsPassed << "out of" << testsTaken;
+    if (testsFailed > 0) {
+        qDebug() << "   tests failed:" << testsFailed;
+    }
+}
+
+static bool childrenMatch(OctreeElement* element, OctreeElement* const* expected) {
+    int expectedCount = 0;
+    for (int i = 0; i < NUMBER_OF_CHILDREN; i++) {
+        if (element->getChildAtIndex(i) != expected[i]) {
+            return false;
+        }
+        if (expected[i]) {
+            expectedCount++;
+        }
+    }
+    return element->getChildCount() == expectedCount;
+}
+
+void OctreeElementSlabTests::childrenTests(bool verbose) {
+    int testsTaken = 0;
+    int testsPassed = 0;
+    int testsFailed = 0;
+
+    qDebug() << "OctreeElementSlabTests::childrenTests()";
+
+    ModelTree tree;
+
+    // children added and removed in different orders go through every count, and so every way of keeping them
+    const int NUMBER_OF_ORDERS = 3;
+    const int addOrders[NUMBER_OF_ORDERS][NUMBER_OF_CHILDREN] = {
+        { 0, 1, 2, 3, 4, 5, 6, 7 },
+        { 7, 6, 5, 4, 3, 2, 1, 0 },
+        { 3, 0, 6, 1, 7, 4, 2, 5 }
+    };
+    const int removeOrders[NUMBER_OF_ORDERS][NUMBER_OF_CHILDREN] = {
+        { 7, 6, 5, 4, 3, 2, 1, 0 },
+        { 4, 0, 7, 2, 5, 1, 6, 3 },
+        { 3, 0, 6, 1, 7, 4, 2, 5 }
+    };
+
+    for (int order = 0; order < NUMBER_OF_ORDERS; order++) {
+        testsTaken++;
+        QString testName = QString("children added and removed in order %1").arg(order);
+        if (verbose) {
+            qDebug() << "Test" << testsTaken <<":" << qPrintable(testName);
+        }
+
+        OctreeElement* parent = tree.getRoot()->addChildAtIndex(order);
+        OctreeElement* expected[NUMBER_OF_CHILDREN] = { NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL };
+        bool result = childrenMatch(parent, expected);
+
+        for (int i = 0; i < NUMBER_OF_CHILDREN; i++) {
+            int childIndex = addOrders[order][i];
+            expected[childIndex] = parent->addChildAtIndex(childIndex);
+            result = result && childrenMatch(parent, expected);
+        }
+        for (int i = 0; i < NUMBER_OF_CHILDREN; i++) {
+            int childIndex = removeOrders[order][i];
+            parent->deleteChildAtIndex(childIndex);
+            expected[childIndex] = NULL;
+            result = result && childrenMatch(parent, expected);
+        }
+        tree.getRoot()->deleteChildAtIndex(order);
+
+        if (result) {
+            testsPassed++;
+        } else {
+            testsFailed++;
+            qDebug() << "FAILED - Test" << testsTaken <<":" << qPrintable(testName);
+        }
+    }
+
+    {
+        testsTaken++;
+        QString testName = "a child replaced in a full element";
+        if (verbose) {
+            qDebug() << "Test" << testsTaken <<":" << qPrintable(testName);
+        }
+
+        OctreeElement* parent = tree.getRoot()->addChildAtIndex(0);
+        OctreeElement* expected[NUMBER_OF_CHILDREN];
+        for (int i = 0; i < NUMBER_OF_CHILDREN; i++) {
+            expected[i] = parent->addChildAtIndex(i);
+        }
+        OctreeElement* removed = parent->removeChildAtIndex(5);
+        expected[5] = parent->addChildAtIndex(5);
+        bool result = removed != NULL && childrenMatch(parent, expected);
+        delete removed;
+        tree.getRoot()->deleteChildAtIndex(0);
+
+        if (result) {
+            testsPassed++;
+        } else {
+            testsFailed++;
+            qDebug() << "FAILED - Test" << testsTaken <<":" << qPrintable(testName);
+        }
+    }
+
+    {
+        testsTaken++;
+        QString testName = "octal codes too long for the element are kept whole";
+        if (verbose) {
+            qDebug() << "Test" << testsTaken <<":" << qPrintable(testName);
+        }
+
+        const int DEEP_LEVELS = 30;
+        OctreeElement* element = tree.getRoot();
+        bool result = true;
+        for (int level = 0; level < DEEP_LEVELS; level++) {
+            unsigned char* expectedCode = childOctalCode(element->getOctalCode(), level % NUMBER_OF_CHILDREN);
+            element = element->addChildAtIndex(level % NUMBER_OF_CHILDREN);
+            size_t expectedLength = bytesRequiredForCodeLength(numberOfThreeBitSectionsInCode(expectedCode));
+            if (memcmp(element->getOctalCode(), expectedCode, expectedLength) != 0) {
+                result = false;
+            }
+            delete[] expectedCode;
+        }
+        tree.getRoot()->deleteChildAtIndex(0);
+
+        if (result) {
+            testsPassed++;
+        } else {
+            testsFailed++;
+            qDebug() << "FAILED - Test" << testsTaken <<":" << qPrintable(testName);
+        }
+    }
+
+    qDebug() << "   tests passed:" << testsPassed << "out of" << testsTaken;
+    if (testsFailed > 0) {
+        qDebug() << "   tests failed:" << testsFailed;
+    }
+}
+
+void OctreeElementSlabTests::runAllTests(bool verbose) {
+    slabTests(verbose);
+    childrenTests(verbose);
+}
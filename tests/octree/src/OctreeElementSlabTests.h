@@ -0,0 +1,20 @@
+//
+//  OctreeElementSlabTests.h
+//  tests/octree/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#ifndef hifi_OctreeElementSlabTests_h
+#define hifi_OctreeElementSlabTests_h
+
+namespace OctreeElementSlabTests {
+    void slabTests(bool verbose);
+    void childrenTests(bool verbose);
+    void runAllTests(bool verbose);
+}
+
+#endif // hifi_OctreeElementSlabTests_h
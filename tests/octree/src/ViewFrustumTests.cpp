@@ -0,0 +1,213 @@
+//
+//  ViewFrustumTests.cpp
+//  tests/octree/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#include <math.h>
+#include <stdlib.h>
+
+#include <QDebug>
+#include <QVector>
+
+#include <glm/gtc/quaternion.hpp>
+
+#include <OctreeConstants.h>
+#include <SharedUtil.h>
+#include <ViewFrustum.h>
+
+#include "ViewFrustumTests.h"
+
+const int NUM_TEST_VIEWS = 50;
+const int CUBES_PER_TEST_VIEW = 2000;
+const int MAX_TEST_CUBE_LEVEL = 14;
+
+static void randomizeView(ViewFrustum& view) {
+    view.setPosition(glm::vec3(randFloat(), randFloat() * 0.1f, randFloat()) * (float)TREE_SCALE);
+    view.setOrientation(glm::quat(glm::radians(glm::vec3(randFloatInRange(-90.0f, 90.0f),
+                                                         randFloatInRange(-180.0f, 180.0f), 0.0f))));
+    view.setFieldOfView(DEFAULT_FIELD_OF_VIEW_DEGREES);
+    view.setAspectRatio(DEFAULT_ASPECT_RATIO);
+    view.setKeyholeRadius(DEFAULT_KEYHOLE_RADIUS);
+    view.calculate();
+}
+
+// a cube of the octree in voxel scale, a quarter of them around the camera so that the keyhole gets tested too
+static AACube randomCube(const ViewFrustum& view, int index) {
+    const int MIN_KEYHOLE_CUBE_LEVEL = 11; // 8 meter cubes, a little bigger than the keyhole
+    bool isAroundCamera = (index % 4 == 0);
+    int level = randIntInRange(isAroundCamera ? MIN_KEYHOLE_CUBE_LEVEL : 1, MAX_TEST_CUBE_LEVEL);
+    float scale = 1.0f / (1 << level);
+
+    glm::vec3 position(randFloat(), randFloat(), randFloat());
+    if (isAroundCamera) {
+        position = view.getPositionVoxelScale() + glm::vec3(randFloatInRange(-1.0f, 1.0f), randFloatInRange(-1.0f, 1.0f),
+                                                            randFloatInRange(-1.0f, 1.0f)) * scale;
+    }
+    glm::vec3 corner = glm::floor(glm::clamp(position, 0.0f, 1.0f - scale) / scale) * scale;
+    return AACube(corner, scale);
+}
+
+static AACube childCubeOf(const AACube& cube, int childIndex) {
+    float childScale = cube.getScale() * 0.5f;
+    glm::vec3 corner = cube.getCorner();
+    for (int axis = 0; axis < 3; axis++) {
+        if ((childIndex >> (2 - axis)) & 1) {
+            corner[axis] += childScale;
+        }
+    }
+    return AACube(corner, childScale);
+}
+
+// the distances from the camera the way OctreeElement finds them, from its cube in voxel scale
+static float distanceToCenter(const ViewFrustum& view, const AACube& voxelCube) {
+    glm::vec3 toCenter = view.getPosition() - voxelCube.calcCenter() * (float)TREE_SCALE;
+    return sqrtf(glm::dot(toCenter, toCenter));
+}
+
+static float distanceToFurthest(const ViewFrustum& view, const AACube& voxelCube) {
+    glm::vec3 furthestPoint;
+    view.getFurthestPointFromCameraVoxelScale(voxelCube, furthestPoint);
+    glm::vec3 toFurthest = view.getPositionVoxelScale() - furthestPoint;
+    return sqrtf(glm::dot(toFurthest, toFurthest)) * (float)TREE_SCALE;
+}
+
+static bool isNear(float value, float expected) {
+    const float RELATIVE_TOLERANCE = 1.0e-6f;
+    return fabsf(value - expected) <= fabsf(expected) * RELATIVE_TOLERANCE;
+}
+
+void ViewFrustumTests::childCubesTests(bool verbose) {
+    int testsTaken = 0;
+    int testsPassed = 0;
+    int testsFailed = 0;
+
+    qDebug() << "ViewFrustumTests::childCubesTests()" << ViewFrustum::getChildCubesInstructionSetName();
+
+    {
+        testsTaken++;
+        QString testName = "the children are where cubeInFrustum() has them, as far as OctreeElement has them";
+        if (verbose) {
+            qDebug() << "Test" << testsTaken <<":" << qPrintable(testName);
+        }
+
+        srand(1);
+        bool result = true;
+        int locationCounts[3] = { 0, 0, 0 };
+        for (int v = 0; v < NUM_TEST_VIEWS && result; v++) {
+            ViewFrustum view;
+            randomizeView(view);
+
+            for (int c = 0; c < CUBES_PER_TEST_VIEW && result; c++) {
+                AACube cube = randomCube(view, c);
+                AACube scaledCube = cube;
+                scaledCube.scale(TREE_SCALE);
+
+                ChildCubeLocations locations;
+                view.childCubesInFrustum(scaledCube, locations);
+
+                for (int i = 0; i < NUMBER_OF_CHILDREN; i++) {
+                    AACube childCube = childCubeOf(cube, i);
+                    AACube scaledChildCube = childCube;
+                    scaledChildCube.scale(TREE_SCALE);
+
+                    ViewFrustum::location expected = view.cubeInFrustum(scaledChildCube);
+                    locationCounts[expected]++;
+                    if (locations.getLocation(i) != expected
+                            || !isNear(locations.distances[i], distanceToCenter(view, childCube))
+                            || !isNear(locations.furthestDistances[i], distanceToFurthest(view, childCube))) {
+                        if (verbose) {
+                            qDebug() << "view" << v << "cube" << c << "child" << i << "is" << locations.getLocation(i)
+                                << "at" << locations.distances[i] << locations.furthestDistances[i] << "expected" << expected
+                                << "at" << distanceToCenter(view, childCube) << distanceToFurthest(view, childCube);
+                        }
+                        result = false;
+                    }
+                }
+            }
+        }
+
+        // the random cubes have to have covered every case for the test to mean anything
+        result = result && locationCounts[ViewFrustum::OUTSIDE] > 0 && locationCounts[ViewFrustum::INTERSECT] > 0
+            && locationCounts[ViewFrustum::INSIDE] > 0;
+        if (verbose) {
+            qDebug() << "outside:" << locationCounts[ViewFrustum::OUTSIDE]
+                << "intersect:" << locationCounts[ViewFrustum::INTERSECT]
+                << "inside:" << locationCounts[ViewFrustum::INSIDE];
+        }
+
+        if (result) {
+            testsPassed++;
+        } else {
+            testsFailed++;
+            qDebug() << "FAILED - Test" << testsTaken <<":" << qPrintable(testName);
+        }
+    }
+
+    qDebug() << "   tests passed:" << testsPassed << "out of" << testsTaken;
+    if (testsFailed > 0) {
+        qDebug() << "   tests failed:" << testsFailed;
+    }
+}
+
+void ViewFrustumTests::benchmarkChildCubes() {
+    const int NUM_BENCHMARK_CUBES = 100000;
+    const int NUM_BENCHMARK_PASSES = 10;
+
+    srand(2);
+    ViewFrustum view;
+    randomizeView(view);
+
+    QVector<AACube> cubes;
+    cubes.reserve(NUM_BENCHMARK_CUBES);
+    for (int c = 0; c < NUM_BENCHMARK_CUBES; c++) {
+        AACube cube = randomCube(view, c);
+        cube.scale(TREE_SCALE);
+        cubes.append(cube);
+    }
+
+    // the location and both distances of each child, one child at a time
+    int checksum = 0;
+    quint64 oneAtATimeStart = usecTimestampNow();
+    for (int p = 0; p < NUM_BENCHMARK_PASSES; p++) {
+        foreach (const AACube& cube, cubes) {
+            for (int i = 0; i < NUMBER_OF_CHILDREN; i++) {
+                AACube childCube = childCubeOf(cube, i);
+                checksum += view.cubeInFrustum(childCube);
+
+                glm::vec3 toCenter = view.getPosition() - childCube.calcCenter();
+                glm::vec3 furthestPoint;
+                view.getFurthestPointFromCamera(childCube, furthestPoint);
+                glm::vec3 toFurthest = view.getPosition() - furthestPoint;
+                checksum += (int)(sqrtf(glm::dot(toCenter, toCenter)) + sqrtf(glm::dot(toFurthest, toFurthest)));
+            }
+        }
+    }
+    quint64 oneAtATimeUsecs = usecTimestampNow() - oneAtATimeStart;
+
+    quint64 batchedStart = usecTimestampNow();
+    for (int p = 0; p < NUM_BENCHMARK_PASSES; p++) {
+        foreach (const AACube& cube, cubes) {
+            ChildCubeLocations locations;
+            view.childCubesInFrustum(cube, locations);
+            checksum -= locations.insideBits + locations.intersectBits;
+            for (int i = 0; i < NUMBER_OF_CHILDREN; i++) {
+                checksum -= (int)(locations.distances[i] + locations.furthestDistances[i]);
+            }
+        }
+    }
+    quint64 batchedUsecs = usecTimestampNow() - batchedStart;
+
+    qDebug("children of %d cubes: one at a time %llu usecs, %s batched %llu usecs (%.2fx) [%d]",
+           NUM_BENCHMARK_CUBES * NUM_BENCHMARK_PASSES, oneAtATimeUsecs, ViewFrustum::getChildCubesInstructionSetName(),
+           batchedUsecs, (batchedUsecs > 0) ? (float)oneAtATimeUsecs / (float)batchedUsecs : 0.0f, checksum);
+}
+
+void ViewFrustumTests::runAllTests(bool verbose) {
+    childCubesTests(verbose);
+    benchmarkChildCubes();
+}
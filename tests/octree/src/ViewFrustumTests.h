@@ -0,0 +1,24 @@
+//
+//  ViewFrustumTests.h
+//  tests/octree/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#ifndef hifi_ViewFrustumTests_h
+#define hifi_ViewFrustumTests_h
+
+namespace ViewFrustumTests {
+    /// checks ViewFrustum::childCubesInFrustum() against cubeInFrustum() on each child of random cubes
+    void childCubesTests(bool verbose);
+
+    /// times childCubesInFrustum() against testing the eight children one at a time, as the octree traversals did
+    void benchmarkChildCubes();
+
+    void runAllTests(bool verbose);
+}
+
+#endif // hifi_ViewFrustumTests_h
@@ -11,10 +11,18 @@
 #include "ModelTests.h"
 #include "OctreeTests.h"
 #include "AABoxCubeTests.h"
+#include "OctreeElementSlabTests.h"
+#include "OctreeElementIndexTests.h"
+#include "OctreeElementBagTests.h"
+#include "ViewFrustumTests.h"
 
 int main(int argc, char** argv) {
     OctreeTests::runAllTests();
     AABoxCubeTests::runAllTests();
     ModelTests::runAllTests(true);
+    OctreeElementSlabTests::runAllTests(true);
+    OctreeElementIndexTests::runAllTests(true);
+    OctreeElementBagTests::runAllTests(true);
+    ViewFrustumTests::runAllTests(true);
     return 0;
 }
@@ -0,0 +1,350 @@
+//
+//  AgentSwarm.cpp
+//  tools/agent-swarm/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#include <algorithm>
+#include <iostream>
+
+#include <QtCore/QCoreApplication>
+#include <QtCore/QDir>
+#include <QtCore/QFile>
+#include <QtCore/QJsonArray>
+#include <QtCore/QJsonDocument>
+#include <QtCore/QMap>
+#include <QtCore/QTimer>
+
+#ifdef Q_OS_LINUX
+#include <unistd.h>
+#endif
+
+#include <SharedUtil.h>
+
+#include "AgentSwarm.h"
+
+using namespace std;
+
+// the names the servers' processes go by, cut to the 15 characters /proc keeps
+const QStringList SERVER_PROCESS_NAMES = QStringList() << "domain-server" << "assignment-clie";
+
+// CPU time comes from /proc, where the kernel counts it in clock ticks
+static quint64 clockTicksPerSecond() {
+#ifdef Q_OS_LINUX
+    return sysconf(_SC_CLK_TCK);
+#else
+    return 0;
+#endif
+}
+
+static bool readProcessTicks(qint64 pid, quint64& ticks) {
+    QFile statFile(QString("/proc/%1/stat").arg(pid));
+    if (!statFile.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+
+    // the name in parentheses can have spaces in it, the fields we want are counted from after it
+    QByteArray stat = statFile.readAll();
+    QList<QByteArray> fields = stat.mid(stat.lastIndexOf(')') + 2).split(' ');
+    const int UTIME_FIELD = 11;
+    const int STIME_FIELD = 12;
+    if (fields.size() <= STIME_FIELD) {
+        return false;
+    }
+    ticks = fields[UTIME_FIELD].toULongLong() + fields[STIME_FIELD].toULongLong();
+    return true;
+}
+
+static QString readProcessName(qint64 pid) {
+    QFile commFile(QString("/proc/%1/comm").arg(pid));
+    if (!commFile.open(QIODevice::ReadOnly)) {
+        return QString();
+    }
+    return QString::fromLocal8Bit(commFile.readAll()).trimmed();
+}
+
+static QList<qint64> findServerPids() {
+    QList<qint64> pids;
+    foreach (const QString& entry, QDir("/proc").entryList(QDir::Dirs | QDir::NoDotAndDotDot)) {
+        bool isPid = false;
+        qint64 pid = entry.toLongLong(&isPid);
+        if (isPid && SERVER_PROCESS_NAMES.contains(readProcessName(pid))) {
+            pids.append(pid);
+        }
+    }
+    return pids;
+}
+
+AgentSwarm::AgentSwarm(int numAgents, int numThreads, const SwarmOptions& options, int warmupSecs, int durationSecs,
+                       const QString& reportFilename, const QList<qint64>& serverPids, QObject* parent) :
+    QObject(parent),
+    _numAgents(numAgents),
+    _warmupSecs(warmupSecs),
+    _durationSecs(durationSecs),
+    _reportFilename(reportFilename),
+    _threads(),
+    _workers(),
+    _numStartedWorkers(0),
+    _numReadyAgents(0),
+    _serverPids(serverPids),
+    _serverProcesses(),
+    _swarmProcess(),
+    _measuringStartedAt(0),
+    _measuringStoppedAt(0)
+{
+    numThreads = std::max(1, std::min(numThreads, numAgents));
+    int firstIndex = 0;
+    for (int i = 0; i < numThreads; i++) {
+        int numWorkerAgents = numAgents / numThreads + (i < numAgents % numThreads ? 1 : 0);
+
+        QThread* thread = new QThread(this);
+        SwarmWorker* worker = new SwarmWorker(firstIndex, numWorkerAgents, options);
+        worker->moveToThread(thread);
+        connect(thread, &QThread::started, worker, &SwarmWorker::start);
+        connect(worker, &SwarmWorker::started, this, &AgentSwarm::workerStarted);
+
+        _threads.append(thread);
+        _workers.append(worker);
+        firstIndex += numWorkerAgents;
+    }
+
+    foreach (QThread* thread, _threads) {
+        thread->start();
+    }
+}
+
+AgentSwarm::~AgentSwarm() {
+    for (int i = 0; i < _threads.size(); i++) {
+        _threads[i]->quit();
+        _threads[i]->wait();
+        delete _workers[i];
+    }
+}
+
+void AgentSwarm::workerStarted(int numReadyAgents) {
+    _numReadyAgents += numReadyAgents;
+    if (++_numStartedWorkers < _workers.size()) {
+        return;
+    }
+
+    if (_numReadyAgents < _numAgents) {
+        cerr << "Only " << _numReadyAgents << " of " << _numAgents << " agents got a socket - raise the limit on open "
+            "files (ulimit -n) to run more" << endl;
+    }
+    cerr << "Running " << _numReadyAgents << " agents on " << _workers.size() << " threads, measuring after a "
+        << _warmupSecs << "s warmup" << endl;
+
+    QTimer::singleShot(_warmupSecs * MSECS_PER_SECOND, this, SLOT(startMeasuring()));
+}
+
+void AgentSwarm::startMeasuring() {
+    foreach (SwarmWorker* worker, _workers) {
+        QMetaObject::invokeMethod(worker, "resetStats");
+    }
+
+    if (_serverPids.isEmpty()) {
+        _serverPids = findServerPids();
+    }
+    foreach (qint64 pid, _serverPids) {
+        ServerProcess process;
+        process.pid = pid;
+        process.name = readProcessName(pid);
+        process.endTicks = 0;
+        if (readProcessTicks(pid, process.startTicks)) {
+            _serverProcesses.append(process);
+        }
+    }
+
+    _swarmProcess.pid = QCoreApplication::applicationPid();
+    _swarmProcess.name = readProcessName(_swarmProcess.pid);
+    _swarmProcess.startTicks = 0;
+    _swarmProcess.endTicks = 0;
+    readProcessTicks(_swarmProcess.pid, _swarmProcess.startTicks);
+
+    _measuringStartedAt = usecTimestampNow();
+    QTimer::singleShot(_durationSecs * MSECS_PER_SECOND, this, SLOT(stopMeasuring()));
+}
+
+void AgentSwarm::stopMeasuring() {
+    _measuringStoppedAt = usecTimestampNow();
+    for (int i = 0; i < _serverProcesses.size(); i++) {
+        readProcessTicks(_serverProcesses[i].pid, _serverProcesses[i].endTicks);
+    }
+    readProcessTicks(_swarmProcess.pid, _swarmProcess.endTicks);
+
+    // the agents are only read once their threads are done with them
+    for (int i = 0; i < _threads.size(); i++) {
+        QMetaObject::invokeMethod(_workers[i], "stop", Qt::BlockingQueuedConnection);
+        _threads[i]->quit();
+        _threads[i]->wait();
+    }
+
+    writeReport(buildReport());
+    emit finished();
+}
+
+static QJsonObject cpuForProcess(const ServerProcess& process, float elapsedSecs) {
+    QJsonObject cpu;
+    cpu["pid"] = (double)process.pid;
+    cpu["name"] = process.name;
+
+    quint64 ticksPerSecond = clockTicksPerSecond();
+    if (ticksPerSecond > 0 && elapsedSecs > 0.0f && process.endTicks >= process.startTicks) {
+        float cpuSecs = (float)(process.endTicks - process.startTicks) / ticksPerSecond;
+        cpu["cpu_secs"] = cpuSecs;
+        cpu["cpu_percent"] = 100.0f * cpuSecs / elapsedSecs;
+    }
+    return cpu;
+}
+
+// what all the agents saw of one type of server
+class ServerTypeTotals {
+public:
+    ServerTypeTotals() : packetsReceived(0), received(0), expected(0), lost(0), outOfOrder(0),
+        pingSamples(0), pingAverageSum(0.0), pingMax(0), flightSamples(0), flightAverageSum(0.0), flightMax(0),
+        sceneSamples(0), sceneAverageSum(0.0), usefulSceneAverageSum(0.0), gapMax(0) { }
+
+    qint64 packetsReceived;
+    qint64 received;
+    qint64 expected;
+    qint64 lost;
+    qint64 outOfOrder;
+    int pingSamples;
+    double pingAverageSum;
+    quint64 pingMax;
+    int flightSamples;
+    double flightAverageSum;
+    quint64 flightMax;
+    int sceneSamples;
+    double sceneAverageSum;
+    double usefulSceneAverageSum;
+    quint64 gapMax;
+};
+
+QJsonObject AgentSwarm::buildReport() const {
+    float elapsedSecs = (float)(_measuringStoppedAt - _measuringStartedAt) / USECS_PER_SECOND;
+
+    QJsonArray agents;
+    QMap<QString, ServerTypeTotals> serverTypeTotals;
+    int numConnectedAgents = 0;
+    qint64 audioFramesSent = 0;
+    qint64 avatarPacketsSent = 0;
+    qint64 queriesSent = 0;
+    qint64 editsSent = 0;
+
+    foreach (SwarmWorker* worker, _workers) {
+        foreach (const QJsonValue& agentStats, worker->getAgentStats()) {
+            agents.append(agentStats);
+        }
+        numConnectedAgents += worker->getNumConnectedAgents();
+
+        foreach (SwarmAgent* agent, worker->getAgents()) {
+            audioFramesSent += agent->getAudioFramesSent();
+            avatarPacketsSent += agent->getAvatarPacketsSent();
+            queriesSent += agent->getQueriesSent();
+            editsSent += agent->getEditsSent();
+
+            foreach (const SwarmServer& server, agent->getServers()) {
+                ServerTypeTotals& totals = serverTypeTotals[NodeType::getNodeTypeName(server.type)];
+                totals.packetsReceived += server.packetsReceived;
+                totals.received += server.inboundSequenceNumberStats.getReceived();
+                totals.expected += server.inboundSequenceNumberStats.getExpectedReceived();
+                totals.lost += server.inboundSequenceNumberStats.getLost();
+                totals.outOfOrder += server.inboundSequenceNumberStats.getOutOfOrder();
+                if (server.pingUsecs.getMax() > 0) {
+                    totals.pingSamples++;
+                    totals.pingAverageSum += server.pingUsecs.getAverage();
+                    totals.pingMax = std::max(totals.pingMax, server.pingUsecs.getMax());
+                }
+                if (server.flightUsecs.getMax() > 0) {
+                    totals.flightSamples++;
+                    totals.flightAverageSum += server.flightUsecs.getAverage();
+                    totals.flightMax = std::max(totals.flightMax, server.flightUsecs.getMax());
+                }
+                if (server.sceneUsecs.getMax() > 0) {
+                    totals.sceneSamples++;
+                    totals.sceneAverageSum += server.sceneUsecs.getAverage();
+                    totals.usefulSceneAverageSum += server.usefulSceneUsecs.getAverage();
+                }
+                totals.gapMax = std::max(totals.gapMax, server.inboundGapUsecs.getMax());
+            }
+        }
+    }
+
+    QJsonObject servers;
+    QMap<QString, ServerTypeTotals>::const_iterator totals = serverTypeTotals.constBegin();
+    while (totals != serverTypeTotals.constEnd()) {
+        QJsonObject typeStats;
+        typeStats["packets_received"] = (double)totals->packetsReceived;
+        if (totals->expected > 0) {
+            typeStats["sequenced_received"] = (double)totals->received;
+            typeStats["sequenced_expected"] = (double)totals->expected;
+            typeStats["sequenced_lost"] = (double)totals->lost;
+            typeStats["sequenced_out_of_order"] = (double)totals->outOfOrder;
+            typeStats["loss_rate"] = (double)totals->lost / totals->expected;
+        }
+        if (totals->pingSamples > 0) {
+            typeStats["ping_usecs_avg"] = totals->pingAverageSum / totals->pingSamples;
+            typeStats["ping_usecs_max"] = (double)totals->pingMax;
+        }
+        if (totals->flightSamples > 0) {
+            typeStats["flight_usecs_avg"] = totals->flightAverageSum / totals->flightSamples;
+            typeStats["flight_usecs_max"] = (double)totals->flightMax;
+        }
+        if (totals->sceneSamples > 0) {
+            typeStats["scene_usecs_avg"] = totals->sceneAverageSum / totals->sceneSamples;
+            typeStats["useful_scene_usecs_avg"] = totals->usefulSceneAverageSum / totals->sceneSamples;
+        }
+        if (totals->gapMax > 0) {
+            typeStats["gap_usecs_max"] = (double)totals->gapMax;
+        }
+        servers[totals.key()] = typeStats;
+        ++totals;
+    }
+
+    QJsonArray cpu;
+    foreach (const ServerProcess& process, _serverProcesses) {
+        cpu.append(cpuForProcess(process, elapsedSecs));
+    }
+
+    QJsonObject summary;
+    summary["agents_requested"] = _numAgents;
+    summary["agents_running"] = _numReadyAgents;
+    summary["agents_connected"] = numConnectedAgents;
+    summary["threads"] = _workers.size();
+    summary["warmup_secs"] = _warmupSecs;
+    summary["measured_secs"] = elapsedSecs;
+    summary["audio_frames_sent"] = (double)audioFramesSent;
+    summary["avatar_packets_sent"] = (double)avatarPacketsSent;
+    summary["queries_sent"] = (double)queriesSent;
+    summary["edits_sent"] = (double)editsSent;
+
+    QJsonObject report;
+    report["summary"] = summary;
+    report["servers"] = servers;
+    report["server_cpu"] = cpu;
+    report["swarm_cpu"] = cpuForProcess(_swarmProcess, elapsedSecs);
+    report["agents"] = agents;
+    return report;
+}
+
+void AgentSwarm::writeReport(const QJsonObject& report) const {
+    QByteArray json = QJsonDocument(report).toJson();
+
+    if (_reportFilename.isEmpty()) {
+        cout << json.constData();
+        return;
+    }
+
+    QFile reportFile(_reportFilename);
+    if (!reportFile.open(QIODevice::WriteOnly | QIODevice::Truncate) || reportFile.write(json) != json.size()) {
+        cerr << "Failed to write the report to " << qPrintable(_reportFilename) << ": "
+            << qPrintable(reportFile.errorString()) << endl;
+        return;
+    }
+    cerr << "Wrote the report to " << qPrintable(_reportFilename) << endl;
+}
@@ -0,0 +1,70 @@
+//
+//  AgentSwarm.h
+//  tools/agent-swarm/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#ifndef hifi_AgentSwarm_h
+#define hifi_AgentSwarm_h
+
+#include <QtCore/QJsonObject>
+#include <QtCore/QObject>
+#include <QtCore/QThread>
+#include <QtCore/QVector>
+
+#include "SwarmWorker.h"
+
+/// A server process on this machine whose CPU time the report includes
+class ServerProcess {
+public:
+    qint64 pid;
+    QString name;
+    quint64 startTicks;
+    quint64 endTicks;
+};
+
+/// Spreads the agents over worker threads and runs them for a while: first a warmup, for them to connect and the
+/// servers to settle, and then the measured run. At the end it writes a JSON report of what each agent saw, totals for
+/// each type of server, and how much CPU the servers on this machine used during the run.
+class AgentSwarm : public QObject {
+    Q_OBJECT
+public:
+    /// \param serverPids the servers to measure, or none to find the domain-server and assignment-clients running here
+    AgentSwarm(int numAgents, int numThreads, const SwarmOptions& options, int warmupSecs, int durationSecs,
+               const QString& reportFilename, const QList<qint64>& serverPids, QObject* parent = 0);
+    ~AgentSwarm();
+
+signals:
+    void finished();
+
+private slots:
+    void workerStarted(int numReadyAgents);
+    void startMeasuring();
+    void stopMeasuring();
+
+private:
+    QJsonObject buildReport() const;
+    void writeReport(const QJsonObject& report) const;
+
+    int _numAgents;
+    int _warmupSecs;
+    int _durationSecs;
+    QString _reportFilename;
+
+    QVector<QThread*> _threads;
+    QVector<SwarmWorker*> _workers;
+    int _numStartedWorkers;
+    int _numReadyAgents;
+
+    QList<qint64> _serverPids;
+    QVector<ServerProcess> _serverProcesses;
+    ServerProcess _swarmProcess;
+    quint64 _measuringStartedAt;
+    quint64 _measuringStoppedAt;
+};
+
+#endif // hifi_AgentSwarm_h
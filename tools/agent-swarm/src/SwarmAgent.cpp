@@ -0,0 +1,672 @@
+//
+//  SwarmAgent.cpp
+//  tools/agent-swarm/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+#include <QtCore/QDataStream>
+#include <QtCore/QDebug>
+#include <QtCore/QJsonArray>
+
+#include <glm/gtc/quaternion.hpp>
+
+#include <AudioRingBuffer.h>
+#include <NodeList.h>
+#include <OctalCode.h>
+#include <OctreePacketData.h>
+#include <OctreeSceneStats.h>
+#include <PacketHeaders.h>
+#include <SharedUtil.h>
+#include <UUID.h>
+
+#include "SwarmAgent.h"
+
+const quint64 DOMAIN_CHECK_IN_INTERVAL_USECS = DOMAIN_SERVER_CHECK_IN_MSECS * USECS_PER_MSEC;
+const quint64 AVATAR_DATA_INTERVAL_USECS = USECS_PER_SECOND / 60;
+const quint64 OCTREE_QUERY_INTERVAL_USECS = USECS_PER_SECOND / 10;
+
+// a late worker catches up on at most this many audio frames, any more than that are lost like a stalled client's
+const int MAX_AUDIO_FRAMES_PER_UPDATE = 4;
+
+// agents walk in circles laid out on a grid, so that they hear and see some of each other but not all of them
+const int WALK_GRID_COLUMNS = 32;
+const float WALK_GRID_SPACING = 8.0f;
+const float WALK_GRID_ORIGIN = 100.0f;
+const float WALK_RADIUS = 3.0f;
+const float WALK_LAP_SECONDS = 20.0f;
+const float EYE_HEIGHT = 1.7f;
+const float HEAD_NOD_DEGREES = 15.0f;
+const float HEAD_NOD_SECONDS = 4.0f;
+
+const float TONE_BASE_FREQUENCY = 220.0f;
+const float TONE_FREQUENCY_STEP = 20.0f;
+const int TONE_FREQUENCY_STEPS = 20;
+const float TONE_AMPLITUDE = 0.1f * std::numeric_limits<int16_t>::max();
+
+// talkers take turns, each talking for part of a cycle that starts at a different time for every agent
+const quint64 TALK_CYCLE_USECS = 5 * USECS_PER_SECOND;
+const quint64 TALK_USECS = 2 * USECS_PER_SECOND;
+
+const float EDIT_VOXEL_METERS = 1.0f;
+
+// the servers these agents use, the same as an Agent assignment's
+const NodeSet SWARM_AGENT_INTERESTS = NodeSet() << NodeType::AudioMixer << NodeType::AvatarMixer << NodeType::VoxelServer;
+
+SwarmServer::SwarmServer() :
+    type(NodeType::Unassigned),
+    connectionSecret(),
+    publicSocket(),
+    localSocket(),
+    activeSocket(),
+    outgoingSequenceNumber(0),
+    inboundSequenceNumberStats(),
+    pingUsecs(1, 1),
+    flightUsecs(1, 1),
+    sceneUsecs(1, 1),
+    usefulSceneUsecs(1, 1),
+    lastInboundAt(0),
+    inboundGapUsecs(1, 1),
+    packetsReceived(0),
+    bytesReceived(0)
+{
+}
+
+SwarmAgent::SwarmAgent(int index, const SwarmOptions& options, QObject* parent) :
+    QObject(parent),
+    _index(index),
+    _options(options),
+    _isReady(false),
+    _socket(new QUdpSocket(this)),
+    _sessionUUID(),
+    _domainListVersion(0),
+    _pendingDomainListVersion(0),
+    _pendingDomainListParts(),
+    _servers(),
+    _connectedAt(0),
+    _startedAt(usecTimestampNow()),
+    _nextCheckInAt(0),
+    _nextAudioFrameAt(0),
+    _nextAvatarDataAt(0),
+    _nextQueryAt(0),
+    _nextEditAt(0),
+    _avatar(),
+    _viewFrustum(),
+    _octreeQuery(),
+    _walkCenter(WALK_GRID_ORIGIN + (index % WALK_GRID_COLUMNS) * WALK_GRID_SPACING, 0.0f,
+                WALK_GRID_ORIGIN + (index / WALK_GRID_COLUMNS) * WALK_GRID_SPACING),
+    _walkPhase(randFloat() * TWO_PI),
+    _tonePhase(0.0f),
+    _toneFrequency(TONE_BASE_FREQUENCY + (index % TONE_FREQUENCY_STEPS) * TONE_FREQUENCY_STEP),
+    _talkPhaseUsecs(randIntInRange(0, TALK_CYCLE_USECS)),
+    _audioFramesSent(0),
+    _avatarPacketsSent(0),
+    _queriesSent(0),
+    _editsSent(0),
+    _avatarPacketsReceived(0)
+{
+    if (!_socket->bind(QHostAddress::AnyIPv4, 0)) {
+        qDebug() << "Agent" << index << "failed to bind a socket -" << _socket->errorString();
+        return;
+    }
+    connect(_socket, &QUdpSocket::readyRead, this, &SwarmAgent::readPendingDatagrams);
+
+    // spread the agents over a frame, so that they don't all send at once
+    quint64 offset = randIntInRange(0, BUFFER_SEND_INTERVAL_USECS);
+    _nextAudioFrameAt = _startedAt + offset;
+    _nextAvatarDataAt = _startedAt + offset;
+    _nextQueryAt = _startedAt + offset;
+    if (_options.editsPerSecond > 0.0f) {
+        _nextEditAt = _startedAt + randFloat() * USECS_PER_SECOND / _options.editsPerSecond;
+    }
+
+    _viewFrustum.setFieldOfView(DEFAULT_FIELD_OF_VIEW_DEGREES);
+    _viewFrustum.setAspectRatio(DEFAULT_ASPECT_RATIO);
+
+    _octreeQuery.setWantLowResMoving(true);
+    _octreeQuery.setWantColor(true);
+    _octreeQuery.setWantDelta(true);
+    _octreeQuery.setWantOcclusionCulling(false);
+    _octreeQuery.setWantCompression(true);
+    _octreeQuery.setOctreeSizeScale(DEFAULT_OCTREE_SIZE_SCALE);
+    _octreeQuery.setBoundaryLevelAdjust(0);
+
+    _isReady = true;
+}
+
+void SwarmAgent::update(quint64 now) {
+    if (now >= _nextCheckInAt) {
+        checkInWithDomain();
+        pingServers(now);
+        _nextCheckInAt = now + DOMAIN_CHECK_IN_INTERVAL_USECS;
+    }
+
+    if (!isConnected()) {
+        return;
+    }
+
+    move(now);
+
+    int audioFrames = 0;
+    while (now >= _nextAudioFrameAt) {
+        if (audioFrames++ < MAX_AUDIO_FRAMES_PER_UPDATE) {
+            sendAudioFrame(now);
+        }
+        _nextAudioFrameAt += BUFFER_SEND_INTERVAL_USECS;
+    }
+
+    if (now >= _nextAvatarDataAt) {
+        sendAvatarData();
+        _nextAvatarDataAt = std::max(_nextAvatarDataAt + AVATAR_DATA_INTERVAL_USECS, now);
+    }
+
+    if (now >= _nextQueryAt) {
+        sendOctreeQuery();
+        _nextQueryAt = std::max(_nextQueryAt + OCTREE_QUERY_INTERVAL_USECS, now);
+    }
+
+    if (_options.editsPerSecond > 0.0f && now >= _nextEditAt) {
+        sendVoxelEdit(now);
+        _nextEditAt = std::max(_nextEditAt + (quint64)(USECS_PER_SECOND / _options.editsPerSecond), now);
+    }
+}
+
+void SwarmAgent::resetStats() {
+    _audioFramesSent = 0;
+    _avatarPacketsSent = 0;
+    _queriesSent = 0;
+    _editsSent = 0;
+    _avatarPacketsReceived = 0;
+
+    QHash<QUuid, SwarmServer>::iterator server = _servers.begin();
+    while (server != _servers.end()) {
+        server->inboundSequenceNumberStats.reset();
+        server->pingUsecs.reset();
+        server->flightUsecs.reset();
+        server->sceneUsecs.reset();
+        server->usefulSceneUsecs.reset();
+        server->inboundGapUsecs.reset();
+        server->lastInboundAt = 0;
+        server->packetsReceived = 0;
+        server->bytesReceived = 0;
+        ++server;
+    }
+}
+
+void SwarmAgent::checkInWithDomain() {
+    // the first check in connects, after that we ask for the changes to the list like any connected node
+    PacketType packetType = isConnected() ? PacketTypeDomainListRequest : PacketTypeDomainConnectRequest;
+    QByteArray packet = byteArrayWithPopulatedHeader(packetType, _sessionUUID);
+    QDataStream packetStream(&packet, QIODevice::Append);
+
+    // a null public socket has the domain-server use the address the request came from
+    packetStream << NodeType::Agent << HifiSockAddr()
+        << HifiSockAddr(QHostAddress(getHostOrderLocalAddress()), _socket->localPort())
+        << (quint8) SWARM_AGENT_INTERESTS.size();
+    foreach (NodeType_t interest, SWARM_AGENT_INTERESTS) {
+        packetStream << interest;
+    }
+
+    if (packetType == PacketTypeDomainListRequest) {
+        packetStream << _domainListVersion;
+    }
+
+    _socket->writeDatagram(packet, _options.domainSockAddr.getAddress(), _options.domainSockAddr.getPort());
+}
+
+void SwarmAgent::processDomainList(const QByteArray& packet) {
+    QDataStream packetStream(packet);
+    packetStream.skipRawData(numBytesForPacketHeader(packet));
+
+    QUuid sessionUUID;
+    packetStream >> sessionUUID;
+    if (_sessionUUID.isNull()) {
+        _connectedAt = usecTimestampNow();
+        _avatar.setSessionUUID(sessionUUID);
+    }
+    _sessionUUID = sessionUUID;
+
+    quint32 listVersion = 0;
+    quint8 isFullList = 0;
+    quint16 partIndex = 0;
+    quint16 numParts = 0;
+    packetStream >> listVersion >> isFullList >> partIndex >> numParts;
+
+    if (listVersion != _pendingDomainListVersion) {
+        _pendingDomainListVersion = listVersion;
+        _pendingDomainListParts.clear();
+    }
+
+    while (packetStream.device()->pos() < packet.size()) {
+        quint8 entryType = DOMAIN_LIST_NODE_ENTRY;
+        packetStream >> entryType;
+
+        QUuid nodeUUID;
+        if (entryType == DOMAIN_LIST_REMOVED_NODE_ENTRY) {
+            packetStream >> nodeUUID;
+            _servers.remove(nodeUUID);
+            continue;
+        }
+
+        NodeType_t nodeType;
+        HifiSockAddr publicSocket;
+        HifiSockAddr localSocket;
+        QUuid connectionSecret;
+        packetStream >> nodeType >> nodeUUID >> publicSocket >> localSocket >> connectionSecret;
+
+        // a server without a public address is at the domain-server's
+        if (publicSocket.getAddress().isNull()) {
+            publicSocket.setAddress(_options.domainSockAddr.getAddress());
+        }
+
+        SwarmServer& server = _servers[nodeUUID];
+        if (server.publicSocket != publicSocket || server.localSocket != localSocket) {
+            server.activeSocket = HifiSockAddr();
+        }
+        server.type = nodeType;
+        server.connectionSecret = connectionSecret;
+        server.publicSocket = publicSocket;
+        server.localSocket = localSocket;
+    }
+
+    _pendingDomainListParts.insert(partIndex);
+    if (_pendingDomainListParts.size() >= numParts) {
+        _domainListVersion = listVersion;
+    }
+}
+
+void SwarmAgent::pingServers(quint64 now) {
+    QHash<QUuid, SwarmServer>::iterator server = _servers.begin();
+    while (server != _servers.end()) {
+        // until a server answered on one of its sockets we try both, after that the pings are just for timing
+        if (server->activeSocket.isNull()) {
+            QByteArray localPing = byteArrayWithPopulatedHeader(PacketTypePing, _sessionUUID);
+            QDataStream localStream(&localPing, QIODevice::Append);
+            localStream << PingType::Local << now;
+            replaceHashInPacketGivenConnectionUUID(localPing, server->connectionSecret);
+            _socket->writeDatagram(localPing, server->localSocket.getAddress(), server->localSocket.getPort());
+
+            QByteArray publicPing = byteArrayWithPopulatedHeader(PacketTypePing, _sessionUUID);
+            QDataStream publicStream(&publicPing, QIODevice::Append);
+            publicStream << PingType::Public << now;
+            replaceHashInPacketGivenConnectionUUID(publicPing, server->connectionSecret);
+            _socket->writeDatagram(publicPing, server->publicSocket.getAddress(), server->publicSocket.getPort());
+        } else {
+            QByteArray ping = byteArrayWithPopulatedHeader(PacketTypePing, _sessionUUID);
+            QDataStream pingStream(&ping, QIODevice::Append);
+            pingStream << PingType::Agnostic << now;
+            writeToServer(ping, server.value());
+        }
+        ++server;
+    }
+}
+
+void SwarmAgent::processPing(const QByteArray& packet, const HifiSockAddr& senderSockAddr) {
+    QHash<QUuid, SwarmServer>::const_iterator server = _servers.constFind(uuidFromPacketHeader(packet));
+    if (server == _servers.constEnd()) {
+        return;
+    }
+
+    QDataStream pingStream(packet);
+    pingStream.skipRawData(numBytesForPacketHeader(packet));
+    PingType_t pingType;
+    quint64 timeFromOriginalPing;
+    pingStream >> pingType >> timeFromOriginalPing;
+
+    QByteArray reply = byteArrayWithPopulatedHeader(PacketTypePingReply, _sessionUUID);
+    QDataStream replyStream(&reply, QIODevice::Append);
+    replyStream << pingType << timeFromOriginalPing << usecTimestampNow();
+    replaceHashInPacketGivenConnectionUUID(reply, server->connectionSecret);
+    _socket->writeDatagram(reply, senderSockAddr.getAddress(), senderSockAddr.getPort());
+}
+
+void SwarmAgent::processPingReply(const QByteArray& packet, quint64 now) {
+    QHash<QUuid, SwarmServer>::iterator server = _servers.find(uuidFromPacketHeader(packet));
+    if (server == _servers.end()) {
+        return;
+    }
+
+    QDataStream replyStream(packet);
+    replyStream.skipRawData(numBytesForPacketHeader(packet));
+    PingType_t pingType;
+    quint64 timeFromOriginalPing;
+    replyStream >> pingType >> timeFromOriginalPing;
+
+    // the same rules NodeList uses to pick the socket
+    if (pingType == PingType::Local && server->activeSocket != server->localSocket) {
+        server->activeSocket = server->localSocket;
+    } else if (pingType == PingType::Public && server->activeSocket.isNull()) {
+        server->activeSocket = server->publicSocket;
+    }
+
+    if (now > timeFromOriginalPing) {
+        server->pingUsecs.update(now - timeFromOriginalPing);
+    }
+}
+
+void SwarmAgent::processMixedAudio(SwarmServer& server, const QByteArray& packet, quint64 now) {
+    int numBytesPacketHeader = numBytesForPacketHeader(packet);
+    if (packet.size() < numBytesPacketHeader + (int)sizeof(quint16)) {
+        return;
+    }
+    quint16 sequence;
+    memcpy(&sequence, packet.constData() + numBytesPacketHeader, sizeof(quint16));
+    server.inboundSequenceNumberStats.sequenceNumberReceived(sequence, uuidFromPacketHeader(packet));
+
+    // the mix is a steady stream, so how far apart the packets arrive is how late the late ones were
+    if (server.lastInboundAt != 0) {
+        server.inboundGapUsecs.update(now - server.lastInboundAt);
+    }
+    server.lastInboundAt = now;
+}
+
+void SwarmAgent::processOctreeData(SwarmServer& server, const QByteArray& packet, quint64 now) {
+    const char* dataAt = packet.constData();
+    int dataBytes = packet.size();
+
+    // a stats message can come first, with the octree data piggybacked after it
+    if (packetTypeForPacket(packet) == PacketTypeOctreeStats) {
+        OctreeSceneStats stats;
+        int statsMessageLength = stats.unpackFromMessage(reinterpret_cast<const unsigned char*>(dataAt), dataBytes);
+        if (stats.isFullScene()) {
+            server.sceneUsecs.update(stats.getElapsedTime());
+            server.usefulSceneUsecs.update(stats.getUsefulElapsedTime());
+        }
+        dataAt += statsMessageLength;
+        dataBytes -= statsMessageLength;
+        if (dataBytes <= 0) {
+            return;
+        }
+    }
+
+    int numBytesPacketHeader = numBytesForPacketHeader(dataAt);
+    if (dataBytes < numBytesPacketHeader + (int)OCTREE_PACKET_EXTRA_HEADERS_SIZE) {
+        return;
+    }
+    dataAt += numBytesPacketHeader + sizeof(OCTREE_PACKET_FLAGS);
+
+    OCTREE_PACKET_SEQUENCE sequence;
+    memcpy(&sequence, dataAt, sizeof(sequence));
+    dataAt += sizeof(sequence);
+    OCTREE_PACKET_SENT_TIME sentAt;
+    memcpy(&sentAt, dataAt, sizeof(sentAt));
+
+    server.inboundSequenceNumberStats.sequenceNumberReceived(sequence, uuidFromPacketHeader(packet));
+
+    // the servers are on this machine, so their clock is ours
+    if (now > sentAt) {
+        server.flightUsecs.update(now - sentAt);
+    }
+}
+
+void SwarmAgent::readPendingDatagrams() {
+    QByteArray incomingPacket;
+    HifiSockAddr senderSockAddr;
+
+    while (_socket->hasPendingDatagrams()) {
+        incomingPacket.resize(_socket->pendingDatagramSize());
+        _socket->readDatagram(incomingPacket.data(), incomingPacket.size(),
+                              senderSockAddr.getAddressPointer(), senderSockAddr.getPortPointer());
+        quint64 now = usecTimestampNow();
+
+        PacketType packetType = packetTypeForPacket(incomingPacket);
+        if (versionFromPacketHeader(incomingPacket.constData()) != versionForPacketType(packetType)) {
+            continue;
+        }
+
+        if (packetType == PacketTypeDomainList) {
+            processDomainList(incomingPacket);
+            continue;
+        }
+
+        QHash<QUuid, SwarmServer>::iterator server = _servers.find(uuidFromPacketHeader(incomingPacket));
+        if (server == _servers.end()) {
+            continue;
+        }
+        server->packetsReceived++;
+        server->bytesReceived += incomingPacket.size();
+
+        switch (packetType) {
+            case PacketTypePing:
+                processPing(incomingPacket, senderSockAddr);
+                break;
+            case PacketTypePingReply:
+                processPingReply(incomingPacket, now);
+                break;
+            case PacketTypeMixedAudio:
+                processMixedAudio(server.value(), incomingPacket, now);
+                break;
+            case PacketTypeVoxelData:
+            case PacketTypeOctreeStats:
+                processOctreeData(server.value(), incomingPacket, now);
+                break;
+            case PacketTypeBulkAvatarData:
+                _avatarPacketsReceived++;
+                break;
+            default:
+                break;
+        }
+    }
+}
+
+void SwarmAgent::move(quint64 now) {
+    float seconds = _options.holdStill ? 0.0f : (float)(now - _startedAt) / USECS_PER_SECOND;
+
+    // walk counterclockwise around the circle, facing the way we're going
+    float angle = _walkPhase + TWO_PI * seconds / WALK_LAP_SECONDS;
+    glm::vec3 position = _walkCenter + glm::vec3(cosf(angle), 0.0f, -sinf(angle)) * WALK_RADIUS;
+    float bodyYaw = glm::degrees(angle);
+    float headPitch = HEAD_NOD_DEGREES * sinf(TWO_PI * seconds / HEAD_NOD_SECONDS);
+
+    _avatar.setPosition(position);
+    _avatar.setBodyYaw(bodyYaw);
+    if (_avatar.getHeadData()) {
+        _avatar.setHeadPitch(headPitch);
+    }
+
+    _viewFrustum.setPosition(position + glm::vec3(0.0f, EYE_HEIGHT, 0.0f));
+    _viewFrustum.setOrientation(glm::quat(glm::radians(glm::vec3(headPitch, bodyYaw, 0.0f))));
+    _viewFrustum.calculate();
+}
+
+void SwarmAgent::writeToServer(QByteArray& packet, const SwarmServer& server) {
+    if (!NON_VERIFIED_PACKETS.contains(packetTypeForPacket(packet))) {
+        replaceHashInPacketGivenConnectionUUID(packet, server.connectionSecret);
+    }
+    _socket->writeDatagram(packet, server.activeSocket.getAddress(), server.activeSocket.getPort());
+}
+
+void SwarmAgent::sendAudioFrame(quint64 now) {
+    bool isSilent = _options.audioPattern == SwarmAudio::Silence
+        || (_options.audioPattern == SwarmAudio::Talk && (now + _talkPhaseUsecs) % TALK_CYCLE_USECS >= TALK_USECS);
+
+    int16_t samples[NETWORK_BUFFER_LENGTH_SAMPLES_PER_CHANNEL];
+    if (!isSilent) {
+        float phaseStep = TWO_PI * _toneFrequency / SAMPLE_RATE;
+        for (int i = 0; i < NETWORK_BUFFER_LENGTH_SAMPLES_PER_CHANNEL; i++) {
+            samples[i] = (int16_t)(TONE_AMPLITUDE * sinf(_tonePhase));
+            _tonePhase = fmodf(_tonePhase + phaseStep, TWO_PI);
+        }
+    }
+
+    glm::vec3 position = _avatar.getPosition();
+    glm::quat orientation = _avatar.getOrientation();
+
+    QHash<QUuid, SwarmServer>::iterator server = _servers.begin();
+    while (server != _servers.end()) {
+        if (server->type != NodeType::AudioMixer || server->activeSocket.isNull()) {
+            ++server;
+            continue;
+        }
+
+        // the same frame ScriptEngine sends for a scripted avatar
+        QByteArray audioPacket = byteArrayWithPopulatedHeader(isSilent ? PacketTypeSilentAudioFrame
+                                                                       : PacketTypeMicrophoneAudioNoEcho, _sessionUUID);
+        QDataStream packetStream(&audioPacket, QIODevice::Append);
+        packetStream << server->outgoingSequenceNumber++;
+        packetStream << (quint8) 0;
+        packetStream.writeRawData(reinterpret_cast<const char*>(&position), sizeof(glm::vec3));
+        packetStream.writeRawData(reinterpret_cast<const char*>(&orientation), sizeof(glm::quat));
+
+        if (isSilent) {
+            int16_t numSilentSamples = NETWORK_BUFFER_LENGTH_SAMPLES_PER_CHANNEL;
+            packetStream.writeRawData(reinterpret_cast<const char*>(&numSilentSamples), sizeof(int16_t));
+        } else {
+            packetStream.writeRawData(reinterpret_cast<const char*>(samples), sizeof(samples));
+        }
+
+        writeToServer(audioPacket, server.value());
+        ++server;
+    }
+    _audioFramesSent++;
+}
+
+void SwarmAgent::sendAvatarData() {
+    QByteArray avatarPacket;
+    bool hasAvatarData = false;
+
+    QHash<QUuid, SwarmServer>::iterator server = _servers.begin();
+    while (server != _servers.end()) {
+        if (server->type == NodeType::AvatarMixer && !server->activeSocket.isNull()) {
+            if (!hasAvatarData) {
+                avatarPacket = byteArrayWithPopulatedHeader(PacketTypeAvatarData, _sessionUUID);
+                avatarPacket.append(_avatar.toByteArray());
+                hasAvatarData = true;
+            }
+            QByteArray packet = avatarPacket;
+            writeToServer(packet, server.value());
+        }
+        ++server;
+    }
+
+    if (hasAvatarData) {
+        _avatarPacketsSent++;
+    }
+}
+
+void SwarmAgent::sendOctreeQuery() {
+    _octreeQuery.setCameraPosition(_viewFrustum.getPosition());
+    _octreeQuery.setCameraOrientation(_viewFrustum.getOrientation());
+    _octreeQuery.setCameraFov(_viewFrustum.getFieldOfView());
+    _octreeQuery.setCameraAspectRatio(_viewFrustum.getAspectRatio());
+    _octreeQuery.setCameraNearClip(_viewFrustum.getNearClip());
+    _octreeQuery.setCameraFarClip(_viewFrustum.getFarClip());
+    _octreeQuery.setCameraEyeOffsetPosition(_viewFrustum.getEyeOffsetPosition());
+
+    unsigned char queryPacket[MAX_PACKET_SIZE];
+    int packetLength = populatePacketHeader(reinterpret_cast<char*>(queryPacket), PacketTypeVoxelQuery, _sessionUUID);
+    packetLength += _octreeQuery.getBroadcastData(queryPacket + packetLength);
+
+    bool hasSent = false;
+    QHash<QUuid, SwarmServer>::iterator server = _servers.begin();
+    while (server != _servers.end()) {
+        if (server->type == NodeType::VoxelServer && !server->activeSocket.isNull()) {
+            QByteArray packet(reinterpret_cast<const char*>(queryPacket), packetLength);
+            writeToServer(packet, server.value());
+            hasSent = true;
+        }
+        ++server;
+    }
+
+    if (hasSent) {
+        _queriesSent++;
+    }
+}
+
+void SwarmAgent::sendVoxelEdit(quint64 now) {
+    // a voxel at our feet, in the color of the moment
+    glm::vec3 position = _avatar.getPosition() / (float)TREE_SCALE;
+    float size = EDIT_VOXEL_METERS / TREE_SCALE;
+    unsigned char* voxelCode = pointToVoxel(position.x, position.y, position.z, size,
+                                            randIntInRange(0, 255), randIntInRange(0, 255), randIntInRange(0, 255));
+    int voxelCodeLength = bytesRequiredForCodeLength(*voxelCode) + SIZE_OF_COLOR_DATA;
+
+    bool hasSent = false;
+    QHash<QUuid, SwarmServer>::iterator server = _servers.begin();
+    while (server != _servers.end()) {
+        if (server->type == NodeType::VoxelServer && !server->activeSocket.isNull()) {
+            // laid out like OctreeEditPacketSender's, one edit per packet
+            QByteArray editPacket = byteArrayWithPopulatedHeader(PacketTypeVoxelSet, _sessionUUID);
+            editPacket.append(reinterpret_cast<const char*>(&server->outgoingSequenceNumber), sizeof(quint16));
+            editPacket.append(reinterpret_cast<const char*>(&now), sizeof(quint64));
+            editPacket.append(reinterpret_cast<const char*>(voxelCode), voxelCodeLength);
+            server->outgoingSequenceNumber++;
+
+            writeToServer(editPacket, server.value());
+            hasSent = true;
+        }
+        ++server;
+    }
+    delete[] voxelCode;
+
+    if (hasSent) {
+        _editsSent++;
+    }
+}
+
+static QJsonObject statsForMinMaxAvg(const MovingMinMaxAvg<quint64>& stats) {
+    QJsonObject object;
+    object["min"] = (double)stats.getMin();
+    object["avg"] = stats.getAverage();
+    object["max"] = (double)stats.getMax();
+    return object;
+}
+
+QJsonObject SwarmAgent::getStats() const {
+    QJsonObject stats;
+    stats["index"] = _index;
+    stats["connected"] = isConnected();
+    if (isConnected()) {
+        stats["connect_msecs"] = (double)(_connectedAt - _startedAt) / USECS_PER_MSEC;
+    }
+    stats["audio_frames_sent"] = _audioFramesSent;
+    stats["avatar_packets_sent"] = _avatarPacketsSent;
+    stats["queries_sent"] = _queriesSent;
+    stats["edits_sent"] = _editsSent;
+    stats["avatar_packets_received"] = _avatarPacketsReceived;
+
+    QJsonArray servers;
+    QHash<QUuid, SwarmServer>::const_iterator server = _servers.constBegin();
+    while (server != _servers.constEnd()) {
+        QJsonObject serverStats;
+        serverStats["type"] = NodeType::getNodeTypeName(server->type);
+        serverStats["uuid"] = uuidStringWithoutCurlyBraces(server.key());
+        serverStats["active"] = !server->activeSocket.isNull();
+        serverStats["packets_received"] = server->packetsReceived;
+        serverStats["bytes_received"] = (double)server->bytesReceived;
+        serverStats["ping_usecs"] = statsForMinMaxAvg(server->pingUsecs);
+
+        const SequenceNumberStats& sequenceStats = server->inboundSequenceNumberStats;
+        if (sequenceStats.getReceived() > 0) {
+            QJsonObject sequenced;
+            sequenced["received"] = (double)sequenceStats.getReceived();
+            sequenced["expected"] = (double)sequenceStats.getExpectedReceived();
+            sequenced["lost"] = (double)sequenceStats.getLost();
+            sequenced["out_of_order"] = (double)sequenceStats.getOutOfOrder();
+            sequenced["unreasonable"] = (double)sequenceStats.getUnreasonable();
+            serverStats["sequenced"] = sequenced;
+        }
+        if (server->type == NodeType::AudioMixer) {
+            serverStats["gap_usecs"] = statsForMinMaxAvg(server->inboundGapUsecs);
+        } else if (server->type == NodeType::VoxelServer) {
+            serverStats["flight_usecs"] = statsForMinMaxAvg(server->flightUsecs);
+            if (server->sceneUsecs.getMax() > 0) {
+                serverStats["scene_usecs"] = statsForMinMaxAvg(server->sceneUsecs);
+                serverStats["useful_scene_usecs"] = statsForMinMaxAvg(server->usefulSceneUsecs);
+            }
+        }
+        servers.append(serverStats);
+        ++server;
+    }
+    stats["servers"] = servers;
+
+    return stats;
+}
@@ -0,0 +1,153 @@
+//
+//  SwarmAgent.h
+//  tools/agent-swarm/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#ifndef hifi_SwarmAgent_h
+#define hifi_SwarmAgent_h
+
+#include <QtCore/QHash>
+#include <QtCore/QJsonObject>
+#include <QtCore/QObject>
+#include <QtCore/QSet>
+#include <QtNetwork/QUdpSocket>
+
+#include <AvatarData.h>
+#include <HifiSockAddr.h>
+#include <MovingMinMaxAvg.h>
+#include <Node.h>
+#include <OctreeQuery.h>
+#include <SequenceNumberStats.h>
+#include <ViewFrustum.h>
+
+namespace SwarmAudio {
+    enum Pattern {
+        Tone,    // a steady tone
+        Silence, // silent frames, which keep the stream open without any mixing to do
+        Talk     // bursts of tone between silences, like people taking turns
+    };
+}
+
+class SwarmOptions {
+public:
+    HifiSockAddr domainSockAddr;
+    SwarmAudio::Pattern audioPattern;
+    float editsPerSecond;
+    bool holdStill; // stand and look the same way, so that the voxel servers get to finish their scenes
+};
+
+/// A server from the domain list, as one agent sees it
+class SwarmServer {
+public:
+    SwarmServer();
+
+    NodeType_t type;
+    QUuid connectionSecret;
+    HifiSockAddr publicSocket;
+    HifiSockAddr localSocket;
+    HifiSockAddr activeSocket; // null until the server answered a local or public ping
+
+    quint16 outgoingSequenceNumber;
+    SequenceNumberStats inboundSequenceNumberStats;
+    MovingMinMaxAvg<quint64> pingUsecs;
+    MovingMinMaxAvg<quint64> flightUsecs; // of the octree packets, that carry the time they were sent
+    MovingMinMaxAvg<quint64> sceneUsecs; // how long the full scenes took to send, from their stats
+    MovingMinMaxAvg<quint64> usefulSceneUsecs; // how long until what matters most to the view of each was sent
+    quint64 lastInboundAt;
+    MovingMinMaxAvg<quint64> inboundGapUsecs;
+    int packetsReceived;
+    qint64 bytesReceived;
+};
+
+/// One simulated client. It connects to the domain like interface does, and then does what a person would: talks into
+/// the microphone, walks around and looks at the voxels in front of it, and now and then edits one. All of it goes out
+/// of its own socket, so the servers see it as a separate node, and everything that comes back can be told apart from
+/// what comes back to the other agents.
+class SwarmAgent : public QObject {
+    Q_OBJECT
+public:
+    SwarmAgent(int index, const SwarmOptions& options, QObject* parent = 0);
+
+    /// \return false if the agent couldn't get a socket
+    bool isReady() const { return _isReady; }
+
+    bool isConnected() const { return !_sessionUUID.isNull(); }
+
+    /// sends whatever is due at the given time, called by the worker every few msecs
+    void update(quint64 now);
+
+    /// forgets everything measured so far, at the end of the warmup
+    void resetStats();
+
+    QJsonObject getStats() const;
+
+    /// the agent's own numbers, summed into the report totals
+    int getAudioFramesSent() const { return _audioFramesSent; }
+    int getAvatarPacketsSent() const { return _avatarPacketsSent; }
+    int getQueriesSent() const { return _queriesSent; }
+    int getEditsSent() const { return _editsSent; }
+    const QHash<QUuid, SwarmServer>& getServers() const { return _servers; }
+
+private slots:
+    void readPendingDatagrams();
+
+private:
+    void checkInWithDomain();
+    void processDomainList(const QByteArray& packet);
+    void pingServers(quint64 now);
+    void processPing(const QByteArray& packet, const HifiSockAddr& senderSockAddr);
+    void processPingReply(const QByteArray& packet, quint64 now);
+    void processMixedAudio(SwarmServer& server, const QByteArray& packet, quint64 now);
+    void processOctreeData(SwarmServer& server, const QByteArray& packet, quint64 now);
+
+    void move(quint64 now);
+    void sendAudioFrame(quint64 now);
+    void sendAvatarData();
+    void sendOctreeQuery();
+    void sendVoxelEdit(quint64 now);
+
+    void writeToServer(QByteArray& packet, const SwarmServer& server);
+
+    int _index;
+    SwarmOptions _options;
+    bool _isReady;
+    QUdpSocket* _socket;
+
+    QUuid _sessionUUID;
+    quint32 _domainListVersion;
+    quint32 _pendingDomainListVersion;
+    QSet<quint16> _pendingDomainListParts;
+    QHash<QUuid, SwarmServer> _servers;
+    quint64 _connectedAt;
+    quint64 _startedAt;
+
+    // when each kind of packet is next due
+    quint64 _nextCheckInAt;
+    quint64 _nextAudioFrameAt;
+    quint64 _nextAvatarDataAt;
+    quint64 _nextQueryAt;
+    quint64 _nextEditAt;
+
+    // what the agent does
+    AvatarData _avatar;
+    ViewFrustum _viewFrustum;
+    OctreeQuery _octreeQuery;
+    glm::vec3 _walkCenter;
+    float _walkPhase;
+    float _tonePhase;
+    float _toneFrequency;
+    quint64 _talkPhaseUsecs;
+
+    int _audioFramesSent;
+    int _avatarPacketsSent;
+    int _queriesSent;
+    int _editsSent;
+    int _avatarPacketsReceived;
+};
+
+#endif // hifi_SwarmAgent_h
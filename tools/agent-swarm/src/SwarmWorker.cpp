@@ -0,0 +1,82 @@
+//
+//  SwarmWorker.cpp
+//  tools/agent-swarm/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#include <SharedUtil.h>
+
+#include "SwarmWorker.h"
+
+// a fraction of an audio frame, so that an agent's frames go out close to when they're due
+const int SWARM_UPDATE_INTERVAL_MSECS = 2;
+
+SwarmWorker::SwarmWorker(int firstIndex, int numAgents, const SwarmOptions& options) :
+    QObject(),
+    _firstIndex(firstIndex),
+    _numAgents(numAgents),
+    _options(options),
+    _agents(),
+    _updateTimer(NULL)
+{
+}
+
+int SwarmWorker::getNumConnectedAgents() const {
+    int numConnected = 0;
+    foreach (SwarmAgent* agent, _agents) {
+        if (agent->isConnected()) {
+            numConnected++;
+        }
+    }
+    return numConnected;
+}
+
+QJsonArray SwarmWorker::getAgentStats() const {
+    QJsonArray stats;
+    foreach (SwarmAgent* agent, _agents) {
+        stats.append(agent->getStats());
+    }
+    return stats;
+}
+
+void SwarmWorker::start() {
+    for (int i = 0; i < _numAgents; i++) {
+        SwarmAgent* agent = new SwarmAgent(_firstIndex + i, _options, this);
+        if (!agent->isReady()) {
+            // most likely out of file descriptors, more agents won't fare any better
+            delete agent;
+            break;
+        }
+        _agents.append(agent);
+    }
+
+    _updateTimer = new QTimer(this);
+    _updateTimer->setTimerType(Qt::PreciseTimer);
+    connect(_updateTimer, &QTimer::timeout, this, &SwarmWorker::updateAgents);
+    _updateTimer->start(SWARM_UPDATE_INTERVAL_MSECS);
+
+    emit started(_agents.size());
+}
+
+void SwarmWorker::resetStats() {
+    foreach (SwarmAgent* agent, _agents) {
+        agent->resetStats();
+    }
+}
+
+void SwarmWorker::stop() {
+    if (_updateTimer) {
+        _updateTimer->stop();
+    }
+}
+
+void SwarmWorker::updateAgents() {
+    quint64 now = usecTimestampNow();
+    foreach (SwarmAgent* agent, _agents) {
+        agent->update(now);
+    }
+}
@@ -0,0 +1,55 @@
+//
+//  SwarmWorker.h
+//  tools/agent-swarm/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#ifndef hifi_SwarmWorker_h
+#define hifi_SwarmWorker_h
+
+#include <QtCore/QJsonArray>
+#include <QtCore/QObject>
+#include <QtCore/QTimer>
+#include <QtCore/QVector>
+
+#include "SwarmAgent.h"
+
+/// Runs a share of the agents on its own thread. The agents are made on that thread so their sockets belong to its
+/// event loop, and one timer there gives each of them its turn to send.
+class SwarmWorker : public QObject {
+    Q_OBJECT
+public:
+    /// \param firstIndex the index of the first of this worker's agents in the whole swarm
+    SwarmWorker(int firstIndex, int numAgents, const SwarmOptions& options);
+
+    int getNumReadyAgents() const { return _agents.size(); }
+    int getNumConnectedAgents() const;
+
+    /// only once the worker's thread has finished
+    QJsonArray getAgentStats() const;
+    const QVector<SwarmAgent*>& getAgents() const { return _agents; }
+
+public slots:
+    void start();
+    void resetStats();
+    void stop();
+
+signals:
+    void started(int numReadyAgents);
+
+private slots:
+    void updateAgents();
+
+private:
+    int _firstIndex;
+    int _numAgents;
+    SwarmOptions _options;
+    QVector<SwarmAgent*> _agents;
+    QTimer* _updateTimer;
+};
+
+#endif // hifi_SwarmWorker_h
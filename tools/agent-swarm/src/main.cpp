@@ -0,0 +1,86 @@
+//
+//  main.cpp
+//  tools/agent-swarm/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+
+#include <iostream>
+
+#include <QCoreApplication>
+#include <QThread>
+
+#include <DomainHandler.h>
+#include <HifiConfigVariantMap.h>
+#include <LimitedNodeList.h>
+
+#include "AgentSwarm.h"
+
+using namespace std;
+
+const int DEFAULT_NUM_AGENTS = 100;
+const int DEFAULT_WARMUP_SECS = 10;
+const int DEFAULT_DURATION_SECS = 60;
+
+int main (int argc, char** argv) {
+    QCoreApplication app(argc, argv);
+
+    const QVariantMap argumentVariantMap = HifiConfigVariantMap::mergeCLParametersWithJSONConfig(app.arguments());
+
+    if (argumentVariantMap.contains("help")) {
+        cerr << "Usage: agent-swarm [--agents N] [--threads N] [--domain hostname] [--audio tone|silence|talk]" << endl;
+        cerr << "                   [--edits per-second] [--warmup secs] [--duration secs] [--report file]" << endl;
+        cerr << "                   [--pids pid,pid,...] [--holdStill]" << endl;
+        cerr << "Runs agents against a domain and writes a JSON report of what they measured, and of the CPU time" << endl;
+        cerr << "of the given servers, or of the domain-server and assignment-clients running on this machine." << endl;
+        return 0;
+    }
+
+    int numAgents = argumentVariantMap.value("agents", DEFAULT_NUM_AGENTS).toInt();
+    int numThreads = argumentVariantMap.value("threads", QThread::idealThreadCount()).toInt();
+    int warmupSecs = argumentVariantMap.value("warmup", DEFAULT_WARMUP_SECS).toInt();
+    int durationSecs = argumentVariantMap.value("duration", DEFAULT_DURATION_SECS).toInt();
+    if (numAgents <= 0 || durationSecs <= 0 || warmupSecs < 0) {
+        cerr << "There has to be at least one agent, running for at least a second" << endl;
+        return 1;
+    }
+
+    SwarmOptions options;
+    options.domainSockAddr = HifiSockAddr(argumentVariantMap.value("domain", "localhost").toString(),
+                                          DEFAULT_DOMAIN_SERVER_PORT);
+    if (options.domainSockAddr.getAddress().isNull()) {
+        cerr << "Failed to look up the domain" << endl;
+        return 1;
+    }
+
+    QString audioPattern = argumentVariantMap.value("audio", "talk").toString();
+    if (audioPattern == "tone") {
+        options.audioPattern = SwarmAudio::Tone;
+    } else if (audioPattern == "silence") {
+        options.audioPattern = SwarmAudio::Silence;
+    } else if (audioPattern == "talk") {
+        options.audioPattern = SwarmAudio::Talk;
+    } else {
+        cerr << "The audio pattern is one of tone, silence or talk" << endl;
+        return 1;
+    }
+
+    options.editsPerSecond = argumentVariantMap.value("edits", 0.0f).toFloat();
+    options.holdStill = argumentVariantMap.contains("holdStill");
+
+    QList<qint64> serverPids;
+    foreach (const QString& pid, argumentVariantMap.value("pids").toString().split(',', QString::SkipEmptyParts)) {
+        serverPids.append(pid.toLongLong());
+    }
+
+    // packet headers we don't give a UUID get the node list's, the agents always give theirs
+    LimitedNodeList::createInstance();
+
+    AgentSwarm swarm(numAgents, numThreads, options, warmupSecs, durationSecs,
+                     argumentVariantMap.value("report").toString(), serverPids);
+    QObject::connect(&swarm, SIGNAL(finished()), &app, SLOT(quit()));
+
+    return app.exec();
+}
@@ -0,0 +1,415 @@
+//
+//  DatagramReplayer.cpp
+//  tools/datagram-replay/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#include <algorithm>
+#include <iostream>
+
+#include <QtCore/QDataStream>
+#include <QtCore/QVariantMap>
+
+#include <DomainHandler.h>
+#include <LimitedNodeList.h>
+#include <PacketHeaders.h>
+#include <SharedUtil.h>
+
+#include "DatagramReplayer.h"
+
+using namespace std;
+
+const int REPLAY_TIMER_INTERVAL_MSECS = 1;
+
+// at full speed the event loop still gets a turn after this many datagrams, so pings and stats are answered
+const int MAX_DATAGRAMS_PER_FULL_SPEED_PASS = 256;
+
+// once the capture runs out the assignment-client gets this long to send the stats for the last of it
+const int STATS_DRAIN_MSECS = 2500;
+
+const quint32 REPLAY_DOMAIN_LIST_VERSION = 1;
+
+DatagramReplayer::DatagramReplayer(const QString& logFilename, float speed, int warmupMsecs, QObject* parent) :
+    QObject(parent),
+    _log(),
+    _speed(speed),
+    _warmupMsecs(warmupMsecs),
+    _isReady(false),
+    _socket(this),
+    _assignmentType(Assignment::AllTypes),
+    _sessionUUID(),
+    _assignmentClientSockAddr(),
+    _fakeNodes(),
+    _capturedUsecs(0),
+    _capturedFirstInboundAt(0),
+    _capturedInboundDatagrams(0),
+    _capturedOutboundDatagrams(0),
+    _capturedOutboundBytes(0),
+    _replayTimer(this),
+    _isReplaying(false),
+    _hasPendingRecord(false),
+    _pendingRecord(),
+    _replayStartedAt(0),
+    _replayEndedAt(0),
+    _datagramsReplayed(0),
+    _bytesReplayed(0),
+    _datagramsReceived(0),
+    _bytesReceived(0),
+    _frameUsecsP50(),
+    _frameUsecsP90(),
+    _frameUsecsP99(),
+    _frameUsecsMax(0.0f),
+    _numFrames(0)
+{
+    if (!_log.open(logFilename)) {
+        cerr << "Failed to open datagram log " << qPrintable(logFilename) << ": " << qPrintable(_log.getErrorString()) << endl;
+        return;
+    }
+
+    _assignmentType = Assignment::typeForNodeType(_log.getOwnerType());
+    if (_assignmentType == Assignment::AllTypes) {
+        cerr << "The datagram log wasn't captured by an assignment" << endl;
+        return;
+    }
+
+    scanLog();
+    if (_fakeNodes.isEmpty()) {
+        cerr << "The datagram log has no datagrams from other nodes to replay" << endl;
+        return;
+    }
+
+    // we are the domain-server the assignment-client asks for its assignment
+    if (!_socket.bind(QHostAddress::AnyIPv4, DEFAULT_DOMAIN_SERVER_PORT)) {
+        cerr << "Failed to bind the domain-server port " << DEFAULT_DOMAIN_SERVER_PORT << ": "
+            << qPrintable(_socket.errorString()) << endl;
+        return;
+    }
+    connect(&_socket, &QUdpSocket::readyRead, this, &DatagramReplayer::readPendingDatagrams);
+
+    _replayTimer.setTimerType(Qt::PreciseTimer);
+    _replayTimer.setInterval(_speed > 0.0f ? REPLAY_TIMER_INTERVAL_MSECS : 0);
+    connect(&_replayTimer, &QTimer::timeout, this, &DatagramReplayer::sendDueDatagrams);
+
+    cout << "Replaying " << _capturedInboundDatagrams << " datagrams from " << _fakeNodes.size() << " nodes over "
+        << (float) _capturedUsecs / USECS_PER_SECOND << "s of capture to a "
+        << qPrintable(NodeType::getNodeTypeName(_log.getOwnerType())) << " - waiting for its assignment-client on port "
+        << DEFAULT_DOMAIN_SERVER_PORT << endl;
+
+    _isReady = true;
+}
+
+static bool isReplayedType(PacketType type) {
+    // pings are answered live, anything else a node sent goes out again as it was
+    return type != PacketTypePing && type != PacketTypePingReply;
+}
+
+void DatagramReplayer::scanLog() {
+    quint64 firstTimestamp = 0;
+    quint64 lastTimestamp = 0;
+
+    DatagramLogRecord record;
+    while (_log.readNext(record)) {
+        if (firstTimestamp == 0) {
+            firstTimestamp = record.timestamp;
+        }
+        lastTimestamp = std::max(lastTimestamp, record.timestamp);
+
+        if (record.direction == DatagramDirection::Outbound) {
+            _capturedOutboundDatagrams++;
+            _capturedOutboundBytes += record.datagram.size();
+
+        } else if (record.nodeType != NodeType::Unassigned && !record.senderUUID.isNull()
+                   && isReplayedType(packetTypeForPacket(record.datagram))) {
+            // anything that came from a node we knew is played by a node of ours, the domain-server's is our own job
+            if (!_fakeNodes.contains(record.senderUUID)) {
+                FakeNode fakeNode;
+                fakeNode.type = record.nodeType;
+                fakeNode.connectionSecret = QUuid::createUuid();
+                _fakeNodes.insert(record.senderUUID, fakeNode);
+            }
+            if (_capturedFirstInboundAt == 0) {
+                _capturedFirstInboundAt = record.timestamp;
+            }
+            _capturedInboundDatagrams++;
+        }
+    }
+    _capturedUsecs = lastTimestamp - firstTimestamp;
+
+    if (!_log.getErrorString().isEmpty()) {
+        cerr << "Replaying what there is of the datagram log: " << qPrintable(_log.getErrorString()) << endl;
+    }
+    _log.rewind();
+}
+
+void DatagramReplayer::readPendingDatagrams() {
+    QByteArray receivedPacket;
+    HifiSockAddr senderSockAddr;
+
+    while (_socket.hasPendingDatagrams()) {
+        receivedPacket.resize(_socket.pendingDatagramSize());
+        _socket.readDatagram(receivedPacket.data(), receivedPacket.size(),
+                             senderSockAddr.getAddressPointer(), senderSockAddr.getPortPointer());
+
+        if (receivedPacket.size() < numBytesForPacketHeader(receivedPacket)) {
+            continue;
+        }
+
+        switch (packetTypeForPacket(receivedPacket)) {
+            case PacketTypeRequestAssignment:
+                sendAssignment(receivedPacket, senderSockAddr);
+                break;
+            case PacketTypeDomainConnectRequest:
+            case PacketTypeDomainListRequest:
+                sendDomainList(receivedPacket, senderSockAddr);
+                break;
+            case PacketTypePing:
+                sendPingReply(receivedPacket, senderSockAddr);
+                break;
+            case PacketTypeNodeJsonStats:
+                takeStats(receivedPacket);
+                break;
+            default:
+                // whatever the assignment-client sends our nodes
+                if (_isReplaying) {
+                    _datagramsReceived++;
+                    _bytesReceived += receivedPacket.size();
+                }
+                break;
+        }
+    }
+}
+
+void DatagramReplayer::sendAssignment(const QByteArray& packet, const HifiSockAddr& senderSockAddr) {
+    if (_isReplaying || _replayEndedAt > 0) {
+        // one assignment-client per replay
+        return;
+    }
+
+    Assignment requestAssignment(packet);
+    if (requestAssignment.getType() != Assignment::AllTypes && requestAssignment.getType() != _assignmentType) {
+        cerr << "Ignoring a request for a " << requestAssignment.getTypeName() << ", the capture is of a "
+            << qPrintable(NodeType::getNodeTypeName(_log.getOwnerType())) << endl;
+        return;
+    }
+
+    Assignment assignment(Assignment::CreateCommand, _assignmentType);
+    assignment.resetUUID();
+
+    QByteArray assignmentPacket = byteArrayWithPopulatedHeader(PacketTypeCreateAssignment);
+    QDataStream assignmentStream(&assignmentPacket, QIODevice::Append);
+    assignmentStream << assignment;
+
+    _socket.writeDatagram(assignmentPacket, senderSockAddr.getAddress(), senderSockAddr.getPort());
+}
+
+void DatagramReplayer::sendDomainList(const QByteArray& packet, const HifiSockAddr& senderSockAddr) {
+    QDataStream packetStream(packet);
+    packetStream.skipRawData(numBytesForPacketHeader(packet));
+
+    NodeType_t ownerType;
+    HifiSockAddr publicSockAddr, localSockAddr;
+    quint8 numInterests = 0;
+    packetStream >> ownerType >> publicSockAddr >> localSockAddr >> numInterests;
+
+    NodeSet interests;
+    for (int i = 0; i < numInterests; i++) {
+        NodeType_t interest;
+        packetStream >> interest;
+        interests.insert(interest);
+    }
+
+    if (_sessionUUID.isNull()) {
+        _sessionUUID = QUuid::createUuid();
+        _assignmentClientSockAddr = senderSockAddr;
+
+        cout << "The assignment-client at " << qPrintable(senderSockAddr.getAddress().toString()) << ":"
+            << senderSockAddr.getPort() << " connected, replaying in " << _warmupMsecs << "ms" << endl;
+
+        // give it the time to ping our nodes, and for them to answer, before their datagrams come
+        QTimer::singleShot(_warmupMsecs, this, SLOT(startReplay()));
+    }
+
+    // the whole list every time, our nodes are all at our own socket
+    HifiSockAddr nodeSockAddr(QHostAddress::LocalHost, _socket.localPort());
+
+    QList<QByteArray> listEntries;
+    for (QHash<QUuid, FakeNode>::const_iterator node = _fakeNodes.constBegin(); node != _fakeNodes.constEnd(); node++) {
+        if (interests.contains(node.value().type)) {
+            QByteArray entry(1, DOMAIN_LIST_NODE_ENTRY);
+            QDataStream entryStream(&entry, QIODevice::Append);
+            entryStream << node.value().type << node.key() << nodeSockAddr << nodeSockAddr
+                << node.value().connectionSecret;
+            listEntries.append(entry);
+        }
+    }
+
+    QByteArray listPacketHeader = byteArrayWithPopulatedHeader(PacketTypeDomainList);
+    QDataStream listPacketHeaderStream(&listPacketHeader, QIODevice::Append);
+    listPacketHeaderStream << _sessionUUID << REPLAY_DOMAIN_LIST_VERSION << (quint8) true;
+    int numListPacketLeadBytes = listPacketHeader.size() + 2 * sizeof(quint16);
+
+    QList<QByteArray> listParts;
+    QByteArray listPart;
+    foreach (const QByteArray& entry, listEntries) {
+        if (numListPacketLeadBytes + listPart.size() + entry.size() > MAX_PACKET_SIZE && !listPart.isEmpty()) {
+            listParts.append(listPart);
+            listPart.clear();
+        }
+        listPart.append(entry);
+    }
+    listParts.append(listPart);
+
+    for (int i = 0; i < listParts.size(); i++) {
+        QByteArray listPacket = listPacketHeader;
+        QDataStream listPacketStream(&listPacket, QIODevice::Append);
+        listPacketStream << (quint16) i << (quint16) listParts.size();
+        listPacket.append(listParts[i]);
+
+        _socket.writeDatagram(listPacket, senderSockAddr.getAddress(), senderSockAddr.getPort());
+    }
+}
+
+void DatagramReplayer::sendPingReply(const QByteArray& packet, const HifiSockAddr& senderSockAddr) {
+    // all our nodes share the socket, the ping is for the one whose secret it was hashed with
+    for (QHash<QUuid, FakeNode>::const_iterator node = _fakeNodes.constBegin(); node != _fakeNodes.constEnd(); node++) {
+        if (packetHashMatchesConnectionUUID(packet.constData(), packet.size(), node.value().connectionSecret)) {
+            QDataStream pingStream(packet);
+            pingStream.skipRawData(numBytesForPacketHeader(packet));
+
+            quint8 pingType;
+            quint64 timeFromOriginalPing;
+            pingStream >> pingType >> timeFromOriginalPing;
+
+            QByteArray replyPacket = byteArrayWithPopulatedHeader(PacketTypePingReply, node.key());
+            QDataStream replyStream(&replyPacket, QIODevice::Append);
+            replyStream << pingType << timeFromOriginalPing << usecTimestampNow();
+
+            replaceHashInPacketGivenConnectionUUID(replyPacket, node.value().connectionSecret);
+            _socket.writeDatagram(replyPacket, senderSockAddr.getAddress(), senderSockAddr.getPort());
+            return;
+        }
+    }
+}
+
+void DatagramReplayer::takeStats(const QByteArray& packet) {
+    if (!_isReplaying) {
+        return;
+    }
+
+    QDataStream statsStream(packet);
+    statsStream.skipRawData(numBytesForPacketHeader(packet));
+
+    QVariantMap stats;
+    statsStream >> stats;
+
+    // see ThreadedAssignment::frameCompleted
+    if (stats.contains("frame_usecs_p50")) {
+        _frameUsecsP50.append(stats.value("frame_usecs_p50").toFloat());
+        _frameUsecsP90.append(stats.value("frame_usecs_p90").toFloat());
+        _frameUsecsP99.append(stats.value("frame_usecs_p99").toFloat());
+        _frameUsecsMax = std::max(_frameUsecsMax, stats.value("frame_usecs_max").toFloat());
+        _numFrames += stats.value("frames").toInt();
+    }
+}
+
+void DatagramReplayer::startReplay() {
+    if (_speed > 0.0f) {
+        cout << "Replaying at " << _speed << "x" << endl;
+    } else {
+        cout << "Replaying as fast as possible" << endl;
+    }
+
+    _isReplaying = true;
+    _replayStartedAt = usecTimestampNow();
+    _replayTimer.start();
+}
+
+void DatagramReplayer::sendDueDatagrams() {
+    quint64 now = usecTimestampNow();
+    int numSentThisPass = 0;
+
+    while (true) {
+        if (!_hasPendingRecord) {
+            if (!_log.readNext(_pendingRecord)) {
+                // the capture ran out, wait for the stats that cover its end
+                _replayTimer.stop();
+                _replayEndedAt = now;
+                QTimer::singleShot(STATS_DRAIN_MSECS, this, SLOT(finishReplay()));
+                return;
+            }
+
+            PacketType packetType = packetTypeForPacket(_pendingRecord.datagram);
+            _hasPendingRecord = _pendingRecord.direction == DatagramDirection::Inbound
+                && _fakeNodes.contains(_pendingRecord.senderUUID) && isReplayedType(packetType);
+            if (!_hasPendingRecord) {
+                continue;
+            }
+        }
+
+        if (_speed > 0.0f) {
+            quint64 capturedOffset = (_pendingRecord.timestamp > _capturedFirstInboundAt)
+                ? _pendingRecord.timestamp - _capturedFirstInboundAt : 0;
+            if (now < _replayStartedAt + (quint64)(capturedOffset / _speed)) {
+                return;
+            }
+        } else if (numSentThisPass == MAX_DATAGRAMS_PER_FULL_SPEED_PASS) {
+            return;
+        }
+
+        QByteArray& datagram = _pendingRecord.datagram;
+        if (!NON_VERIFIED_PACKETS.contains(packetTypeForPacket(datagram))) {
+            // signed by our node now, instead of the one captured
+            replaceHashInPacketGivenConnectionUUID(datagram, _fakeNodes.value(_pendingRecord.senderUUID).connectionSecret);
+        }
+        _socket.writeDatagram(datagram, _assignmentClientSockAddr.getAddress(), _assignmentClientSockAddr.getPort());
+
+        _datagramsReplayed++;
+        _bytesReplayed += datagram.size();
+        numSentThisPass++;
+        _hasPendingRecord = false;
+    }
+}
+
+static float median(QVector<float> values) {
+    if (values.isEmpty()) {
+        return 0.0f;
+    }
+    QVector<float>::iterator middle = values.begin() + values.size() / 2;
+    std::nth_element(values.begin(), middle, values.end());
+    return *middle;
+}
+
+void DatagramReplayer::printReport() {
+    float replaySeconds = (float)(_replayEndedAt - _replayStartedAt) / USECS_PER_SECOND;
+    float receiveSeconds = replaySeconds + STATS_DRAIN_MSECS / 1000.0f;
+    float capturedSeconds = (float) _capturedUsecs / USECS_PER_SECOND;
+
+    cout << endl << "Replayed " << _datagramsReplayed << " datagrams (" << _bytesReplayed << " bytes) in " << replaySeconds
+        << "s, " << (replaySeconds > 0.0f ? _datagramsReplayed / replaySeconds : 0.0f) << " per second" << endl;
+
+    cout << "The assignment-client sent " << (receiveSeconds > 0.0f ? _datagramsReceived / receiveSeconds : 0.0f)
+        << " datagrams and " << (receiveSeconds > 0.0f ? _bytesReceived / receiveSeconds : 0.0f)
+        << " bytes per second, it sent " << (capturedSeconds > 0.0f ? _capturedOutboundDatagrams / capturedSeconds : 0.0f)
+        << " datagrams and " << (capturedSeconds > 0.0f ? _capturedOutboundBytes / capturedSeconds : 0.0f)
+        << " bytes per second during the capture" << endl;
+
+    if (_frameUsecsP50.isEmpty()) {
+        cout << "The assignment-client didn't report any frame times" << endl;
+        return;
+    }
+
+    // the percentiles come a second at a time, so the typical second's p50 and p90 and the worst second's p99
+    cout << _numFrames << " frames, frame time p50 " << median(_frameUsecsP50) << "us, p90 " << median(_frameUsecsP90)
+        << "us, p99 " << *std::max_element(_frameUsecsP99.begin(), _frameUsecsP99.end()) << "us, max "
+        << _frameUsecsMax << "us" << endl;
+}
+
+void DatagramReplayer::finishReplay() {
+    _isReplaying = false;
+    printReport();
+    emit finished();
+}
@@ -0,0 +1,103 @@
+//
+//  DatagramReplayer.h
+//  tools/datagram-replay/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+//
+
+#ifndef hifi_DatagramReplayer_h
+#define hifi_DatagramReplayer_h
+
+#include <QtCore/QHash>
+#include <QtCore/QObject>
+#include <QtCore/QTimer>
+#include <QtCore/QVector>
+#include <QtNetwork/QUdpSocket>
+
+#include <Assignment.h>
+#include <DatagramLog.h>
+#include <HifiSockAddr.h>
+
+/// A node from the capture, played by the replayer
+class FakeNode {
+public:
+    NodeType_t type;
+    QUuid connectionSecret;
+};
+
+/// Drives an assignment-client on this machine with the inbound datagrams of a capture. The replayer stands in for the
+/// domain-server: it hands the assignment-client the captured assignment, and lists the nodes that sent the captured
+/// datagrams as nodes at its own socket, each with a new connection secret. It answers pings as those nodes, and
+/// once the assignment-client is up sends their datagrams on the captured schedule, sped up by the given factor, or as
+/// fast as it can. When the capture runs out it reports what the assignment-client sent back, and the frame times
+/// from its stats packets.
+class DatagramReplayer : public QObject {
+    Q_OBJECT
+public:
+    /// \param speed how many times faster than captured to replay, 0 for as fast as possible
+    DatagramReplayer(const QString& logFilename, float speed, int warmupMsecs, QObject* parent = 0);
+
+    /// \return false if the log couldn't be read or the domain-server port couldn't be bound
+    bool isReady() const { return _isReady; }
+
+signals:
+    void finished();
+
+private slots:
+    void readPendingDatagrams();
+    void startReplay();
+    void sendDueDatagrams();
+    void finishReplay();
+
+private:
+    void scanLog();
+
+    void sendAssignment(const QByteArray& packet, const HifiSockAddr& senderSockAddr);
+    void sendDomainList(const QByteArray& packet, const HifiSockAddr& senderSockAddr);
+    void sendPingReply(const QByteArray& packet, const HifiSockAddr& senderSockAddr);
+    void takeStats(const QByteArray& packet);
+
+    void printReport();
+
+    DatagramLogReader _log;
+    float _speed;
+    int _warmupMsecs;
+    bool _isReady;
+
+    QUdpSocket _socket;
+    Assignment::Type _assignmentType;
+    QUuid _sessionUUID; // of the assignment-client, once it connected
+    HifiSockAddr _assignmentClientSockAddr;
+    QHash<QUuid, FakeNode> _fakeNodes;
+
+    // what the capture holds
+    quint64 _capturedUsecs;
+    quint64 _capturedFirstInboundAt;
+    int _capturedInboundDatagrams;
+    int _capturedOutboundDatagrams;
+    qint64 _capturedOutboundBytes;
+
+    // the replay
+    QTimer _replayTimer;
+    bool _isReplaying;
+    bool _hasPendingRecord;
+    DatagramLogRecord _pendingRecord;
+    quint64 _replayStartedAt;
+    quint64 _replayEndedAt;
+    int _datagramsReplayed;
+    qint64 _bytesReplayed;
+
+    // what the assignment-client did meanwhile
+    int _datagramsReceived;
+    qint64 _bytesReceived;
+    QVector<float> _frameUsecsP50;
+    QVector<float> _frameUsecsP90;
+    QVector<float> _frameUsecsP99;
+    float _frameUsecsMax;
+    int _numFrames;
+};
+
+#endif // hifi_DatagramReplayer_h
@@ -0,0 +1,58 @@
+//
+//  main.cpp
+//  tools/datagram-replay/src
+//
+//  Copyright 2014 High Fidelity, Inc.
+//
+//  Distributed under the Apache License, Version 2.0.
+//  See the accompanying file LICENSE or http://www.apache.org/licenses/LICENSE-2.0.html
+
+#include <iostream>
+
+#include <QCoreApplication>
+
+#include <HifiConfigVariantMap.h>
+#include <LimitedNodeList.h>
+
+#include "DatagramReplayer.h"
+
+using namespace std;
+
+const int DEFAULT_WARMUP_MSECS = 3000;
+
+int main (int argc, char** argv) {
+    QCoreApplication app(argc, argv);
+    
+    if (argc < 2) {
+        cerr << "Usage: datagram-replay logfile [--speed multiplier|max] [--warmup msecs]" << endl;
+        cerr << "Capture the log with assignment-client --captureDatagrams logfile, then run this and an" << endl;
+        cerr << "assignment-client with no domain-server running on this machine." << endl;
+        return 0;
+    }
+    
+    const QVariantMap argumentVariantMap = HifiConfigVariantMap::mergeCLParametersWithJSONConfig(app.arguments());
+    
+    // 0 replays as fast as possible
+    float speed = 1.0f;
+    if (argumentVariantMap.contains("speed")) {
+        QString speedString = argumentVariantMap.value("speed").toString();
+        speed = (speedString == "max") ? 0.0f : speedString.toFloat();
+        if (speed < 0.0f) {
+            cerr << "The speed can't be negative" << endl;
+            return 1;
+        }
+    }
+    
+    int warmupMsecs = argumentVariantMap.value("warmup", DEFAULT_WARMUP_MSECS).toInt();
+    
+    // packet headers we don't give a UUID get the node list's, which is null for us like it is for a domain-server
+    LimitedNodeList::createInstance();
+    
+    DatagramReplayer replayer(argv[1], speed, warmupMsecs);
+    if (!replayer.isReady()) {
+        return 1;
+    }
+    QObject::connect(&replayer, SIGNAL(finished()), &app, SLOT(quit()));
+    
+    return app.exec();
+}
@@ -15,6 +15,8 @@
 #include <JurisdictionMap.h>
 #include <QString>
 #include <QStringList>
+#include <QThread>
+#include <QVector>
 
 
 int _nodeCount=0;
@@ -236,6 +238,93 @@ void processFillSVOFile(const char* fillSVOFile) {
     qDebug("exiting now");
 }
 
+// Writes an SVO file of randomly placed voxels, then times reading it on one thread and on as many as there are cores
+void benchmarkSVOLoad(int voxelCount) {
+    const char* BENCHMARK_SVO_FILE = "benchmark.svo";
+    const float BENCHMARK_VOXEL_SIZE = 1.0f / 4096.0f;
+
+    qDebug("Generating %d voxels...", voxelCount);
+    {
+        VoxelTree generatedSVO;
+        for (int i = 0; i < voxelCount; i++) {
+            generatedSVO.createVoxel(randFloat(), randFloat(), randFloat(), BENCHMARK_VOXEL_SIZE,
+                                     randomColorValue(), randomColorValue(), randomColorValue());
+        }
+        qDebug("Nodes after generating %lu nodes", generatedSVO.getOctreeElementsCount());
+        generatedSVO.writeToSVOFile(BENCHMARK_SVO_FILE);
+    }
+
+    const int NUMBER_OF_RUNS = 2;
+    int readThreads[NUMBER_OF_RUNS] = { 1, QThread::idealThreadCount() };
+    for (int run = 0; run < NUMBER_OF_RUNS; run++) {
+        unsigned long nodeCountBefore = OctreeElement::getNodeCount();
+        VoxelTree loadedSVO;
+
+        quint64 start = usecTimestampNow();
+        loadedSVO.readFromSVOFile(BENCHMARK_SVO_FILE, readThreads[run]);
+        quint64 elapsed = usecTimestampNow() - start;
+
+        qDebug("Read with %d threads in %llu usecs, %lu nodes, %lu nodes counted", readThreads[run], elapsed,
+               loadedSVO.getOctreeElementsCount(), OctreeElement::getNodeCount() - nodeCountBefore);
+    }
+}
+
+// Applies edits to the voxels of a tree of randomly placed voxels, as the voxel server does, and looks them all up,
+// without the tree's element index and then with it
+void benchmarkElementIndex(int voxelCount) {
+    const float BENCHMARK_VOXEL_SIZE = 1.0f / 4096.0f;
+
+    qDebug("Generating %d voxels...", voxelCount);
+    VoxelTree tree;
+    QVector<glm::vec3> corners;
+    for (int i = 0; i < voxelCount; i++) {
+        glm::vec3 corner(randFloat(), randFloat(), randFloat());
+        tree.createVoxel(corner.x, corner.y, corner.z, BENCHMARK_VOXEL_SIZE,
+                         randomColorValue(), randomColorValue(), randomColorValue());
+        corners.append(corner);
+    }
+    qDebug("Nodes after generating %lu nodes", tree.getOctreeElementsCount());
+
+    // the edits are in the form they arrive in from the network, each recoloring one of the voxels
+    QVector<unsigned char*> edits;
+    foreach (const glm::vec3& corner, corners) {
+        edits.append(pointToVoxel(corner.x, corner.y, corner.z, BENCHMARK_VOXEL_SIZE,
+                                  randomColorValue(), randomColorValue(), randomColorValue()));
+    }
+
+    const int NUMBER_OF_RUNS = 2;
+    bool useElementIndex[NUMBER_OF_RUNS] = { false, true };
+    for (int run = 0; run < NUMBER_OF_RUNS; run++) {
+        tree.lockForWrite();
+        tree.setUseElementIndex(useElementIndex[run]);
+
+        quint64 start = usecTimestampNow();
+        foreach (unsigned char* edit, edits) {
+            int editBytes = bytesRequiredForCodeLength(numberOfThreeBitSectionsInCode(edit)) + SIZE_OF_COLOR_DATA;
+            tree.processEditPacketData(PacketTypeVoxelSet, edit, editBytes, edit, editBytes, SharedNodePointer());
+        }
+        quint64 editUsecs = usecTimestampNow() - start;
+
+        start = usecTimestampNow();
+        int foundCount = 0;
+        foreach (const glm::vec3& corner, corners) {
+            if (tree.getVoxelAt(corner.x, corner.y, corner.z, BENCHMARK_VOXEL_SIZE)) {
+                foundCount++;
+            }
+        }
+        quint64 lookupUsecs = usecTimestampNow() - start;
+
+        tree.unlock();
+
+        qDebug("%s the element index: %d edits in %llu usecs, %d of %d voxels found in %llu usecs",
+               useElementIndex[run] ? "With" : "Without", edits.size(), editUsecs, foundCount, corners.size(), lookupUsecs);
+    }
+
+    foreach (unsigned char* edit, edits) {
+        delete[] edit;
+    }
+}
+
 void unitTest(VoxelTree * tree);
 
 
@@ -327,6 +416,22 @@ int main(int argc, const char * argv[])
         return 0;
     }
 
+    // Times reading a generated SVO file serially and in parallel
+    const char* BENCHMARK_SVO_LOAD = "--benchmarkSVOLoad";
+    const char* benchmarkVoxelCount = getCmdOption(argc, argv, BENCHMARK_SVO_LOAD);
+    if (benchmarkVoxelCount) {
+        benchmarkSVOLoad(QString(benchmarkVoxelCount).toInt());
+        return 0;
+    }
+
+    // Times applying edits and looking voxels up with and without the element index
+    const char* BENCHMARK_ELEMENT_INDEX = "--benchmarkElementIndex";
+    const char* benchmarkIndexVoxelCount = getCmdOption(argc, argv, BENCHMARK_ELEMENT_INDEX);
+    if (benchmarkIndexVoxelCount) {
+        benchmarkElementIndex(QString(benchmarkIndexVoxelCount).toInt());
+        return 0;
+    }
+
     const char* DONT_CREATE_FILE = "--dontCreateSceneFile";
     bool dontCreateFile = cmdOptionExists(argc, argv, DONT_CREATE_FILE);
 